@@ -0,0 +1,901 @@
+/*
+ * Cycle microbenchmarks of the building blocks shipped in this repo.
+ *
+ * Each primitive runs a number of times between two current_cycles
+ * syscalls, the cost of that syscall pair is measured first and subtracted.
+ * Results are printed through ckb_debug, one JSON object per line:
+ *
+ * {"primitive":"blake2b_update","unit":"128 B block","runs":64,
+ *  "cycles":192000,"per_run":3000,"bound":3000}
+ *
+ * bound is the matching model of c/cycle_model.h, or 0 when there is none.
+ * A per_run above its bound fails the benchmark, since the bounds printed
+ * by build/cycle_bound rest on these models.
+ *
+ * Run it in ckb-debugger as a lock script, with the sighash library, its
+ * prelinked image, the multisig library, the Ed25519 library, the receipt
+ * proof library, build/secp256k1_data and build/ed25519_data as cell deps.
+ * Built with CKB_BENCH_SCHNORR, as SCHNORR=1 does, it also measures the
+ * Schnorr library, which is then a cell dep too.
+ */
+#include "blake2b.h"
+#include "blockchain.h"
+#include "ckb_loader.h"
+#include "ckb_syscalls.h"
+#include "current_cycles.h"
+#include "cycle_model.h"
+#include "ed25519_data_info.h"
+#include "ed25519_lib.h"
+#include "ed25519_table.h"
+#include "eth_receipt_proof_lib.h"
+#include "eth_receipt_proof_table.h"
+#include "keccak256.h"
+#include "rlp.h"
+#include "secp256k1_blake2b_multisig_all_lib.h"
+#include "secp256k1_blake2b_multisig_all_table.h"
+#include "secp256k1_blake2b_sighash_all_lib.h"
+#include "secp256k1_blake2b_sighash_all_lib_prelinked.h"
+#include "secp256k1_blake2b_sighash_all_table.h"
+#include "secp256k1_helper.h"
+#ifdef CKB_BENCH_SCHNORR
+#include "secp256k1_schnorr_sighash_all_lib.h"
+#include "secp256k1_schnorr_sighash_all_table.h"
+#endif
+#include "sha256.h"
+
+#define ERROR_BENCH_FAILED -120
+#define ERROR_BOUND_EXCEEDED -121
+
+#define HASH_BLOCKS 64
+#define BLAKE2B_BLOCK 128
+#define SHA256_BLOCK 64
+#define KECCAK256_BLOCK 136
+#define BLAKE2B_HASH_SIZE 32
+#define MOLECULE_RUNS 100
+#define DIGEST_RUNS 16
+#define SYMBOL_RUNS 16
+#define SECP_INIT_RUNS 3
+#define SECP_RECOVER_RUNS 4
+#define INVERSE_RUNS 16
+#define PUBKEY_SIZE 33
+#define BLAKE160_SIZE 20
+#define RECID_INDEX 64
+/* Committee size the MuSig2 lock is compared at */
+#define COMMITTEE_SIZE 8
+#define COMMITTEE_UNIT "committee of 8"
+/* Thresholds of the multisig sweep, each an M of M config */
+#define MULTISIG_SWEEP 5
+#define MULTISIG_MAX 16
+#define MULTISIG_LOCK_SIZE                        \
+  (SECP256K1_MULTISIG_CONFIG_SIZE(MULTISIG_MAX) + \
+   MULTISIG_MAX * SECP256K1_MULTISIG_SIGNATURE_SIZE)
+#define ED25519_RUNS 4
+#define ED25519_BATCH 16
+#define ED25519_BATCH_UNIT "signature in a batch of 16"
+/* Receipt proofs of 1 to 4 nodes for the key of transaction 0x81 */
+#define RECEIPT_PROOF_DEPTH 4
+#define RECEIPT_PROOF_RUNS 4
+#define RECEIPT_TX_INDEX 0x81
+#define RECEIPT_KEY_NIBBLES 4
+#define RECEIPT_TYPE 2
+#define TRIE_NODE_SIZE 640
+#define BRANCH_ITEMS 17
+#define LEAF_ITEMS 2
+#define ARGS_SIZE 76
+#define LOCK_SIZE 97
+#define SCRIPT_ITEMS 3
+#define WITNESS_ARGS_ITEMS 3
+
+#define CODE_SIZE (128 * 1024)
+#define PRELINKED_CODE_SIZE (100 * 1024)
+#define OUTPUT_SIZE 256
+
+#define SIGHASH_ALL_SYMBOL "validate_secp256k1_blake2b_sighash_all"
+
+/* What the libraries return for the signatures below, see bench_committee */
+#define SIGHASH_ALL_ERROR_PUBKEY_BLAKE160_HASH -54
+#ifdef CKB_BENCH_SCHNORR
+#define SCHNORR_ERROR_VERIFY -53
+#endif
+
+/* Same placement as in htlc, the prelinked image is relocated for it */
+static uint8_t prelinked_code_buffer[PRELINKED_CODE_SIZE]
+    __attribute__((section(".dl_arena"), aligned(RISCV_PGSIZE)));
+static uint8_t code_buffer[CODE_SIZE] __attribute__((aligned(RISCV_PGSIZE)));
+#ifdef CKB_BENCH_SCHNORR
+static uint8_t schnorr_code_buffer[CODE_SIZE]
+    __attribute__((aligned(RISCV_PGSIZE)));
+#endif
+static uint8_t multisig_code_buffer[CODE_SIZE]
+    __attribute__((aligned(RISCV_PGSIZE)));
+static uint8_t multisig_lock[MULTISIG_LOCK_SIZE];
+static uint8_t ed25519_code_buffer[CODE_SIZE]
+    __attribute__((aligned(RISCV_PGSIZE)));
+static uint8_t receipt_proof_code_buffer[CODE_SIZE]
+    __attribute__((aligned(RISCV_PGSIZE)));
+static uint8_t ed25519_data[CKB_ED25519_DATA_SIZE];
+static uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+/* Big enough for the largest block, keccak256's rate */
+static uint8_t hash_input[HASH_BLOCKS * KECCAK256_BLOCK + 1];
+
+/* Cost of the current_cycles syscall pair around a measurement */
+static uint64_t overhead = 0;
+static int exceeded = 0;
+
+static const secp256k1_blake2b_sighash_all_table_t *sighash_table = NULL;
+/* What compact_signature recovers to, see bench_secp256k1 */
+static uint8_t recovered_pubkey[PUBKEY_SIZE];
+
+/*
+ * Recovery succeeds for any r that is the x coordinate of a curve point,
+ * the generator's is used here, and costs the same as for a real
+ * signature. For the same reason it serves as x-only pubkey and as r of a
+ * Schnorr signature, whose verification runs to the end before failing.
+ */
+static const uint8_t compact_signature[64] = {
+    0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62,
+    0x95, 0xce, 0x87, 0x0b, 0x07, 0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce,
+    0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98, 0x12,
+    0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78,
+    0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde,
+    0xf0, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0};
+
+static uint64_t elapsed(uint64_t start) {
+  uint64_t cycles = ckb_current_cycles() - start;
+  return cycles > overhead ? cycles - overhead : 0;
+}
+
+static void append(char *buffer, size_t *pos, const char *s) {
+  while (*s != '\0' && *pos < OUTPUT_SIZE - 1) {
+    buffer[(*pos)++] = *s++;
+  }
+  buffer[*pos] = '\0';
+}
+
+static void append_u64(char *buffer, size_t *pos, uint64_t value) {
+  char digits[21];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n > 0 && *pos < OUTPUT_SIZE - 1) {
+    buffer[(*pos)++] = digits[--n];
+  }
+  buffer[*pos] = '\0';
+}
+
+static void report(const char *primitive, const char *unit, uint64_t runs,
+                   uint64_t cycles, uint64_t bound) {
+  uint64_t per_run = cycles / runs;
+  char buffer[OUTPUT_SIZE];
+  size_t pos = 0;
+  append(buffer, &pos, "{\"primitive\":\"");
+  append(buffer, &pos, primitive);
+  append(buffer, &pos, "\",\"unit\":\"");
+  append(buffer, &pos, unit);
+  append(buffer, &pos, "\",\"runs\":");
+  append_u64(buffer, &pos, runs);
+  append(buffer, &pos, ",\"cycles\":");
+  append_u64(buffer, &pos, cycles);
+  append(buffer, &pos, ",\"per_run\":");
+  append_u64(buffer, &pos, per_run);
+  append(buffer, &pos, ",\"bound\":");
+  append_u64(buffer, &pos, bound);
+  append(buffer, &pos, "}");
+  ckb_debug(buffer);
+  if (bound != 0 && per_run > bound) {
+    exceeded = 1;
+  }
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+/* Script { code_hash, hash_type, args } with 76 bytes of args, as htlc */
+static size_t build_script(uint8_t *p) {
+  size_t header = 4 * (SCRIPT_ITEMS + 1);
+  size_t total = header + 32 + 1 + 4 + ARGS_SIZE;
+  memset(p, 0x11, total);
+  write_u32(p, total);
+  write_u32(p + 4, header);
+  write_u32(p + 8, header + 32);
+  write_u32(p + 12, header + 33);
+  p[header + 32] = 0;
+  write_u32(p + header + 33, ARGS_SIZE);
+  return total;
+}
+
+/* WitnessArgs with a signature and a 32 byte preimage as lock */
+static size_t build_witness_args(uint8_t *p) {
+  size_t header = 4 * (WITNESS_ARGS_ITEMS + 1);
+  size_t total = header + 4 + LOCK_SIZE;
+  memset(p, 0x22, total);
+  write_u32(p, total);
+  write_u32(p + 4, header);
+  write_u32(p + 8, total);
+  write_u32(p + 12, total);
+  write_u32(p + header, LOCK_SIZE);
+  return total;
+}
+
+static void bench_blake2b() {
+  blake2b_state state;
+  uint8_t hash[BLAKE2B_HASH_SIZE];
+
+  /* A leading byte makes the update compress every measured block */
+  blake2b_init(&state, BLAKE2B_HASH_SIZE);
+  blake2b_update(&state, hash_input, 1);
+  uint64_t start = ckb_current_cycles();
+  blake2b_update(&state, &hash_input[1], HASH_BLOCKS * BLAKE2B_BLOCK);
+  report("blake2b_update", "128 B block", HASH_BLOCKS, elapsed(start),
+         CKB_CYCLES_BLAKE2B_BLOCK);
+
+  uint64_t init = 0, final = 0;
+  for (int i = 0; i < DIGEST_RUNS; i++) {
+    start = ckb_current_cycles();
+    blake2b_init(&state, BLAKE2B_HASH_SIZE);
+    init += elapsed(start);
+    blake2b_update(&state, hash_input, BLAKE2B_HASH_SIZE);
+    start = ckb_current_cycles();
+    blake2b_final(&state, hash, BLAKE2B_HASH_SIZE);
+    final += elapsed(start);
+  }
+  report("blake2b_init", "digest", DIGEST_RUNS, init, 0);
+  report("blake2b_final", "digest", DIGEST_RUNS, final, 0);
+  report("blake2b_init_final", "digest", DIGEST_RUNS, init + final,
+         CKB_CYCLES_BLAKE2B_FIXED);
+}
+
+static void bench_sha256() {
+  SHA256_CTX ctx;
+  sha256_init(&ctx);
+  uint64_t start = ckb_current_cycles();
+  sha256_update(&ctx, hash_input, HASH_BLOCKS * SHA256_BLOCK);
+  report("sha256_update", "64 B block", HASH_BLOCKS, elapsed(start),
+         CKB_CYCLES_SHA256_BLOCK);
+}
+
+/* The unrolled keccak-f[1600] of deps/keccak256.h, one call per block */
+static void bench_keccak256() {
+  keccak256_ctx_t ctx;
+  uint8_t hash[KECCAK256_HASH_SIZE];
+  keccak256_init(&ctx);
+  uint64_t start = ckb_current_cycles();
+  keccak256_update(&ctx, hash_input, HASH_BLOCKS * KECCAK256_BLOCK);
+  report("keccak256_update", "136 B block", HASH_BLOCKS, elapsed(start),
+         CKB_CYCLES_KECCAK256_BLOCK);
+
+  uint64_t cycles = 0;
+  for (int i = 0; i < DIGEST_RUNS; i++) {
+    start = ckb_current_cycles();
+    keccak256_init(&ctx);
+    keccak256_update(&ctx, hash_input, KECCAK256_HASH_SIZE);
+    keccak256_final(&ctx, hash);
+    cycles += elapsed(start);
+  }
+  report("keccak256", "32 B digest", DIGEST_RUNS, cycles,
+         CKB_CYCLES_KECCAK256_FIXED);
+}
+
+static int bench_molecule() {
+  uint8_t script[128];
+  mol_seg_t script_seg;
+  script_seg.ptr = script;
+  script_seg.size = build_script(script);
+  uint64_t start = ckb_current_cycles();
+  for (int i = 0; i < MOLECULE_RUNS; i++) {
+    if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("MolReader_Script_verify", "call", MOLECULE_RUNS, elapsed(start),
+         CKB_CYCLES_MOLECULE_FIXED + SCRIPT_ITEMS * CKB_CYCLES_MOLECULE_ITEM);
+
+  uint8_t witness[128];
+  mol_seg_t witness_seg;
+  witness_seg.ptr = witness;
+  witness_seg.size = build_witness_args(witness);
+  start = ckb_current_cycles();
+  for (int i = 0; i < MOLECULE_RUNS; i++) {
+    if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("MolReader_WitnessArgs_verify", "call", MOLECULE_RUNS,
+         elapsed(start),
+         CKB_CYCLES_MOLECULE_FIXED +
+             WITNESS_ARGS_ITEMS * CKB_CYCLES_MOLECULE_ITEM);
+  return CKB_SUCCESS;
+}
+
+/* Loaded code pages are frozen, so each loader runs once */
+static int bench_loader() {
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  uint64_t start = ckb_current_cycles();
+  int ret = ckb_loader_open(secp256k1_blake2b_sighash_all_data_hash,
+                            code_buffer, CODE_SIZE, &handle, &consumed_size);
+  uint64_t cycles = elapsed(start);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  report("ckb_loader_open", "sighash library", 1, cycles, 0);
+
+  start = ckb_current_cycles();
+  for (int i = 0; i < SYMBOL_RUNS; i++) {
+    if (ckb_loader_sym(handle, SIGHASH_ALL_SYMBOL) == NULL) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("ckb_loader_sym", "lookup", SYMBOL_RUNS, elapsed(start),
+         CKB_CYCLES_SYMBOL_LOOKUP);
+
+  start = ckb_current_cycles();
+  ret = ckb_loader_open_prelinked(
+      secp256k1_blake2b_sighash_all_prelinked_data_hash, prelinked_code_buffer,
+      ROUNDDOWN(PRELINKED_CODE_SIZE, RISCV_PGSIZE), &handle, &consumed_size);
+  cycles = elapsed(start);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  report("ckb_loader_open_prelinked", "sighash library", 1, cycles, 0);
+
+  sighash_table =
+      ckb_loader_table(handle, SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE,
+                       SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_VERSION,
+                       sizeof(secp256k1_blake2b_sighash_all_table_t));
+  if (sighash_table == NULL) {
+    return ERROR_BENCH_FAILED;
+  }
+  return CKB_SUCCESS;
+}
+
+static int bench_secp256k1() {
+  secp256k1_context context;
+  uint64_t start = ckb_current_cycles();
+  for (int i = 0; i < SECP_INIT_RUNS; i++) {
+    if (ckb_secp256k1_custom_verify_only_initialize(&context, secp_data) !=
+        0) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("ckb_secp256k1_custom_verify_only_initialize", "call",
+         SECP_INIT_RUNS, elapsed(start), 0);
+
+  /*
+   * The constant time inverses of the library against the safegcd ones
+   * secp256k1_helper.h substitutes for recovery and verification. Each
+   * run inverts the previous result, starting from r of the signature
+   * below, and both paths must agree.
+   */
+  secp256k1_scalar scalar, scalar_inverse, scalar_inverse_var;
+  secp256k1_scalar_set_b32(&scalar, compact_signature, NULL);
+  scalar_inverse = scalar;
+  start = ckb_current_cycles();
+  for (int i = 0; i < INVERSE_RUNS; i++) {
+    secp256k1_scalar_inverse(&scalar_inverse, &scalar_inverse);
+  }
+  report("secp256k1_scalar_inverse", "call", INVERSE_RUNS, elapsed(start), 0);
+  scalar_inverse_var = scalar;
+  start = ckb_current_cycles();
+  for (int i = 0; i < INVERSE_RUNS; i++) {
+    secp256k1_scalar_inverse_var(&scalar_inverse_var, &scalar_inverse_var);
+  }
+  report("secp256k1_scalar_inverse_var", "call", INVERSE_RUNS, elapsed(start),
+         0);
+  secp256k1_scalar_inverse(&scalar_inverse, &scalar_inverse);
+  secp256k1_scalar_inverse_var(&scalar_inverse_var, &scalar_inverse_var);
+  if (!secp256k1_scalar_eq(&scalar_inverse, &scalar_inverse_var)) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  secp256k1_fe fe, fe_inverse, fe_inverse_var;
+  if (!secp256k1_fe_set_b32(&fe, compact_signature)) {
+    return ERROR_BENCH_FAILED;
+  }
+  fe_inverse = fe;
+  start = ckb_current_cycles();
+  for (int i = 0; i < INVERSE_RUNS; i++) {
+    secp256k1_fe_inv(&fe_inverse, &fe_inverse);
+  }
+  report("secp256k1_fe_inv", "call", INVERSE_RUNS, elapsed(start), 0);
+  fe_inverse_var = fe;
+  start = ckb_current_cycles();
+  for (int i = 0; i < INVERSE_RUNS; i++) {
+    secp256k1_fe_inv_var(&fe_inverse_var, &fe_inverse_var);
+  }
+  report("secp256k1_fe_inv_var", "call", INVERSE_RUNS, elapsed(start), 0);
+  secp256k1_fe_inv(&fe_inverse, &fe_inverse);
+  secp256k1_fe_inv_var(&fe_inverse_var, &fe_inverse_var);
+  if (!secp256k1_fe_equal_var(&fe_inverse, &fe_inverse_var)) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  uint8_t message[32];
+  memset(message, 0x33, sizeof(message));
+  secp256k1_ecdsa_recoverable_signature signature;
+  if (secp256k1_ecdsa_recoverable_signature_parse_compact(
+          &context, &signature, compact_signature, 0) == 0) {
+    return ERROR_BENCH_FAILED;
+  }
+  secp256k1_pubkey pubkey;
+  start = ckb_current_cycles();
+  for (int i = 0; i < SECP_RECOVER_RUNS; i++) {
+    if (secp256k1_ecdsa_recover(&context, &pubkey, &signature, message) != 1) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("secp256k1_ecdsa_recover", "call", SECP_RECOVER_RUNS,
+         elapsed(start), 0);
+
+  /*
+   * The two ways the sighash library checks a signer: recovery plus
+   * serialize, or parse plus verify of a pubkey taken from the witness. The
+   * recovered pubkey is the one the signature verifies against.
+   */
+  uint8_t serialized[PUBKEY_SIZE];
+  size_t serialized_size = PUBKEY_SIZE;
+  start = ckb_current_cycles();
+  for (int i = 0; i < SECP_RECOVER_RUNS; i++) {
+    if (secp256k1_ecdsa_recover(&context, &pubkey, &signature, message) != 1 ||
+        secp256k1_ec_pubkey_serialize(&context, serialized, &serialized_size,
+                                      &pubkey, SECP256K1_EC_COMPRESSED) != 1) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("secp256k1_recover_serialize", "signer", SECP_RECOVER_RUNS,
+         elapsed(start), CKB_CYCLES_SECP_RECOVER);
+  memcpy(recovered_pubkey, serialized, PUBKEY_SIZE);
+
+  secp256k1_ecdsa_signature plain_signature;
+  if (secp256k1_ecdsa_recoverable_signature_convert(&context, &plain_signature,
+                                                    &signature) == 0) {
+    return ERROR_BENCH_FAILED;
+  }
+  start = ckb_current_cycles();
+  for (int i = 0; i < SECP_RECOVER_RUNS; i++) {
+    if (secp256k1_ec_pubkey_parse(&context, &pubkey, serialized,
+                                  PUBKEY_SIZE) != 1 ||
+        secp256k1_ecdsa_verify(&context, &plain_signature, message, &pubkey) !=
+            1) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("secp256k1_parse_verify", "signer", SECP_RECOVER_RUNS,
+         elapsed(start), CKB_CYCLES_SECP_VERIFY);
+
+#ifdef CKB_BENCH_SCHNORR
+  /* The x-only pubkey parse plus BIP340 verify of the Schnorr library */
+  secp256k1_xonly_pubkey xonly_pubkey;
+  start = ckb_current_cycles();
+  for (int i = 0; i < SECP_RECOVER_RUNS; i++) {
+    if (secp256k1_xonly_pubkey_parse(&context, &xonly_pubkey,
+                                     compact_signature) != 1 ||
+        secp256k1_schnorrsig_verify(&context, compact_signature, message,
+                                    &xonly_pubkey) != 0) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("secp256k1_xonly_parse_schnorr_verify", "signer", SECP_RECOVER_RUNS,
+         elapsed(start), CKB_CYCLES_SECP_SCHNORR_VERIFY);
+#endif
+  return CKB_SUCCESS;
+}
+
+/*
+ * A committee of COMMITTEE_SIZE signers checked the way a lock without
+ * aggregation would, one validate_secp256k1_blake2b_sighash_all call per
+ * signer, against the single Schnorr verification of the MuSig2 lock,
+ * which keeps the secp256k1 tables in its context as c/musig_lock.c does,
+ * when built with CKB_BENCH_SCHNORR.
+ * Both fail only after their last step, see compact_signature.
+ */
+static int bench_committee() {
+  uint8_t witness[128];
+  size_t witness_len = build_witness_args(witness);
+  uint8_t pubkey_hash[BLAKE160_SIZE];
+  memset(pubkey_hash, 0, sizeof(pubkey_hash));
+  uint8_t recoverable_signature[RECID_INDEX + 1];
+  memcpy(recoverable_signature, compact_signature, RECID_INDEX);
+  recoverable_signature[RECID_INDEX] = 0;
+
+  uint64_t start = ckb_current_cycles();
+  for (int i = 0; i < COMMITTEE_SIZE; i++) {
+    if (sighash_table->validate(pubkey_hash, recoverable_signature, witness,
+                                witness_len) !=
+        SIGHASH_ALL_ERROR_PUBKEY_BLAKE160_HASH) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("validate_secp256k1_blake2b_sighash_all", COMMITTEE_UNIT, 1,
+         elapsed(start), 0);
+
+#ifdef CKB_BENCH_SCHNORR
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  int ret = ckb_loader_open(secp256k1_schnorr_sighash_all_data_hash,
+                            schnorr_code_buffer, CODE_SIZE, &handle,
+                            &consumed_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  const secp256k1_schnorr_sighash_all_table_t *schnorr_table =
+      ckb_loader_table(handle, SECP256K1_SCHNORR_SIGHASH_ALL_TABLE,
+                       SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_VERSION,
+                       sizeof(secp256k1_schnorr_sighash_all_table_t));
+  if (schnorr_table == NULL) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  start = ckb_current_cycles();
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  ckb_tx_context_set_first_witness(&tx_ctx, witness, witness_len);
+  tx_ctx.secp_data = secp_data;
+  tx_ctx.secp_data_size = sizeof(secp_data);
+  if (schnorr_table->validate(&tx_ctx, compact_signature, compact_signature) !=
+      SCHNORR_ERROR_VERIFY) {
+    return ERROR_BENCH_FAILED;
+  }
+  report("validate_secp256k1_schnorr_sighash_all", COMMITTEE_UNIT, 1,
+         elapsed(start), 0);
+#endif
+  return CKB_SUCCESS;
+}
+
+static void blake160(const uint8_t *data, size_t size, uint8_t *hash) {
+  uint8_t full[BLAKE2B_HASH_SIZE];
+  blake2b_state state;
+  blake2b_init(&state, BLAKE2B_HASH_SIZE);
+  blake2b_update(&state, data, size);
+  blake2b_final(&state, full, BLAKE2B_HASH_SIZE);
+  memcpy(hash, full, BLAKE160_SIZE);
+}
+
+/*
+ * validate_secp256k1_blake2b_multisig_all over M of M configs for growing
+ * M, reported per signature. Every slot holds the signer of
+ * compact_signature, so each of the M signatures recovers, matches the
+ * next slot and the config is accepted. The secp256k1 tables and the
+ * sighash message are already in the context, as after a first call.
+ */
+static int bench_multisig() {
+  static const int thresholds[MULTISIG_SWEEP] = {1, 2, 4, 8, MULTISIG_MAX};
+  static const char *units[MULTISIG_SWEEP] = {
+      "signature of 1 of 1", "signature of 2 of 2", "signature of 4 of 4",
+      "signature of 8 of 8", "signature of 16 of 16"};
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  int ret = ckb_loader_open(secp256k1_blake2b_multisig_all_data_hash,
+                            multisig_code_buffer, CODE_SIZE, &handle,
+                            &consumed_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  const secp256k1_blake2b_multisig_all_table_t *table =
+      ckb_loader_table(handle, SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE,
+                       SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE_VERSION,
+                       sizeof(secp256k1_blake2b_multisig_all_table_t));
+  if (table == NULL) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  uint8_t witness[128];
+  size_t witness_len = build_witness_args(witness);
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  ckb_tx_context_set_first_witness(&tx_ctx, witness, witness_len);
+  tx_ctx.secp_data = secp_data;
+  tx_ctx.secp_data_size = sizeof(secp_data);
+
+  uint8_t pubkey_hash[BLAKE160_SIZE];
+  blake160(recovered_pubkey, PUBKEY_SIZE, pubkey_hash);
+  for (int m = 0; m < MULTISIG_SWEEP; m++) {
+    int threshold = thresholds[m];
+    multisig_lock[0] = 0;
+    multisig_lock[1] = 0;
+    multisig_lock[2] = threshold;
+    multisig_lock[3] = threshold;
+    size_t config_size = SECP256K1_MULTISIG_CONFIG_SIZE(threshold);
+    for (int i = 0; i < threshold; i++) {
+      memcpy(&multisig_lock[SECP256K1_MULTISIG_HEADER_SIZE +
+                            i * SECP256K1_MULTISIG_BLAKE160_SIZE],
+             pubkey_hash, BLAKE160_SIZE);
+      uint8_t *signature =
+          &multisig_lock[config_size + i * SECP256K1_MULTISIG_SIGNATURE_SIZE];
+      memcpy(signature, compact_signature, RECID_INDEX);
+      signature[RECID_INDEX] = 0;
+    }
+    size_t lock_size =
+        config_size + threshold * SECP256K1_MULTISIG_SIGNATURE_SIZE;
+    uint8_t config_hash[BLAKE160_SIZE];
+    blake160(multisig_lock, config_size, config_hash);
+
+    /* The first call loads the tables and digests the message */
+    if (m == 0 && table->validate(&tx_ctx, config_hash, multisig_lock,
+                                  lock_size) != CKB_SUCCESS) {
+      return ERROR_BENCH_FAILED;
+    }
+    uint64_t start = ckb_current_cycles();
+    if (table->validate(&tx_ctx, config_hash, multisig_lock, lock_size) !=
+        CKB_SUCCESS) {
+      return ERROR_BENCH_FAILED;
+    }
+    report("validate_secp256k1_blake2b_multisig_all", units[m], threshold,
+           elapsed(start), 0);
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Single Ed25519 verification against the per signature cost of a batch.
+ * The signature is test 1 of RFC 8032, over the empty message; a batch
+ * repeating it is valid and costs the same as distinct signatures.
+ */
+static int bench_ed25519() {
+  static const uint8_t pubkey[32] = {
+      0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe,
+      0xd3, 0xc9, 0x64, 0x07, 0x3a, 0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6,
+      0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a};
+  static const uint8_t signature[64] = {
+      0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2,
+      0xcc, 0x80, 0x6e, 0x82, 0x8a, 0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5,
+      0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55, 0x5f,
+      0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70,
+      0x1c, 0xf9, 0xb4, 0x6b, 0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe,
+      0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b};
+  ed25519_item_t items[ED25519_BATCH];
+  for (int i = 0; i < ED25519_BATCH; i++) {
+    items[i].pubkey = pubkey;
+    items[i].signature = signature;
+    items[i].message = signature;
+    items[i].message_len = 0;
+  }
+
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  int ret = ckb_loader_open(ed25519_data_hash, ed25519_code_buffer, CODE_SIZE,
+                            &handle, &consumed_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  const ed25519_table_t *table = ckb_loader_table(
+      handle, ED25519_TABLE, ED25519_TABLE_VERSION, sizeof(ed25519_table_t));
+  if (table == NULL) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  /* The first call loads the base point table into the context */
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  tx_ctx.ed25519_data = ed25519_data;
+  tx_ctx.ed25519_data_size = sizeof(ed25519_data);
+  if (table->verify(&tx_ctx, &items[0]) != CKB_SUCCESS) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  uint64_t start = ckb_current_cycles();
+  for (int i = 0; i < ED25519_RUNS; i++) {
+    if (table->verify(&tx_ctx, &items[i]) != CKB_SUCCESS) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("verify_ed25519", "signature", ED25519_RUNS, elapsed(start),
+         CKB_CYCLES_ED25519_VERIFY);
+
+  start = ckb_current_cycles();
+  if (table->verify_batch(&tx_ctx, items, ED25519_BATCH) != CKB_SUCCESS) {
+    return ERROR_BENCH_FAILED;
+  }
+  report("verify_ed25519_batch", ED25519_BATCH_UNIT, ED25519_BATCH,
+         elapsed(start), CKB_CYCLES_ED25519_BATCH_SIGNATURE);
+  return CKB_SUCCESS;
+}
+
+/* Wraps the len bytes at p into an RLP string or list in place */
+static size_t rlp_wrap(uint8_t *p, size_t len, uint8_t base) {
+  uint8_t header[3];
+  size_t header_size = 1;
+  if (base == RLP_STRING_SHORT && len == 1 && p[0] < RLP_STRING_SHORT) {
+    return len;
+  }
+  if (len <= RLP_SHORT_MAX) {
+    header[0] = base + len;
+  } else {
+    size_t length_size = len > 0xff ? 2 : 1;
+    header[0] = base + RLP_SHORT_MAX + length_size;
+    for (size_t i = 0; i < length_size; i++) {
+      header[1 + i] = (uint8_t)(len >> (8 * (length_size - 1 - i)));
+    }
+    header_size += length_size;
+  }
+  memmove(p + header_size, p, len);
+  memcpy(p, header, header_size);
+  return header_size + len;
+}
+
+static size_t rlp_put(uint8_t *p, uint8_t fill, size_t len) {
+  memset(p, fill, len);
+  return rlp_wrap(p, len, RLP_STRING_SHORT);
+}
+
+/*
+ * A successful typed receipt with the logs bloom and one lock event of
+ * three topics and 64 bytes of data, the leaf value of the proofs below.
+ */
+static size_t build_receipt(uint8_t *p) {
+  static const uint8_t gas_used[3] = {0x82, 0x52, 0x08};
+  size_t n = 0;
+  p[n++] = RECEIPT_TYPE;
+  size_t fields = n;
+  p[n++] = 0x01;
+  memcpy(&p[n], gas_used, sizeof(gas_used));
+  n += rlp_wrap(&p[n], sizeof(gas_used), RLP_STRING_SHORT);
+  n += rlp_put(&p[n], 0, 256);
+  size_t logs = n;
+  n += rlp_put(&p[n], 0xaa, ETH_ADDRESS_SIZE);
+  size_t topics = n;
+  for (int i = 0; i < 3; i++) {
+    n += rlp_put(&p[n], 0xbb + i, ETH_HASH_SIZE);
+  }
+  n = topics + rlp_wrap(&p[topics], n - topics, RLP_LIST_SHORT);
+  n += rlp_put(&p[n], 0xdd, 64);
+  n = logs + rlp_wrap(&p[logs], n - logs, RLP_LIST_SHORT);
+  n = logs + rlp_wrap(&p[logs], n - logs, RLP_LIST_SHORT);
+  n = fields + rlp_wrap(&p[fields], n - fields, RLP_LIST_SHORT);
+  return rlp_wrap(p, n, RLP_STRING_SHORT);
+}
+
+/*
+ * Proof of depth nodes, depth - 1 branches and the leaf, root first, and
+ * the bound of verifying it: hashing and decoding each node.
+ */
+static size_t build_receipt_proof(int depth, uint8_t *proof, uint8_t *root,
+                                  uint64_t *bound) {
+  /* RLP of RECEIPT_TX_INDEX is 0x81 0x81 */
+  static const uint8_t key_nibbles[RECEIPT_KEY_NIBBLES] = {8, 1, 8, 1};
+  static uint8_t nodes[RECEIPT_PROOF_DEPTH][TRIE_NODE_SIZE];
+  size_t sizes[RECEIPT_PROOF_DEPTH];
+
+  /* Leaf with the rest of the key, hex prefix encoded */
+  uint8_t *leaf = nodes[depth - 1];
+  int i = depth - 1;
+  size_t n = 0;
+  if ((RECEIPT_KEY_NIBBLES - i) & 1) {
+    leaf[n++] = 0x30 | key_nibbles[i++];
+  } else {
+    leaf[n++] = 0x20;
+  }
+  for (; i < RECEIPT_KEY_NIBBLES; i += 2) {
+    leaf[n++] = (key_nibbles[i] << 4) | key_nibbles[i + 1];
+  }
+  n = rlp_wrap(leaf, n, RLP_STRING_SHORT);
+  n += build_receipt(&leaf[n]);
+  sizes[depth - 1] = rlp_wrap(leaf, n, RLP_LIST_SHORT);
+  *bound = LEAF_ITEMS * CKB_CYCLES_RLP_ITEM;
+
+  /* Branches up to the root, the other 15 children are hashes too */
+  for (int d = depth - 2; d >= 0; d--) {
+    uint8_t child[KECCAK256_HASH_SIZE];
+    keccak256(nodes[d + 1], sizes[d + 1], child);
+    uint8_t *branch = nodes[d];
+    n = 0;
+    for (i = 0; i < BRANCH_ITEMS - 1; i++) {
+      size_t slot = rlp_put(&branch[n], 0x33, KECCAK256_HASH_SIZE);
+      if (i == key_nibbles[d]) {
+        memcpy(&branch[n + 1], child, KECCAK256_HASH_SIZE);
+      }
+      n += slot;
+    }
+    branch[n++] = RLP_STRING_SHORT;
+    sizes[d] = rlp_wrap(branch, n, RLP_LIST_SHORT);
+    *bound += BRANCH_ITEMS * CKB_CYCLES_RLP_ITEM;
+  }
+  keccak256(nodes[0], sizes[0], root);
+
+  n = 0;
+  for (int d = 0; d < depth; d++) {
+    memcpy(&proof[n], nodes[d], sizes[d]);
+    n += rlp_wrap(&proof[n], sizes[d], RLP_STRING_SHORT);
+    *bound += CKB_CYCLES_TRIE_NODE + CKB_CYCLES_KECCAK256_FIXED +
+              sizes[d] / KECCAK256_RATE * CKB_CYCLES_KECCAK256_BLOCK;
+  }
+  return rlp_wrap(proof, n, RLP_LIST_SHORT);
+}
+
+/* Receipt proofs of growing depth, then the lock event search */
+static int bench_receipt_proof() {
+  static const char *units[RECEIPT_PROOF_DEPTH] = {
+      "1 node proof", "2 node proof", "3 node proof", "4 node proof"};
+  static uint8_t proof[RECEIPT_PROOF_DEPTH * (TRIE_NODE_SIZE + 3) + 3];
+
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  int ret = ckb_loader_open(eth_receipt_proof_data_hash,
+                            receipt_proof_code_buffer, CODE_SIZE, &handle,
+                            &consumed_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  const eth_receipt_proof_table_t *table = ckb_loader_table(
+      handle, ETH_RECEIPT_PROOF_TABLE, ETH_RECEIPT_PROOF_TABLE_VERSION,
+      sizeof(eth_receipt_proof_table_t));
+  if (table == NULL) {
+    return ERROR_BENCH_FAILED;
+  }
+
+  eth_receipt_t receipt;
+  for (int depth = 1; depth <= RECEIPT_PROOF_DEPTH; depth++) {
+    uint8_t root[KECCAK256_HASH_SIZE];
+    uint64_t bound = 0;
+    size_t proof_size = build_receipt_proof(depth, proof, root, &bound);
+    uint64_t start = ckb_current_cycles();
+    for (int i = 0; i < RECEIPT_PROOF_RUNS; i++) {
+      if (table->verify_receipt(root, RECEIPT_TX_INDEX, proof, proof_size,
+                                &receipt) != CKB_SUCCESS) {
+        return ERROR_BENCH_FAILED;
+      }
+    }
+    report("verify_eth_receipt", units[depth - 1], RECEIPT_PROOF_RUNS,
+           elapsed(start), bound);
+  }
+
+  uint8_t address[ETH_ADDRESS_SIZE];
+  uint8_t topic[ETH_HASH_SIZE];
+  memset(address, 0xaa, sizeof(address));
+  memset(topic, 0xbb, sizeof(topic));
+  eth_log_t log;
+  uint64_t start = ckb_current_cycles();
+  for (int i = 0; i < RECEIPT_PROOF_RUNS; i++) {
+    if (table->find_log(&receipt, address, topic, 0, &log) != CKB_SUCCESS ||
+        receipt.type != RECEIPT_TYPE || log.topic_count != 3) {
+      return ERROR_BENCH_FAILED;
+    }
+  }
+  report("find_eth_log", "lock event", RECEIPT_PROOF_RUNS, elapsed(start), 0);
+  return CKB_SUCCESS;
+}
+
+int main() {
+  uint64_t start = ckb_current_cycles();
+  overhead = ckb_current_cycles() - start;
+  memset(hash_input, 0x5a, sizeof(hash_input));
+
+  bench_blake2b();
+  bench_sha256();
+  bench_keccak256();
+  int ret = bench_molecule();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_loader();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_secp256k1();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_committee();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_multisig();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_ed25519();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = bench_receipt_proof();
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return exceeded ? ERROR_BOUND_EXCEEDED : CKB_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/*
+ * Optional bundle of htlc, simple_udt, crosschain_lockscript and
+ * crosschain_typescript in a single binary.
+ *
+ * A transaction using several of these scripts then references one code
+ * cell, and the VM loads one ELF carrying one copy of molecule, the syscall
+ * wrappers and the other shared helpers. The first byte of the script args
+ * selects the entry (see c/bundle.h), the remaining bytes are the args of
+ * the selected script, unchanged.
+ *
+ * Each script is compiled into this translation unit with its main renamed.
+ */
+#define main htlc_main
+#include "htlc.c"
+#undef main
+
+#define main simple_udt_main
+#include "simple_udt.c"
+#undef main
+
+#define main crosschain_lockscript_main
+#include "crosschain_lockscript.c"
+#undef main
+
+#define main crosschain_typescript_main
+#include "crosschain_typescript.c"
+#undef main
+
+#define ERROR_BUNDLE_TAG -110
+
+/* Kept out of main so the script buffer is released before the entry runs */
+static __attribute__((noinline)) int load_bundle_tag(uint8_t *tag) {
+  unsigned char script[SCRIPT_SIZE];
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_load_script(script, &len, 0);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (len > SCRIPT_SIZE) {
+    return ERROR_SCRIPT_TOO_LONG;
+  }
+  mol_seg_t script_seg;
+  script_seg.ptr = (uint8_t *)script;
+  script_seg.size = len;
+
+  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  if (args_bytes_seg.size < BUNDLE_TAG_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+  *tag = args_bytes_seg.ptr[0];
+  return CKB_SUCCESS;
+}
+
+int main() {
+  uint8_t tag = 0;
+  int ret = load_bundle_tag(&tag);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  switch (tag) {
+    case BUNDLE_TAG_HTLC:
+      return htlc_main();
+    case BUNDLE_TAG_SIMPLE_UDT:
+      return simple_udt_main();
+    case BUNDLE_TAG_CROSSCHAIN_LOCKSCRIPT:
+      return crosschain_lockscript_main();
+    case BUNDLE_TAG_CROSSCHAIN_TYPESCRIPT:
+      return crosschain_typescript_main();
+    default:
+      return ERROR_BUNDLE_TAG;
+  }
+}
@@ -0,0 +1,43 @@
+/*
+ * Support for building several scripts into one binary, see c/bundle.c.
+ *
+ * In the bundle the first byte of the script args is a tag selecting the
+ * entry to run, every entry strips it before parsing its own args. In
+ * standalone builds this is a no-op.
+ */
+#ifndef CKB_BUNDLE_H_
+#define CKB_BUNDLE_H_
+
+#define BUNDLE_TAG_SIZE 1
+
+#define BUNDLE_TAG_HTLC 0
+#define BUNDLE_TAG_SIMPLE_UDT 1
+#define BUNDLE_TAG_CROSSCHAIN_LOCKSCRIPT 2
+#define BUNDLE_TAG_CROSSCHAIN_TYPESCRIPT 3
+
+/*
+ * A script deriving the args of another bundled script writes its tag in
+ * front of them with BUNDLE_PUT_TAG, BUNDLE_ARGS_TAG_SIZE bytes.
+ */
+#ifdef CKB_SCRIPT_BUNDLE
+#define BUNDLE_ARGS_TAG_SIZE BUNDLE_TAG_SIZE
+#define BUNDLE_STRIP_TAG(seg)      \
+  do {                             \
+    (seg).ptr += BUNDLE_TAG_SIZE;  \
+    (seg).size -= BUNDLE_TAG_SIZE; \
+  } while (0)
+#define BUNDLE_PUT_TAG(args, tag) \
+  do {                            \
+    (args)[0] = (tag);            \
+  } while (0)
+#else
+#define BUNDLE_ARGS_TAG_SIZE 0
+#define BUNDLE_STRIP_TAG(seg) \
+  do {                        \
+  } while (0)
+#define BUNDLE_PUT_TAG(args, tag) \
+  do {                            \
+  } while (0)
+#endif
+
+#endif
@@ -0,0 +1,630 @@
+/*
+ * Dynamic library loader for CKB scripts.
+ *
+ * A drop-in replacement for ckb_dlopen/ckb_dlsym from ckb-c-stdlib. Segments
+ * and relocations are processed the same way, but the dynamic section is
+ * read from the loaded image instead of reloading section headers from the
+ * cell, and symbols are resolved through DT_GNU_HASH or DT_HASH when the
+ * library carries them, falling back to a linear scan of the dynamic symbol
+ * table otherwise.
+ *
+ * Layout of the arena passed to ckb_loader_open: the first page holds the
+ * handle, the library image starts at the second page.
+ *
+ * ckb_loader_open_prelinked is a fast path for images produced by
+ * deps/prelink_library.c: they only load when the arena sits at the address
+ * the image was relocated for, and then loading is a plain copy. Callers
+ * fall back to ckb_loader_open on the regular library on any error.
+ */
+#ifndef CKB_LOADER_H_
+#define CKB_LOADER_H_
+
+#include "ckb_syscalls.h"
+#include "export_table.h"
+#include "prelink_image.h"
+
+#ifndef RISCV_PGSIZE
+#define RISCV_PGSIZE 4096
+#endif
+#ifndef ROUNDUP
+#define ROUNDUP(a, b) ((((a)-1) / (b) + 1) * (b))
+#endif
+#ifndef ROUNDDOWN
+#define ROUNDDOWN(a, b) ((a) / (b) * (b))
+#endif
+
+#define CKB_LOADER_MAX_PHNUM 16
+
+static const uint8_t CKB_LOADER_ELF_MAGIC[4] = {0x7f, 'E', 'L', 'F'};
+
+#define CKB_LOADER_ERROR_MEMORY_NOT_ENOUGH -71
+#define CKB_LOADER_ERROR_INVALID_ELF -72
+#define CKB_LOADER_ERROR_INVALID_SEGMENT -73
+#define CKB_LOADER_ERROR_INVALID_DYNAMIC -74
+#define CKB_LOADER_ERROR_INVALID_RELOCATION -75
+#define CKB_LOADER_ERROR_PRELINK_IMAGE -76
+#define CKB_LOADER_ERROR_PRELINK_ADDRESS -77
+
+typedef struct {
+  uint8_t e_ident[16];
+  uint16_t e_type;
+  uint16_t e_machine;
+  uint32_t e_version;
+  uint64_t e_entry;
+  uint64_t e_phoff;
+  uint64_t e_shoff;
+  uint32_t e_flags;
+  uint16_t e_ehsize;
+  uint16_t e_phentsize;
+  uint16_t e_phnum;
+  uint16_t e_shentsize;
+  uint16_t e_shnum;
+  uint16_t e_shstrndx;
+} Elf64_Ehdr;
+
+typedef struct {
+  uint32_t p_type;
+  uint32_t p_flags;
+  uint64_t p_offset;
+  uint64_t p_vaddr;
+  uint64_t p_paddr;
+  uint64_t p_filesz;
+  uint64_t p_memsz;
+  uint64_t p_align;
+} Elf64_Phdr;
+
+typedef struct {
+  uint32_t st_name;
+  uint8_t st_info;
+  uint8_t st_other;
+  uint16_t st_shndx;
+  uint64_t st_value;
+  uint64_t st_size;
+} Elf64_Sym;
+
+typedef struct {
+  uint64_t r_offset;
+  uint64_t r_info;
+  int64_t r_addend;
+} Elf64_Rela;
+
+typedef struct {
+  int64_t d_tag;
+  uint64_t d_val;
+} Elf64_Dyn;
+
+#define PT_LOAD 1
+#define PT_DYNAMIC 2
+#define PF_X 1
+
+#define DT_NULL 0
+#define DT_PLTRELSZ 2
+#define DT_HASH 4
+#define DT_STRTAB 5
+#define DT_SYMTAB 6
+#define DT_RELA 7
+#define DT_RELASZ 8
+#define DT_RELAENT 9
+#define DT_STRSZ 10
+#define DT_SYMENT 11
+#define DT_JMPREL 23
+#define DT_GNU_HASH 0x6ffffef5
+
+#define SHN_UNDEF 0
+
+#define ELF64_R_SYM(i) ((i) >> 32)
+#define ELF64_R_TYPE(i) ((i)&0xffffffff)
+
+#define R_RISCV_NONE 0
+#define R_RISCV_64 2
+#define R_RISCV_RELATIVE 3
+#define R_RISCV_JUMP_SLOT 5
+
+typedef struct {
+  uint8_t *base_addr;
+  uint64_t size;
+  const Elf64_Sym *dynsyms;
+  uint64_t dynsym_count;
+  const char *dynstr;
+  uint64_t dynstr_size;
+  /* Either may be NULL when the library was linked without it */
+  const uint32_t *gnu_hash;
+  const uint32_t *sysv_hash;
+} ckb_loader_handle_t;
+
+static int ckb_loader_in_image(const ckb_loader_handle_t *h, uint64_t offset,
+                               uint64_t size) {
+  return offset <= h->size && size <= h->size - offset;
+}
+
+static int ckb_loader_load_segments(ckb_loader_handle_t *h, size_t index,
+                                    const Elf64_Phdr *program_headers,
+                                    uint16_t phnum, uint64_t aligned_size) {
+  uint64_t code_end = 0;
+  for (uint16_t i = 0; i < phnum; i++) {
+    const Elf64_Phdr *ph = &program_headers[i];
+    if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+      continue;
+    }
+    if (ph->p_filesz > ph->p_memsz ||
+        (ph->p_vaddr % RISCV_PGSIZE) != (ph->p_offset % RISCV_PGSIZE)) {
+      return CKB_LOADER_ERROR_INVALID_SEGMENT;
+    }
+    uint64_t end = ROUNDUP(ph->p_vaddr + ph->p_memsz, RISCV_PGSIZE);
+    if (end > aligned_size) {
+      return CKB_LOADER_ERROR_MEMORY_NOT_ENOUGH;
+    }
+    if ((ph->p_flags & PF_X) != 0) {
+      uint64_t prepad = ph->p_vaddr % RISCV_PGSIZE;
+      uint64_t vaddr = ph->p_vaddr - prepad;
+      uint64_t memsz = end - vaddr;
+      int ret = ckb_load_cell_code(h->base_addr + vaddr, memsz,
+                                   ph->p_offset - prepad,
+                                   ph->p_filesz + prepad, index,
+                                   CKB_SOURCE_CELL_DEP);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+      code_end = end;
+    } else {
+      /* Code pages are frozen once loaded, data must not share them */
+      if (ph->p_vaddr < code_end) {
+        return CKB_LOADER_ERROR_INVALID_SEGMENT;
+      }
+      uint64_t filesz = ph->p_filesz;
+      int ret = ckb_load_cell_data(h->base_addr + ph->p_vaddr, &filesz,
+                                   ph->p_offset, index, CKB_SOURCE_CELL_DEP);
+      if (ret != CKB_SUCCESS || filesz < ph->p_filesz) {
+        return CKB_LOADER_ERROR_INVALID_SEGMENT;
+      }
+      memset(h->base_addr + ph->p_vaddr + ph->p_filesz, 0,
+             ph->p_memsz - ph->p_filesz);
+    }
+    if (end > h->size) {
+      h->size = end;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+static int ckb_loader_relocate(ckb_loader_handle_t *h, const Elf64_Rela *relas,
+                               uint64_t count) {
+  for (uint64_t i = 0; i < count; i++) {
+    const Elf64_Rela *rela = &relas[i];
+    uint64_t type = ELF64_R_TYPE(rela->r_info);
+    if (type == R_RISCV_NONE) {
+      continue;
+    }
+    if (!ckb_loader_in_image(h, rela->r_offset, sizeof(uint64_t))) {
+      return CKB_LOADER_ERROR_INVALID_RELOCATION;
+    }
+    uint64_t *target = (uint64_t *)(h->base_addr + rela->r_offset);
+    if (type == R_RISCV_RELATIVE) {
+      *target = (uint64_t)h->base_addr + rela->r_addend;
+    } else if (type == R_RISCV_64 || type == R_RISCV_JUMP_SLOT) {
+      /* Libraries are self contained, only local definitions resolve */
+      uint64_t sym_index = ELF64_R_SYM(rela->r_info);
+      if (sym_index >= h->dynsym_count ||
+          h->dynsyms[sym_index].st_shndx == SHN_UNDEF) {
+        return CKB_LOADER_ERROR_INVALID_RELOCATION;
+      }
+      *target = (uint64_t)h->base_addr + h->dynsyms[sym_index].st_value +
+                rela->r_addend;
+    } else {
+      return CKB_LOADER_ERROR_INVALID_RELOCATION;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Number of dynamic symbols. DT_HASH records it directly; for DT_GNU_HASH it
+ * is one past the end of the chain of the highest used bucket.
+ */
+static uint64_t ckb_loader_symbol_count(const ckb_loader_handle_t *h,
+                                        const uint8_t *symtab,
+                                        const uint8_t *strtab) {
+  if (h->sysv_hash != NULL) {
+    return h->sysv_hash[1];
+  }
+  if (h->gnu_hash != NULL) {
+    uint32_t nbuckets = h->gnu_hash[0];
+    uint32_t symoffset = h->gnu_hash[1];
+    uint32_t bloom_size = h->gnu_hash[2];
+    const uint32_t *buckets =
+        (const uint32_t *)((const uint64_t *)&h->gnu_hash[4] + bloom_size);
+    const uint32_t *chain = &buckets[nbuckets];
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < nbuckets; i++) {
+      if (buckets[i] > last) {
+        last = buckets[i];
+      }
+    }
+    if (last < symoffset) {
+      return symoffset;
+    }
+    while ((chain[last - symoffset] & 1) == 0) {
+      last++;
+    }
+    return last + 1;
+  }
+  /* Linkers emit .dynsym right before .dynstr */
+  if (strtab > symtab) {
+    return (strtab - symtab) / sizeof(Elf64_Sym);
+  }
+  return 0;
+}
+
+static int ckb_loader_parse_dynamic(ckb_loader_handle_t *h,
+                                    const Elf64_Phdr *dynamic_ph) {
+  if (!ckb_loader_in_image(h, dynamic_ph->p_vaddr, dynamic_ph->p_memsz)) {
+    return CKB_LOADER_ERROR_INVALID_DYNAMIC;
+  }
+  const Elf64_Dyn *dyns =
+      (const Elf64_Dyn *)(h->base_addr + dynamic_ph->p_vaddr);
+  uint64_t dyn_count = dynamic_ph->p_memsz / sizeof(Elf64_Dyn);
+
+  uint64_t symtab = 0, strtab = 0, sysv_hash = 0, gnu_hash = 0;
+  uint64_t rela = 0, relasz = 0, relaent = sizeof(Elf64_Rela);
+  uint64_t jmprel = 0, pltrelsz = 0;
+  for (uint64_t i = 0; i < dyn_count && dyns[i].d_tag != DT_NULL; i++) {
+    switch (dyns[i].d_tag) {
+      case DT_SYMTAB:
+        symtab = dyns[i].d_val;
+        break;
+      case DT_STRTAB:
+        strtab = dyns[i].d_val;
+        break;
+      case DT_STRSZ:
+        h->dynstr_size = dyns[i].d_val;
+        break;
+      case DT_HASH:
+        sysv_hash = dyns[i].d_val;
+        break;
+      case DT_GNU_HASH:
+        gnu_hash = dyns[i].d_val;
+        break;
+      case DT_RELA:
+        rela = dyns[i].d_val;
+        break;
+      case DT_RELASZ:
+        relasz = dyns[i].d_val;
+        break;
+      case DT_RELAENT:
+        relaent = dyns[i].d_val;
+        break;
+      case DT_JMPREL:
+        jmprel = dyns[i].d_val;
+        break;
+      case DT_PLTRELSZ:
+        pltrelsz = dyns[i].d_val;
+        break;
+      default:
+        break;
+    }
+  }
+  if (relaent != sizeof(Elf64_Rela) ||
+      !ckb_loader_in_image(h, strtab, h->dynstr_size) ||
+      !ckb_loader_in_image(h, rela, relasz) ||
+      !ckb_loader_in_image(h, jmprel, pltrelsz)) {
+    return CKB_LOADER_ERROR_INVALID_DYNAMIC;
+  }
+  h->dynsyms = (const Elf64_Sym *)(h->base_addr + symtab);
+  h->dynstr = (const char *)(h->base_addr + strtab);
+  if (sysv_hash != 0) {
+    h->sysv_hash = (const uint32_t *)(h->base_addr + sysv_hash);
+  }
+  if (gnu_hash != 0) {
+    h->gnu_hash = (const uint32_t *)(h->base_addr + gnu_hash);
+  }
+  h->dynsym_count = ckb_loader_symbol_count(h, h->base_addr + symtab,
+                                            h->base_addr + strtab);
+  if (!ckb_loader_in_image(h, symtab, h->dynsym_count * sizeof(Elf64_Sym))) {
+    return CKB_LOADER_ERROR_INVALID_DYNAMIC;
+  }
+
+  int ret = ckb_loader_relocate(h, (const Elf64_Rela *)(h->base_addr + rela),
+                                relasz / sizeof(Elf64_Rela));
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return ckb_loader_relocate(h, (const Elf64_Rela *)(h->base_addr + jmprel),
+                             pltrelsz / sizeof(Elf64_Rela));
+}
+
+int ckb_loader_open(const uint8_t *dep_cell_data_hash, uint8_t *aligned_addr,
+                    size_t aligned_size, void **handle, size_t *consumed_size) {
+  if ((uint64_t)aligned_addr % RISCV_PGSIZE != 0 ||
+      aligned_size % RISCV_PGSIZE != 0 || aligned_size <= RISCV_PGSIZE) {
+    return CKB_LOADER_ERROR_MEMORY_NOT_ENOUGH;
+  }
+  ckb_loader_handle_t *h = (ckb_loader_handle_t *)aligned_addr;
+  memset(h, 0, sizeof(ckb_loader_handle_t));
+  h->base_addr = aligned_addr + RISCV_PGSIZE;
+  aligned_size -= RISCV_PGSIZE;
+
+  size_t index = SIZE_MAX;
+  int ret = ckb_look_for_dep_with_hash(dep_cell_data_hash, &index);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  Elf64_Ehdr header;
+  uint64_t len = sizeof(header);
+  ret = ckb_load_cell_data(&header, &len, 0, index, CKB_SOURCE_CELL_DEP);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len < sizeof(header) ||
+      memcmp(header.e_ident, CKB_LOADER_ELF_MAGIC, 4) != 0 ||
+      header.e_phentsize != sizeof(Elf64_Phdr) || header.e_phnum == 0 ||
+      header.e_phnum > CKB_LOADER_MAX_PHNUM) {
+    return CKB_LOADER_ERROR_INVALID_ELF;
+  }
+
+  Elf64_Phdr program_headers[CKB_LOADER_MAX_PHNUM];
+  len = sizeof(Elf64_Phdr) * header.e_phnum;
+  ret = ckb_load_cell_data(program_headers, &len, header.e_phoff, index,
+                           CKB_SOURCE_CELL_DEP);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len < sizeof(Elf64_Phdr) * header.e_phnum) {
+    return CKB_LOADER_ERROR_INVALID_ELF;
+  }
+
+  ret = ckb_loader_load_segments(h, index, program_headers, header.e_phnum,
+                                 aligned_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  for (uint16_t i = 0; i < header.e_phnum; i++) {
+    if (program_headers[i].p_type == PT_DYNAMIC) {
+      ret = ckb_loader_parse_dynamic(h, &program_headers[i]);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+    }
+  }
+
+  *handle = h;
+  *consumed_size = RISCV_PGSIZE + h->size;
+  return CKB_SUCCESS;
+}
+
+int ckb_loader_open_prelinked(const uint8_t *dep_cell_data_hash,
+                              uint8_t *aligned_addr, size_t aligned_size,
+                              void **handle, size_t *consumed_size) {
+  if ((uint64_t)aligned_addr % RISCV_PGSIZE != 0 ||
+      aligned_size % RISCV_PGSIZE != 0 || aligned_size <= RISCV_PGSIZE) {
+    return CKB_LOADER_ERROR_MEMORY_NOT_ENOUGH;
+  }
+  size_t index = SIZE_MAX;
+  int ret = ckb_look_for_dep_with_hash(dep_cell_data_hash, &index);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  ckb_prelink_header_t header;
+  uint64_t len = sizeof(header);
+  ret = ckb_load_cell_data(&header, &len, 0, index, CKB_SOURCE_CELL_DEP);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  /* All checks happen before any page gets frozen by a code load */
+  if (len < sizeof(header) ||
+      memcmp(header.magic, CKB_PRELINK_MAGIC, CKB_PRELINK_MAGIC_SIZE) != 0 ||
+      header.version != CKB_PRELINK_VERSION ||
+      header.header_size != CKB_PRELINK_HEADER_SIZE ||
+      header.code_size % RISCV_PGSIZE != 0 ||
+      header.mem_size % RISCV_PGSIZE != 0 ||
+      header.code_size > header.file_size ||
+      header.file_size > header.mem_size ||
+      len < header.header_size + header.file_size) {
+    return CKB_LOADER_ERROR_PRELINK_IMAGE;
+  }
+  if (header.base != (uint64_t)aligned_addr + RISCV_PGSIZE) {
+    return CKB_LOADER_ERROR_PRELINK_ADDRESS;
+  }
+  if (header.mem_size > aligned_size - RISCV_PGSIZE) {
+    return CKB_LOADER_ERROR_MEMORY_NOT_ENOUGH;
+  }
+
+  ckb_loader_handle_t *h = (ckb_loader_handle_t *)aligned_addr;
+  memset(h, 0, sizeof(ckb_loader_handle_t));
+  h->base_addr = aligned_addr + RISCV_PGSIZE;
+  h->size = header.mem_size;
+  if (!ckb_loader_in_image(h, header.dynstr, header.dynstr_size) ||
+      !ckb_loader_in_image(h, header.dynsym,
+                           header.dynsym_count * sizeof(Elf64_Sym))) {
+    return CKB_LOADER_ERROR_PRELINK_IMAGE;
+  }
+
+  if (header.code_size > 0) {
+    ret = ckb_load_cell_code(h->base_addr, header.code_size,
+                             header.header_size, header.code_size, index,
+                             CKB_SOURCE_CELL_DEP);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+  }
+  len = header.file_size - header.code_size;
+  ret = ckb_load_cell_data(h->base_addr + header.code_size, &len,
+                           header.header_size + header.code_size, index,
+                           CKB_SOURCE_CELL_DEP);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  memset(h->base_addr + header.file_size, 0,
+         header.mem_size - header.file_size);
+
+  h->dynsyms = (const Elf64_Sym *)(h->base_addr + header.dynsym);
+  h->dynsym_count = header.dynsym_count;
+  h->dynstr = (const char *)(h->base_addr + header.dynstr);
+  h->dynstr_size = header.dynstr_size;
+  if (header.gnu_hash != 0) {
+    h->gnu_hash = (const uint32_t *)(h->base_addr + header.gnu_hash);
+  }
+  if (header.sysv_hash != 0) {
+    h->sysv_hash = (const uint32_t *)(h->base_addr + header.sysv_hash);
+  }
+
+  *handle = h;
+  *consumed_size = RISCV_PGSIZE + h->size;
+  return CKB_SUCCESS;
+}
+
+static uint32_t ckb_loader_gnu_hash(const char *s) {
+  uint32_t h = 5381;
+  for (const uint8_t *p = (const uint8_t *)s; *p != 0; p++) {
+    h = (h << 5) + h + *p;
+  }
+  return h;
+}
+
+static uint32_t ckb_loader_sysv_hash(const char *s) {
+  uint32_t h = 0;
+  for (const uint8_t *p = (const uint8_t *)s; *p != 0; p++) {
+    h = (h << 4) + *p;
+    uint32_t g = h & 0xf0000000;
+    if (g != 0) {
+      h ^= g >> 24;
+    }
+    h &= ~g;
+  }
+  return h;
+}
+
+static void *ckb_loader_match(const ckb_loader_handle_t *h, uint64_t index,
+                              const char *symbol) {
+  if (index >= h->dynsym_count) {
+    return NULL;
+  }
+  const Elf64_Sym *sym = &h->dynsyms[index];
+  if (sym->st_shndx == SHN_UNDEF || sym->st_name >= h->dynstr_size ||
+      strcmp(h->dynstr + sym->st_name, symbol) != 0) {
+    return NULL;
+  }
+  return h->base_addr + sym->st_value;
+}
+
+static void *ckb_loader_gnu_lookup(const ckb_loader_handle_t *h,
+                                   const char *symbol) {
+  uint32_t nbuckets = h->gnu_hash[0];
+  uint32_t symoffset = h->gnu_hash[1];
+  uint32_t bloom_size = h->gnu_hash[2];
+  uint32_t bloom_shift = h->gnu_hash[3];
+  const uint64_t *bloom = (const uint64_t *)&h->gnu_hash[4];
+  const uint32_t *buckets = (const uint32_t *)&bloom[bloom_size];
+  const uint32_t *chain = &buckets[nbuckets];
+  if (nbuckets == 0 || bloom_size == 0) {
+    return NULL;
+  }
+
+  uint32_t hash = ckb_loader_gnu_hash(symbol);
+  uint64_t word = bloom[(hash / 64) % bloom_size];
+  uint64_t mask = ((uint64_t)1 << (hash % 64)) |
+                  ((uint64_t)1 << ((hash >> bloom_shift) % 64));
+  if ((word & mask) != mask) {
+    return NULL;
+  }
+  uint32_t index = buckets[hash % nbuckets];
+  if (index < symoffset) {
+    return NULL;
+  }
+  while (1) {
+    uint32_t chain_hash = chain[index - symoffset];
+    if ((hash | 1) == (chain_hash | 1)) {
+      void *addr = ckb_loader_match(h, index, symbol);
+      if (addr != NULL) {
+        return addr;
+      }
+    }
+    if ((chain_hash & 1) != 0) {
+      return NULL;
+    }
+    index++;
+  }
+}
+
+static void *ckb_loader_sysv_lookup(const ckb_loader_handle_t *h,
+                                    const char *symbol) {
+  uint32_t nbucket = h->sysv_hash[0];
+  const uint32_t *buckets = &h->sysv_hash[2];
+  const uint32_t *chain = &buckets[nbucket];
+  if (nbucket == 0) {
+    return NULL;
+  }
+  uint32_t hash = ckb_loader_sysv_hash(symbol);
+  for (uint32_t index = buckets[hash % nbucket];
+       index != 0 && index < h->dynsym_count; index = chain[index]) {
+    void *addr = ckb_loader_match(h, index, symbol);
+    if (addr != NULL) {
+      return addr;
+    }
+  }
+  return NULL;
+}
+
+void *ckb_loader_sym(void *handle, const char *symbol) {
+  const ckb_loader_handle_t *h = (const ckb_loader_handle_t *)handle;
+  if (h->gnu_hash != NULL) {
+    return ckb_loader_gnu_lookup(h, symbol);
+  }
+  if (h->sysv_hash != NULL) {
+    return ckb_loader_sysv_lookup(h, symbol);
+  }
+  for (uint64_t i = 0; i < h->dynsym_count; i++) {
+    void *addr = ckb_loader_match(h, i, symbol);
+    if (addr != NULL) {
+      return addr;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Resolves a versioned function table, returns NULL when the library does
+ * not export it or only provides an older version than required.
+ */
+const void *ckb_loader_table(void *handle, const char *symbol,
+                             uint32_t version, uint32_t size) {
+  const ckb_export_table_header_t *header =
+      (const ckb_export_table_header_t *)ckb_loader_sym(handle, symbol);
+  if (header == NULL || header->version < version || header->size < size) {
+    return NULL;
+  }
+  return header;
+}
+
+/*
+ * Loads a library exporting a versioned table into the arena the way the
+ * signature locks do: the relocation free image with prelinked_hash first,
+ * which only loads when the arena sits at DL_ARENA_BASE, then the regular
+ * library with library_hash. Loading errors are returned as is, *table is
+ * NULL when the loaded library lacks a compatible table, as with
+ * ckb_loader_table.
+ */
+int ckb_loader_open_table(const uint8_t *prelinked_hash,
+                          const uint8_t *library_hash, uint8_t *arena,
+                          size_t arena_size, const char *symbol,
+                          uint32_t version, uint32_t size,
+                          const void **table) {
+  size_t aligned_size = ROUNDDOWN(arena_size, RISCV_PGSIZE);
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  *table = NULL;
+  int ret = ckb_loader_open_prelinked(prelinked_hash, arena, aligned_size,
+                                      &handle, &consumed_size);
+  if (ret != CKB_SUCCESS) {
+    ret = ckb_loader_open(library_hash, arena, aligned_size, &handle,
+                          &consumed_size);
+  }
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  *table = ckb_loader_table(handle, symbol, version, size);
+  return CKB_SUCCESS;
+}
+
+#endif
@@ -1,16 +1,68 @@
+/*
+ * Owner lock of the UDT of one asset of a crosschain_typescript registry:
+ * the simple_udt of the asset takes the hash of this lock as its args, so
+ * issuing or burning that UDT needs a cell with this lock as input.
+ *
+ * Args: 32 byte registry type hash | 32 byte foreign asset id
+ *
+ * The cell unlocks when the registry is the first input of the
+ * transaction, so the registry checks it, and the asset is among the
+ * touched ids in the input_type of the registry's witness, so the supply
+ * of the asset moves with the UDT issued or burned. The registry derives
+ * the same args to check the UDT of each record and rejects owner cells
+ * of assets it does not touch.
+ */
 #include "blockchain.h"
+#include "bundle.h"
 #include "ckb_syscalls.h"
 
 #define BLAKE2B_BLOCK_SIZE 32
 #define SCRIPT_SIZE 32768
+#define MAX_WITNESS_SIZE 32768
+#define OWNER_ASSET_ID_SIZE 32
 
 #define ERROR_ARGUMENTS_LEN -1
 #define ERROR_ENCODING -2
 #define ERROR_SYSCALL -3
 #define ERROR_SCRIPT_TOO_LONG -21
+#define ERROR_WITNESS_SIZE -22
 #define ERROR_OVERFLOWING -51
 #define ERROR_1ST_CELL_TYPE_HASH_NOT_MATCH -52
 #define ERROR_LOAD_INPUT -53
+#define ERROR_ASSET_NOT_TOUCHED -54
+
+/* Whether id is among the touched ids of the registry's witness */
+static int owner_asset_touched(const uint8_t *id, int *touched) {
+  uint8_t witness[MAX_WITNESS_SIZE];
+  uint64_t witness_len = MAX_WITNESS_SIZE;
+  int ret = ckb_load_witness(witness, &witness_len, 0, 0, CKB_SOURCE_INPUT);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (witness_len > MAX_WITNESS_SIZE) {
+    return ERROR_WITNESS_SIZE;
+  }
+  mol_seg_t witness_seg;
+  witness_seg.ptr = witness;
+  witness_seg.size = witness_len;
+  if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  mol_seg_t input_type_seg = MolReader_WitnessArgs_get_input_type(&witness_seg);
+  *touched = 0;
+  if (MolReader_BytesOpt_is_none(&input_type_seg)) {
+    return CKB_SUCCESS;
+  }
+  mol_seg_t ids = MolReader_Bytes_raw_bytes(&input_type_seg);
+  for (uint32_t i = 0; i + OWNER_ASSET_ID_SIZE <= ids.size;
+       i += OWNER_ASSET_ID_SIZE) {
+    if (memcmp(&ids.ptr[i], id, OWNER_ASSET_ID_SIZE) == 0) {
+      *touched = 1;
+      break;
+    }
+  }
+  return CKB_SUCCESS;
+}
 
 int main() {
   unsigned char script[SCRIPT_SIZE];
@@ -32,25 +84,32 @@ int main() {
 
   mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
   mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
-  if (args_bytes_seg.size != BLAKE2B_BLOCK_SIZE) {
+  BUNDLE_STRIP_TAG(args_bytes_seg);
+  if (args_bytes_seg.size != BLAKE2B_BLOCK_SIZE + OWNER_ASSET_ID_SIZE) {
     return ERROR_ARGUMENTS_LEN;
   }
 
-    uint8_t buffer[BLAKE2B_BLOCK_SIZE];
-    uint64_t len2 = BLAKE2B_BLOCK_SIZE;
-    ret = ckb_checked_load_cell_by_field(buffer, &len, 0, 0, CKB_SOURCE_INPUT,
-                                         CKB_CELL_FIELD_TYPE_HASH);
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      return ERROR_LOAD_INPUT;
-    }
-    if (ret != CKB_SUCCESS) {
-      return ret;
-    }
-    if (len2 != BLAKE2B_BLOCK_SIZE) {
-      return ERROR_ENCODING;
-    }
-    if (memcmp(buffer, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) == 0) {
-      return 0;
-    }
+  uint8_t buffer[BLAKE2B_BLOCK_SIZE];
+  uint64_t len2 = BLAKE2B_BLOCK_SIZE;
+  ret = ckb_checked_load_cell_by_field(buffer, &len2, 0, 0, CKB_SOURCE_INPUT,
+                                       CKB_CELL_FIELD_TYPE_HASH);
+  if (ret == CKB_INDEX_OUT_OF_BOUND) {
+    return ERROR_LOAD_INPUT;
+  }
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len2 != BLAKE2B_BLOCK_SIZE) {
+    return ERROR_ENCODING;
+  }
+  if (memcmp(buffer, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) != 0) {
     return ERROR_1ST_CELL_TYPE_HASH_NOT_MATCH;
+  }
+
+  int touched = 0;
+  ret = owner_asset_touched(&args_bytes_seg.ptr[BLAKE2B_BLOCK_SIZE], &touched);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return touched ? CKB_SUCCESS : ERROR_ASSET_NOT_TOUCHED;
 }
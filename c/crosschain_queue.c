@@ -0,0 +1,207 @@
+/*
+ * Outbound message queue of a bridge, one cell committing to every message
+ * ever sent instead of one cell per message.
+ *
+ * The cell data is the state of a Merkle mountain range over the message
+ * hashes, see c/mmr.h: the leaf count followed by the peaks, at most 2056
+ * bytes however many messages were queued. Its data hash is the root the
+ * foreign chain checks inclusion proofs against, and deps/mmr_proof.c
+ * builds those proofs for relayers from the queued messages.
+ *
+ * A transaction appending messages spends the queue and recreates it, the
+ * output_type of its witness is a molecule BytesVec of the messages in
+ * queue order. The script appends their hashes to the old state and the
+ * new cell data must be the result, which costs k + log n merges for k
+ * messages on a queue of n and never reads an earlier message. The
+ * messages stay in the witnesses of the chain for relayers to pick up.
+ *
+ * The queue can be created from nothing with the first messages in the
+ * witness of its output, and destroyed while it is empty. Who may append
+ * is up to its lock.
+ *
+ * Args: 32 byte type id
+ *
+ * The type id, see c/type_id.h, is checked when the queue is created, so
+ * the queue is the only cell with its type hash. Any other cell running
+ * this code holds a state of its own choosing, so the foreign chain must
+ * pin the queue type hash and only take roots from the cell carrying it.
+ */
+#include "blockchain.h"
+#include "ckb_syscalls.h"
+#include "mmr.h"
+#include "type_id.h"
+
+#define ERROR_ARGUMENTS_LEN -1
+#define ERROR_ENCODING -2
+#define ERROR_SYSCALL -3
+#define ERROR_SCRIPT_TOO_LONG -21
+#define ERROR_WITNESS_SIZE -22
+#define ERROR_QUEUE_CELLS -51
+#define ERROR_QUEUE_SIZE -52
+#define ERROR_QUEUE_FULL -53
+#define ERROR_QUEUE_APPEND -54
+#define ERROR_QUEUE_NOT_EMPTY -55
+
+#define MAX_WITNESS_SIZE 32768
+#define SCRIPT_SIZE 32768
+
+/* Kept out of main so the script buffer is released before the checks */
+static __attribute__((noinline)) int queue_load_type_id(uint8_t *type_id) {
+  uint8_t script[SCRIPT_SIZE];
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_load_script(script, &len, 0);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (len > SCRIPT_SIZE) {
+    return ERROR_SCRIPT_TOO_LONG;
+  }
+  mol_seg_t script_seg;
+  script_seg.ptr = script;
+  script_seg.size = len;
+  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  if (args_bytes_seg.size != CKB_TYPE_ID_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+  memcpy(type_id, args_bytes_seg.ptr, CKB_TYPE_ID_SIZE);
+  return CKB_SUCCESS;
+}
+
+/* The state in group cell 0 of source, if there is one */
+static int queue_load(size_t source, int *present, uint8_t *data,
+                      uint64_t *size) {
+  uint64_t len = MMR_DATA_SIZE_MAX;
+  int ret = ckb_load_cell_data(data, &len, 0, 0, source);
+  if (ret == CKB_INDEX_OUT_OF_BOUND) {
+    *present = 0;
+    return CKB_SUCCESS;
+  }
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len > MMR_DATA_SIZE_MAX) {
+    return ERROR_QUEUE_SIZE;
+  }
+  *size = len;
+  /* A type script group holds one queue */
+  uint8_t byte;
+  len = 0;
+  ret = ckb_load_cell_data(&byte, &len, 0, 1, source);
+  if (ret != CKB_INDEX_OUT_OF_BOUND) {
+    return ret == CKB_SUCCESS ? ERROR_QUEUE_CELLS : ret;
+  }
+  *present = 1;
+  return CKB_SUCCESS;
+}
+
+/* The messages in the output_type of the group witness of source */
+static int queue_load_messages(size_t source, uint8_t *witness,
+                               mol_seg_t *messages) {
+  uint64_t witness_len = MAX_WITNESS_SIZE;
+  int ret = ckb_load_witness(witness, &witness_len, 0, 0, source);
+  messages->ptr = NULL;
+  messages->size = 0;
+  if (ret == CKB_INDEX_OUT_OF_BOUND) {
+    return CKB_SUCCESS;
+  }
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (witness_len > MAX_WITNESS_SIZE) {
+    return ERROR_WITNESS_SIZE;
+  }
+  mol_seg_t witness_seg;
+  witness_seg.ptr = witness;
+  witness_seg.size = witness_len;
+  if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  mol_seg_t output_type_seg =
+      MolReader_WitnessArgs_get_output_type(&witness_seg);
+  if (MolReader_BytesOpt_is_none(&output_type_seg)) {
+    return CKB_SUCCESS;
+  }
+  *messages = MolReader_Bytes_raw_bytes(&output_type_seg);
+  if (MolReader_BytesVec_verify(messages, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  return CKB_SUCCESS;
+}
+
+static int queue_append(mmr_t *mmr, const mol_seg_t *messages) {
+  if (messages->size == 0) {
+    return CKB_SUCCESS;
+  }
+  mol_num_t count = MolReader_BytesVec_length(messages);
+  for (mol_num_t i = 0; i < count; i++) {
+    mol_seg_res_t message_res = MolReader_BytesVec_get(messages, i);
+    if (message_res.errno != MOL_OK) {
+      return ERROR_ENCODING;
+    }
+    mol_seg_t message = MolReader_Bytes_raw_bytes(&message_res.seg);
+    uint8_t leaf[MMR_HASH_SIZE];
+    mmr_hash(message.ptr, message.size, leaf);
+    if (mmr_append(mmr, leaf) != 0) {
+      return ERROR_QUEUE_FULL;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+int main() {
+  uint8_t type_id[CKB_TYPE_ID_SIZE];
+  int ret = queue_load_type_id(type_id);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  uint8_t old_data[MMR_DATA_SIZE_MAX];
+  uint8_t new_data[MMR_DATA_SIZE_MAX];
+  uint64_t old_size = 0, new_size = 0;
+  int has_input = 0, has_output = 0;
+  ret = queue_load(CKB_SOURCE_GROUP_INPUT, &has_input, old_data, &old_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = queue_load(CKB_SOURCE_GROUP_OUTPUT, &has_output, new_data, &new_size);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (!has_input) {
+    ret = ckb_check_type_id(type_id);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+  }
+
+  mmr_t mmr;
+  mmr_init(&mmr);
+  if (has_input && mmr_load(&mmr, old_data, old_size) != 0) {
+    return ERROR_QUEUE_SIZE;
+  }
+  if (!has_output) {
+    return mmr.count == 0 ? CKB_SUCCESS : ERROR_QUEUE_NOT_EMPTY;
+  }
+
+  uint8_t witness[MAX_WITNESS_SIZE];
+  mol_seg_t messages;
+  ret = queue_load_messages(
+      has_input ? CKB_SOURCE_GROUP_INPUT : CKB_SOURCE_GROUP_OUTPUT, witness,
+      &messages);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = queue_append(&mmr, &messages);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  uint64_t size = mmr_store(&mmr, old_data);
+  if (size != new_size || memcmp(old_data, new_data, size) != 0) {
+    return ERROR_QUEUE_APPEND;
+  }
+  return CKB_SUCCESS;
+}
@@ -1,8 +1,898 @@
+/*
+ * Registry of the foreign assets a bridge handles, one cell for all of
+ * them instead of one state cell per asset.
+ *
+ * The cell data is the relay window, see below, followed by a sorted
+ * array of fixed size records:
+ *
+ * 32 byte foreign asset id | 32 byte UDT type hash | 16 byte supply |
+ * 16 byte cap | withdrawal limit, see below
+ *
+ * ordered by asset id, with supply the amount of the UDT issued on CKB
+ * and at most cap. The fixed size makes record i readable at offset
+ * REGISTRY_HEADER_SIZE + i * RECORD_SIZE, so a lookup is a binary search
+ * loading one 32 byte id per probe instead of the whole cell.
+ *
+ * The relay window replaces a strictly increasing nonce, which would make
+ * relayers submit messages one after the other in order. It is an 8 byte
+ * base followed by 4096 bits, bit i set once message base + i has been
+ * processed; every message below base has been. An update lists the
+ * messages it processes in the output_type of its witness, in any order:
+ *
+ * 8 byte message id | 32 byte foreign asset id | 16 byte amount
+ *
+ * and each costs one bit test and set. Whenever the lowest 64 bits are all
+ * set the window slides up by 64, so messages may run up to 4096 ahead of
+ * the oldest one still missing. The new window must be exactly the old
+ * one with these messages set and slid, which rules out replays. Each
+ * message mints its amount of its asset, which must be touched: the
+ * supply of a touched asset rises by exactly the sum of its messages, and
+ * an asset whose supply does not rise has none, so every issued UDT is
+ * bound to relayed ids and no id is spent without issuing.
+ *
+ * The window lets relayers pick up messages in any order, but every
+ * update still spends and recreates the one registry cell, so updates
+ * stay serialized: two relayers can not land updates in the same block,
+ * and relaying in parallel is not supported.
+ *
+ * An update spends the registry and recreates it, the input_type of its
+ * witness lists the ids of the touched assets in ascending order. Each is
+ * binary searched in the old and new records, where a touched record
+ * missing from the old ones is inserted; records are never removed. The
+ * supply of a touched record must move by exactly the amount of its UDT
+ * issued or burned in the transaction. The untouched runs between touched
+ * records must be the same bytes in both cells and are compared in bulk
+ * without decoding a record. Decoding and checking cost O(k log n) for k
+ * touched assets out of n, only the bulk comparison reads every record.
+ *
+ * Withdrawals, updates lowering a supply, are rate limited per asset:
+ *
+ * 16 byte withdrawal cap | 8 byte since of the last withdrawal |
+ * 16 byte window sum | 16 byte total of each of the last RATE_EPOCHS epochs
+ *
+ * The totals are a ring indexed by epoch number modulo RATE_EPOCHS and
+ * the window sum is the sum of the ring, which must stay within the
+ * withdrawal cap. A withdrawal gives the registry input an absolute epoch
+ * since, which must not be below the since of the last withdrawal, as the
+ * current epoch. The epochs passed since the last withdrawal leave the
+ * window, their slots are subtracted from the sum and cleared, then the
+ * amount is added to the slot of the current epoch and to the sum. The
+ * check is one comparison against the sum whatever RATE_EPOCHS is, aging
+ * costs one subtraction per epoch passed, at most RATE_EPOCHS. The
+ * withdrawal cap of a record may only be lowered, and its other limit
+ * fields are derived this way, so whoever holds the lock can not withdraw
+ * faster by rewriting them.
+ *
+ * Args: 32 byte type id | code hash and hash type of crosschain_lockscript
+ * | code hash and hash type of simple_udt
+ *
+ * The type id, see c/type_id.h, makes the registry the only cell with its
+ * type hash. The UDT of an asset is the simple_udt owned by the
+ * crosschain_lockscript whose args are the registry type hash and the
+ * asset id, which the registry derives to check the UDT hash of every
+ * record it creates or inserts. simple_udt only lets the supply of a UDT
+ * change with its owner lock among the inputs, and the registry rejects
+ * owner cells of any of its assets the update does not touch, so every
+ * UDT of the registry issued or burned is accounted for in its record.
+ *
+ * The registry can be created with zero supplies and limits and destroyed
+ * once all supplies are back to zero, without any of its owner cells. Who
+ * may update it is up to its lock, which is trusted with deposits: the
+ * relayed messages behind issued UDT are not proven on-chain.
+ */
 #include "blockchain.h"
+#include "bundle.h"
 #include "ckb_syscalls.h"
+#include "ckb_utils.h"
+#include "registry_layout.h"
+#include "type_id.h"
+
+#define ERROR_ARGUMENTS_LEN -1
+#define ERROR_ENCODING -2
+#define ERROR_SYSCALL -3
+#define ERROR_SCRIPT_TOO_LONG -21
+#define ERROR_WITNESS_SIZE -22
+#define ERROR_OVERFLOWING -51
+#define ERROR_REGISTRY_CELLS -52
+#define ERROR_REGISTRY_SIZE -53
+#define ERROR_REGISTRY_DIFF -54
+#define ERROR_REGISTRY_RECORD -55
+#define ERROR_REGISTRY_UNTOUCHED -56
+#define ERROR_REGISTRY_SUPPLY -57
+#define ERROR_RELAY_REPLAY -58
+#define ERROR_RELAY_WINDOW -59
+#define ERROR_RATE_SINCE -60
+#define ERROR_RATE_LIMIT -61
+#define ERROR_RATE_STATE -62
+#define ERROR_REGISTRY_UNLISTED -63
+#define ERROR_RELAY_AMOUNT -64
+
+#define MAX_WITNESS_SIZE 32768
+#define SCRIPT_SIZE 32768
+
+#define MESSAGE_ID_SIZE 8
+#define MESSAGE_ASSET MESSAGE_ID_SIZE
+#define MESSAGE_AMOUNT (MESSAGE_ASSET + ASSET_ID_SIZE)
+#define MESSAGE_SIZE (MESSAGE_AMOUNT + AMOUNT_SIZE)
+/* Messages processed by one update */
+#define REGISTRY_MESSAGES_MAX 512
+
+/* Absolute, epoch metric, and the epoch number in the low 24 bits */
+#define SINCE_FLAGS_MASK 0xff00000000000000ULL
+#define SINCE_EPOCH_FLAGS 0x2000000000000000ULL
+#define SINCE_EPOCH_NUMBER(since) ((since)&0xffffffULL)
+
+/* Code hash and hash type of a script */
+#define SCRIPT_CODE_SIZE 33
+/* Molecule Script header, code hash, hash type and args length */
+#define SCRIPT_FIXED_SIZE (16 + SCRIPT_CODE_SIZE + 4)
+#define REGISTRY_ARGS_SIZE (CKB_TYPE_ID_SIZE + 2 * SCRIPT_CODE_SIZE)
+/* Owner lock args, registry type hash and asset id */
+#define OWNER_ARGS_SIZE (BUNDLE_ARGS_TAG_SIZE + UDT_HASH_SIZE + ASSET_ID_SIZE)
+#define OWNER_LOCK_SIZE (SCRIPT_FIXED_SIZE + OWNER_ARGS_SIZE)
+/* simple_udt args, the owner lock hash */
+#define UDT_ARGS_SIZE (BUNDLE_ARGS_TAG_SIZE + UDT_HASH_SIZE)
+#define UDT_SCRIPT_SIZE (SCRIPT_FIXED_SIZE + UDT_ARGS_SIZE)
+
+/* Touched assets of one update */
+#define REGISTRY_TOUCHED_MAX 32
 
 typedef unsigned __int128 uint128_t;
 
+/* Little endian like RV64, so the header loads straight into it */
+typedef struct {
+  uint64_t base;
+  uint64_t bits[WINDOW_WORDS];
+} registry_window_t;
+
+typedef struct {
+  uint8_t type_id[CKB_TYPE_ID_SIZE];
+  /* Type hash of the registry */
+  uint8_t type_hash[UDT_HASH_SIZE];
+  /* Owner lock of the asset id in its last ASSET_ID_SIZE bytes */
+  uint8_t owner_lock[OWNER_LOCK_SIZE];
+  uint8_t udt_code[SCRIPT_CODE_SIZE];
+} registry_script_t;
+
+typedef struct {
+  uint8_t udt_hash[UDT_HASH_SIZE];
+  /* Withdrawal limit fields of the old and new record */
+  uint8_t old_limit[LIMIT_SIZE];
+  uint8_t new_limit[LIMIT_SIZE];
+  uint128_t old_supply;
+  uint128_t new_supply;
+  uint128_t inputs;
+  uint128_t outputs;
+  /* Sum of the relayed messages of the asset */
+  uint128_t relayed;
+} registry_touched_t;
+
+static uint128_t registry_amount(const uint8_t *record, size_t field) {
+  uint128_t amount;
+  memcpy(&amount, &record[field], AMOUNT_SIZE);
+  return amount;
+}
+
+static void registry_set_amount(uint8_t *record, size_t field,
+                                uint128_t amount) {
+  memcpy(&record[field], &amount, AMOUNT_SIZE);
+}
+
+static void registry_hash(const uint8_t *data, size_t size, uint8_t *hash) {
+  blake2b_state state;
+  blake2b_init(&state, UDT_HASH_SIZE);
+  blake2b_update(&state, data, size);
+  blake2b_final(&state, hash, UDT_HASH_SIZE);
+}
+
+/* Writes the molecule Script of code and args, SCRIPT_FIXED_SIZE + size */
+static void registry_build_script(const uint8_t *code, const uint8_t *args,
+                                  uint32_t size, uint8_t *script) {
+  uint32_t header[4] = {SCRIPT_FIXED_SIZE + size, 16, 16 + UDT_HASH_SIZE,
+                        16 + SCRIPT_CODE_SIZE};
+  memcpy(script, header, sizeof(header));
+  memcpy(&script[16], code, SCRIPT_CODE_SIZE);
+  memcpy(&script[16 + SCRIPT_CODE_SIZE], &size, 4);
+  memcpy(&script[SCRIPT_FIXED_SIZE], args, size);
+}
+
+/* Kept out of main so the script buffer is released before the checks */
+static __attribute__((noinline)) int registry_load_script(
+    registry_script_t *registry) {
+  uint8_t script[SCRIPT_SIZE];
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_load_script(script, &len, 0);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (len > SCRIPT_SIZE) {
+    return ERROR_SCRIPT_TOO_LONG;
+  }
+  mol_seg_t script_seg;
+  script_seg.ptr = script;
+  script_seg.size = len;
+  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  BUNDLE_STRIP_TAG(args_bytes_seg);
+  if (args_bytes_seg.size != REGISTRY_ARGS_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+  const uint8_t *args = args_bytes_seg.ptr;
+  memcpy(registry->type_id, args, CKB_TYPE_ID_SIZE);
+  memcpy(registry->udt_code, &args[CKB_TYPE_ID_SIZE + SCRIPT_CODE_SIZE],
+         SCRIPT_CODE_SIZE);
+  len = UDT_HASH_SIZE;
+  ret = ckb_load_script_hash(registry->type_hash, &len, 0);
+  if (ret != CKB_SUCCESS || len != UDT_HASH_SIZE) {
+    return ERROR_SYSCALL;
+  }
+  uint8_t owner_args[OWNER_ARGS_SIZE] = {0};
+  BUNDLE_PUT_TAG(owner_args, BUNDLE_TAG_CROSSCHAIN_LOCKSCRIPT);
+  memcpy(&owner_args[BUNDLE_ARGS_TAG_SIZE], registry->type_hash,
+         UDT_HASH_SIZE);
+  registry_build_script(&args[CKB_TYPE_ID_SIZE], owner_args, OWNER_ARGS_SIZE,
+                        registry->owner_lock);
+  return CKB_SUCCESS;
+}
+
+/* Hash of the simple_udt owned by the owner lock of asset id */
+static void registry_udt_hash(registry_script_t *registry, const uint8_t *id,
+                              uint8_t *hash) {
+  memcpy(&registry->owner_lock[OWNER_LOCK_SIZE - ASSET_ID_SIZE], id,
+         ASSET_ID_SIZE);
+  uint8_t udt_args[UDT_ARGS_SIZE];
+  BUNDLE_PUT_TAG(udt_args, BUNDLE_TAG_SIMPLE_UDT);
+  registry_hash(registry->owner_lock, OWNER_LOCK_SIZE,
+                &udt_args[BUNDLE_ARGS_TAG_SIZE]);
+  uint8_t udt_script[UDT_SCRIPT_SIZE];
+  registry_build_script(registry->udt_code, udt_args, UDT_ARGS_SIZE,
+                        udt_script);
+  registry_hash(udt_script, UDT_SCRIPT_SIZE, hash);
+}
+
+/* Index of id among the count ascending ids, count if it is not there */
+static size_t registry_find_id(const uint8_t *ids, size_t count,
+                               const uint8_t *id) {
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = memcmp(&ids[mid * ASSET_ID_SIZE], id, ASSET_ID_SIZE);
+    if (cmp == 0) {
+      return mid;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return count;
+}
+
+/*
+ * Rejects inputs locked by the owner lock of an asset of this registry
+ * that is not among the count ascending ids, one lock load per input.
+ * Without its owner cell the supply of a UDT can not change.
+ */
+static int registry_check_owners(const registry_script_t *registry,
+                                 const uint8_t *ids, size_t count) {
+  for (size_t i = 0;; i++) {
+    uint8_t lock[OWNER_LOCK_SIZE];
+    uint64_t len = OWNER_LOCK_SIZE;
+    int ret = ckb_load_cell_by_field(lock, &len, 0, i, CKB_SOURCE_INPUT,
+                                     CKB_CELL_FIELD_LOCK);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      return CKB_SUCCESS;
+    }
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (len != OWNER_LOCK_SIZE ||
+        memcmp(lock, registry->owner_lock, OWNER_LOCK_SIZE - ASSET_ID_SIZE) !=
+            0) {
+      continue;
+    }
+    if (registry_find_id(ids, count, &lock[OWNER_LOCK_SIZE - ASSET_ID_SIZE]) ==
+        count) {
+      return ERROR_REGISTRY_UNLISTED;
+    }
+  }
+}
+
+/* Records of the registry in group cell 0 of source, if there is one */
+static int registry_count(size_t source, int *present, uint64_t *count) {
+  uint8_t byte;
+  uint64_t len = 0;
+  int ret = ckb_load_cell_data(&byte, &len, 0, 0, source);
+  if (ret == CKB_INDEX_OUT_OF_BOUND) {
+    *present = 0;
+    return CKB_SUCCESS;
+  }
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len < REGISTRY_HEADER_SIZE ||
+      (len - REGISTRY_HEADER_SIZE) % RECORD_SIZE != 0) {
+    return ERROR_REGISTRY_SIZE;
+  }
+  *count = (len - REGISTRY_HEADER_SIZE) / RECORD_SIZE;
+  /* A type script group holds one registry */
+  len = 0;
+  ret = ckb_load_cell_data(&byte, &len, 0, 1, source);
+  if (ret != CKB_INDEX_OUT_OF_BOUND) {
+    return ret == CKB_SUCCESS ? ERROR_REGISTRY_CELLS : ret;
+  }
+  *present = 1;
+  return CKB_SUCCESS;
+}
+
+/* Loads size bytes of the registry from record index on */
+static int registry_load(size_t source, uint64_t index, uint8_t *buffer,
+                         uint64_t size) {
+  uint64_t len = size;
+  int ret = ckb_load_cell_data(buffer, &len,
+                               REGISTRY_HEADER_SIZE + index * RECORD_SIZE, 0,
+                               source);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len < size) {
+    return ERROR_REGISTRY_SIZE;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * First record from lo on whose id is not below id, with one 32 byte
+ * load per probe. *found tells whether it holds id.
+ */
+static int registry_search(size_t source, uint64_t lo, uint64_t hi,
+                           const uint8_t *id, uint64_t *pos, int *found) {
+  *found = 0;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    uint8_t probe[ASSET_ID_SIZE];
+    int ret = registry_load(source, mid, probe, ASSET_ID_SIZE);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    int cmp = memcmp(probe, id, ASSET_ID_SIZE);
+    if (cmp == 0) {
+      lo = mid;
+      *found = 1;
+      break;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *pos = lo;
+  return CKB_SUCCESS;
+}
+
+/* The count records at old_pos in the input and new_pos in the output */
+static int registry_compare_run(uint64_t old_pos, uint64_t new_pos,
+                                uint64_t count) {
+  uint8_t old_chunk[REGISTRY_CHUNK_SIZE];
+  uint8_t new_chunk[REGISTRY_CHUNK_SIZE];
+  while (count > 0) {
+    uint64_t n = count;
+    if (n > REGISTRY_CHUNK_RECORDS) {
+      n = REGISTRY_CHUNK_RECORDS;
+    }
+    int ret = registry_load(CKB_SOURCE_GROUP_INPUT, old_pos, old_chunk,
+                            n * RECORD_SIZE);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    ret = registry_load(CKB_SOURCE_GROUP_OUTPUT, new_pos, new_chunk,
+                        n * RECORD_SIZE);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (memcmp(old_chunk, new_chunk, n * RECORD_SIZE) != 0) {
+      return ERROR_REGISTRY_UNTOUCHED;
+    }
+    old_pos += n;
+    new_pos += n;
+    count -= n;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Reads every record of a registry being created or destroyed, which must
+ * be sorted and must not account for any issued UDT. A new registry,
+ * created is its script then and NULL otherwise, has not seen any
+ * withdrawal either and holds the UDT of each asset.
+ */
+static int registry_check_empty(size_t source, uint64_t count,
+                                registry_script_t *created) {
+  static const uint8_t zero[RECORD_SIZE - RECORD_LAST_SINCE] = {0};
+  uint8_t chunk[REGISTRY_CHUNK_SIZE];
+  uint8_t last[ASSET_ID_SIZE];
+  for (uint64_t i = 0; i < count; i += REGISTRY_CHUNK_RECORDS) {
+    uint64_t n = count - i;
+    if (n > REGISTRY_CHUNK_RECORDS) {
+      n = REGISTRY_CHUNK_RECORDS;
+    }
+    int ret = registry_load(source, i, chunk, n * RECORD_SIZE);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    for (uint64_t j = 0; j < n; j++) {
+      const uint8_t *record = &chunk[j * RECORD_SIZE];
+      if (i + j > 0 && memcmp(last, record, ASSET_ID_SIZE) >= 0) {
+        return ERROR_REGISTRY_RECORD;
+      }
+      if (registry_amount(record, RECORD_SUPPLY) != 0) {
+        return ERROR_REGISTRY_SUPPLY;
+      }
+      if (created != NULL) {
+        if (memcmp(&record[RECORD_LAST_SINCE], zero,
+                   RECORD_SIZE - RECORD_LAST_SINCE) != 0) {
+          return ERROR_RATE_STATE;
+        }
+        uint8_t udt_hash[UDT_HASH_SIZE];
+        registry_udt_hash(created, record, udt_hash);
+        if (memcmp(&record[RECORD_UDT_HASH], udt_hash, UDT_HASH_SIZE) != 0) {
+          return ERROR_REGISTRY_RECORD;
+        }
+      }
+      memcpy(last, record, ASSET_ID_SIZE);
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+static int registry_load_window(size_t source, registry_window_t *window) {
+  uint64_t len = REGISTRY_HEADER_SIZE;
+  int ret = ckb_load_cell_data((uint8_t *)window, &len, 0, 0, source);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len < REGISTRY_HEADER_SIZE) {
+    return ERROR_REGISTRY_SIZE;
+  }
+  return CKB_SUCCESS;
+}
+
+/* Sets the bit of each message, then slides past the full low words */
+static int registry_relay(const mol_seg_t *messages) {
+  registry_window_t window;
+  int ret = registry_load_window(CKB_SOURCE_GROUP_INPUT, &window);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  for (uint32_t i = 0; i < messages->size; i += MESSAGE_SIZE) {
+    uint64_t id;
+    memcpy(&id, &messages->ptr[i], MESSAGE_ID_SIZE);
+    if (id < window.base) {
+      return ERROR_RELAY_REPLAY;
+    }
+    uint64_t offset = id - window.base;
+    if (offset >= WINDOW_BITS) {
+      return ERROR_RELAY_WINDOW;
+    }
+    uint64_t mask = 1ULL << (offset & 63);
+    if (window.bits[offset >> 6] & mask) {
+      return ERROR_RELAY_REPLAY;
+    }
+    window.bits[offset >> 6] |= mask;
+  }
+  size_t full = 0;
+  while (full < WINDOW_WORDS && window.bits[full] == UINT64_MAX) {
+    full++;
+  }
+  if (full > 0) {
+    memmove(window.bits, &window.bits[full],
+            (WINDOW_WORDS - full) * sizeof(uint64_t));
+    memset(&window.bits[WINDOW_WORDS - full], 0, full * sizeof(uint64_t));
+    window.base += full * 64;
+  }
+
+  registry_window_t new_window;
+  ret = registry_load_window(CKB_SOURCE_GROUP_OUTPUT, &new_window);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (memcmp(&window, &new_window, REGISTRY_HEADER_SIZE) != 0) {
+    return ERROR_RELAY_WINDOW;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Adds the amount of each message to the touched asset it mints, every
+ * message minting a non zero amount of a touched asset.
+ */
+static int registry_relay_amounts(const mol_seg_t *messages,
+                                  const mol_seg_t *diff,
+                                  registry_touched_t *touched) {
+  size_t count = diff->size / ASSET_ID_SIZE;
+  for (uint32_t i = 0; i < messages->size; i += MESSAGE_SIZE) {
+    const uint8_t *message = &messages->ptr[i];
+    size_t k = registry_find_id(diff->ptr, count, &message[MESSAGE_ASSET]);
+    if (k == count) {
+      return ERROR_RELAY_AMOUNT;
+    }
+    uint128_t amount = registry_amount(message, MESSAGE_AMOUNT);
+    if (amount == 0) {
+      return ERROR_RELAY_AMOUNT;
+    }
+    touched[k].relayed += amount;
+    if (touched[k].relayed < amount) {
+      return ERROR_OVERFLOWING;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Ascending asset ids in the input_type of the registry's witness, and
+ * processed messages in its output_type.
+ */
+static int registry_load_witness(uint8_t *witness, mol_seg_t *diff,
+                                 mol_seg_t *messages) {
+  uint64_t witness_len = MAX_WITNESS_SIZE;
+  int ret = ckb_load_witness(witness, &witness_len, 0, 0,
+                             CKB_SOURCE_GROUP_INPUT);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (witness_len > MAX_WITNESS_SIZE) {
+    return ERROR_WITNESS_SIZE;
+  }
+  mol_seg_t witness_seg;
+  witness_seg.ptr = witness;
+  witness_seg.size = witness_len;
+  if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+  mol_seg_t output_type_seg =
+      MolReader_WitnessArgs_get_output_type(&witness_seg);
+  messages->ptr = witness;
+  messages->size = 0;
+  if (!MolReader_BytesOpt_is_none(&output_type_seg)) {
+    *messages = MolReader_Bytes_raw_bytes(&output_type_seg);
+  }
+  if (messages->size % MESSAGE_SIZE != 0 ||
+      messages->size / MESSAGE_SIZE > REGISTRY_MESSAGES_MAX) {
+    return ERROR_RELAY_WINDOW;
+  }
+
+  mol_seg_t input_type_seg = MolReader_WitnessArgs_get_input_type(&witness_seg);
+  diff->ptr = witness;
+  diff->size = 0;
+  if (!MolReader_BytesOpt_is_none(&input_type_seg)) {
+    *diff = MolReader_Bytes_raw_bytes(&input_type_seg);
+  }
+  if (diff->size % ASSET_ID_SIZE != 0 ||
+      diff->size / ASSET_ID_SIZE > REGISTRY_TOUCHED_MAX) {
+    return ERROR_REGISTRY_DIFF;
+  }
+  for (uint32_t i = ASSET_ID_SIZE; i < diff->size; i += ASSET_ID_SIZE) {
+    if (memcmp(&diff->ptr[i - ASSET_ID_SIZE], &diff->ptr[i], ASSET_ID_SIZE) >=
+        0) {
+      return ERROR_REGISTRY_DIFF;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+/* Adds the UDT amounts of source to the touched assets they belong to */
+static int registry_sum_udt(size_t source, registry_touched_t *touched,
+                            size_t touched_count) {
+  for (size_t i = 0;; i++) {
+    uint8_t type_hash[UDT_HASH_SIZE];
+    uint64_t len = UDT_HASH_SIZE;
+    int ret = ckb_checked_load_cell_by_field(type_hash, &len, 0, i, source,
+                                             CKB_CELL_FIELD_TYPE_HASH);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      return CKB_SUCCESS;
+    }
+    if (ret == CKB_ITEM_MISSING) {
+      continue;
+    }
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (len != UDT_HASH_SIZE) {
+      return ERROR_ENCODING;
+    }
+    for (size_t k = 0; k < touched_count; k++) {
+      if (memcmp(type_hash, touched[k].udt_hash, UDT_HASH_SIZE) != 0) {
+        continue;
+      }
+      uint128_t amount = 0;
+      len = AMOUNT_SIZE;
+      ret = ckb_load_cell_data((uint8_t *)&amount, &len, 0, i, source);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+      if (len != AMOUNT_SIZE) {
+        return ERROR_ENCODING;
+      }
+      uint128_t *sum = source == CKB_SOURCE_INPUT ? &touched[k].inputs
+                                                  : &touched[k].outputs;
+      *sum += amount;
+      if (*sum < amount) {
+        return ERROR_OVERFLOWING;
+      }
+    }
+  }
+}
+
+/* The since of the registry input, the epoch a withdrawal happens in */
+static int registry_load_since(uint64_t *since) {
+  uint64_t len = SINCE_SIZE;
+  int ret = ckb_load_input_by_field(since, &len, 0, 0, CKB_SOURCE_GROUP_INPUT,
+                                    CKB_INPUT_FIELD_SINCE);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len != SINCE_SIZE) {
+    return ERROR_ENCODING;
+  }
+  if ((*since & SINCE_FLAGS_MASK) != SINCE_EPOCH_FLAGS) {
+    return ERROR_RATE_SINCE;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Ages the withdrawal window of a touched record to the current epoch and
+ * adds its withdrawal, then checks the new record holds the result. *since
+ * is loaded on first use. Burning a registry UDT needs its owner cell,
+ * which registry_check_owners only lets into updates touching its asset,
+ * so no burn skips this limit by leaving its asset out of the diff.
+ */
+static int registry_limit(const registry_touched_t *touched, uint64_t *since) {
+  uint8_t limit[LIMIT_SIZE];
+  memcpy(limit, touched->old_limit, LIMIT_SIZE);
+  uint128_t cap =
+      registry_amount(touched->new_limit, LIMIT(RECORD_WITHDRAW_CAP));
+  if (cap > registry_amount(limit, LIMIT(RECORD_WITHDRAW_CAP))) {
+    return ERROR_RATE_STATE;
+  }
+  if (touched->new_supply < touched->old_supply) {
+    if (*since == 0) {
+      int ret = registry_load_since(since);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+    }
+    uint64_t last;
+    memcpy(&last, &limit[LIMIT(RECORD_LAST_SINCE)], SINCE_SIZE);
+    if (last != 0) {
+      int comparable = 0;
+      int cmp = ckb_since_cmp(last, *since, &comparable);
+      if (comparable != 1 || cmp > 0) {
+        return ERROR_RATE_SINCE;
+      }
+    }
+    uint64_t epoch = SINCE_EPOCH_NUMBER(*since);
+    uint64_t last_epoch = SINCE_EPOCH_NUMBER(last);
+    uint128_t sum = registry_amount(limit, LIMIT(RECORD_WINDOW_SUM));
+    if (epoch - last_epoch >= RATE_EPOCHS) {
+      memset(&limit[LIMIT(RECORD_RING)], 0, RATE_EPOCHS * AMOUNT_SIZE);
+      sum = 0;
+    } else {
+      for (uint64_t e = last_epoch + 1; e <= epoch; e++) {
+        size_t slot = LIMIT(RECORD_RING) + (e % RATE_EPOCHS) * AMOUNT_SIZE;
+        sum -= registry_amount(limit, slot);
+        registry_set_amount(limit, slot, 0);
+      }
+    }
+    uint128_t withdrawn = touched->old_supply - touched->new_supply;
+    size_t slot = LIMIT(RECORD_RING) + (epoch % RATE_EPOCHS) * AMOUNT_SIZE;
+    uint128_t total = registry_amount(limit, slot) + withdrawn;
+    if (total < withdrawn || sum + withdrawn < withdrawn) {
+      return ERROR_OVERFLOWING;
+    }
+    sum += withdrawn;
+    if (sum > cap) {
+      return ERROR_RATE_LIMIT;
+    }
+    registry_set_amount(limit, slot, total);
+    registry_set_amount(limit, LIMIT(RECORD_WINDOW_SUM), sum);
+    memcpy(&limit[LIMIT(RECORD_LAST_SINCE)], since, SINCE_SIZE);
+  }
+  if (memcmp(&limit[LIMIT(RECORD_LAST_SINCE)],
+             &touched->new_limit[LIMIT(RECORD_LAST_SINCE)],
+             LIMIT_SIZE - LIMIT(RECORD_LAST_SINCE)) != 0) {
+    return ERROR_RATE_STATE;
+  }
+  return CKB_SUCCESS;
+}
+
+static int registry_update(registry_script_t *registry, uint64_t old_count,
+                           uint64_t new_count) {
+  uint8_t witness[MAX_WITNESS_SIZE];
+  mol_seg_t diff, messages;
+  int ret = registry_load_witness(witness, &diff, &messages);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = registry_check_owners(registry, diff.ptr, diff.size / ASSET_ID_SIZE);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = registry_relay(&messages);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  registry_touched_t touched[REGISTRY_TOUCHED_MAX];
+  size_t touched_count = diff.size / ASSET_ID_SIZE;
+  /* Loaded by the first withdrawal */
+  uint64_t since = 0;
+  uint64_t old_cursor = 0, new_cursor = 0;
+  for (size_t k = 0; k < touched_count; k++) {
+    const uint8_t *id = &diff.ptr[k * ASSET_ID_SIZE];
+    /* Ids ascend, so each search starts after the previous record */
+    uint64_t old_pos = 0, new_pos = 0;
+    int old_found = 0, new_found = 0;
+    ret = registry_search(CKB_SOURCE_GROUP_INPUT, old_cursor, old_count, id,
+                          &old_pos, &old_found);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    ret = registry_search(CKB_SOURCE_GROUP_OUTPUT, new_cursor, new_count, id,
+                          &new_pos, &new_found);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (!new_found) {
+      return ERROR_REGISTRY_RECORD;
+    }
+    /*
+     * The run before the record is unchanged, which with the ascending
+     * ids also keeps the new records sorted.
+     */
+    if (old_pos - old_cursor != new_pos - new_cursor) {
+      return ERROR_REGISTRY_UNTOUCHED;
+    }
+    ret = registry_compare_run(old_cursor, new_cursor, old_pos - old_cursor);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+
+    uint8_t new_record[RECORD_SIZE];
+    ret = registry_load(CKB_SOURCE_GROUP_OUTPUT, new_pos, new_record,
+                        RECORD_SIZE);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    memcpy(touched[k].udt_hash, &new_record[RECORD_UDT_HASH], UDT_HASH_SIZE);
+    touched[k].old_supply = 0;
+    touched[k].new_supply = registry_amount(new_record, RECORD_SUPPLY);
+    touched[k].inputs = 0;
+    touched[k].outputs = 0;
+    touched[k].relayed = 0;
+    memcpy(touched[k].new_limit, &new_record[RECORD_WITHDRAW_CAP], LIMIT_SIZE);
+    /* An inserted record starts without withdrawals, at any cap */
+    memset(touched[k].old_limit, 0, LIMIT_SIZE);
+    memcpy(touched[k].old_limit, touched[k].new_limit, AMOUNT_SIZE);
+    if (touched[k].new_supply > registry_amount(new_record, RECORD_CAP)) {
+      return ERROR_REGISTRY_SUPPLY;
+    }
+    if (old_found) {
+      uint8_t old_record[RECORD_SIZE];
+      ret = registry_load(CKB_SOURCE_GROUP_INPUT, old_pos, old_record,
+                          RECORD_SIZE);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+      if (memcmp(&old_record[RECORD_UDT_HASH], touched[k].udt_hash,
+                 UDT_HASH_SIZE) != 0) {
+        return ERROR_REGISTRY_RECORD;
+      }
+      touched[k].old_supply = registry_amount(old_record, RECORD_SUPPLY);
+      memcpy(touched[k].old_limit, &old_record[RECORD_WITHDRAW_CAP],
+             LIMIT_SIZE);
+      old_pos++;
+    } else {
+      uint8_t udt_hash[UDT_HASH_SIZE];
+      registry_udt_hash(registry, id, udt_hash);
+      if (memcmp(touched[k].udt_hash, udt_hash, UDT_HASH_SIZE) != 0) {
+        return ERROR_REGISTRY_RECORD;
+      }
+    }
+    old_cursor = old_pos;
+    new_cursor = new_pos + 1;
+  }
+  if (old_count - old_cursor != new_count - new_cursor) {
+    return ERROR_REGISTRY_UNTOUCHED;
+  }
+  ret = registry_compare_run(old_cursor, new_cursor, old_count - old_cursor);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  ret = registry_relay_amounts(&messages, &diff, touched);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  /* Issued UDT raises the supply, burned UDT lowers it */
+  ret = registry_sum_udt(CKB_SOURCE_INPUT, touched, touched_count);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = registry_sum_udt(CKB_SOURCE_OUTPUT, touched, touched_count);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  for (size_t k = 0; k < touched_count; k++) {
+    uint128_t before = touched[k].old_supply + touched[k].outputs;
+    uint128_t after = touched[k].new_supply + touched[k].inputs;
+    if (before < touched[k].outputs || after < touched[k].inputs) {
+      return ERROR_OVERFLOWING;
+    }
+    if (before != after) {
+      return ERROR_REGISTRY_SUPPLY;
+    }
+    uint128_t minted = 0;
+    if (touched[k].new_supply > touched[k].old_supply) {
+      minted = touched[k].new_supply - touched[k].old_supply;
+    }
+    if (touched[k].relayed != minted) {
+      return ERROR_RELAY_AMOUNT;
+    }
+    ret = registry_limit(&touched[k], &since);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
 int main() {
-  return 0;
+  registry_script_t registry;
+  int ret = registry_load_script(&registry);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  int has_input = 0, has_output = 0;
+  uint64_t old_count = 0, new_count = 0;
+  ret = registry_count(CKB_SOURCE_GROUP_INPUT, &has_input, &old_count);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  ret = registry_count(CKB_SOURCE_GROUP_OUTPUT, &has_output, &new_count);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (!has_input) {
+    ret = ckb_check_type_id(registry.type_id);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    /* Any base, with no message processed yet */
+    registry_window_t window;
+    ret = registry_load_window(CKB_SOURCE_GROUP_OUTPUT, &window);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    for (size_t i = 0; i < WINDOW_WORDS; i++) {
+      if (window.bits[i] != 0) {
+        return ERROR_RELAY_WINDOW;
+      }
+    }
+    return registry_check_empty(CKB_SOURCE_GROUP_OUTPUT, new_count,
+                                &registry);
+  }
+  if (!has_output) {
+    ret = registry_check_owners(&registry, NULL, 0);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    return registry_check_empty(CKB_SOURCE_GROUP_INPUT, old_count, NULL);
+  }
+  return registry_update(&registry, old_count, new_count);
 }
@@ -0,0 +1,20 @@
+/*
+ * Cycles consumed so far by the current script, through the current_cycles
+ * syscall. Only VMs implementing it, such as ckb-debugger, can run code
+ * using this.
+ */
+#ifndef CKB_CURRENT_CYCLES_H_
+#define CKB_CURRENT_CYCLES_H_
+
+#include <stdint.h>
+
+#define CKB_SYSCALL_CURRENT_CYCLES 2042
+
+static uint64_t ckb_current_cycles() {
+  register uint64_t a0 asm("a0") = 0;
+  register uint64_t a7 asm("a7") = CKB_SYSCALL_CURRENT_CYCLES;
+  asm volatile("scall" : "+r"(a0) : "r"(a7) : "memory");
+  return a0;
+}
+
+#endif
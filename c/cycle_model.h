@@ -0,0 +1,74 @@
+/*
+ * Cycle models of the primitives scripts are built from, each an upper
+ * bound for one use of the primitive on CKB-VM.
+ *
+ * Syscall and data transfer costs follow the CKB cycle rules: every
+ * syscall has a fixed cost, and every 4 bytes a syscall copies into VM
+ * memory cost one cycle, program loading included. The other figures are
+ * bounds measured on the code in this repo, they must be raised whenever a
+ * measurement exceeds them.
+ *
+ * build/cycle_bound combines them with the loop structure of each script,
+ * see deps/cycle_bound.c.
+ */
+#ifndef CKB_CYCLE_MODEL_H_
+#define CKB_CYCLE_MODEL_H_
+
+#define CKB_CYCLES_SYSCALL 500
+#define CKB_CYCLES_BYTES(n) (((n) + 3) / 4)
+
+/* Per 128 byte block, and init plus final of one digest */
+#define CKB_CYCLES_BLAKE2B_BLOCK 3000
+#define CKB_CYCLES_BLAKE2B_FIXED 3500
+/* Per 64 byte block, and init plus final of one digest */
+#define CKB_CYCLES_SHA256_BLOCK 5500
+#define CKB_CYCLES_SHA256_FIXED 6000
+/*
+ * Per 136 byte block, and a whole digest of up to 135 bytes, which is one
+ * permutation. Estimated from host runs until build/bench has measured
+ * them in the VM.
+ */
+#define CKB_CYCLES_KECCAK256_BLOCK 7000
+#define CKB_CYCLES_KECCAK256_FIXED 8000
+
+/* Recover, serialize and the verify only context setup */
+#define CKB_CYCLES_SECP_RECOVER 1300000
+/* Pubkey parse and verify, the same context setup */
+#define CKB_CYCLES_SECP_VERIFY 1250000
+/* x-only pubkey parse, BIP340 challenge and verify, the same context setup */
+#define CKB_CYCLES_SECP_SCHNORR_VERIFY 1270000
+
+/*
+ * Ed25519 decode, challenge and check of one signature alone, and per
+ * signature in a full batch. Estimated from host runs until build/bench
+ * has measured them in the VM.
+ */
+#define CKB_CYCLES_ED25519_VERIFY 2000000
+#define CKB_CYCLES_ED25519_BATCH_SIGNATURE 1000000
+
+/*
+ * Per decoded RLP item, and per trie node of a receipt proof besides
+ * hashing and decoding its items. Estimated from host runs until
+ * build/bench has measured them in the VM.
+ */
+#define CKB_CYCLES_RLP_ITEM 100
+#define CKB_CYCLES_TRIE_NODE 1500
+
+/* Per verified item, and per verified table or vector */
+#define CKB_CYCLES_MOLECULE_ITEM 150
+#define CKB_CYCLES_MOLECULE_FIXED 300
+
+/* Dynamic loading: per applied relocation and per symbol lookup */
+#define CKB_CYCLES_RELOCATION 60
+#define CKB_CYCLES_SYMBOL_LOOKUP 2500
+/* ELF header and program header checks of one ckb_loader_open */
+#define CKB_CYCLES_LOADER_FIXED 5000
+
+/* Per copied byte, memcpy and memset */
+#define CKB_CYCLES_MEMORY_BYTE 1
+
+/* Glue code of one loop iteration, and of a script run outside its loops */
+#define CKB_CYCLES_LOOP_ITERATION 100
+#define CKB_CYCLES_SCRIPT_FIXED 10000
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Ed25519 verification for crosschain light clients, e.g. the validator
+ * signatures of a Tendermint commit.
+ *
+ * A commit carries dozens of signatures, each over its own vote. Batches
+ * of them are checked with one multi-scalar multiplication, which shares
+ * the doublings and the base point multiplication between all signatures,
+ * see ed25519_check_batch. The base point table is loaded from a cell dep
+ * by data hash.
+ */
+#define __SHARED_LIBRARY__ 1
+#include "ckb_syscalls.h"
+#include "ed25519_helper.h"
+#include "ed25519_table.h"
+
+#define ERROR_ED25519_ENCODING -51
+#define ERROR_ED25519_VERIFY -52
+#define ERROR_ED25519_BATCH_SIZE -53
+
+static int prepare_items(const ed25519_item_t *items, size_t count,
+                         ed25519_prepared_t *prepared) {
+  for (size_t i = 0; i < count; i++) {
+    if (ed25519_prepare(&prepared[i], items[i].pubkey, items[i].signature,
+                        items[i].message, items[i].message_len) != 0) {
+      return ERROR_ED25519_ENCODING;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+/* Kept out of line so single verifications never touch its stack */
+static __attribute__((noinline)) int check_batch(
+    const ed25519_base_table_t *table, const ed25519_item_t *items,
+    size_t count) {
+  ed25519_prepared_t prepared[ED25519_BATCH_MAX];
+  ed25519_msm_point_t scratch[2 * ED25519_BATCH_MAX];
+  int ret = prepare_items(items, count, prepared);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ed25519_check_batch(table, prepared, count, scratch) != 0) {
+    return ERROR_ED25519_VERIFY;
+  }
+  return CKB_SUCCESS;
+}
+
+static int check(const ed25519_base_table_t *table,
+                 const ed25519_item_t *items, size_t count) {
+  if (count > 1) {
+    return check_batch(table, items, count);
+  }
+  ed25519_prepared_t prepared;
+  ed25519_msm_point_t scratch;
+  int ret = prepare_items(items, 1, &prepared);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ed25519_check(table, &prepared, &scratch) != 0) {
+    return ERROR_ED25519_VERIFY;
+  }
+  return CKB_SUCCESS;
+}
+
+/* For callers whose context carries no storage for the table */
+static __attribute__((noinline)) int check_with_stack_data(
+    ckb_tx_context_t *ctx, const ed25519_item_t *items, size_t count) {
+  uint8_t data[CKB_ED25519_DATA_SIZE];
+  const ed25519_base_table_t *table = NULL;
+  int ret = ckb_ed25519_load_table_with_context(ctx, data, &table);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return check(table, items, count);
+}
+
+static int validate(ckb_tx_context_t *ctx, const ed25519_item_t *items,
+                    size_t count) {
+  int ret = ckb_tx_context_check(ctx);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->ed25519_data == NULL ||
+      ctx->ed25519_data_size < CKB_ED25519_DATA_SIZE) {
+    return check_with_stack_data(ctx, items, count);
+  }
+  const ed25519_base_table_t *table = NULL;
+  ret = ckb_ed25519_load_table_with_context(ctx, NULL, &table);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return check(table, items, count);
+}
+
+__attribute__((visibility("default"))) int verify_ed25519(
+    ckb_tx_context_t *ctx, const ed25519_item_t *item) {
+  return validate(ctx, item, 1);
+}
+
+/*
+ * Fails as a whole if any signature is invalid, without telling which one.
+ * Callers wanting to know, e.g. to count voting power, verify one by one
+ * after a failed batch.
+ */
+__attribute__((visibility("default"))) int verify_ed25519_batch(
+    ckb_tx_context_t *ctx, const ed25519_item_t *items, size_t count) {
+  if (count == 0 || count > ED25519_BATCH_MAX) {
+    return ERROR_ED25519_BATCH_SIZE;
+  }
+  return validate(ctx, items, count);
+}
+
+CKB_EXPORT_TABLE const ed25519_table_t ed25519_table = {
+    {ED25519_TABLE_VERSION, sizeof(ed25519_table_t)},
+    verify_ed25519,
+    verify_ed25519_batch,
+};
@@ -0,0 +1,35 @@
+/*
+ * Function table exported by ed25519_lib.so
+ */
+#ifndef ED25519_TABLE_H_
+#define ED25519_TABLE_H_
+
+#include "export_table.h"
+#include "tx_context.h"
+
+#define ED25519_TABLE "ed25519_table"
+#define ED25519_TABLE_VERSION 1
+
+/*
+ * Most signatures verify_batch takes in one call, larger sets such as a
+ * big validator commit are split over several calls.
+ */
+#define ED25519_BATCH_MAX 64
+
+/* 32 byte pubkey and 64 byte signature, R then S, over a message */
+typedef struct {
+  const uint8_t *pubkey;
+  const uint8_t *signature;
+  const uint8_t *message;
+  uint64_t message_len;
+} ed25519_item_t;
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*verify)(ckb_tx_context_t *ctx, const ed25519_item_t *item);
+  int (*verify_batch)(ckb_tx_context_t *ctx, const ed25519_item_t *items,
+                      size_t count);
+} ed25519_table_t;
+
+#endif
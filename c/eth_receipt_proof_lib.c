@@ -0,0 +1,305 @@
+/*
+ * Ethereum receipt proofs for crosschain deposits, e.g. the lock event an
+ * ERC-20 bridge contract emits on Ethereum.
+ *
+ * The receipts of a block form a Merkle-Patricia trie keyed by the RLP of
+ * the transaction index, whose root is in the block header. A proof is the
+ * RLP list of the trie nodes from the root down to the receipt, as
+ * returned by eth_getProof style tooling. It is walked node by node inside
+ * the caller's buffer, each node hashed in place and decoded without
+ * copies, so the receipt and its logs come back as slices of the proof.
+ *
+ * Trusting the receipts root, i.e. the block header, is up to the caller.
+ */
+#define __SHARED_LIBRARY__ 1
+#include "ckb_syscalls.h"
+#include "eth_receipt_proof_table.h"
+#include "keccak256.h"
+#include "rlp.h"
+
+#define ERROR_RLP_ENCODING -51
+#define ERROR_PROOF_HASH -52
+#define ERROR_PROOF_NODE -53
+#define ERROR_PROOF_KEY -54
+#define ERROR_RECEIPT_STATUS -55
+#define ERROR_LOG_NOT_FOUND -56
+
+/* Nodes are a branch of 16 children and a value, or a path and a child */
+#define BRANCH_ITEMS 17
+#define BRANCH_VALUE 16
+#define SHORT_ITEMS 2
+/* Flags in the high nibble of a hex prefix encoded path */
+#define PATH_ODD 1
+#define PATH_LEAF 2
+/* RLP of a transaction index, at most a prefix and 8 bytes */
+#define KEY_SIZE 9
+/* Types are single bytes below the first RLP list prefix */
+#define RECEIPT_TYPE_MAX 0x7f
+
+#define RECEIPT_ITEMS 4
+#define RECEIPT_STATUS 0
+#define RECEIPT_LOGS 3
+#define LOG_ITEMS 3
+#define STATUS_SUCCESS 1
+
+static size_t encode_key(uint64_t tx_index, uint8_t *key) {
+  if (tx_index == 0) {
+    key[0] = RLP_STRING_SHORT;
+    return 1;
+  }
+  if (tx_index < RLP_STRING_SHORT) {
+    key[0] = (uint8_t)tx_index;
+    return 1;
+  }
+  size_t n = 0;
+  for (uint64_t v = tx_index; v != 0; v >>= 8) {
+    n++;
+  }
+  key[0] = RLP_STRING_SHORT + n;
+  for (size_t i = 0; i < n; i++) {
+    key[n - i] = (uint8_t)(tx_index >> (8 * i));
+  }
+  return n + 1;
+}
+
+static uint8_t nibble(const uint8_t *bytes, size_t i) {
+  return (i & 1) ? (bytes[i >> 1] & 0x0f) : (bytes[i >> 1] >> 4);
+}
+
+/*
+ * Matches the hex prefix encoded path of an extension or leaf against the
+ * key from nibble *pos on, moving *pos past it.
+ */
+static int match_path(const rlp_item_t *path, const uint8_t *key,
+                      size_t key_nibbles, size_t *pos, int *is_leaf) {
+  if (path->is_list || path->payload.size == 0) {
+    return ERROR_PROOF_NODE;
+  }
+  const uint8_t *p = path->payload.ptr;
+  uint8_t flags = p[0] >> 4;
+  if (flags > (PATH_ODD | PATH_LEAF) ||
+      (!(flags & PATH_ODD) && (p[0] & 0x0f) != 0)) {
+    return ERROR_PROOF_NODE;
+  }
+  /* Nibble 0 holds the flags, 1 is padding unless the path is odd */
+  size_t start = (flags & PATH_ODD) ? 1 : 2;
+  size_t length = 2 * (size_t)path->payload.size - start;
+  if (length > key_nibbles - *pos) {
+    return ERROR_PROOF_KEY;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (nibble(p, start + i) != nibble(key, *pos + i)) {
+      return ERROR_PROOF_KEY;
+    }
+  }
+  *pos += length;
+  *is_leaf = (flags & PATH_LEAF) != 0;
+  return CKB_SUCCESS;
+}
+
+/*
+ * Walks from the root to the value stored under key. Children of at least
+ * 32 bytes are referenced by hash and are the next node of the proof,
+ * smaller ones are embedded in their parent and decoded right there.
+ */
+static int walk_proof(const uint8_t *root, const uint8_t *key,
+                      size_t key_nibbles, rlp_seg_t proof,
+                      rlp_item_t *value) {
+  rlp_item_t proof_item;
+  if (rlp_decode(proof, &proof_item) != 0 || !proof_item.is_list) {
+    return ERROR_RLP_ENCODING;
+  }
+  rlp_seg_t nodes = proof_item.payload;
+  const uint8_t *expected = root;
+  rlp_item_t node;
+  size_t pos = 0;
+  while (1) {
+    if (expected != NULL) {
+      rlp_item_t encoded;
+      if (rlp_next(&nodes, &encoded) != 0 || encoded.is_list) {
+        return ERROR_PROOF_NODE;
+      }
+      uint8_t hash[KECCAK256_HASH_SIZE];
+      keccak256(encoded.payload.ptr, encoded.payload.size, hash);
+      if (memcmp(hash, expected, KECCAK256_HASH_SIZE) != 0) {
+        return ERROR_PROOF_HASH;
+      }
+      if (rlp_decode(encoded.payload, &node) != 0) {
+        return ERROR_RLP_ENCODING;
+      }
+    }
+
+    rlp_item_t items[BRANCH_ITEMS];
+    size_t count = 0;
+    if (rlp_list_items(&node, items, BRANCH_ITEMS, &count) != 0) {
+      return ERROR_PROOF_NODE;
+    }
+    const rlp_item_t *child = NULL;
+    if (count == BRANCH_ITEMS) {
+      if (pos == key_nibbles) {
+        *value = items[BRANCH_VALUE];
+        break;
+      }
+      child = &items[nibble(key, pos++)];
+    } else if (count == SHORT_ITEMS) {
+      int is_leaf = 0;
+      int ret = match_path(&items[0], key, key_nibbles, &pos, &is_leaf);
+      if (ret != CKB_SUCCESS) {
+        return ret;
+      }
+      if (is_leaf) {
+        if (pos != key_nibbles) {
+          return ERROR_PROOF_KEY;
+        }
+        *value = items[1];
+        break;
+      }
+      child = &items[1];
+    } else {
+      return ERROR_PROOF_NODE;
+    }
+
+    if (child->is_list) {
+      node = *child;
+      expected = NULL;
+    } else if (rlp_is_string(child, KECCAK256_HASH_SIZE)) {
+      expected = child->payload.ptr;
+    } else if (child->payload.size == 0) {
+      /* An empty slot, nothing is stored under the key */
+      return ERROR_PROOF_KEY;
+    } else {
+      return ERROR_PROOF_NODE;
+    }
+  }
+  /* A proof carries the path and nothing else */
+  if (nodes.size != 0) {
+    return ERROR_PROOF_NODE;
+  }
+  if (value->is_list || value->payload.size == 0) {
+    return ERROR_PROOF_KEY;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * proof is the RLP list of the encoded trie nodes, root first. On success
+ * receipt points into proof, which must stay alive while it is used.
+ */
+__attribute__((visibility("default"))) int verify_eth_receipt(
+    const uint8_t *receipts_root, uint64_t tx_index, const uint8_t *proof,
+    uint64_t proof_size, eth_receipt_t *receipt) {
+  if (proof_size > UINT32_MAX) {
+    return ERROR_RLP_ENCODING;
+  }
+  uint8_t key[KEY_SIZE];
+  size_t key_size = encode_key(tx_index, key);
+  rlp_seg_t proof_seg = {proof, (uint32_t)proof_size};
+  rlp_item_t value;
+  int ret = walk_proof(receipts_root, key, 2 * key_size, proof_seg, &value);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  /* Typed receipts are the type byte followed by the RLP list */
+  rlp_seg_t encoded = value.payload;
+  uint8_t type = 0;
+  if (encoded.ptr[0] <= RECEIPT_TYPE_MAX) {
+    type = encoded.ptr[0];
+    encoded.ptr++;
+    encoded.size--;
+  }
+  rlp_item_t fields;
+  if (rlp_decode(encoded, &fields) != 0 || !fields.is_list) {
+    return ERROR_RLP_ENCODING;
+  }
+  receipt->type = type;
+  receipt->fields = fields.payload.ptr;
+  receipt->fields_size = fields.payload.size;
+  return CKB_SUCCESS;
+}
+
+static int decode_log(const rlp_item_t *item, eth_log_t *log) {
+  rlp_item_t fields[LOG_ITEMS];
+  size_t count = 0;
+  if (rlp_list_items(item, fields, LOG_ITEMS, &count) != 0 ||
+      count != LOG_ITEMS) {
+    return ERROR_RLP_ENCODING;
+  }
+  rlp_item_t topics[ETH_LOG_TOPICS_MAX];
+  if (rlp_list_items(&fields[1], topics, ETH_LOG_TOPICS_MAX, &count) != 0 ||
+      fields[2].is_list) {
+    return ERROR_RLP_ENCODING;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (!rlp_is_string(&topics[i], ETH_HASH_SIZE)) {
+      return ERROR_RLP_ENCODING;
+    }
+    log->topics[i] = topics[i].payload.ptr;
+  }
+  log->topic_count = count;
+  log->data = fields[2].payload.ptr;
+  log->data_size = fields[2].payload.size;
+  return CKB_SUCCESS;
+}
+
+/*
+ * Finds the first log from index start on emitted by address with topic
+ * as its first topic, the event signature. Logs of other contracts are
+ * skipped after reading their address, without decoding topics or data.
+ */
+__attribute__((visibility("default"))) int find_eth_log(
+    const eth_receipt_t *receipt, const uint8_t *address, const uint8_t *topic,
+    uint64_t start, eth_log_t *log) {
+  rlp_item_t receipt_item;
+  receipt_item.is_list = 1;
+  receipt_item.payload.ptr = receipt->fields;
+  receipt_item.payload.size = (uint32_t)receipt->fields_size;
+  rlp_item_t fields[RECEIPT_ITEMS];
+  size_t count = 0;
+  if (rlp_list_items(&receipt_item, fields, RECEIPT_ITEMS, &count) != 0 ||
+      count != RECEIPT_ITEMS || !fields[RECEIPT_LOGS].is_list) {
+    return ERROR_RLP_ENCODING;
+  }
+  /* Reverted transactions keep no logs, this guards the odd receipt */
+  uint64_t status = 0;
+  if (rlp_uint64(&fields[RECEIPT_STATUS], &status) != 0 ||
+      status != STATUS_SUCCESS) {
+    return ERROR_RECEIPT_STATUS;
+  }
+
+  rlp_seg_t logs = fields[RECEIPT_LOGS].payload;
+  for (uint64_t index = 0; logs.size > 0; index++) {
+    rlp_item_t item;
+    if (rlp_next(&logs, &item) != 0 || !item.is_list) {
+      return ERROR_RLP_ENCODING;
+    }
+    if (index < start) {
+      continue;
+    }
+    rlp_seg_t cursor = item.payload;
+    rlp_item_t log_address;
+    if (rlp_next(&cursor, &log_address) != 0 ||
+        !rlp_is_string(&log_address, ETH_ADDRESS_SIZE)) {
+      return ERROR_RLP_ENCODING;
+    }
+    if (memcmp(log_address.payload.ptr, address, ETH_ADDRESS_SIZE) != 0) {
+      continue;
+    }
+    int ret = decode_log(&item, log);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (log->topic_count > 0 &&
+        memcmp(log->topics[0], topic, ETH_HASH_SIZE) == 0) {
+      log->index = index;
+      return CKB_SUCCESS;
+    }
+  }
+  return ERROR_LOG_NOT_FOUND;
+}
+
+CKB_EXPORT_TABLE const eth_receipt_proof_table_t eth_receipt_proof_table = {
+    {ETH_RECEIPT_PROOF_TABLE_VERSION, sizeof(eth_receipt_proof_table_t)},
+    verify_eth_receipt,
+    find_eth_log,
+};
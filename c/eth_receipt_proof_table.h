@@ -0,0 +1,46 @@
+/*
+ * Function table exported by eth_receipt_proof_lib.so
+ */
+#ifndef ETH_RECEIPT_PROOF_TABLE_H_
+#define ETH_RECEIPT_PROOF_TABLE_H_
+
+#include "export_table.h"
+
+#define ETH_RECEIPT_PROOF_TABLE "eth_receipt_proof_table"
+#define ETH_RECEIPT_PROOF_TABLE_VERSION 1
+
+#define ETH_HASH_SIZE 32
+#define ETH_ADDRESS_SIZE 20
+/* LOG0 to LOG4 */
+#define ETH_LOG_TOPICS_MAX 4
+
+/* A receipt proven against a receipts root, pointing into the proof */
+typedef struct {
+  /* EIP-2718 transaction type, 0 for legacy receipts */
+  uint8_t type;
+  /* Payload of [status, cumulative gas used, logs bloom, logs] */
+  const uint8_t *fields;
+  uint64_t fields_size;
+} eth_receipt_t;
+
+/* A log of a receipt, pointing into the proof as well */
+typedef struct {
+  /* Position in the logs of the receipt */
+  uint64_t index;
+  const uint8_t *topics[ETH_LOG_TOPICS_MAX];
+  uint64_t topic_count;
+  const uint8_t *data;
+  uint64_t data_size;
+} eth_log_t;
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*verify_receipt)(const uint8_t *receipts_root, uint64_t tx_index,
+                        const uint8_t *proof, uint64_t proof_size,
+                        eth_receipt_t *receipt);
+  int (*find_log)(const eth_receipt_t *receipt, const uint8_t *address,
+                  const uint8_t *topic, uint64_t start, eth_log_t *log);
+} eth_receipt_proof_table_t;
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * Versioned function tables exported by dynamically loaded libraries.
+ *
+ * Instead of one symbol per entry point, a library exports a single const
+ * table whose first member is ckb_export_table_header_t. Callers resolve it
+ * with one ckb_loader_table lookup. Entries may only be appended: a new
+ * entry bumps the version, so a caller asking for version N can use every
+ * entry up to and including those introduced in N.
+ */
+#ifndef CKB_EXPORT_TABLE_H_
+#define CKB_EXPORT_TABLE_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t version;
+  /* sizeof the full table as compiled into the library */
+  uint32_t size;
+} ckb_export_table_header_t;
+
+#define CKB_EXPORT_TABLE __attribute__((visibility("default")))
+
+#endif
@@ -1,12 +1,25 @@
 /*
  * A simple HTLC script designed to be compatible with liquality.io
+ *
+ * A covenant mode serves swaps whose destinations are fixed up front: the
+ * args commit to the lock hashes the cell goes to, and settling only
+ * checks that the outputs pay them, without any signature.
  */
 #include "blockchain.h"
-#include "ckb_dlfcn.h"
+#include "bundle.h"
+#include "ckb_loader.h"
 #include "ckb_syscalls.h"
 #include "ckb_utils.h"
+#include "memory_layout.h"
 #include "secp256k1_blake2b_sighash_all_lib.h"
+#include "secp256k1_blake2b_sighash_all_lib_prelinked.h"
+#include "secp256k1_blake2b_sighash_all_table.h"
+#include "secp256k1_data_info.h"
 #include "sha256.h"
+#include "stage_trace.h"
+#include "timeout.h"
+#include "tx_context.h"
+#include "witness_lock.h"
 
 #define ERROR_ARGUMENTS_LEN -1
 #define ERROR_ENCODING -2
@@ -20,11 +33,16 @@
 #define ERROR_WITNESS_SIZE -22
 #define ERROR_PUBKEY_BLAKE160_HASH -31
 #define ERROR_SECRET_HASH -101
-#define ERROR_INCORRECT_SINCE -102
 #define ERROR_DYNAMIC_LOADING -103
+#define ERROR_COVENANT_LOCK -104
+#define ERROR_COVENANT_CAPACITY -105
+#define ERROR_COVENANT_TYPE -106
+#define ERROR_COVENANT_DATA -107
 
 #define BLAKE2B_BLOCK_SIZE 32
 #define BLAKE160_SIZE 20
+#define LOCK_HASH_SIZE 32
+#define CAPACITY_SIZE 8
 #define PUBKEY_SIZE 33
 /* 32 KB */
 #define MAX_WITNESS_SIZE 32768
@@ -32,60 +50,175 @@
 #define SIGNATURE_SIZE 65
 
 #define SCRIPT_ARG_SIZE (BLAKE160_SIZE * 2 + SHA256_BLOCK_SIZE + 8)
+#define COVENANT_ARG_SIZE (LOCK_HASH_SIZE * 2 + SHA256_BLOCK_SIZE + 8)
 
-/* Extract lock from WitnessArgs */
-int extract_witness_lock(uint8_t *witness, uint64_t len,
-                         mol_seg_t *lock_bytes_seg) {
-  mol_seg_t witness_seg;
-  witness_seg.ptr = witness;
-  witness_seg.size = len;
+#define SECP_CODE_SIZE (100 * 1024)
 
-  if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
-    return ERROR_ENCODING;
+/*
+ * Linked at DL_ARENA_BASE by build/dl_arena.ld, the address the prelinked
+ * sighash library image has been relocated for.
+ */
+static uint8_t secp_code_buffer[SECP_CODE_SIZE]
+    __attribute__((section(".dl_arena"), aligned(RISCV_PGSIZE)));
+
+/*
+ * Memory plan. The script is only needed until its args are copied out,
+ * and the secp256k1 tables only while verifying, so the two share memory.
+ */
+typedef struct {
+  uint8_t script[SCRIPT_SIZE];
+} htlc_parse_phase_t;
+
+typedef struct {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+} htlc_verify_phase_t;
+
+static struct {
+  /* Alive for the whole run */
+  uint8_t args[COVENANT_ARG_SIZE];
+  uint8_t signature[SIGNATURE_SIZE];
+  uint8_t witness[MAX_WITNESS_SIZE];
+  union {
+    htlc_parse_phase_t parse;
+    htlc_verify_phase_t verify;
+  } phase;
+} htlc_memory;
+
+/*
+ * Compares a hash field of input i and output i, both absent counts as
+ * equal. Returns 1 when they match, 0 when not, or an error.
+ */
+static int covenant_field_matches(size_t i, size_t field) {
+  uint8_t input_hash[LOCK_HASH_SIZE];
+  uint8_t output_hash[LOCK_HASH_SIZE];
+  uint64_t len = LOCK_HASH_SIZE;
+  int input_ret =
+      ckb_load_cell_by_field(input_hash, &len, 0, i, CKB_SOURCE_INPUT, field);
+  if (input_ret == CKB_SUCCESS && len != LOCK_HASH_SIZE) {
+    return ERROR_SYSCALL;
+  }
+  len = LOCK_HASH_SIZE;
+  int output_ret =
+      ckb_load_cell_by_field(output_hash, &len, 0, i, CKB_SOURCE_OUTPUT, field);
+  if (output_ret == CKB_SUCCESS && len != LOCK_HASH_SIZE) {
+    return ERROR_SYSCALL;
   }
-  mol_seg_t lock_seg = MolReader_WitnessArgs_get_lock(&witness_seg);
+  if ((input_ret != CKB_SUCCESS && input_ret != CKB_ITEM_MISSING) ||
+      (output_ret != CKB_SUCCESS && output_ret != CKB_ITEM_MISSING)) {
+    return ERROR_SYSCALL;
+  }
+  if (input_ret != output_ret) {
+    return 0;
+  }
+  return input_ret == CKB_ITEM_MISSING ||
+         memcmp(input_hash, output_hash, LOCK_HASH_SIZE) == 0;
+}
 
-  if (MolReader_BytesOpt_is_none(&lock_seg)) {
-    return ERROR_ENCODING;
+/*
+ * Covenant mode: every input of the group is paid forward by the output
+ * at the same index, locked by lock_hash, holding at least the input's
+ * capacity and carrying the input's type script and data unchanged.
+ * Pairing outputs with input indices keeps one output from settling two
+ * HTLCs that share a destination. The fee comes from other inputs.
+ */
+static int check_covenant(const uint8_t *lock_hash) {
+  uint8_t script_hash[LOCK_HASH_SIZE];
+  uint64_t len = LOCK_HASH_SIZE;
+  int ret = ckb_load_script_hash(script_hash, &len, 0);
+  if (ret != CKB_SUCCESS || len != LOCK_HASH_SIZE) {
+    return ERROR_SYSCALL;
+  }
+
+  size_t i = 0;
+  while (1) {
+    uint8_t hash[LOCK_HASH_SIZE];
+    len = LOCK_HASH_SIZE;
+    ret = ckb_load_cell_by_field(hash, &len, 0, i, CKB_SOURCE_INPUT,
+                                 CKB_CELL_FIELD_LOCK_HASH);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      break;
+    }
+    if (ret != CKB_SUCCESS || len != LOCK_HASH_SIZE) {
+      return ERROR_SYSCALL;
+    }
+    if (memcmp(hash, script_hash, LOCK_HASH_SIZE) != 0) {
+      i += 1;
+      continue;
+    }
+
+    uint64_t input_capacity = 0;
+    len = CAPACITY_SIZE;
+    ret = ckb_load_cell_by_field(&input_capacity, &len, 0, i,
+                                 CKB_SOURCE_INPUT, CKB_CELL_FIELD_CAPACITY);
+    if (ret != CKB_SUCCESS || len != CAPACITY_SIZE) {
+      return ERROR_SYSCALL;
+    }
+    len = LOCK_HASH_SIZE;
+    ret = ckb_load_cell_by_field(hash, &len, 0, i, CKB_SOURCE_OUTPUT,
+                                 CKB_CELL_FIELD_LOCK_HASH);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      return ERROR_COVENANT_LOCK;
+    }
+    if (ret != CKB_SUCCESS || len != LOCK_HASH_SIZE) {
+      return ERROR_SYSCALL;
+    }
+    if (memcmp(hash, lock_hash, LOCK_HASH_SIZE) != 0) {
+      return ERROR_COVENANT_LOCK;
+    }
+    uint64_t output_capacity = 0;
+    len = CAPACITY_SIZE;
+    ret = ckb_load_cell_by_field(&output_capacity, &len, 0, i,
+                                 CKB_SOURCE_OUTPUT, CKB_CELL_FIELD_CAPACITY);
+    if (ret != CKB_SUCCESS || len != CAPACITY_SIZE) {
+      return ERROR_SYSCALL;
+    }
+    if (output_capacity < input_capacity) {
+      return ERROR_COVENANT_CAPACITY;
+    }
+    ret = covenant_field_matches(i, CKB_CELL_FIELD_TYPE_HASH);
+    if (ret != 1) {
+      return ret == 0 ? ERROR_COVENANT_TYPE : ret;
+    }
+    ret = covenant_field_matches(i, CKB_CELL_FIELD_DATA_HASH);
+    if (ret != 1) {
+      return ret == 0 ? ERROR_COVENANT_DATA : ret;
+    }
+    i += 1;
   }
-  *lock_bytes_seg = MolReader_Bytes_raw_bytes(&lock_seg);
   return CKB_SUCCESS;
 }
 
 /*
  * Arguments:
- * two 20-byte pubkey blake160 hashes, one 32-byte secret hash, as well as
- * one 8-byte lock time.
+ * two 20-byte pubkey blake160 hashes, refund key first, one 32-byte secret
+ * hash, as well as one 8-byte lock time. In covenant mode the two hashes
+ * are 32-byte lock hashes instead, refund lock first.
  *
  * Witness:
  * WitnessArgs with the following items in lock field:
- * * 65 byte recoverable signature
+ * * 65 byte recoverable signature, absent in covenant mode
  * * Optional data use to generate secret hash
+ *
+ * Validation runs in stages ordered by cost, so a transaction failing a
+ * cheap check never pays for loading the secp256k1 library:
+ *
+ * 1. parse: load and decode script args and the witness
+ * 2. predicates: sizes, the secret hash or the since lock time
+ * 3. load: dynamically load the sighash library
+ * 4. verify: signature check against the selected pubkey hash
+ *
+ * Covenant mode replaces stages 3 and 4 with the output checks of
+ * check_covenant.
  */
 int main() {
-  uint8_t secp_code_buffer[100 * 1024] __attribute__((aligned(RISCV_PGSIZE)));
-  uint8_t *aligned_code_start = secp_code_buffer;
-  size_t aligned_size = ROUNDDOWN(100 * 1024, RISCV_PGSIZE);
-
-  void *handle = NULL;
-  uint64_t consumed_size = 0;
-  int ret =
-      ckb_dlopen(secp256k1_blake2b_sighash_all_data_hash, aligned_code_start,
-                 aligned_size, &handle, &consumed_size);
-  if (ret != CKB_SUCCESS) {
-    return ret;
-  }
-  int (*verify_func)(const uint8_t *, const uint8_t *, const uint8_t *, size_t);
-  *(void **)(&verify_func) =
-      ckb_dlsym(handle, "validate_secp256k1_blake2b_sighash_all");
-  if (verify_func == NULL) {
-    return ERROR_DYNAMIC_LOADING;
-  }
+  CKB_MEMORY_PHASE(htlc, parse, sizeof(htlc_parse_phase_t));
+  CKB_MEMORY_PHASE(htlc, verify, sizeof(htlc_verify_phase_t));
 
-  /* Load args */
-  unsigned char script[SCRIPT_SIZE];
+  /* Stage 1: parse */
+  STAGE("parse");
+  uint8_t *script = htlc_memory.phase.parse.script;
   uint64_t len = SCRIPT_SIZE;
-  ret = ckb_load_script(script, &len, 0);
+  int ret = ckb_load_script(script, &len, 0);
   if (ret != CKB_SUCCESS) {
     return ERROR_SYSCALL;
   }
@@ -102,12 +235,20 @@ int main() {
 
   mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
   mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
-  if (args_bytes_seg.size != SCRIPT_ARG_SIZE) {
+  BUNDLE_STRIP_TAG(args_bytes_seg);
+  int covenant = args_bytes_seg.size == COVENANT_ARG_SIZE;
+  if (!covenant && args_bytes_seg.size != SCRIPT_ARG_SIZE) {
     return ERROR_ARGUMENTS_LEN;
   }
+  /* Size of each of the two destinations, and of the witness signature */
+  size_t key_size = covenant ? LOCK_HASH_SIZE : BLAKE160_SIZE;
+  uint64_t signature_size = covenant ? 0 : SIGNATURE_SIZE;
+  /* The script buffer is reused once parsing is done */
+  memcpy(htlc_memory.args, args_bytes_seg.ptr, args_bytes_seg.size);
+  args_bytes_seg.ptr = htlc_memory.args;
 
   /* Load witness of first input */
-  unsigned char witness[MAX_WITNESS_SIZE];
+  uint8_t *witness = htlc_memory.witness;
   uint64_t witness_len = MAX_WITNESS_SIZE;
   ret = ckb_load_witness(witness, &witness_len, 0, 0, CKB_SOURCE_GROUP_INPUT);
   if (ret != CKB_SUCCESS) {
@@ -120,61 +261,79 @@ int main() {
 
   /* load signature */
   mol_seg_t lock_bytes_seg;
-  ret = extract_witness_lock(witness, witness_len, &lock_bytes_seg);
+  ret = ckb_extract_witness_lock(witness, witness_len, &lock_bytes_seg);
   if (ret != 0) {
     return ERROR_ENCODING;
   }
 
+  /* Stage 2: cheap predicates */
+  STAGE("predicates");
   uint64_t lock_bytes_len = lock_bytes_seg.size;
-  if (lock_bytes_len < SIGNATURE_SIZE || lock_bytes_len > MAX_WITNESS_SIZE) {
+  if (lock_bytes_len < signature_size || lock_bytes_len > MAX_WITNESS_SIZE) {
     return ERROR_ARGUMENTS_LEN;
   }
-  unsigned char lock_bytes[MAX_WITNESS_SIZE];
-  memcpy(lock_bytes, lock_bytes_seg.ptr, lock_bytes_len);
 
-  /* Clear lock field to zero for the first witness */
-  memset((void *)lock_bytes_seg.ptr, 0, lock_bytes_len);
-
-  if (lock_bytes_len > SIGNATURE_SIZE) {
+  const uint8_t *pubkey_hash = NULL;
+  if (lock_bytes_len > signature_size) {
     unsigned char secret_hash[SHA256_BLOCK_SIZE];
     SHA256_CTX sha256_ctx;
     sha256_init(&sha256_ctx);
-    sha256_update(&sha256_ctx, &lock_bytes[SIGNATURE_SIZE],
-                  lock_bytes_len - SIGNATURE_SIZE);
+    sha256_update(&sha256_ctx, &lock_bytes_seg.ptr[signature_size],
+                  lock_bytes_len - signature_size);
     sha256_final(&sha256_ctx, secret_hash);
-    if (memcmp(&args_bytes_seg.ptr[BLAKE160_SIZE * 2], secret_hash,
+    if (memcmp(&args_bytes_seg.ptr[key_size * 2], secret_hash,
                SHA256_BLOCK_SIZE) != 0) {
       return ERROR_SECRET_HASH;
     }
-    ret = verify_func(&args_bytes_seg.ptr[BLAKE160_SIZE], lock_bytes, witness,
-                      witness_len);
-    if (ret != CKB_SUCCESS) {
-      return ret;
-    }
+    pubkey_hash = &args_bytes_seg.ptr[key_size];
   } else {
-    uint64_t since =
-        *((uint64_t *)(&args_bytes_seg
-                            .ptr[BLAKE160_SIZE * 2 + SHA256_BLOCK_SIZE]));
-    uint64_t input_since = 0;
-    len = 8;
-    ret =
-        ckb_load_input_by_field(&input_since, &len, 0, 0,
-                                CKB_SOURCE_GROUP_INPUT, CKB_INPUT_FIELD_SINCE);
-    if (ret != CKB_SUCCESS) {
-      return ret;
-    }
-    if (len != 8) {
-      return ERROR_SYSCALL;
-    }
-    int comparable = 0;
-    int cmp = ckb_since_cmp(since, input_since, &comparable);
-    if (comparable != 1 || cmp > 0) {
-      return ERROR_INCORRECT_SINCE;
-    }
-    ret = verify_func(args_bytes_seg.ptr, lock_bytes, witness, witness_len);
+    uint64_t since = *(
+        (uint64_t *)(&args_bytes_seg.ptr[key_size * 2 + SHA256_BLOCK_SIZE]));
+    ret = ckb_check_timeout(since);
     if (ret != CKB_SUCCESS) {
       return ret;
     }
+    pubkey_hash = args_bytes_seg.ptr;
   }
-  return CKB_SUCCESS;
+
+  if (covenant) {
+    STAGE("covenant");
+    ret = check_covenant(pubkey_hash);
+    STAGE("done");
+    return ret;
+  }
+
+  /* Stage 3: load the signature library */
+  STAGE("load");
+  const secp256k1_blake2b_sighash_all_table_t *table = NULL;
+  ret = ckb_loader_open_table(
+      secp256k1_blake2b_sighash_all_prelinked_data_hash,
+      secp256k1_blake2b_sighash_all_data_hash, secp_code_buffer, SECP_CODE_SIZE,
+      SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE,
+      SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_VERSION, sizeof(*table),
+      (const void **)&table);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (table == NULL) {
+    return ERROR_DYNAMIC_LOADING;
+  }
+
+  /* Stage 4: signature verification */
+  STAGE("verify");
+  memcpy(htlc_memory.signature, lock_bytes_seg.ptr, SIGNATURE_SIZE);
+
+  /* Clear lock field to zero for the first witness */
+  memset((void *)lock_bytes_seg.ptr, 0, lock_bytes_len);
+
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  ckb_tx_context_set_first_witness(&tx_ctx, witness, witness_len);
+  tx_ctx.secp_data = htlc_memory.phase.verify.secp_data;
+  tx_ctx.secp_data_size = sizeof(htlc_memory.phase.verify.secp_data);
+
+  ret = table->validate_with_context(&tx_ctx, pubkey_hash,
+                                     htlc_memory.signature);
+  STAGE("done");
+  return ret;
 }
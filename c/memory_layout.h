@@ -0,0 +1,33 @@
+/*
+ * Static memory planning for scripts.
+ *
+ * Instead of stacking large buffers on the stack, a script describes its
+ * memory as phases: one struct per phase holding the buffers that are only
+ * alive during that phase. The phase structs are overlaid in a union inside
+ * one static arena, so buffers whose lifetimes don't overlap share memory.
+ * Buffers needed across phases are plain members of the arena next to the
+ * union.
+ *
+ * CKB_MEMORY_PHASE records the size of a phase as an absolute symbol named
+ * __ckb_memory_<script>_<phase>. Such symbols take no memory and survive
+ * section garbage collection. build/memory_report reads them back from the
+ * unstripped binary and prints the peak memory of each script against the
+ * VM limit, see `make memory-report`.
+ */
+#ifndef CKB_MEMORY_LAYOUT_H_
+#define CKB_MEMORY_LAYOUT_H_
+
+/* Memory of one CKB-VM instance, code, data and stack included */
+#define CKB_VM_MEMORY_SIZE (4 * 1024 * 1024)
+
+#define CKB_MEMORY_SYMBOL_PREFIX "__ckb_memory_"
+
+/* Must be used inside a function, it emits assembler directives only */
+#define CKB_MEMORY_PHASE(script, phase, size)                         \
+  asm volatile(".globl " CKB_MEMORY_SYMBOL_PREFIX #script "_" #phase \
+               "\n.set " CKB_MEMORY_SYMBOL_PREFIX #script "_" #phase \
+               ", %c0"                                                \
+               :                                                      \
+               : "i"(size))
+
+#endif
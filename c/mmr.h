@@ -0,0 +1,184 @@
+/*
+ * Append only Merkle mountain range over 32 byte blake2b hashes, shared by
+ * c/crosschain_queue.c and the host proof tool deps/mmr_proof.c.
+ *
+ * An MMR of n leaves is a list of perfect binary trees, one of height h
+ * for every bit h set in n, highest first. Only their roots, the peaks,
+ * are kept:
+ *
+ * 8 byte leaf count | 32 byte peak...
+ *
+ * so the state of n leaves is MMR_DATA_SIZE(n) bytes. Appending a leaf
+ * pushes it as a new peak of height 0 and merges the two lowest peaks for
+ * as long as they have the same height, the carries of n + 1. Appending k
+ * leaves to n costs k + popcount(n) - popcount(n + k) merges, at most
+ * k + 63, and no leaf is ever read again.
+ *
+ * The root of the MMR is the blake2b hash of the state, which for a state
+ * kept as cell data is its data hash. An inclusion proof of leaf i is the
+ * path of siblings from the leaf up to its peak plus the other peaks, see
+ * mmr_verify. Leaves and inner nodes are not domain separated, the leaf
+ * index of a proof fixes the height of every node on the path.
+ *
+ * Hashes are blake2b-256 with the ckb-default-hash personalization, a
+ * leaf is the hash of its message and an inner node the hash of its two
+ * children. The 64 bytes of a merge are one compression, so mmr_merge
+ * skips blake2b_init, update and final and compresses a single block from
+ * a state initialized once in mmr_init.
+ */
+#ifndef CKB_MMR_H_
+#define CKB_MMR_H_
+
+#include "blake2b.h"
+
+#define MMR_HASH_SIZE 32
+#define MMR_COUNT_SIZE 8
+/* One peak per bit of the leaf count */
+#define MMR_PEAKS_MAX 64
+#define MMR_DATA_SIZE(count) \
+  (MMR_COUNT_SIZE + (uint64_t)__builtin_popcountll(count) * MMR_HASH_SIZE)
+#define MMR_DATA_SIZE_MAX (MMR_COUNT_SIZE + MMR_PEAKS_MAX * MMR_HASH_SIZE)
+
+#define MMR_ERROR_SIZE -1
+#define MMR_ERROR_FULL -2
+#define MMR_ERROR_PROOF -3
+
+typedef struct {
+  uint64_t count;
+  /* Highest first, peak_count is popcount(count) */
+  uint8_t peaks[MMR_PEAKS_MAX][MMR_HASH_SIZE];
+  uint64_t peak_count;
+  /* blake2b state right after init, every merge starts from it */
+  blake2b_state merge;
+} mmr_t;
+
+static void mmr_init(mmr_t *mmr) {
+  mmr->count = 0;
+  mmr->peak_count = 0;
+  blake2b_init(&mmr->merge, MMR_HASH_SIZE);
+}
+
+static void mmr_hash(const uint8_t *data, size_t size, uint8_t *hash) {
+  blake2b_state state;
+  blake2b_init(&state, MMR_HASH_SIZE);
+  blake2b_update(&state, data, size);
+  blake2b_final(&state, hash, MMR_HASH_SIZE);
+}
+
+/* blake2b of left | right, as blake2b_final would compress it */
+static void mmr_merge(const mmr_t *mmr, const uint8_t *left,
+                      const uint8_t *right, uint8_t *out) {
+  blake2b_state state = mmr->merge;
+  memcpy(state.buf, left, MMR_HASH_SIZE);
+  memcpy(&state.buf[MMR_HASH_SIZE], right, MMR_HASH_SIZE);
+  memset(&state.buf[2 * MMR_HASH_SIZE], 0,
+         BLAKE2B_BLOCKBYTES - 2 * MMR_HASH_SIZE);
+  state.t[0] = 2 * MMR_HASH_SIZE;
+  state.f[0] = (uint64_t)-1;
+  blake2b_compress(&state, state.buf);
+  for (size_t i = 0; i < MMR_HASH_SIZE / sizeof(uint64_t); i++) {
+    store64(&out[i * sizeof(uint64_t)], state.h[i]);
+  }
+}
+
+/* Takes the state in data, a previously initialized mmr keeps its merge */
+static int mmr_load(mmr_t *mmr, const uint8_t *data, uint64_t size) {
+  if (size < MMR_COUNT_SIZE) {
+    return MMR_ERROR_SIZE;
+  }
+  uint64_t count = load64(data);
+  if (size != MMR_DATA_SIZE(count)) {
+    return MMR_ERROR_SIZE;
+  }
+  mmr->count = count;
+  mmr->peak_count = (uint64_t)__builtin_popcountll(count);
+  memcpy(mmr->peaks, &data[MMR_COUNT_SIZE], mmr->peak_count * MMR_HASH_SIZE);
+  return 0;
+}
+
+/* Writes the state to data, which holds MMR_DATA_SIZE_MAX bytes */
+static uint64_t mmr_store(const mmr_t *mmr, uint8_t *data) {
+  store64(data, mmr->count);
+  memcpy(&data[MMR_COUNT_SIZE], mmr->peaks, mmr->peak_count * MMR_HASH_SIZE);
+  return MMR_COUNT_SIZE + mmr->peak_count * MMR_HASH_SIZE;
+}
+
+static int mmr_append(mmr_t *mmr, const uint8_t *leaf) {
+  if (mmr->count == UINT64_MAX) {
+    return MMR_ERROR_FULL;
+  }
+  uint8_t node[MMR_HASH_SIZE];
+  memcpy(node, leaf, MMR_HASH_SIZE);
+  /* Each set low bit of count is a peak of that height to merge with */
+  for (uint64_t n = mmr->count; n & 1; n >>= 1) {
+    mmr->peak_count--;
+    mmr_merge(mmr, mmr->peaks[mmr->peak_count], node, node);
+  }
+  memcpy(mmr->peaks[mmr->peak_count++], node, MMR_HASH_SIZE);
+  mmr->count++;
+  return 0;
+}
+
+/*
+ * Checks that leaf is leaf index of the MMR whose root is root and that
+ * has count leaves. The proof holds the siblings from the leaf up to its
+ * peak, lowest first, then the other peaks, highest first: one hash per
+ * level of the leaf's tree plus popcount(count) - 1.
+ */
+static int mmr_verify(const mmr_t *mmr, const uint8_t *root, uint64_t count,
+                      uint64_t index, const uint8_t *leaf,
+                      const uint8_t *proof, uint64_t proof_size) {
+  if (index >= count) {
+    return MMR_ERROR_PROOF;
+  }
+  /* The peak covering the leaf, and the leaf's place under it */
+  uint64_t start = 0, peak = 0;
+  int height = 63;
+  for (;; height--) {
+    uint64_t leaves = (uint64_t)1 << height;
+    if (!(count & leaves)) {
+      continue;
+    }
+    if (index - start < leaves) {
+      break;
+    }
+    start += leaves;
+    peak++;
+  }
+  uint64_t peak_count = (uint64_t)__builtin_popcountll(count);
+  if (proof_size != (height + peak_count - 1) * MMR_HASH_SIZE) {
+    return MMR_ERROR_PROOF;
+  }
+
+  uint8_t node[MMR_HASH_SIZE];
+  memcpy(node, leaf, MMR_HASH_SIZE);
+  uint64_t position = index - start;
+  for (int level = 0; level < height; level++, position >>= 1) {
+    const uint8_t *sibling = &proof[level * MMR_HASH_SIZE];
+    if (position & 1) {
+      mmr_merge(mmr, sibling, node, node);
+    } else {
+      mmr_merge(mmr, node, sibling, node);
+    }
+  }
+
+  /* Hashes the state with the computed peak in its place */
+  const uint8_t *peaks = &proof[height * MMR_HASH_SIZE];
+  uint8_t count_bytes[MMR_COUNT_SIZE];
+  store64(count_bytes, count);
+  blake2b_state state;
+  blake2b_init(&state, MMR_HASH_SIZE);
+  blake2b_update(&state, count_bytes, MMR_COUNT_SIZE);
+  blake2b_update(&state, peaks, peak * MMR_HASH_SIZE);
+  blake2b_update(&state, node, MMR_HASH_SIZE);
+  blake2b_update(&state, &peaks[peak * MMR_HASH_SIZE],
+                 (peak_count - 1 - peak) * MMR_HASH_SIZE);
+  uint8_t hash[MMR_HASH_SIZE];
+  blake2b_final(&state, hash, MMR_HASH_SIZE);
+  if (memcmp(hash, root, MMR_HASH_SIZE) != 0) {
+    return MMR_ERROR_PROOF;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Lock for an n-party committee signing with MuSig2, e.g. a crosschain
+ * bridge committee.
+ *
+ * The committee aggregates its keys off-chain, see deps/musig_aggregate.c,
+ * and signs with one BIP340 signature under the aggregated key. On-chain
+ * this is a single Schnorr verification whatever the committee size.
+ */
+#include "secp256k1_schnorr_sighash_all_table.h"
+
+#define SCHNORR_LOCK_ARGS_SIZE SECP256K1_SCHNORR_PUBKEY_SIZE
+#include "schnorr_lock.h"
+
+/*
+ * Arguments:
+ * 32 byte x-only aggregated pubkey of the committee.
+ *
+ * Witness:
+ * WitnessArgs with the 64 byte BIP340 signature of the sighash all message
+ * in lock field.
+ *
+ * Stages:
+ *
+ * 1. parse: load and decode script args and the witness
+ * 2. load: dynamically load the Schnorr library
+ * 3. verify: one signature check against the aggregated pubkey
+ */
+int main() { return ckb_schnorr_lock_main(); }
@@ -2,10 +2,23 @@
  * A simple composable OR lock script. It runs each lock script in
  * sequence, as long as any lock script passes, it returns a success
  * state, otherwise it returns a failure.
+ *
+ * Validation runs in stages ordered by cost:
+ *
+ * 1. parse: load script args and witness, decode OrScripts and OrWitnesses
+ * 2. predicates: check every branch script.
+ * 3. load and verify: load the branches one by one until one of them
+ *    passes, those with a witness first. An empty witness usually marks a
+ *    branch the signer is not attempting, but a branch may need none, e.g.
+ *    a time lock, so those still run once every witnessed branch failed.
  */
 #include "or.h"
-#include "ckb_dlfcn.h"
+#include "ckb_loader.h"
 #include "ckb_syscalls.h"
+#include "memory_layout.h"
+#include "secp256k1_data_info.h"
+#include "stage_trace.h"
+#include "tx_context.h"
 
 #define CODE_SIZE (256 * 1024)
 #define MAX_WITNESS_SIZE 32768
@@ -17,8 +30,28 @@
 #define ERROR_TOO_LONG -104
 #define ERROR_ALL_FAILURES -105
 
+/*
+ * Memory plan. Every buffer is alive for the whole run: branch scripts and
+ * witnesses point into the parsed script and lock, and loaded code pages
+ * stay frozen. The secp256k1 tables are shared by all branches, so
+ * stacking several sighash branches loads them only once.
+ */
+typedef struct {
+  uint8_t code_buffer[CODE_SIZE] __attribute__((aligned(RISCV_PGSIZE)));
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+  uint8_t script[SCRIPT_SIZE];
+  uint8_t witness[MAX_WITNESS_SIZE];
+  uint8_t lock_bytes[MAX_WITNESS_SIZE];
+} or_memory_t;
+
+static or_memory_t or_memory;
+
 int main() {
-  unsigned char script[SCRIPT_SIZE];
+  CKB_MEMORY_PHASE(or, run, sizeof(or_memory_t));
+
+  /* Stage 1: parse */
+  STAGE("parse");
+  uint8_t *script = or_memory.script;
   uint64_t len = SCRIPT_SIZE;
   int ret = ckb_load_script(script, &len, 0);
   if (ret != CKB_SUCCESS) {
@@ -36,7 +69,7 @@ int main() {
   mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
   mol_seg_t or_scripts_seg = MolReader_Bytes_raw_bytes(&args_seg);
 
-  unsigned char witness[MAX_WITNESS_SIZE];
+  uint8_t *witness = or_memory.witness;
   uint64_t witness_len = MAX_WITNESS_SIZE;
   ret = ckb_load_witness(witness, &witness_len, 0, 0, CKB_SOURCE_GROUP_INPUT);
   if (ret != CKB_SUCCESS) {
@@ -47,7 +80,7 @@ int main() {
   }
   mol_seg_t witness_seg;
   witness_seg.ptr = witness;
-  witness_seg.size = len;
+  witness_seg.size = witness_len;
   if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
     return ERROR_ENCODING;
   }
@@ -55,48 +88,95 @@ int main() {
   if (MolReader_BytesOpt_is_none(&lock_opt_seg)) {
     return ERROR_ENCODING;
   }
-  mol_seg_t or_witnesses_seg = MolReader_Bytes_raw_bytes(&lock_opt_seg);
+  mol_seg_t lock_bytes_seg = MolReader_Bytes_raw_bytes(&lock_opt_seg);
+  if (lock_bytes_seg.size > MAX_WITNESS_SIZE) {
+    return ERROR_TOO_LONG;
+  }
+  uint8_t *lock_bytes = or_memory.lock_bytes;
+  memcpy(lock_bytes, lock_bytes_seg.ptr, lock_bytes_seg.size);
+  mol_seg_t or_witnesses_seg;
+  or_witnesses_seg.ptr = lock_bytes;
+  or_witnesses_seg.size = lock_bytes_seg.size;
 
   if ((MolReader_OrScripts_verify(&or_scripts_seg, false) != MOL_OK) ||
       (MolReader_OrWitnesses_verify(&or_witnesses_seg, false) != MOL_OK) ||
       (MolReader_OrScripts_length(&or_scripts_seg) !=
-       MolReader_OrScripts_length(&or_witnesses_seg))) {
+       MolReader_OrWitnesses_length(&or_witnesses_seg))) {
     return ERROR_ENCODING;
   }
-  uint8_t code_buffer[CODE_SIZE] __attribute__((aligned(RISCV_PGSIZE)));
-  size_t used_size = 0;
-  for (size_t i = 0; i < MolReader_OrScripts_length(&or_scripts_seg); i++) {
+  size_t branches = MolReader_OrScripts_length(&or_scripts_seg);
+
+  /* Stage 2: cheap predicates on every branch */
+  STAGE("predicates");
+  for (size_t i = 0; i < branches; i++) {
     mol_seg_res_t script_res = MolReader_OrScripts_get(&or_scripts_seg, i);
     mol_seg_res_t witness_res = MolReader_OrWitnesses_get(&or_witnesses_seg, i);
     if (script_res.errno != MOL_OK || witness_res.errno != MOL_OK) {
       return ERROR_ENCODING;
     }
-    mol_seg_t script = script_res.seg;
-    mol_seg_t witness = witness_res.seg;
 
     /* TODO: type hash type support */
-    mol_seg_t hash_type = MolReader_Script_get_hash_type(&script);
+    mol_seg_t hash_type = MolReader_Script_get_hash_type(&script_res.seg);
     if (hash_type.ptr[0] != 0) {
       return ERROR_ENCODING;
     }
-    mol_seg_t code_hash = MolReader_Script_get_code_hash(&script);
+    mol_seg_t code_hash = MolReader_Script_get_code_hash(&script_res.seg);
     if (code_hash.size != 32) {
       return ERROR_ENCODING;
     }
+  }
+
+  /* Clear lock field to zero so branches can digest the first witness */
+  memset((void *)lock_bytes_seg.ptr, 0, lock_bytes_seg.size);
+
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  ckb_tx_context_set_first_witness(&tx_ctx, witness, witness_len);
+  tx_ctx.secp_data = or_memory.secp_data;
+  tx_ctx.secp_data_size = sizeof(or_memory.secp_data);
+
+  /* Stage 3: load and verify, witnessed branches in the first pass */
+  uint8_t *code_buffer = or_memory.code_buffer;
+  size_t used_size = 0;
+  for (size_t b = 0; b < 2 * branches; b++) {
+    size_t i = b % branches;
+    mol_seg_t script = MolReader_OrScripts_get(&or_scripts_seg, i).seg;
+    mol_seg_t witness = MolReader_OrWitnesses_get(&or_witnesses_seg, i).seg;
+    int witnessed = MolReader_Bytes_length(&witness) > 0;
+    if (witnessed != (b < branches)) {
+      continue;
+    }
+    STAGE("load");
+    mol_seg_t code_hash = MolReader_Script_get_code_hash(&script);
+
+    /* Loaded code pages are frozen, every branch needs fresh pages */
     void *handle = NULL;
     uint64_t consumed_size = 0;
-    int ret = ckb_dlopen(code_hash.ptr, &code_buffer[used_size],
-                         CODE_SIZE - used_size, &handle, &consumed_size);
+    ret = ckb_loader_open(code_hash.ptr, &code_buffer[used_size],
+                          CODE_SIZE - used_size, &handle, &consumed_size);
     if (ret != CKB_SUCCESS) {
       return ret;
     }
-    int (*verify)(const mol_seg_t *, const mol_seg_t *);
-    *(void **)(&verify) = ckb_dlsym(handle, "verify");
-    if (verify == NULL) {
-      return ERROR_DYNAMIC_LOADING;
+    used_size += consumed_size;
+
+    STAGE("verify");
+    /* Prefer the context aware entry so branches share memoized facts */
+    int (*verify_with_context)(ckb_tx_context_t *, const mol_seg_t *,
+                               const mol_seg_t *);
+    *(void **)(&verify_with_context) =
+        ckb_loader_sym(handle, "verify_with_context");
+    if (verify_with_context != NULL) {
+      ret = verify_with_context(&tx_ctx, &script, &witness);
+    } else {
+      int (*verify)(const mol_seg_t *, const mol_seg_t *);
+      *(void **)(&verify) = ckb_loader_sym(handle, "verify");
+      if (verify == NULL) {
+        return ERROR_DYNAMIC_LOADING;
+      }
+      ret = verify(&script, &witness);
     }
-    ret = verify(&script, &witness);
     if (ret == CKB_SUCCESS) {
+      STAGE("done");
       return CKB_SUCCESS;
     }
   }
@@ -0,0 +1,46 @@
+/*
+ * Layout of a pre-relocated library image, produced on the host by
+ * deps/prelink_library.c and loaded by ckb_loader_open_prelinked.
+ *
+ * The image has been linked for one fixed load address: every relocation is
+ * already applied, so loading it only copies bytes. The cell data is one
+ * header page followed by the memory image of the library starting at
+ * virtual address 0:
+ *
+ * [0, code_size)          executable pages, loaded as code
+ * [code_size, file_size)  initialized data, loaded as data
+ * [file_size, mem_size)   zero filled
+ *
+ * Offsets of the dynamic symbol tables are recorded in the header so
+ * symbol lookup works without parsing the dynamic section.
+ */
+#ifndef CKB_PRELINK_IMAGE_H_
+#define CKB_PRELINK_IMAGE_H_
+
+#include <stdint.h>
+
+#define CKB_PRELINK_MAGIC "CKBPRELK"
+#define CKB_PRELINK_MAGIC_SIZE 8
+#define CKB_PRELINK_VERSION 1
+#define CKB_PRELINK_HEADER_SIZE 4096
+
+typedef struct {
+  uint8_t magic[CKB_PRELINK_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t header_size;
+  /* Address the library was relocated to, i.e. where vaddr 0 lives */
+  uint64_t base;
+  uint64_t code_size;
+  uint64_t file_size;
+  uint64_t mem_size;
+
+  uint64_t dynsym;
+  uint64_t dynsym_count;
+  uint64_t dynstr;
+  uint64_t dynstr_size;
+  /* 0 when the library was linked without the table */
+  uint64_t gnu_hash;
+  uint64_t sysv_hash;
+} ckb_prelink_header_t;
+
+#endif
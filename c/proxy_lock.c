@@ -0,0 +1,71 @@
+/*
+ * A proxy lock deferring to a master lock.
+ *
+ * The args hold the lock hash of a master lock, e.g. a sighash or multisig
+ * lock. The proxy unlocks whenever the transaction also spends an input
+ * locked by the master, the same check as the owner mode of simple_udt.
+ * The master runs the one real signature verification, and since CKB runs
+ * a lock once per script group, any number of cells behind the same proxy
+ * args cost one scan of the input lock hashes on top of it.
+ *
+ * Whoever can unlock the master can spend every cell behind the proxy, in
+ * any transaction that also spends a master cell.
+ */
+#include "blockchain.h"
+#include "ckb_syscalls.h"
+
+#define BLAKE2B_BLOCK_SIZE 32
+#define SCRIPT_SIZE 32768
+
+#define ERROR_ARGUMENTS_LEN -1
+#define ERROR_ENCODING -2
+#define ERROR_SYSCALL -3
+#define ERROR_SCRIPT_TOO_LONG -21
+#define ERROR_MASTER_NOT_FOUND -51
+
+int main() {
+  unsigned char script[SCRIPT_SIZE];
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_load_script(script, &len, 0);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (len > SCRIPT_SIZE) {
+    return ERROR_SCRIPT_TOO_LONG;
+  }
+  mol_seg_t script_seg;
+  script_seg.ptr = (uint8_t *)script;
+  script_seg.size = len;
+
+  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  if (args_bytes_seg.size != BLAKE2B_BLOCK_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+
+  /* Stops at the first master input, usually the first input */
+  size_t i = 0;
+  while (1) {
+    uint8_t buffer[BLAKE2B_BLOCK_SIZE];
+    len = BLAKE2B_BLOCK_SIZE;
+    ret = ckb_checked_load_cell_by_field(buffer, &len, 0, i, CKB_SOURCE_INPUT,
+                                         CKB_CELL_FIELD_LOCK_HASH);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      return ERROR_MASTER_NOT_FOUND;
+    }
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    if (len != BLAKE2B_BLOCK_SIZE) {
+      return ERROR_ENCODING;
+    }
+    if (memcmp(buffer, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) == 0) {
+      return CKB_SUCCESS;
+    }
+    i += 1;
+  }
+}
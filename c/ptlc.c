@@ -0,0 +1,65 @@
+/*
+ * Point time locked contract, the adaptor signature counterpart of htlc.
+ *
+ * The claim key is the MuSig2 aggregate of both parties of a swap, see
+ * deps/musig_aggregate.c. Before funding, the sender hands out an adaptor
+ * pre-signature that only becomes a valid BIP340 signature once the secret
+ * t behind the adaptor point T = tG is added to it, or subtracted when the
+ * final nonce R' + T has odd y. Claiming publishes that signature, from
+ * which the sender learns t as whichever of s - s' and s' - s matches T,
+ * see deps/musig_aggregate.c, and completes the matching swap on the other
+ * chain. Nothing on-chain links the two swaps, and a claim is a single
+ * Schnorr verification without any preimage.
+ *
+ * After the lock time the refund key can take the cell back, with the same
+ * timeout check as htlc.
+ */
+#include "secp256k1_schnorr_sighash_all_table.h"
+#include "timeout.h"
+
+#define SCHNORR_LOCK_ARGS_SIZE \
+  (SECP256K1_SCHNORR_PUBKEY_SIZE * 2 + CKB_TIMEOUT_SINCE_SIZE)
+#define SCHNORR_LOCK_PREDICATES
+#include "schnorr_lock.h"
+
+/* A byte after the signature selects the refund path */
+#define REFUND_LOCK_SIZE (SECP256K1_SCHNORR_SIGNATURE_SIZE + 1)
+#define REFUND_PATH 1
+
+/* The refund path needs the lock time and signs with the refund key */
+static int schnorr_lock_predicates(const uint8_t *args,
+                                   mol_seg_t lock_bytes_seg,
+                                   const uint8_t **pubkey) {
+  if (lock_bytes_seg.size == REFUND_LOCK_SIZE &&
+      lock_bytes_seg.ptr[SECP256K1_SCHNORR_SIGNATURE_SIZE] == REFUND_PATH) {
+    uint64_t since = 0;
+    memcpy(&since, &args[SECP256K1_SCHNORR_PUBKEY_SIZE * 2],
+           CKB_TIMEOUT_SINCE_SIZE);
+    int ret = ckb_check_timeout(since);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    *pubkey = &args[SECP256K1_SCHNORR_PUBKEY_SIZE];
+  } else if (lock_bytes_seg.size != SECP256K1_SCHNORR_SIGNATURE_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Arguments:
+ * 32 byte x-only claim pubkey, 32 byte x-only refund pubkey and the 8 byte
+ * lock time.
+ *
+ * Witness:
+ * WitnessArgs with the 64 byte BIP340 signature of the sighash all message
+ * in lock field, followed by one byte 0x01 on the refund path.
+ *
+ * Stages:
+ *
+ * 1. parse: load and decode script args and the witness
+ * 2. predicates: the since lock time on the refund path
+ * 3. load: dynamically load the Schnorr library
+ * 4. verify: one signature check against the selected pubkey
+ */
+int main() { return ckb_schnorr_lock_main(); }
@@ -0,0 +1,36 @@
+/*
+ * Cell data layout of the crosschain_typescript registry, the relay window
+ * followed by the records, see c/crosschain_typescript.c. Shared with
+ * deps/cycle_bound.c, whose bounds scale with these sizes.
+ */
+#ifndef CKB_REGISTRY_LAYOUT_H_
+#define CKB_REGISTRY_LAYOUT_H_
+
+#define WINDOW_BITS 4096
+#define WINDOW_WORDS (WINDOW_BITS / 64)
+#define REGISTRY_HEADER_SIZE (8 + WINDOW_BITS / 8)
+
+#define ASSET_ID_SIZE 32
+#define UDT_HASH_SIZE 32
+#define AMOUNT_SIZE 16
+#define SINCE_SIZE 8
+
+/* Epochs of the withdrawal window, about a day at 4 hours per epoch */
+#define RATE_EPOCHS 6
+#define RECORD_UDT_HASH ASSET_ID_SIZE
+#define RECORD_SUPPLY (RECORD_UDT_HASH + UDT_HASH_SIZE)
+#define RECORD_CAP (RECORD_SUPPLY + AMOUNT_SIZE)
+#define RECORD_WITHDRAW_CAP (RECORD_CAP + AMOUNT_SIZE)
+#define RECORD_LAST_SINCE (RECORD_WITHDRAW_CAP + AMOUNT_SIZE)
+#define RECORD_WINDOW_SUM (RECORD_LAST_SINCE + SINCE_SIZE)
+#define RECORD_RING (RECORD_WINDOW_SUM + AMOUNT_SIZE)
+#define RECORD_SIZE (RECORD_RING + RATE_EPOCHS * AMOUNT_SIZE)
+/* The withdrawal limit fields, at LIMIT(field) within them */
+#define LIMIT_SIZE (RECORD_SIZE - RECORD_WITHDRAW_CAP)
+#define LIMIT(field) ((field)-RECORD_WITHDRAW_CAP)
+
+/* Records per load when every record is read */
+#define REGISTRY_CHUNK_RECORDS 17
+#define REGISTRY_CHUNK_SIZE (REGISTRY_CHUNK_RECORDS * RECORD_SIZE)
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Parse, load and verify sequence of the locks checking one BIP340
+ * signature with secp256k1_schnorr_sighash_all_lib, musig_lock and ptlc.
+ *
+ * A lock defines SCHNORR_LOCK_ARGS_SIZE, the exact size of its script
+ * args, before including this header, and calls ckb_schnorr_lock_main from
+ * its main. The pubkey is the first 32 bytes of the args and the lock field
+ * of the first witness is the 64 byte signature, unless the lock also
+ * defines SCHNORR_LOCK_PREDICATES and implements schnorr_lock_predicates,
+ * which then checks the lock field and picks the pubkey from the args.
+ */
+#ifndef CKB_SCHNORR_LOCK_H_
+#define CKB_SCHNORR_LOCK_H_
+
+#include "blockchain.h"
+#include "ckb_loader.h"
+#include "ckb_syscalls.h"
+#include "memory_layout.h"
+#include "secp256k1_data_info.h"
+#include "secp256k1_schnorr_sighash_all_lib.h"
+#include "secp256k1_schnorr_sighash_all_lib_prelinked.h"
+#include "secp256k1_schnorr_sighash_all_table.h"
+#include "stage_trace.h"
+#include "tx_context.h"
+#include "witness_lock.h"
+
+#ifndef SCHNORR_LOCK_ARGS_SIZE
+#error "Define SCHNORR_LOCK_ARGS_SIZE before including schnorr_lock.h"
+#endif
+
+#define ERROR_ARGUMENTS_LEN -1
+#define ERROR_ENCODING -2
+#define ERROR_SYSCALL -3
+#define ERROR_SCRIPT_TOO_LONG -21
+#define ERROR_WITNESS_SIZE -22
+#define ERROR_DYNAMIC_LOADING -103
+
+/* 32 KB */
+#define MAX_WITNESS_SIZE 32768
+#define SCRIPT_SIZE 32768
+
+#define SECP_CODE_SIZE (100 * 1024)
+
+/* Relocated for DL_ARENA_BASE, see htlc */
+static uint8_t secp_code_buffer[SECP_CODE_SIZE]
+    __attribute__((section(".dl_arena"), aligned(RISCV_PGSIZE)));
+
+/* Memory plan, the script and the secp256k1 tables share memory */
+typedef struct {
+  uint8_t script[SCRIPT_SIZE];
+} schnorr_lock_parse_phase_t;
+
+typedef struct {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+} schnorr_lock_verify_phase_t;
+
+static struct {
+  /* Alive for the whole run */
+  uint8_t args[SCHNORR_LOCK_ARGS_SIZE];
+  uint8_t signature[SECP256K1_SCHNORR_SIGNATURE_SIZE];
+  uint8_t witness[MAX_WITNESS_SIZE];
+  union {
+    schnorr_lock_parse_phase_t parse;
+    schnorr_lock_verify_phase_t verify;
+  } phase;
+} schnorr_lock_memory;
+
+#ifdef SCHNORR_LOCK_PREDICATES
+/*
+ * Checks the lock field, which starts with the signature, and sets pubkey
+ * to the one in args it must verify against. Runs before the library is
+ * loaded.
+ */
+static int schnorr_lock_predicates(const uint8_t *args,
+                                   mol_seg_t lock_bytes_seg,
+                                   const uint8_t **pubkey);
+#endif
+
+static int ckb_schnorr_lock_main() {
+  CKB_MEMORY_PHASE(schnorr_lock, parse, sizeof(schnorr_lock_parse_phase_t));
+  CKB_MEMORY_PHASE(schnorr_lock, verify, sizeof(schnorr_lock_verify_phase_t));
+
+  /* Parse */
+  STAGE("parse");
+  uint8_t *script = schnorr_lock_memory.phase.parse.script;
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_load_script(script, &len, 0);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (len > SCRIPT_SIZE) {
+    return ERROR_SCRIPT_TOO_LONG;
+  }
+  mol_seg_t script_seg;
+  script_seg.ptr = (uint8_t *)script;
+  script_seg.size = len;
+
+  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+    return ERROR_ENCODING;
+  }
+
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  if (args_bytes_seg.size != SCHNORR_LOCK_ARGS_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+  /* The script buffer is reused once parsing is done */
+  memcpy(schnorr_lock_memory.args, args_bytes_seg.ptr,
+         SCHNORR_LOCK_ARGS_SIZE);
+
+  /* Load witness of first input */
+  uint8_t *witness = schnorr_lock_memory.witness;
+  uint64_t witness_len = MAX_WITNESS_SIZE;
+  ret = ckb_load_witness(witness, &witness_len, 0, 0, CKB_SOURCE_GROUP_INPUT);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_SYSCALL;
+  }
+  if (witness_len > MAX_WITNESS_SIZE) {
+    return ERROR_WITNESS_SIZE;
+  }
+
+  mol_seg_t lock_bytes_seg;
+  ret = ckb_extract_witness_lock(witness, witness_len, &lock_bytes_seg);
+  if (ret != CKB_SUCCESS) {
+    return ERROR_ENCODING;
+  }
+
+  const uint8_t *pubkey = schnorr_lock_memory.args;
+#ifdef SCHNORR_LOCK_PREDICATES
+  /* Cheap predicates of the lock */
+  STAGE("predicates");
+  ret = schnorr_lock_predicates(schnorr_lock_memory.args, lock_bytes_seg,
+                                &pubkey);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+#else
+  if (lock_bytes_seg.size != SECP256K1_SCHNORR_SIGNATURE_SIZE) {
+    return ERROR_ARGUMENTS_LEN;
+  }
+#endif
+
+  /* Load the signature library */
+  STAGE("load");
+  const secp256k1_schnorr_sighash_all_table_t *table = NULL;
+  ret = ckb_loader_open_table(
+      secp256k1_schnorr_sighash_all_prelinked_data_hash,
+      secp256k1_schnorr_sighash_all_data_hash, secp_code_buffer, SECP_CODE_SIZE,
+      SECP256K1_SCHNORR_SIGHASH_ALL_TABLE,
+      SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_VERSION, sizeof(*table),
+      (const void **)&table);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (table == NULL) {
+    return ERROR_DYNAMIC_LOADING;
+  }
+
+  /* Signature verification */
+  STAGE("verify");
+  memcpy(schnorr_lock_memory.signature, lock_bytes_seg.ptr,
+         SECP256K1_SCHNORR_SIGNATURE_SIZE);
+
+  /* Clear lock field to zero for the first witness */
+  memset((void *)lock_bytes_seg.ptr, 0, lock_bytes_seg.size);
+
+  ckb_tx_context_t tx_ctx;
+  ckb_tx_context_init(&tx_ctx);
+  ckb_tx_context_set_first_witness(&tx_ctx, witness, witness_len);
+  tx_ctx.secp_data = schnorr_lock_memory.phase.verify.secp_data;
+  tx_ctx.secp_data_size = sizeof(schnorr_lock_memory.phase.verify.secp_data);
+
+  ret = table->validate(&tx_ctx, pubkey, schnorr_lock_memory.signature);
+  STAGE("done");
+  return ret;
+}
+
+#endif
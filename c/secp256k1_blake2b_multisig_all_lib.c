@@ -0,0 +1,215 @@
+/*
+ * M of N multisig over the sighash all message, with the config layout
+ * and config hash of the CKB system multisig script.
+ *
+ * Lock args hold the blake160 of the multisig config, the lock field of
+ * the first witness the config followed by threshold signatures. The
+ * signatures must be in config order, so every recovered signer is
+ * matched in a single forward pass over the config slots. The message is
+ * digested and the secp256k1 context initialized once for all of them,
+ * which leaves one recovery plus one blake160 per signature.
+ *
+ * Requiring config order is a deliberate incompatibility: the system
+ * script accepts the signatures in any order, and witnesses from existing
+ * wallets that do not sort them fail here. Such a wallet must reorder the
+ * signatures to match the config before the transaction is sent.
+ *
+ * The sighash all message is computed like the system script does, over
+ * the first witness with only the signatures of the lock field zeroed,
+ * the config before them is signed as it is.
+ */
+#define __SHARED_LIBRARY__ 1
+#include "blake2b.h"
+#include "ckb_syscalls.h"
+#include "secp256k1_blake2b_multisig_all_table.h"
+#include "secp256k1_helper.h"
+#include "sighash_all_message.h"
+
+#define BLAKE2B_BLOCK_SIZE 32
+#define PUBKEY_SIZE 33
+#define RECID_INDEX 64
+#define TEMP_SIZE 32768
+
+#define ERROR_SECP_RECOVER_PUBKEY -51
+#define ERROR_SECP_PARSE_SIGNATURE -52
+#define ERROR_SECP_SERIALIZE_PUBKEY -53
+#define ERROR_MULTISIG_CONFIG_HASH -54
+#define ERROR_MULTISIG_CONFIG -55
+#define ERROR_MULTISIG_LOCK_SIZE -56
+#define ERROR_MULTISIG_VERIFY -57
+
+typedef struct {
+  uint8_t require_first_n;
+  uint8_t threshold;
+  uint8_t pubkeys;
+  const uint8_t *pubkey_hashes;
+  const uint8_t *signatures;
+} multisig_t;
+
+static void blake160(const uint8_t *data, size_t size, uint8_t *hash) {
+  uint8_t full[BLAKE2B_BLOCK_SIZE];
+  blake2b_state blake2b_ctx;
+  blake2b_init(&blake2b_ctx, BLAKE2B_BLOCK_SIZE);
+  blake2b_update(&blake2b_ctx, data, size);
+  blake2b_final(&blake2b_ctx, full, BLAKE2B_BLOCK_SIZE);
+  memcpy(hash, full, SECP256K1_MULTISIG_BLAKE160_SIZE);
+}
+
+/* Cheap and independent of the transaction, so it runs first */
+static int parse_multisig(const uint8_t *config_hash, const uint8_t *lock,
+                          size_t lock_size, multisig_t *multisig) {
+  if (lock_size < SECP256K1_MULTISIG_HEADER_SIZE) {
+    return ERROR_MULTISIG_LOCK_SIZE;
+  }
+  multisig->require_first_n = lock[1];
+  multisig->threshold = lock[2];
+  multisig->pubkeys = lock[3];
+  if (lock[0] != 0 || multisig->threshold == 0 ||
+      multisig->threshold > multisig->pubkeys ||
+      multisig->require_first_n > multisig->threshold) {
+    return ERROR_MULTISIG_CONFIG;
+  }
+  size_t config_size = SECP256K1_MULTISIG_CONFIG_SIZE(multisig->pubkeys);
+  if (lock_size != config_size + multisig->threshold *
+                                     SECP256K1_MULTISIG_SIGNATURE_SIZE) {
+    return ERROR_MULTISIG_LOCK_SIZE;
+  }
+
+  uint8_t hash[SECP256K1_MULTISIG_BLAKE160_SIZE];
+  blake160(lock, config_size, hash);
+  if (memcmp(config_hash, hash, SECP256K1_MULTISIG_BLAKE160_SIZE) != 0) {
+    return ERROR_MULTISIG_CONFIG_HASH;
+  }
+  multisig->pubkey_hashes = &lock[SECP256K1_MULTISIG_HEADER_SIZE];
+  multisig->signatures = &lock[config_size];
+  return CKB_SUCCESS;
+}
+
+static int recover_blake160(secp256k1_context *context, const uint8_t *message,
+                            const uint8_t *compact_signature, uint8_t *hash) {
+  secp256k1_ecdsa_recoverable_signature signature;
+  if (secp256k1_ecdsa_recoverable_signature_parse_compact(
+          context, &signature, compact_signature,
+          compact_signature[RECID_INDEX]) == 0) {
+    return ERROR_SECP_PARSE_SIGNATURE;
+  }
+  secp256k1_pubkey pubkey;
+  if (secp256k1_ecdsa_recover(context, &pubkey, &signature, message) != 1) {
+    return ERROR_SECP_RECOVER_PUBKEY;
+  }
+  uint8_t serialized[PUBKEY_SIZE];
+  size_t serialized_size = PUBKEY_SIZE;
+  if (secp256k1_ec_pubkey_serialize(context, serialized, &serialized_size,
+                                    &pubkey, SECP256K1_EC_COMPRESSED) != 1) {
+    return ERROR_SECP_SERIALIZE_PUBKEY;
+  }
+  blake160(serialized, serialized_size, hash);
+  return CKB_SUCCESS;
+}
+
+/*
+ * Signature i must match a slot after the one signature i - 1 matched, so
+ * no slot counts twice and the scan never goes back. The first
+ * require_first_n signatures must match the first require_first_n slots.
+ */
+static int match_signers(secp256k1_context *context, const uint8_t *message,
+                         const multisig_t *multisig) {
+  size_t slot = 0;
+  for (size_t i = 0; i < multisig->threshold; i++) {
+    uint8_t hash[SECP256K1_MULTISIG_BLAKE160_SIZE];
+    int ret = recover_blake160(
+        context, message,
+        &multisig->signatures[i * SECP256K1_MULTISIG_SIGNATURE_SIZE], hash);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    size_t end = i < multisig->require_first_n ? i + 1 : multisig->pubkeys;
+    while (slot < end &&
+           memcmp(hash,
+                  &multisig->pubkey_hashes[slot *
+                                           SECP256K1_MULTISIG_BLAKE160_SIZE],
+                  SECP256K1_MULTISIG_BLAKE160_SIZE) != 0) {
+      slot++;
+    }
+    if (slot == end) {
+      return ERROR_MULTISIG_VERIFY;
+    }
+    slot++;
+    /* Not enough slots left for the remaining signatures */
+    if (multisig->pubkeys - slot < multisig->threshold - i - 1) {
+      return ERROR_MULTISIG_VERIFY;
+    }
+  }
+  return CKB_SUCCESS;
+}
+
+static int validate_signatures(ckb_tx_context_t *ctx,
+                               const multisig_t *multisig) {
+  uint8_t buffer[TEMP_SIZE];
+  const uint8_t *message = NULL;
+  int ret = ckb_load_sighash_all_message(ctx, buffer, TEMP_SIZE, &message);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  secp256k1_context context;
+  ret = ckb_secp256k1_custom_verify_only_initialize_with_context(&context, ctx,
+                                                                 NULL);
+  if (ret != 0) {
+    return ret;
+  }
+  return match_signers(&context, message, multisig);
+}
+
+/*
+ * Only callers whose context carries no storage for the secp256k1 tables
+ * pay for a 1 MB stack frame, see secp256k1_blake2b_sighash_all_lib.
+ */
+static __attribute__((noinline)) int validate_signatures_with_stack_data(
+    ckb_tx_context_t *ctx, const multisig_t *multisig) {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+  ctx->secp_data = secp_data;
+  ctx->secp_data_size = sizeof(secp_data);
+  int ret = validate_signatures(ctx, multisig);
+  /* The tables die with this frame */
+  ctx->secp_data = NULL;
+  ctx->secp_data_size = 0;
+  ctx->computed &= ~((uint64_t)CKB_TX_CONTEXT_HAS_SECP_DATA);
+  return ret;
+}
+
+/*
+ * config_hash is the blake160 from the lock args, lock the lock field of
+ * the first witness as it was before the caller cleared it for the
+ * sighash all message. The caller copies the lock field out, then zeroes
+ * the threshold signatures in the witness, that is the lock_size -
+ * SECP256K1_MULTISIG_CONFIG_SIZE(pubkeys) bytes after the config, and
+ * leaves the config in place.
+ */
+__attribute__((visibility("default"))) int
+validate_secp256k1_blake2b_multisig_all(ckb_tx_context_t *ctx,
+                                        const uint8_t *config_hash,
+                                        const uint8_t *lock,
+                                        size_t lock_size) {
+  int ret = ckb_tx_context_check(ctx);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  multisig_t multisig;
+  ret = parse_multisig(config_hash, lock, lock_size, &multisig);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->secp_data == NULL ||
+      ctx->secp_data_size < CKB_SECP256K1_DATA_SIZE) {
+    return validate_signatures_with_stack_data(ctx, &multisig);
+  }
+  return validate_signatures(ctx, &multisig);
+}
+
+CKB_EXPORT_TABLE const secp256k1_blake2b_multisig_all_table_t
+    secp256k1_blake2b_multisig_all_table = {
+        {SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE_VERSION,
+         sizeof(secp256k1_blake2b_multisig_all_table_t)},
+        validate_secp256k1_blake2b_multisig_all,
+};
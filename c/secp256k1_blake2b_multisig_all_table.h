@@ -0,0 +1,36 @@
+/*
+ * Function table exported by secp256k1_blake2b_multisig_all_lib.so
+ */
+#ifndef SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE_H_
+#define SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE_H_
+
+#include "export_table.h"
+#include "tx_context.h"
+
+#define SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE \
+  "secp256k1_blake2b_multisig_all_table"
+#define SECP256K1_BLAKE2B_MULTISIG_ALL_TABLE_VERSION 1
+
+/*
+ * Multisig config, the layout of the CKB system multisig script:
+ *
+ *   reserved (0) | require_first_n | threshold | pubkeys | blake160...
+ *
+ * followed in the lock by threshold 65 byte recoverable signatures.
+ */
+#define SECP256K1_MULTISIG_HEADER_SIZE 4
+#define SECP256K1_MULTISIG_BLAKE160_SIZE 20
+#define SECP256K1_MULTISIG_SIGNATURE_SIZE 65
+/* Bytes of the config in the lock field, which stay in the signed witness */
+#define SECP256K1_MULTISIG_CONFIG_SIZE(pubkeys) \
+  (SECP256K1_MULTISIG_HEADER_SIZE +             \
+   (pubkeys) * SECP256K1_MULTISIG_BLAKE160_SIZE)
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*validate)(ckb_tx_context_t *ctx, const uint8_t *config_hash,
+                  const uint8_t *lock, size_t lock_size);
+} secp256k1_blake2b_multisig_all_table_t;
+
+#endif
@@ -4,7 +4,9 @@
 #define __SHARED_LIBRARY__ 1
 #include "blake2b.h"
 #include "ckb_syscalls.h"
+#include "secp256k1_blake2b_sighash_all_table.h"
 #include "secp256k1_helper.h"
+#include "sighash_all_message.h"
 
 #define BLAKE2B_BLOCK_SIZE 32
 #define BLAKE160_SIZE 20
@@ -13,99 +15,188 @@
 #define SIGNATURE_SIZE 65
 #define TEMP_SIZE 32768
 
-#define ERROR_SYSCALL -50
 #define ERROR_SECP_RECOVER_PUBKEY -51
 #define ERROR_SECP_PARSE_SIGNATURE -52
 #define ERROR_SECP_SERIALIZE_PUBKEY -53
 #define ERROR_PUBKEY_BLAKE160_HASH -54
+#define ERROR_SECP_PARSE_PUBKEY -55
+#define ERROR_SECP_VERIFY -56
 
-__attribute__((visibility("default"))) int
-validate_secp256k1_blake2b_sighash_all(const uint8_t *pubkey_hash,
-                                       const uint8_t *compact_signature,
-                                       const uint8_t *first_witness_data,
-                                       size_t first_witness_length) {
-  uint8_t tx_hash[BLAKE2B_BLOCK_SIZE];
-  uint64_t len = BLAKE2B_BLOCK_SIZE;
-  int ret = ckb_checked_load_tx_hash(tx_hash, &len, 0);
-  if (ret != CKB_SUCCESS) {
-    return ret;
-  }
-
+static int check_blake160(const uint8_t *pubkey_hash, const uint8_t *pubkey,
+                          size_t pubkey_size) {
+  uint8_t hash[BLAKE2B_BLOCK_SIZE];
   blake2b_state blake2b_ctx;
   blake2b_init(&blake2b_ctx, BLAKE2B_BLOCK_SIZE);
-  blake2b_update(&blake2b_ctx, tx_hash, BLAKE2B_BLOCK_SIZE);
-  blake2b_update(&blake2b_ctx, (char *)&first_witness_length, sizeof(uint64_t));
-  blake2b_update(&blake2b_ctx, first_witness_data, first_witness_length);
-
-  uint8_t buffer[TEMP_SIZE];
-  /* Digest same group witnesses */
-  size_t i = 1;
-  while (1) {
-    len = TEMP_SIZE;
-    ret = ckb_checked_load_witness(buffer, &len, 0, i, CKB_SOURCE_GROUP_INPUT);
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      break;
-    }
-    if (ret != CKB_SUCCESS) {
-      return ERROR_SYSCALL;
-    }
-    blake2b_update(&blake2b_ctx, (char *)&len, sizeof(uint64_t));
-    blake2b_update(&blake2b_ctx, buffer, len);
-    i += 1;
-  }
-  /* Digest witnesses that not covered by inputs */
-  i = ckb_calculate_inputs_len();
-  while (1) {
-    len = TEMP_SIZE;
-    ret = ckb_checked_load_witness(buffer, &len, 0, i, CKB_SOURCE_INPUT);
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      break;
-    }
-    if (ret != CKB_SUCCESS) {
-      return ERROR_SYSCALL;
-    }
-    blake2b_update(&blake2b_ctx, (char *)&len, sizeof(uint64_t));
-    blake2b_update(&blake2b_ctx, buffer, len);
-    i += 1;
-  }
-  uint8_t message[BLAKE2B_BLOCK_SIZE];
-  blake2b_final(&blake2b_ctx, message, BLAKE2B_BLOCK_SIZE);
+  blake2b_update(&blake2b_ctx, pubkey, pubkey_size);
+  blake2b_final(&blake2b_ctx, hash, BLAKE2B_BLOCK_SIZE);
 
-  /* Load signature */
-  secp256k1_context context;
-  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
-  ret = ckb_secp256k1_custom_verify_only_initialize(&context, secp_data);
-  if (ret != 0) {
-    return ret;
+  if (memcmp(pubkey_hash, hash, BLAKE160_SIZE) != 0) {
+    return ERROR_PUBKEY_BLAKE160_HASH;
   }
+  return CKB_SUCCESS;
+}
 
+static int recover_pubkey(secp256k1_context *context, const uint8_t *message,
+                          const uint8_t *pubkey_hash,
+                          const uint8_t *compact_signature, uint8_t *buffer) {
   secp256k1_ecdsa_recoverable_signature signature;
   if (secp256k1_ecdsa_recoverable_signature_parse_compact(
-          &context, &signature, compact_signature,
+          context, &signature, compact_signature,
           compact_signature[RECID_INDEX]) == 0) {
     return ERROR_SECP_PARSE_SIGNATURE;
   }
 
   /* Recover pubkey */
   secp256k1_pubkey pubkey;
-  if (secp256k1_ecdsa_recover(&context, &pubkey, &signature, message) != 1) {
+  if (secp256k1_ecdsa_recover(context, &pubkey, &signature, message) != 1) {
     return ERROR_SECP_RECOVER_PUBKEY;
   }
 
   /* Check pubkey hash */
   size_t pubkey_size = PUBKEY_SIZE;
-  if (secp256k1_ec_pubkey_serialize(&context, buffer, &pubkey_size, &pubkey,
+  if (secp256k1_ec_pubkey_serialize(context, buffer, &pubkey_size, &pubkey,
                                     SECP256K1_EC_COMPRESSED) != 1) {
     return ERROR_SECP_SERIALIZE_PUBKEY;
   }
+  return check_blake160(pubkey_hash, buffer, pubkey_size);
+}
 
-  blake2b_init(&blake2b_ctx, BLAKE2B_BLOCK_SIZE);
-  blake2b_update(&blake2b_ctx, buffer, pubkey_size);
-  blake2b_final(&blake2b_ctx, buffer, BLAKE2B_BLOCK_SIZE);
+/*
+ * The pubkey comes from the witness and has been checked against the
+ * blake160 already, so a plain verify replaces recovery, serialization and
+ * the hash. The signature is normalized first, which accepts the same high
+ * S signatures recovery does.
+ */
+static int verify_pubkey(secp256k1_context *context, const uint8_t *message,
+                         const uint8_t *serialized_pubkey,
+                         const uint8_t *compact_signature) {
+  secp256k1_pubkey pubkey;
+  if (secp256k1_ec_pubkey_parse(context, &pubkey, serialized_pubkey,
+                                PUBKEY_SIZE) != 1) {
+    return ERROR_SECP_PARSE_PUBKEY;
+  }
 
-  if (memcmp(pubkey_hash, buffer, BLAKE160_SIZE) != 0) {
-    return ERROR_PUBKEY_BLAKE160_HASH;
+  secp256k1_ecdsa_signature signature;
+  if (secp256k1_ecdsa_signature_parse_compact(context, &signature,
+                                              compact_signature) == 0) {
+    return ERROR_SECP_PARSE_SIGNATURE;
   }
+  secp256k1_ecdsa_signature_normalize(context, &signature, &signature);
 
+  if (secp256k1_ecdsa_verify(context, &signature, message, &pubkey) != 1) {
+    return ERROR_SECP_VERIFY;
+  }
   return CKB_SUCCESS;
 }
+
+/*
+ * Recovers the signer when pubkey is NULL, otherwise verifies against the
+ * given pubkey, whose blake160 the caller has checked.
+ */
+static int validate_signature(ckb_tx_context_t *ctx, const uint8_t *pubkey_hash,
+                              const uint8_t *pubkey,
+                              const uint8_t *compact_signature) {
+  uint8_t buffer[TEMP_SIZE];
+  const uint8_t *message = NULL;
+  int ret = ckb_load_sighash_all_message(ctx, buffer, TEMP_SIZE, &message);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  /* Load signature */
+  secp256k1_context context;
+  ret = ckb_secp256k1_custom_verify_only_initialize_with_context(&context, ctx,
+                                                                 NULL);
+  if (ret != 0) {
+    return ret;
+  }
+
+  if (pubkey == NULL) {
+    return recover_pubkey(&context, message, pubkey_hash, compact_signature,
+                          buffer);
+  }
+  return verify_pubkey(&context, message, pubkey, compact_signature);
+}
+
+/*
+ * Only callers whose context carries no storage for the secp256k1 tables
+ * pay for a 1 MB stack frame, kept out of line so the others never touch
+ * it.
+ */
+static __attribute__((noinline)) int validate_signature_with_stack_data(
+    ckb_tx_context_t *ctx, const uint8_t *pubkey_hash, const uint8_t *pubkey,
+    const uint8_t *compact_signature) {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+  ctx->secp_data = secp_data;
+  ctx->secp_data_size = sizeof(secp_data);
+  int ret = validate_signature(ctx, pubkey_hash, pubkey, compact_signature);
+  /* The tables die with this frame */
+  ctx->secp_data = NULL;
+  ctx->secp_data_size = 0;
+  ctx->computed &= ~((uint64_t)CKB_TX_CONTEXT_HAS_SECP_DATA);
+  return ret;
+}
+
+static int validate(ckb_tx_context_t *ctx, const uint8_t *pubkey_hash,
+                    const uint8_t *pubkey, const uint8_t *compact_signature) {
+  int ret = ckb_tx_context_check(ctx);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->secp_data == NULL ||
+      ctx->secp_data_size < CKB_SECP256K1_DATA_SIZE) {
+    return validate_signature_with_stack_data(ctx, pubkey_hash, pubkey,
+                                              compact_signature);
+  }
+  return validate_signature(ctx, pubkey_hash, pubkey, compact_signature);
+}
+
+__attribute__((visibility("default"))) int
+validate_secp256k1_blake2b_sighash_all_with_context(
+    ckb_tx_context_t *ctx, const uint8_t *pubkey_hash,
+    const uint8_t *compact_signature) {
+  return validate(ctx, pubkey_hash, NULL, compact_signature);
+}
+
+/*
+ * Variant for locks that put the 33 byte compressed pubkey in the witness
+ * next to a 64 byte compact signature. It trades those witness bytes for
+ * the cycles of recovery, see the secp256k1 cases of build/bench.
+ */
+__attribute__((visibility("default"))) int
+validate_secp256k1_blake2b_sighash_all_with_pubkey(
+    ckb_tx_context_t *ctx, const uint8_t *pubkey_hash, const uint8_t *pubkey,
+    const uint8_t *compact_signature) {
+  /* Cheap and independent of the transaction, so it goes first */
+  int ret = check_blake160(pubkey_hash, pubkey, PUBKEY_SIZE);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  return validate(ctx, pubkey_hash, pubkey, compact_signature);
+}
+
+/*
+ * Legacy entry point kept for callers that predate the transaction context,
+ * it simply runs the context aware version on a throwaway context.
+ */
+__attribute__((visibility("default"))) int
+validate_secp256k1_blake2b_sighash_all(const uint8_t *pubkey_hash,
+                                       const uint8_t *compact_signature,
+                                       const uint8_t *first_witness_data,
+                                       size_t first_witness_length) {
+  ckb_tx_context_t ctx;
+  ckb_tx_context_init(&ctx);
+  ckb_tx_context_set_first_witness(&ctx, first_witness_data,
+                                   first_witness_length);
+  return validate_secp256k1_blake2b_sighash_all_with_context(
+      &ctx, pubkey_hash, compact_signature);
+}
+
+CKB_EXPORT_TABLE const secp256k1_blake2b_sighash_all_table_t
+    secp256k1_blake2b_sighash_all_table = {
+        {SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_VERSION,
+         sizeof(secp256k1_blake2b_sighash_all_table_t)},
+        validate_secp256k1_blake2b_sighash_all,
+        validate_secp256k1_blake2b_sighash_all_with_context,
+        validate_secp256k1_blake2b_sighash_all_with_pubkey,
+};
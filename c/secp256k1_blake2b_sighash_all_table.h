@@ -0,0 +1,30 @@
+/*
+ * Function table exported by secp256k1_blake2b_sighash_all_lib.so
+ */
+#ifndef SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_H_
+#define SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_H_
+
+#include "export_table.h"
+#include "tx_context.h"
+
+#define SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE \
+  "secp256k1_blake2b_sighash_all_table"
+#define SECP256K1_BLAKE2B_SIGHASH_ALL_TABLE_VERSION 2
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*validate)(const uint8_t *pubkey_hash, const uint8_t *compact_signature,
+                  const uint8_t *first_witness_data,
+                  size_t first_witness_length);
+  int (*validate_with_context)(ckb_tx_context_t *ctx,
+                               const uint8_t *pubkey_hash,
+                               const uint8_t *compact_signature);
+  /* Version 2 */
+  int (*validate_with_pubkey)(ckb_tx_context_t *ctx,
+                              const uint8_t *pubkey_hash,
+                              const uint8_t *pubkey,
+                              const uint8_t *compact_signature);
+} secp256k1_blake2b_sighash_all_table_t;
+
+#endif
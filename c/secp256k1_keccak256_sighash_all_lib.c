@@ -0,0 +1,141 @@
+/*
+ * Sighash all verification for users signing with an Ethereum wallet,
+ * the personal_sign counterpart of secp256k1_blake2b_sighash_all_lib.
+ *
+ * The wallet signs the 32 byte sighash all message as EIP-191 data, that
+ * is keccak256("\x19Ethereum Signed Message:\n32" || message). The signer
+ * is recovered from the signature and its address, the last 20 bytes of
+ * the keccak256 of the uncompressed pubkey, compared with the lock args.
+ */
+#define __SHARED_LIBRARY__ 1
+#include "ckb_syscalls.h"
+#include "keccak256.h"
+#include "secp256k1_helper.h"
+#include "secp256k1_keccak256_sighash_all_table.h"
+#include "sighash_all_message.h"
+
+#define UNCOMPRESSED_PUBKEY_SIZE 65
+#define RECID_INDEX 64
+/* Wallets put 27 + recid in v, some libraries the bare recid */
+#define ETHEREUM_V_OFFSET 27
+#define TEMP_SIZE 32768
+
+#define PERSONAL_SIGN_PREFIX "\x19" "Ethereum Signed Message:\n32"
+#define PERSONAL_SIGN_PREFIX_SIZE 28
+
+#define ERROR_SECP_RECOVER_PUBKEY -51
+#define ERROR_SECP_PARSE_SIGNATURE -52
+#define ERROR_SECP_SERIALIZE_PUBKEY -53
+#define ERROR_PUBKEY_ADDRESS -54
+
+static void personal_sign_hash(const uint8_t *message, uint8_t *hash) {
+  keccak256_ctx_t keccak_ctx;
+  keccak256_init(&keccak_ctx);
+  keccak256_update(&keccak_ctx, (const uint8_t *)PERSONAL_SIGN_PREFIX,
+                   PERSONAL_SIGN_PREFIX_SIZE);
+  keccak256_update(&keccak_ctx, message, CKB_SIGHASH_ALL_MESSAGE_SIZE);
+  keccak256_final(&keccak_ctx, hash);
+}
+
+static int recover_address(secp256k1_context *context, const uint8_t *message,
+                           const uint8_t *address, const uint8_t *signature) {
+  int recid = signature[RECID_INDEX];
+  if (recid >= ETHEREUM_V_OFFSET) {
+    recid -= ETHEREUM_V_OFFSET;
+  }
+  secp256k1_ecdsa_recoverable_signature recoverable_signature;
+  if (recid > 3 ||
+      secp256k1_ecdsa_recoverable_signature_parse_compact(
+          context, &recoverable_signature, signature, recid) == 0) {
+    return ERROR_SECP_PARSE_SIGNATURE;
+  }
+
+  uint8_t hash[KECCAK256_HASH_SIZE];
+  personal_sign_hash(message, hash);
+  secp256k1_pubkey pubkey;
+  if (secp256k1_ecdsa_recover(context, &pubkey, &recoverable_signature,
+                              hash) != 1) {
+    return ERROR_SECP_RECOVER_PUBKEY;
+  }
+
+  uint8_t serialized[UNCOMPRESSED_PUBKEY_SIZE];
+  size_t serialized_size = UNCOMPRESSED_PUBKEY_SIZE;
+  if (secp256k1_ec_pubkey_serialize(context, serialized, &serialized_size,
+                                    &pubkey,
+                                    SECP256K1_EC_UNCOMPRESSED) != 1) {
+    return ERROR_SECP_SERIALIZE_PUBKEY;
+  }
+
+  /* The address hashes x and y without the 0x04 tag */
+  keccak256_ctx_t keccak_ctx;
+  keccak256_init(&keccak_ctx);
+  keccak256_update(&keccak_ctx, &serialized[1], serialized_size - 1);
+  keccak256_final(&keccak_ctx, hash);
+  if (memcmp(address,
+             &hash[KECCAK256_HASH_SIZE - SECP256K1_KECCAK256_ADDRESS_SIZE],
+             SECP256K1_KECCAK256_ADDRESS_SIZE) != 0) {
+    return ERROR_PUBKEY_ADDRESS;
+  }
+  return CKB_SUCCESS;
+}
+
+static int validate_signature(ckb_tx_context_t *ctx, const uint8_t *address,
+                              const uint8_t *signature) {
+  uint8_t buffer[TEMP_SIZE];
+  const uint8_t *message = NULL;
+  int ret = ckb_load_sighash_all_message(ctx, buffer, TEMP_SIZE, &message);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  secp256k1_context context;
+  ret = ckb_secp256k1_custom_verify_only_initialize_with_context(&context, ctx,
+                                                                 NULL);
+  if (ret != 0) {
+    return ret;
+  }
+  return recover_address(&context, message, address, signature);
+}
+
+/*
+ * Only callers whose context carries no storage for the secp256k1 tables
+ * pay for a 1 MB stack frame, see secp256k1_blake2b_sighash_all_lib.
+ */
+static __attribute__((noinline)) int validate_signature_with_stack_data(
+    ckb_tx_context_t *ctx, const uint8_t *address, const uint8_t *signature) {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+  ctx->secp_data = secp_data;
+  ctx->secp_data_size = sizeof(secp_data);
+  int ret = validate_signature(ctx, address, signature);
+  /* The tables die with this frame */
+  ctx->secp_data = NULL;
+  ctx->secp_data_size = 0;
+  ctx->computed &= ~((uint64_t)CKB_TX_CONTEXT_HAS_SECP_DATA);
+  return ret;
+}
+
+/*
+ * address is the 20 byte Ethereum address of the signer, signature the 65
+ * byte r, s and v returned by personal_sign.
+ */
+__attribute__((visibility("default"))) int
+validate_secp256k1_keccak256_sighash_all(ckb_tx_context_t *ctx,
+                                         const uint8_t *address,
+                                         const uint8_t *signature) {
+  int ret = ckb_tx_context_check(ctx);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->secp_data == NULL ||
+      ctx->secp_data_size < CKB_SECP256K1_DATA_SIZE) {
+    return validate_signature_with_stack_data(ctx, address, signature);
+  }
+  return validate_signature(ctx, address, signature);
+}
+
+CKB_EXPORT_TABLE const secp256k1_keccak256_sighash_all_table_t
+    secp256k1_keccak256_sighash_all_table = {
+        {SECP256K1_KECCAK256_SIGHASH_ALL_TABLE_VERSION,
+         sizeof(secp256k1_keccak256_sighash_all_table_t)},
+        validate_secp256k1_keccak256_sighash_all,
+};
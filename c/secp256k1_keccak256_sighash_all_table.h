@@ -0,0 +1,25 @@
+/*
+ * Function table exported by secp256k1_keccak256_sighash_all_lib.so
+ */
+#ifndef SECP256K1_KECCAK256_SIGHASH_ALL_TABLE_H_
+#define SECP256K1_KECCAK256_SIGHASH_ALL_TABLE_H_
+
+#include "export_table.h"
+#include "tx_context.h"
+
+#define SECP256K1_KECCAK256_SIGHASH_ALL_TABLE \
+  "secp256k1_keccak256_sighash_all_table"
+#define SECP256K1_KECCAK256_SIGHASH_ALL_TABLE_VERSION 1
+
+/* Ethereum address, and r, s and v of a personal_sign signature */
+#define SECP256K1_KECCAK256_ADDRESS_SIZE 20
+#define SECP256K1_KECCAK256_SIGNATURE_SIZE 65
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*validate)(ckb_tx_context_t *ctx, const uint8_t *address,
+                  const uint8_t *signature);
+} secp256k1_keccak256_sighash_all_table_t;
+
+#endif
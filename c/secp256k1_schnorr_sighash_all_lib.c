@@ -0,0 +1,248 @@
+/*
+ * BIP340 Schnorr verification of the sighash all message, the Taproot
+ * counterpart of secp256k1_blake2b_sighash_all_lib.
+ *
+ * Locks keep the 32 byte x-only pubkey itself in their args, so there is
+ * no recovery, serialization or pubkey hash to pay for: the pubkey is
+ * lifted to the curve point with even y and checked against the signature
+ * directly.
+ */
+#define __SHARED_LIBRARY__ 1
+#include "ckb_syscalls.h"
+#include "secp256k1_helper.h"
+#include "secp256k1_schnorr_sighash_all_table.h"
+#include "sighash_all_message.h"
+
+#define TEMP_SIZE 32768
+#define SCALAR_SIZE 32
+/* A nonce point and a pubkey point per signature */
+#define BATCH_POINTS (2 * SECP256K1_SCHNORR_BATCH_MAX)
+#define BATCH_TABLE_SIZE (BATCH_POINTS * ECMULT_TABLE_SIZE(WINDOW_A))
+
+#define BATCH_TAG "BIP0340/batch"
+#define BATCH_TAG_SIZE 13
+
+#define ERROR_SCHNORR_PARSE_PUBKEY -51
+#define ERROR_SCHNORR_PARSE_SIGNATURE -52
+#define ERROR_SCHNORR_VERIFY -53
+#define ERROR_SCHNORR_BATCH_SIZE -54
+
+static int verify_signature(secp256k1_context *context, const uint8_t *message,
+                            const uint8_t *pubkey, const uint8_t *signature) {
+  secp256k1_xonly_pubkey xonly_pubkey;
+  if (secp256k1_xonly_pubkey_parse(context, &xonly_pubkey, pubkey) != 1) {
+    return ERROR_SCHNORR_PARSE_PUBKEY;
+  }
+  if (secp256k1_schnorrsig_verify(context, signature, message,
+                                  &xonly_pubkey) != 1) {
+    return ERROR_SCHNORR_VERIFY;
+  }
+  return CKB_SUCCESS;
+}
+
+/*
+ * Strauss multi-scalar multiplication of all batch points at once, with
+ * the wNAF tables on this frame rather than in a malloc'ed scratch space.
+ * Kept out of line so single verifications never touch its stack.
+ */
+static __attribute__((noinline)) void batch_multiply(
+    secp256k1_context *context, secp256k1_gej *result,
+    const secp256k1_gej *points, const secp256k1_scalar *scalars,
+    size_t point_count, const secp256k1_scalar *g_scalar) {
+  secp256k1_gej prej[BATCH_TABLE_SIZE];
+  secp256k1_fe zr[BATCH_TABLE_SIZE];
+  secp256k1_ge pre_a[BATCH_TABLE_SIZE];
+#ifdef USE_ENDOMORPHISM
+  secp256k1_ge pre_a_lam[BATCH_TABLE_SIZE];
+#endif
+  struct secp256k1_strauss_point_state ps[BATCH_POINTS];
+  struct secp256k1_strauss_state state;
+  state.prej = prej;
+  state.zr = zr;
+  state.pre_a = pre_a;
+#ifdef USE_ENDOMORPHISM
+  state.pre_a_lam = pre_a_lam;
+#endif
+  state.ps = ps;
+  secp256k1_ecmult_strauss_wnaf(&context->ecmult_ctx, &state, result,
+                                point_count, points, scalars, g_scalar);
+}
+
+/*
+ * All signatures sign the same message. With e_i the BIP340 challenge of
+ * signature (R_i, s_i) under pubkey P_i, the batch holds when
+ *
+ *   (sum a_i s_i) G - sum a_i R_i - sum a_i e_i P_i = 0
+ *
+ * for randomizers a_i with a_0 = 1. The a_i are derived from a hash over
+ * the message and every pubkey and signature, as BIP340 suggests, so the
+ * signatures can not be chosen to cancel each other out.
+ */
+static int verify_batch(secp256k1_context *context, const uint8_t *message,
+                        const uint8_t *pubkeys, const uint8_t *signatures,
+                        size_t count) {
+  uint8_t seed[SCALAR_SIZE + sizeof(uint32_t)];
+  secp256k1_sha256 hash;
+  secp256k1_sha256_initialize_tagged(&hash, (const unsigned char *)BATCH_TAG,
+                                     BATCH_TAG_SIZE);
+  secp256k1_sha256_write(&hash, message, CKB_SIGHASH_ALL_MESSAGE_SIZE);
+  secp256k1_sha256_write(&hash, pubkeys,
+                         count * SECP256K1_SCHNORR_PUBKEY_SIZE);
+  secp256k1_sha256_write(&hash, signatures,
+                         count * SECP256K1_SCHNORR_SIGNATURE_SIZE);
+  secp256k1_sha256_finalize(&hash, seed);
+
+  secp256k1_gej points[BATCH_POINTS];
+  secp256k1_scalar scalars[BATCH_POINTS];
+  secp256k1_scalar g_scalar;
+  secp256k1_scalar_clear(&g_scalar);
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *pubkey = &pubkeys[i * SECP256K1_SCHNORR_PUBKEY_SIZE];
+    const uint8_t *signature =
+        &signatures[i * SECP256K1_SCHNORR_SIGNATURE_SIZE];
+
+    secp256k1_xonly_pubkey xonly_pubkey;
+    secp256k1_ge p;
+    if (secp256k1_xonly_pubkey_parse(context, &xonly_pubkey, pubkey) != 1 ||
+        !secp256k1_xonly_pubkey_load(context, &p, &xonly_pubkey)) {
+      return ERROR_SCHNORR_PARSE_PUBKEY;
+    }
+
+    /* R is the point with even y at x = r, r must be below the field size */
+    secp256k1_fe rx;
+    secp256k1_ge r;
+    if (!secp256k1_fe_set_b32(&rx, signature)) {
+      return ERROR_SCHNORR_PARSE_SIGNATURE;
+    }
+    if (!secp256k1_ge_set_xo_var(&r, &rx, 0)) {
+      return ERROR_SCHNORR_VERIFY;
+    }
+    secp256k1_scalar s;
+    int overflow = 0;
+    secp256k1_scalar_set_b32(&s, &signature[SCALAR_SIZE], &overflow);
+    if (overflow) {
+      return ERROR_SCHNORR_PARSE_SIGNATURE;
+    }
+
+    secp256k1_scalar e;
+    secp256k1_schnorrsig_challenge(&e, signature, message, pubkey);
+
+    secp256k1_scalar a;
+    if (i == 0) {
+      secp256k1_scalar_set_int(&a, 1);
+    } else {
+      uint8_t a32[SCALAR_SIZE];
+      seed[SCALAR_SIZE] = i & 0xff;
+      seed[SCALAR_SIZE + 1] = (i >> 8) & 0xff;
+      seed[SCALAR_SIZE + 2] = (i >> 16) & 0xff;
+      seed[SCALAR_SIZE + 3] = (i >> 24) & 0xff;
+      secp256k1_sha256_initialize(&hash);
+      secp256k1_sha256_write(&hash, seed, sizeof(seed));
+      secp256k1_sha256_finalize(&hash, a32);
+      secp256k1_scalar_set_b32(&a, a32, NULL);
+    }
+
+    /* g_scalar += a s, and the points enter with -a and -a e */
+    secp256k1_scalar_mul(&s, &s, &a);
+    secp256k1_scalar_add(&g_scalar, &g_scalar, &s);
+    secp256k1_scalar_mul(&e, &e, &a);
+    secp256k1_scalar_negate(&scalars[2 * i], &a);
+    secp256k1_gej_set_ge(&points[2 * i], &r);
+    secp256k1_scalar_negate(&scalars[2 * i + 1], &e);
+    secp256k1_gej_set_ge(&points[2 * i + 1], &p);
+  }
+
+  secp256k1_gej result;
+  batch_multiply(context, &result, points, scalars, 2 * count, &g_scalar);
+  if (!secp256k1_gej_is_infinity(&result)) {
+    return ERROR_SCHNORR_VERIFY;
+  }
+  return CKB_SUCCESS;
+}
+
+/* A single signature goes through secp256k1_schnorrsig_verify */
+static int validate_signatures(ckb_tx_context_t *ctx, const uint8_t *pubkeys,
+                               const uint8_t *signatures, size_t count) {
+  uint8_t buffer[TEMP_SIZE];
+  const uint8_t *message = NULL;
+  int ret = ckb_load_sighash_all_message(ctx, buffer, TEMP_SIZE, &message);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+
+  secp256k1_context context;
+  ret = ckb_secp256k1_custom_verify_only_initialize_with_context(&context, ctx,
+                                                                 NULL);
+  if (ret != 0) {
+    return ret;
+  }
+
+  if (count == 1) {
+    return verify_signature(&context, message, pubkeys, signatures);
+  }
+  return verify_batch(&context, message, pubkeys, signatures, count);
+}
+
+/*
+ * Only callers whose context carries no storage for the secp256k1 tables
+ * pay for a 1 MB stack frame, see secp256k1_blake2b_sighash_all_lib.
+ */
+static __attribute__((noinline)) int validate_signatures_with_stack_data(
+    ckb_tx_context_t *ctx, const uint8_t *pubkeys, const uint8_t *signatures,
+    size_t count) {
+  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+  ctx->secp_data = secp_data;
+  ctx->secp_data_size = sizeof(secp_data);
+  int ret = validate_signatures(ctx, pubkeys, signatures, count);
+  /* The tables die with this frame */
+  ctx->secp_data = NULL;
+  ctx->secp_data_size = 0;
+  ctx->computed &= ~((uint64_t)CKB_TX_CONTEXT_HAS_SECP_DATA);
+  return ret;
+}
+
+static int validate(ckb_tx_context_t *ctx, const uint8_t *pubkeys,
+                    const uint8_t *signatures, size_t count) {
+  int ret = ckb_tx_context_check(ctx);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->secp_data == NULL ||
+      ctx->secp_data_size < CKB_SECP256K1_DATA_SIZE) {
+    return validate_signatures_with_stack_data(ctx, pubkeys, signatures,
+                                               count);
+  }
+  return validate_signatures(ctx, pubkeys, signatures, count);
+}
+
+__attribute__((visibility("default"))) int
+validate_secp256k1_schnorr_sighash_all(ckb_tx_context_t *ctx,
+                                       const uint8_t *pubkey,
+                                       const uint8_t *signature) {
+  return validate(ctx, pubkey, signature, 1);
+}
+
+/*
+ * Verifies count signatures over the same sighash all message, e.g. one per
+ * member of a committee. pubkeys holds count x-only pubkeys back to back
+ * and signatures the matching 64 byte signatures. Fails as a whole if any
+ * signature is invalid, without telling which one.
+ */
+__attribute__((visibility("default"))) int
+validate_secp256k1_schnorr_sighash_all_batch(ckb_tx_context_t *ctx,
+                                             const uint8_t *pubkeys,
+                                             const uint8_t *signatures,
+                                             size_t count) {
+  if (count == 0 || count > SECP256K1_SCHNORR_BATCH_MAX) {
+    return ERROR_SCHNORR_BATCH_SIZE;
+  }
+  return validate(ctx, pubkeys, signatures, count);
+}
+
+CKB_EXPORT_TABLE const secp256k1_schnorr_sighash_all_table_t
+    secp256k1_schnorr_sighash_all_table = {
+        {SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_VERSION,
+         sizeof(secp256k1_schnorr_sighash_all_table_t)},
+        validate_secp256k1_schnorr_sighash_all,
+        validate_secp256k1_schnorr_sighash_all_batch,
+};
@@ -0,0 +1,29 @@
+/*
+ * Function table exported by secp256k1_schnorr_sighash_all_lib.so
+ */
+#ifndef SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_H_
+#define SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_H_
+
+#include "export_table.h"
+#include "tx_context.h"
+
+#define SECP256K1_SCHNORR_SIGHASH_ALL_TABLE \
+  "secp256k1_schnorr_sighash_all_table"
+#define SECP256K1_SCHNORR_SIGHASH_ALL_TABLE_VERSION 1
+
+/* 32 byte x-only pubkeys and 64 byte BIP340 signatures */
+#define SECP256K1_SCHNORR_PUBKEY_SIZE 32
+#define SECP256K1_SCHNORR_SIGNATURE_SIZE 64
+/* Most signatures validate_batch takes in one call */
+#define SECP256K1_SCHNORR_BATCH_MAX 16
+
+typedef struct {
+  ckb_export_table_header_t header;
+  /* Version 1 */
+  int (*validate)(ckb_tx_context_t *ctx, const uint8_t *pubkey,
+                  const uint8_t *signature);
+  int (*validate_batch)(ckb_tx_context_t *ctx, const uint8_t *pubkeys,
+                        const uint8_t *signatures, size_t count);
+} secp256k1_schnorr_sighash_all_table_t;
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Sighash all message shared by the sighash libraries: blake2b of the tx
+ * hash and of every witness of the current script group, plus the
+ * witnesses not covered by inputs.
+ */
+#ifndef CKB_SIGHASH_ALL_MESSAGE_H_
+#define CKB_SIGHASH_ALL_MESSAGE_H_
+
+#include "blake2b.h"
+#include "ckb_syscalls.h"
+#include "tx_context.h"
+
+#define CKB_SIGHASH_ALL_MESSAGE_SIZE 32
+
+#define CKB_SIGHASH_ALL_MESSAGE_ERROR_SYSCALL -50
+
+/*
+ * Digests witnesses through buffer, which must hold the largest witness.
+ * The result is memoized in the transaction context so every later
+ * verifier in the same script run reuses it, whichever library it lives
+ * in.
+ */
+static int ckb_load_sighash_all_message(ckb_tx_context_t *ctx,
+                                        uint8_t *buffer, uint64_t buffer_size,
+                                        const uint8_t **message) {
+  if (ckb_tx_context_has(ctx, CKB_TX_CONTEXT_HAS_SIGHASH)) {
+    *message = ctx->sighash_message;
+    return CKB_SUCCESS;
+  }
+  if (ctx->first_witness == NULL) {
+    return CKB_TX_CONTEXT_ERROR_NO_WITNESS;
+  }
+  const uint8_t *tx_hash = ckb_tx_context_tx_hash(ctx);
+  if (tx_hash == NULL) {
+    return CKB_SIGHASH_ALL_MESSAGE_ERROR_SYSCALL;
+  }
+
+  blake2b_state blake2b_ctx;
+  blake2b_init(&blake2b_ctx, CKB_SIGHASH_ALL_MESSAGE_SIZE);
+  blake2b_update(&blake2b_ctx, tx_hash, CKB_SIGHASH_ALL_MESSAGE_SIZE);
+  blake2b_update(&blake2b_ctx, (char *)&ctx->first_witness_len,
+                 sizeof(uint64_t));
+  blake2b_update(&blake2b_ctx, ctx->first_witness, ctx->first_witness_len);
+
+  /* Digest same group witnesses */
+  size_t i = 1;
+  uint64_t len = 0;
+  int ret = CKB_SUCCESS;
+  while (1) {
+    len = buffer_size;
+    ret = ckb_checked_load_witness(buffer, &len, 0, i, CKB_SOURCE_GROUP_INPUT);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      break;
+    }
+    if (ret != CKB_SUCCESS) {
+      return CKB_SIGHASH_ALL_MESSAGE_ERROR_SYSCALL;
+    }
+    blake2b_update(&blake2b_ctx, (char *)&len, sizeof(uint64_t));
+    blake2b_update(&blake2b_ctx, buffer, len);
+    i += 1;
+  }
+  /* Digest witnesses that not covered by inputs */
+  i = ckb_tx_context_inputs_len(ctx);
+  while (1) {
+    len = buffer_size;
+    ret = ckb_checked_load_witness(buffer, &len, 0, i, CKB_SOURCE_INPUT);
+    if (ret == CKB_INDEX_OUT_OF_BOUND) {
+      break;
+    }
+    if (ret != CKB_SUCCESS) {
+      return CKB_SIGHASH_ALL_MESSAGE_ERROR_SYSCALL;
+    }
+    blake2b_update(&blake2b_ctx, (char *)&len, sizeof(uint64_t));
+    blake2b_update(&blake2b_ctx, buffer, len);
+    i += 1;
+  }
+  blake2b_final(&blake2b_ctx, ctx->sighash_message,
+                CKB_SIGHASH_ALL_MESSAGE_SIZE);
+  ctx->computed |= CKB_TX_CONTEXT_HAS_SIGHASH;
+
+  *message = ctx->sighash_message;
+  return CKB_SUCCESS;
+}
+
+#endif
@@ -17,6 +17,7 @@
  * however for the sake of simplicity, we are happy with this limitation.
  */
 #include "blockchain.h"
+#include "bundle.h"
 #include "ckb_syscalls.h"
 
 #define BLAKE2B_BLOCK_SIZE 32
@@ -51,6 +52,7 @@ int main() {
 
   mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
   mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  BUNDLE_STRIP_TAG(args_bytes_seg);
   if (args_bytes_seg.size != BLAKE2B_BLOCK_SIZE) {
     return ERROR_ARGUMENTS_LEN;
   }
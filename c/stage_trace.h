@@ -0,0 +1,45 @@
+/*
+ * Cycle tracing of script stages.
+ *
+ * Scripts mark the start of each validation stage with STAGE("name"). In
+ * builds with CKB_STAGE_TRACE defined, every mark prints the stage name
+ * and the cycles consumed so far through ckb_debug, so a VM run yields the
+ * cost of each stage and shows at which stage a failing transaction
+ * stopped. In regular builds the marks compile to nothing.
+ */
+#ifndef CKB_STAGE_TRACE_H_
+#define CKB_STAGE_TRACE_H_
+
+#ifdef CKB_STAGE_TRACE
+#include "ckb_syscalls.h"
+#include "current_cycles.h"
+
+static void stage_trace(const char *name) {
+  uint64_t cycles = ckb_current_cycles();
+  char buffer[64] = "stage ";
+  size_t pos = strlen(buffer);
+  while (*name != '\0' && pos < sizeof(buffer) - 22) {
+    buffer[pos++] = *name++;
+  }
+  buffer[pos++] = ' ';
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + (cycles % 10);
+    cycles /= 10;
+  } while (cycles != 0);
+  while (n > 0) {
+    buffer[pos++] = digits[--n];
+  }
+  buffer[pos] = '\0';
+  ckb_debug(buffer);
+}
+
+#define STAGE(name) stage_trace(name)
+#else
+#define STAGE(name) \
+  do {              \
+  } while (0)
+#endif
+
+#endif
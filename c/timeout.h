@@ -0,0 +1,37 @@
+/*
+ * Timeout path shared by the swap locks: the first input of the script
+ * group must carry a since at or beyond the lock time in the args.
+ */
+#ifndef CKB_TIMEOUT_H_
+#define CKB_TIMEOUT_H_
+
+#include "ckb_syscalls.h"
+#include "ckb_utils.h"
+
+#define CKB_TIMEOUT_SINCE_SIZE 8
+
+#define CKB_TIMEOUT_ERROR_SYSCALL -3
+#define CKB_TIMEOUT_ERROR_INCORRECT_SINCE -102
+
+/* Returns a syscall error as is, like the scripts did before sharing it */
+static int ckb_check_timeout(uint64_t since) {
+  uint64_t input_since = 0;
+  uint64_t len = CKB_TIMEOUT_SINCE_SIZE;
+  int ret =
+      ckb_load_input_by_field(&input_since, &len, 0, 0, CKB_SOURCE_GROUP_INPUT,
+                              CKB_INPUT_FIELD_SINCE);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (len != CKB_TIMEOUT_SINCE_SIZE) {
+    return CKB_TIMEOUT_ERROR_SYSCALL;
+  }
+  int comparable = 0;
+  int cmp = ckb_since_cmp(since, input_since, &comparable);
+  if (comparable != 1 || cmp > 0) {
+    return CKB_TIMEOUT_ERROR_INCORRECT_SINCE;
+  }
+  return CKB_SUCCESS;
+}
+
+#endif
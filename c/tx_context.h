@@ -0,0 +1,139 @@
+/*
+ * Transaction context shared between a script and the libraries it loads
+ * via ckb_dlopen.
+ *
+ * The outermost script creates one context on its stack and passes a pointer
+ * into every verifier it calls. Facts about the current transaction are
+ * computed lazily on first use and memoized in the context, so nested or
+ * repeated verifiers never pay for the same syscall or hash twice.
+ *
+ * The layout is versioned: a library must call ckb_tx_context_check before
+ * touching any field, and new fields may only ever be appended.
+ */
+#ifndef CKB_TX_CONTEXT_H_
+#define CKB_TX_CONTEXT_H_
+
+#include "ckb_syscalls.h"
+
+#define CKB_TX_CONTEXT_VERSION 1
+
+#define CKB_TX_CONTEXT_HASH_SIZE 32
+#define CKB_TX_CONTEXT_MAX_DEPS 8
+
+#define CKB_TX_CONTEXT_HAS_TX_HASH (1 << 0)
+#define CKB_TX_CONTEXT_HAS_INPUTS_LEN (1 << 1)
+#define CKB_TX_CONTEXT_HAS_SIGHASH (1 << 2)
+#define CKB_TX_CONTEXT_HAS_SECP_DATA (1 << 3)
+#define CKB_TX_CONTEXT_HAS_ED25519_DATA (1 << 4)
+
+#define CKB_TX_CONTEXT_ERROR_VERSION -61
+#define CKB_TX_CONTEXT_ERROR_NO_WITNESS -62
+
+typedef struct {
+  uint8_t data_hash[CKB_TX_CONTEXT_HASH_SIZE];
+  size_t index;
+} ckb_tx_context_dep_t;
+
+typedef struct {
+  uint32_t version;
+  uint32_t size;
+  /* Bitmask of CKB_TX_CONTEXT_HAS_* facts already computed */
+  uint64_t computed;
+
+  uint8_t tx_hash[CKB_TX_CONTEXT_HASH_SIZE];
+  uint64_t inputs_len;
+
+  /*
+   * First witness of the current script group with its lock field cleared,
+   * owned by the outermost script. Sighash libraries digest it together with
+   * the rest of the group witnesses into sighash_message exactly once.
+   */
+  const uint8_t *first_witness;
+  uint64_t first_witness_len;
+  uint8_t sighash_message[CKB_TX_CONTEXT_HASH_SIZE];
+
+  /*
+   * Optional caller owned storage for the secp256k1 precomputed tables. When
+   * present and large enough, the tables are loaded from the cell dep at most
+   * once per script run.
+   */
+  void *secp_data;
+  uint64_t secp_data_size;
+
+  /* Cell dep indices already resolved by data hash */
+  size_t dep_count;
+  ckb_tx_context_dep_t deps[CKB_TX_CONTEXT_MAX_DEPS];
+
+  /* Optional caller owned storage for the Ed25519 base point table */
+  void *ed25519_data;
+  uint64_t ed25519_data_size;
+} ckb_tx_context_t;
+
+void ckb_tx_context_init(ckb_tx_context_t *ctx) {
+  memset(ctx, 0, sizeof(ckb_tx_context_t));
+  ctx->version = CKB_TX_CONTEXT_VERSION;
+  ctx->size = sizeof(ckb_tx_context_t);
+}
+
+int ckb_tx_context_check(const ckb_tx_context_t *ctx) {
+  if (ctx == NULL || ctx->version != CKB_TX_CONTEXT_VERSION ||
+      ctx->size < sizeof(ckb_tx_context_t)) {
+    return CKB_TX_CONTEXT_ERROR_VERSION;
+  }
+  return CKB_SUCCESS;
+}
+
+int ckb_tx_context_has(const ckb_tx_context_t *ctx, uint64_t fact) {
+  return (ctx->computed & fact) == fact;
+}
+
+void ckb_tx_context_set_first_witness(ckb_tx_context_t *ctx,
+                                      const uint8_t *witness, uint64_t len) {
+  ctx->first_witness = witness;
+  ctx->first_witness_len = len;
+  ctx->computed &= ~((uint64_t)CKB_TX_CONTEXT_HAS_SIGHASH);
+}
+
+const uint8_t *ckb_tx_context_tx_hash(ckb_tx_context_t *ctx) {
+  if (!ckb_tx_context_has(ctx, CKB_TX_CONTEXT_HAS_TX_HASH)) {
+    uint64_t len = CKB_TX_CONTEXT_HASH_SIZE;
+    int ret = ckb_checked_load_tx_hash(ctx->tx_hash, &len, 0);
+    if (ret != CKB_SUCCESS) {
+      return NULL;
+    }
+    ctx->computed |= CKB_TX_CONTEXT_HAS_TX_HASH;
+  }
+  return ctx->tx_hash;
+}
+
+uint64_t ckb_tx_context_inputs_len(ckb_tx_context_t *ctx) {
+  if (!ckb_tx_context_has(ctx, CKB_TX_CONTEXT_HAS_INPUTS_LEN)) {
+    ctx->inputs_len = ckb_calculate_inputs_len();
+    ctx->computed |= CKB_TX_CONTEXT_HAS_INPUTS_LEN;
+  }
+  return ctx->inputs_len;
+}
+
+int ckb_tx_context_find_dep(ckb_tx_context_t *ctx, const uint8_t *data_hash,
+                            size_t *index) {
+  for (size_t i = 0; i < ctx->dep_count; i++) {
+    if (memcmp(ctx->deps[i].data_hash, data_hash, CKB_TX_CONTEXT_HASH_SIZE) ==
+        0) {
+      *index = ctx->deps[i].index;
+      return CKB_SUCCESS;
+    }
+  }
+  int ret = ckb_look_for_dep_with_hash(data_hash, index);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  if (ctx->dep_count < CKB_TX_CONTEXT_MAX_DEPS) {
+    memcpy(ctx->deps[ctx->dep_count].data_hash, data_hash,
+           CKB_TX_CONTEXT_HASH_SIZE);
+    ctx->deps[ctx->dep_count].index = *index;
+    ctx->dep_count++;
+  }
+  return CKB_SUCCESS;
+}
+
+#endif
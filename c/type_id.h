@@ -0,0 +1,78 @@
+/*
+ * Type ID, a type script that only one cell can ever carry.
+ *
+ * The args of such a script start with a 32 byte id, and the transaction
+ * creating the cell must have
+ *
+ *   id = blake2b(first CellInput of the transaction | 8 byte output index)
+ *
+ * for the output index of the created cell, the same id as the type ID of
+ * the CKB system scripts. The first input can only be spent once, so no
+ * other transaction can create a cell with that script: any cell carrying
+ * it is the one created then or a successor the script let through. A
+ * script checks the id when its group has no input and only carries the
+ * cell forward otherwise.
+ */
+#ifndef CKB_TYPE_ID_H_
+#define CKB_TYPE_ID_H_
+
+#ifndef BLAKE2_H
+#include "blake2b.h"
+#endif
+#include "ckb_syscalls.h"
+
+#define CKB_TYPE_ID_SIZE 32
+/* Molecule CellInput, 8 byte since and 36 byte out point */
+#define CKB_TYPE_ID_INPUT_SIZE 44
+
+#define CKB_TYPE_ID_ERROR_SYSCALL -3
+#define CKB_TYPE_ID_ERROR_MISMATCH -80
+
+/* Checks the id of the single cell the current group creates */
+static int ckb_check_type_id(const uint8_t *type_id) {
+  uint8_t script_hash[CKB_TYPE_ID_SIZE];
+  uint64_t len = CKB_TYPE_ID_SIZE;
+  int ret = ckb_load_script_hash(script_hash, &len, 0);
+  if (ret != CKB_SUCCESS || len != CKB_TYPE_ID_SIZE) {
+    return CKB_TYPE_ID_ERROR_SYSCALL;
+  }
+  /* The output index of the group's cell in the transaction */
+  uint64_t index = 0;
+  while (1) {
+    uint8_t type_hash[CKB_TYPE_ID_SIZE];
+    len = CKB_TYPE_ID_SIZE;
+    ret = ckb_load_cell_by_field(type_hash, &len, 0, index, CKB_SOURCE_OUTPUT,
+                                 CKB_CELL_FIELD_TYPE_HASH);
+    if (ret == CKB_SUCCESS && len == CKB_TYPE_ID_SIZE &&
+        memcmp(type_hash, script_hash, CKB_TYPE_ID_SIZE) == 0) {
+      break;
+    }
+    if (ret != CKB_SUCCESS && ret != CKB_ITEM_MISSING) {
+      return CKB_TYPE_ID_ERROR_SYSCALL;
+    }
+    index++;
+  }
+
+  uint8_t input[CKB_TYPE_ID_INPUT_SIZE];
+  len = CKB_TYPE_ID_INPUT_SIZE;
+  ret = ckb_load_input(input, &len, 0, 0, CKB_SOURCE_INPUT);
+  if (ret != CKB_SUCCESS || len != CKB_TYPE_ID_INPUT_SIZE) {
+    return CKB_TYPE_ID_ERROR_SYSCALL;
+  }
+  uint8_t index_bytes[8];
+  for (size_t i = 0; i < 8; i++) {
+    index_bytes[i] = (uint8_t)(index >> (8 * i));
+  }
+  uint8_t id[CKB_TYPE_ID_SIZE];
+  blake2b_state state;
+  blake2b_init(&state, CKB_TYPE_ID_SIZE);
+  blake2b_update(&state, input, CKB_TYPE_ID_INPUT_SIZE);
+  blake2b_update(&state, index_bytes, sizeof(index_bytes));
+  blake2b_final(&state, id, CKB_TYPE_ID_SIZE);
+  if (memcmp(id, type_id, CKB_TYPE_ID_SIZE) != 0) {
+    return CKB_TYPE_ID_ERROR_MISMATCH;
+  }
+  return CKB_SUCCESS;
+}
+
+#endif
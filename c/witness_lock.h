@@ -0,0 +1,32 @@
+/*
+ * Lock field of a WitnessArgs, where the signature locks take their
+ * signature and proofs from.
+ */
+#ifndef CKB_WITNESS_LOCK_H_
+#define CKB_WITNESS_LOCK_H_
+
+#include "blockchain.h"
+#include "ckb_syscalls.h"
+
+#define CKB_WITNESS_LOCK_ERROR_ENCODING -2
+
+/* Extract lock from WitnessArgs, a missing lock is an encoding error */
+static int ckb_extract_witness_lock(uint8_t *witness, uint64_t len,
+                                    mol_seg_t *lock_bytes_seg) {
+  mol_seg_t witness_seg;
+  witness_seg.ptr = witness;
+  witness_seg.size = len;
+
+  if (MolReader_WitnessArgs_verify(&witness_seg, false) != MOL_OK) {
+    return CKB_WITNESS_LOCK_ERROR_ENCODING;
+  }
+  mol_seg_t lock_seg = MolReader_WitnessArgs_get_lock(&witness_seg);
+
+  if (MolReader_BytesOpt_is_none(&lock_seg)) {
+    return CKB_WITNESS_LOCK_ERROR_ENCODING;
+  }
+  *lock_bytes_seg = MolReader_Bytes_raw_bytes(&lock_seg);
+  return CKB_SUCCESS;
+}
+
+#endif
@@ -175,6 +175,8 @@ static BLAKE2_INLINE void secure_zero_memory(void *v, size_t n)
 #endif
 
 // blake2b-ref.c
+#ifndef BLAKE2B_REF_C
+#define BLAKE2B_REF_C
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -540,3 +542,4 @@ fail:
 }
 #endif
 
+#endif
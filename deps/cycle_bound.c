@@ -0,0 +1,696 @@
+/*
+ * Worst case cycle bounds of the scripts in this repo for a given
+ * transaction shape, e.g. for mempool policy.
+ *
+ * Each script is modeled by the primitives of c/cycle_model.h it runs,
+ * multiplied out along its loops with every size at the limit of the
+ * shape: every witness is as large as the witness size limit, every
+ * lookup scans all cell deps and every or branch fails after running its
+ * signature check. Library costs come from the built library files.
+ *
+ * Measured cycles can be given as <script>=<cycles>. The tool then fails
+ * when a measurement exceeds its bound, which means the bound or the
+ * models behind it are wrong.
+ */
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cycle_model.h"
+#include "prelink_image.h"
+#include "registry_layout.h"
+
+#define MAX_PATH_SIZE 512
+#define HASH_SIZE 32
+#define LENGTH_SIZE 8
+#define PUBKEY_SIZE 33
+#define BLAKE160_SIZE 20
+#define SIGNATURE_SIZE 65
+/* Same components as SCRIPT_ARG_SIZE and COVENANT_ARG_SIZE in c/htlc.c */
+#define HTLC_ARGS_SIZE (BLAKE160_SIZE * 2 + HASH_SIZE + SINCE_SIZE)
+#define HTLC_COVENANT_ARGS_SIZE (HASH_SIZE * 2 + HASH_SIZE + SINCE_SIZE)
+#define CAPACITY_SIZE 8
+#define UDT_AMOUNT_SIZE 16
+/* Scripts with the bundle tag and the 64 or 32 bytes of their args */
+#define REGISTRY_OWNER_LOCK_SIZE (16 + 33 + 4 + 1 + HASH_SIZE * 2)
+#define REGISTRY_UDT_SCRIPT_SIZE (16 + 33 + 4 + 1 + HASH_SIZE)
+/* Queue state of 64 peaks, and the merges beyond one per message */
+#define MMR_STATE_SIZE 2056
+#define MMR_CARRIES 63
+#define SCHNORR_PUBKEY_SIZE 32
+#define SCHNORR_SIGNATURE_SIZE 64
+/* Fields of Script and WitnessArgs */
+#define SCRIPT_ITEMS 3
+#define WITNESS_ARGS_ITEMS 3
+
+#define SIGHASH_LIB "secp256k1_blake2b_sighash_all_lib.so"
+#define SIGHASH_LIB_IMAGE "secp256k1_blake2b_sighash_all_lib.img"
+#define SCHNORR_LIB "secp256k1_schnorr_sighash_all_lib.so"
+#define SCHNORR_LIB_IMAGE "secp256k1_schnorr_sighash_all_lib.img"
+#define SECP256K1_DATA "secp256k1_data"
+
+#define ERROR_ARGS 1
+#define ERROR_IO -1
+#define ERROR_INVALID_ELF -2
+#define ERROR_BOUND_EXCEEDED -9
+
+typedef struct {
+  uint64_t witness_size;
+  uint64_t inputs;
+  uint64_t witnesses;
+  uint64_t group_inputs;
+  uint64_t group_outputs;
+  uint64_t script_size;
+  uint64_t cell_deps;
+  uint64_t branches;
+  uint64_t outputs;
+  uint64_t registry_records;
+  uint64_t touched_assets;
+  uint64_t messages;
+} shape_t;
+
+typedef struct {
+  uint64_t file_size;
+  uint64_t segments;
+  uint64_t zero_fill;
+  uint64_t relocations;
+} library_t;
+
+typedef struct {
+  const char *name;
+  uint64_t total;
+} bound_t;
+
+static const char *build_dir = "build";
+static int verbose = 0;
+/* musig_lock and ptlc are only built with SCHNORR=1 */
+static int schnorr = 0;
+static shape_t shape = {32768, 1, 1, 1, 1, 32768, 4, 2, 1, 256, 4, 16};
+static library_t sighash_lib;
+static ckb_prelink_header_t sighash_image;
+static library_t schnorr_lib;
+static ckb_prelink_header_t schnorr_image;
+static uint64_t secp_data_size;
+
+static void add(bound_t *bound, const char *what, uint64_t cycles) {
+  bound->total += cycles;
+  if (verbose) {
+    printf("  %-44s %12lu\n", what, (unsigned long)cycles);
+  }
+}
+
+static bound_t start_bound(const char *name) {
+  bound_t bound = {name, 0};
+  if (verbose) {
+    printf("%s\n", name);
+  }
+  return bound;
+}
+
+static uint64_t blocks(uint64_t bytes, uint64_t block_size) {
+  return (bytes + block_size - 1) / block_size;
+}
+
+static uint64_t syscall_cycles(uint64_t bytes) {
+  return CKB_CYCLES_SYSCALL + CKB_CYCLES_BYTES(bytes);
+}
+
+static uint64_t blake2b_cycles(uint64_t bytes) {
+  return CKB_CYCLES_BLAKE2B_FIXED +
+         blocks(bytes, 128) * CKB_CYCLES_BLAKE2B_BLOCK;
+}
+
+/* Padding adds at least 9 bytes */
+static uint64_t sha256_cycles(uint64_t bytes) {
+  return CKB_CYCLES_SHA256_FIXED +
+         blocks(bytes + 9, 64) * CKB_CYCLES_SHA256_BLOCK;
+}
+
+static uint64_t molecule_cycles(uint64_t items) {
+  return CKB_CYCLES_MOLECULE_FIXED + items * CKB_CYCLES_MOLECULE_ITEM;
+}
+
+/* Loading the script and verifying it as a Script table */
+static uint64_t load_script_cycles() {
+  return syscall_cycles(shape.script_size) + molecule_cycles(SCRIPT_ITEMS);
+}
+
+/* ckb_look_for_dep_with_hash loads the data hash of every cell dep */
+static uint64_t dep_lookup_cycles() {
+  return (shape.cell_deps + 1) *
+         (syscall_cycles(HASH_SIZE) + CKB_CYCLES_LOOP_ITERATION);
+}
+
+/* ckb_calculate_inputs_len doubles its guess, then bisects */
+static uint64_t inputs_len_cycles() {
+  uint64_t steps = 2;
+  for (uint64_t n = shape.inputs + 4; n > 1; n >>= 1) {
+    steps += 2;
+  }
+  return steps * (syscall_cycles(0) + CKB_CYCLES_LOOP_ITERATION);
+}
+
+static uint64_t file_size(const char *name) {
+  char path[MAX_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s", build_dir, name);
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  uint64_t size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+static uint8_t *read_file(const char *name, uint64_t *size) {
+  char path[MAX_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s", build_dir, name);
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(*size);
+  if (fread(data, *size, 1, f) != 1) {
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  return data;
+}
+
+/* Segments, zero filled bytes and relocations ckb_loader_open handles */
+static int load_library_info(const char *name, library_t *lib) {
+  uint64_t size = 0;
+  uint8_t *data = read_file(name, &size);
+  if (data == NULL) {
+    return ERROR_IO;
+  }
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)data;
+  if (size < sizeof(Elf64_Ehdr) ||
+      memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_phoff + header->e_phnum * sizeof(Elf64_Phdr) > size ||
+      header->e_shoff + header->e_shnum * sizeof(Elf64_Shdr) > size) {
+    free(data);
+    return ERROR_INVALID_ELF;
+  }
+  memset(lib, 0, sizeof(library_t));
+  lib->file_size = size;
+  const Elf64_Phdr *phs = (const Elf64_Phdr *)(data + header->e_phoff);
+  for (int i = 0; i < header->e_phnum; i++) {
+    if (phs[i].p_type == PT_LOAD) {
+      lib->segments++;
+      lib->zero_fill += phs[i].p_memsz - phs[i].p_filesz;
+    }
+  }
+  const Elf64_Shdr *shs = (const Elf64_Shdr *)(data + header->e_shoff);
+  for (int i = 0; i < header->e_shnum; i++) {
+    if (shs[i].sh_type == SHT_RELA) {
+      lib->relocations += shs[i].sh_size / sizeof(Elf64_Rela);
+    }
+  }
+  free(data);
+  return 0;
+}
+
+static int load_image_info(const char *name, ckb_prelink_header_t *image) {
+  uint64_t size = 0;
+  uint8_t *data = read_file(name, &size);
+  if (data == NULL) {
+    return ERROR_IO;
+  }
+  if (size < sizeof(ckb_prelink_header_t) ||
+      memcmp(data, CKB_PRELINK_MAGIC, CKB_PRELINK_MAGIC_SIZE) != 0) {
+    free(data);
+    return ERROR_INVALID_ELF;
+  }
+  memcpy(image, data, sizeof(ckb_prelink_header_t));
+  free(data);
+  return 0;
+}
+
+/* ckb_loader_open with two symbol lookups, verify and its context variant */
+static uint64_t open_library_cycles(const library_t *lib) {
+  return dep_lookup_cycles() + CKB_CYCLES_LOADER_FIXED +
+         (lib->segments + 2) * CKB_CYCLES_SYSCALL +
+         CKB_CYCLES_BYTES(lib->file_size) +
+         lib->zero_fill * CKB_CYCLES_MEMORY_BYTE +
+         lib->relocations * CKB_CYCLES_RELOCATION +
+         2 * CKB_CYCLES_SYMBOL_LOOKUP;
+}
+
+static uint64_t open_prelinked_cycles(const ckb_prelink_header_t *image) {
+  return dep_lookup_cycles() + CKB_CYCLES_LOADER_FIXED +
+         syscall_cycles(image->header_size) +
+         syscall_cycles(image->code_size) +
+         syscall_cycles(image->file_size - image->code_size) +
+         (image->mem_size - image->file_size) * CKB_CYCLES_MEMORY_BYTE +
+         CKB_CYCLES_SYMBOL_LOOKUP;
+}
+
+/*
+ * Sighash message over the group witnesses and the witnesses beyond the
+ * inputs, computed once per script run thanks to the transaction context.
+ */
+static void add_sighash_message(bound_t *bound) {
+  uint64_t extra = shape.witnesses > shape.inputs
+                       ? shape.witnesses - shape.inputs
+                       : 0;
+  uint64_t loaded = shape.group_inputs - 1 + extra;
+  uint64_t digested =
+      HASH_SIZE + (shape.group_inputs + extra) *
+                      (LENGTH_SIZE + shape.witness_size);
+  add(bound, "sighash: tx hash", syscall_cycles(HASH_SIZE));
+  add(bound, "sighash: inputs length", inputs_len_cycles());
+  add(bound, "sighash: load witnesses",
+      loaded * (syscall_cycles(shape.witness_size) +
+                CKB_CYCLES_LOOP_ITERATION) +
+          2 * syscall_cycles(0));
+  add(bound, "sighash: blake2b", blake2b_cycles(digested));
+}
+
+static void add_secp_data(bound_t *bound) {
+  add(bound, "secp256k1 tables", dep_lookup_cycles() +
+                                     syscall_cycles(secp_data_size));
+}
+
+/* Recover, serialize and blake160 of the recovered pubkey */
+static void add_signature(bound_t *bound) {
+  add(bound, "secp256k1 recover",
+      CKB_CYCLES_SECP_RECOVER + blake2b_cycles(PUBKEY_SIZE));
+}
+
+static void add_program(bound_t *bound, const char *name) {
+  add(bound, "program load", CKB_CYCLES_BYTES(file_size(name)));
+  add(bound, "fixed", CKB_CYCLES_SCRIPT_FIXED);
+}
+
+/* A missing prelinked image costs a full lookup before the fallback */
+static uint64_t load_library_cycles(const library_t *lib,
+                                    const ckb_prelink_header_t *image) {
+  uint64_t prelinked = open_prelinked_cycles(image);
+  uint64_t fallback = dep_lookup_cycles() + open_library_cycles(lib);
+  return prelinked > fallback ? prelinked : fallback;
+}
+
+static bound_t htlc_bound() {
+  bound_t bound = start_bound("htlc");
+  add_program(&bound, "htlc");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "copy args and signature",
+      (HTLC_ARGS_SIZE + SIGNATURE_SIZE) * CKB_CYCLES_MEMORY_BYTE);
+  /* The secret path hashes the preimage, the refund path loads since */
+  uint64_t secret = sha256_cycles(shape.witness_size);
+  uint64_t refund = syscall_cycles(SINCE_SIZE);
+  add(&bound, "secret hash or since", secret > refund ? secret : refund);
+  add(&bound, "load sighash library",
+      load_library_cycles(&sighash_lib, &sighash_image));
+  add(&bound, "clear lock", shape.witness_size * CKB_CYCLES_MEMORY_BYTE);
+  add_secp_data(&bound);
+  add_sighash_message(&bound);
+  add_signature(&bound);
+  return bound;
+}
+
+/*
+ * Covenant mode of htlc, no library and no signature. Every input lock
+ * hash is compared with the script hash, each group input is paired with
+ * the output at its index, whose lock, capacity, type hash and data hash
+ * are checked.
+ */
+static bound_t htlc_covenant_bound() {
+  bound_t bound = start_bound("htlc_covenant");
+  add_program(&bound, "htlc");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "copy args", HTLC_COVENANT_ARGS_SIZE * CKB_CYCLES_MEMORY_BYTE);
+  uint64_t secret = sha256_cycles(shape.witness_size);
+  uint64_t refund = syscall_cycles(SINCE_SIZE);
+  add(&bound, "secret hash or since", secret > refund ? secret : refund);
+  add(&bound, "script hash", syscall_cycles(HASH_SIZE));
+  add(&bound, "input lock hashes",
+      (shape.inputs + 1) *
+          (syscall_cycles(HASH_SIZE) + CKB_CYCLES_LOOP_ITERATION));
+  add(&bound, "paired outputs",
+      shape.group_inputs *
+          (2 * syscall_cycles(CAPACITY_SIZE) + syscall_cycles(HASH_SIZE)));
+  add(&bound, "paired type and data hashes",
+      shape.group_inputs * 4 * syscall_cycles(HASH_SIZE));
+  return bound;
+}
+
+/* Every branch is the in-tree sighash library and fails at the very end */
+static bound_t or_bound() {
+  bound_t bound = start_bound("or");
+  add_program(&bound, "or");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "OrScripts",
+      molecule_cycles(shape.branches) +
+          shape.branches * molecule_cycles(SCRIPT_ITEMS));
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "copy and clear lock",
+      2 * shape.witness_size * CKB_CYCLES_MEMORY_BYTE);
+  add(&bound, "OrWitnesses", molecule_cycles(shape.branches));
+  add(&bound, "branch predicates",
+      shape.branches * CKB_CYCLES_LOOP_ITERATION);
+  add(&bound, "load branch libraries",
+      shape.branches * open_library_cycles(&sighash_lib));
+  add_secp_data(&bound);
+  add_sighash_message(&bound);
+  for (uint64_t i = 0; i < shape.branches; i++) {
+    add_signature(&bound);
+  }
+  return bound;
+}
+
+/* Normal mode, after scanning every input lock for the owner */
+static bound_t simple_udt_bound() {
+  bound_t bound = start_bound("simple_udt");
+  add_program(&bound, "simple_udt");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "input lock hashes",
+      (shape.inputs + 1) *
+          (syscall_cycles(HASH_SIZE) + CKB_CYCLES_LOOP_ITERATION));
+  add(&bound, "input amounts",
+      (shape.group_inputs + 1) *
+          (syscall_cycles(16) + CKB_CYCLES_LOOP_ITERATION));
+  add(&bound, "output amounts",
+      (shape.group_outputs + 1) *
+          (syscall_cycles(16) + CKB_CYCLES_LOOP_ITERATION));
+  return bound;
+}
+
+static bound_t crosschain_lockscript_bound() {
+  bound_t bound = start_bound("crosschain_lockscript");
+  add_program(&bound, "crosschain_lockscript");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "first input type hash", syscall_cycles(HASH_SIZE));
+  add(&bound, "touched ids",
+      syscall_cycles(shape.witness_size) +
+          molecule_cycles(WITNESS_ARGS_ITEMS) +
+          shape.touched_assets * CKB_CYCLES_LOOP_ITERATION);
+  return bound;
+}
+
+/*
+ * A registry update relaying the messages of the shape and touching every
+ * asset of it, each inserted after the last record or withdrawn from after
+ * a full window of epochs, with every other cell of the transaction one of
+ * their UDTs.
+ */
+static bound_t crosschain_typescript_bound() {
+  bound_t bound = start_bound("crosschain_typescript");
+  add_program(&bound, "crosschain_typescript");
+  uint64_t records = shape.registry_records + shape.touched_assets;
+  uint64_t probes = 1;
+  for (uint64_t n = records; n > 0; n >>= 1) {
+    probes++;
+  }
+  add(&bound, "script", load_script_cycles() + syscall_cycles(HASH_SIZE));
+  add(&bound, "group cells", 4 * syscall_cycles(0));
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "owner locks",
+      (shape.inputs + 1) * (syscall_cycles(REGISTRY_OWNER_LOCK_SIZE) +
+                            probes * CKB_CYCLES_LOOP_ITERATION));
+  add(&bound, "derived UDTs",
+      shape.touched_assets * (blake2b_cycles(REGISTRY_OWNER_LOCK_SIZE) +
+                              blake2b_cycles(REGISTRY_UDT_SCRIPT_SIZE)));
+  add(&bound, "relay window",
+      2 * syscall_cycles(REGISTRY_HEADER_SIZE) +
+          shape.messages * CKB_CYCLES_LOOP_ITERATION +
+          2 * REGISTRY_HEADER_SIZE * CKB_CYCLES_MEMORY_BYTE);
+  add(&bound, "relayed amounts",
+      shape.messages * (probes + 1) * CKB_CYCLES_LOOP_ITERATION);
+  add(&bound, "record searches",
+      shape.touched_assets *
+          (2 * probes * (syscall_cycles(HASH_SIZE) +
+                         CKB_CYCLES_LOOP_ITERATION) +
+           2 * syscall_cycles(RECORD_SIZE)));
+  uint64_t bytes = shape.registry_records * RECORD_SIZE;
+  add(&bound, "untouched records",
+      2 * (blocks(shape.registry_records, REGISTRY_CHUNK_RECORDS) +
+           shape.touched_assets + 1) *
+              syscall_cycles(0) +
+          2 * CKB_CYCLES_BYTES(bytes) + bytes * CKB_CYCLES_MEMORY_BYTE);
+  uint64_t cells = shape.inputs + shape.outputs;
+  add(&bound, "UDT amounts",
+      (cells + 2) * (syscall_cycles(HASH_SIZE) +
+                     shape.touched_assets * CKB_CYCLES_LOOP_ITERATION) +
+          cells * syscall_cycles(UDT_AMOUNT_SIZE));
+  add(&bound, "withdrawal limits",
+      syscall_cycles(SINCE_SIZE) +
+          shape.touched_assets *
+              (RATE_EPOCHS * CKB_CYCLES_LOOP_ITERATION +
+               4 * LIMIT_SIZE * CKB_CYCLES_MEMORY_BYTE));
+  return bound;
+}
+
+/*
+ * A queue append of the messages of the shape, filling the witness, onto
+ * a queue whose every peak gets merged.
+ */
+static bound_t crosschain_queue_bound() {
+  bound_t bound = start_bound("crosschain_queue");
+  add_program(&bound, "crosschain_queue");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "group cells",
+      2 * syscall_cycles(MMR_STATE_SIZE) + 2 * syscall_cycles(0));
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS) +
+                             molecule_cycles(shape.messages));
+  /* Every message may end in a partial block of its own */
+  add(&bound, "message hashes",
+      shape.messages * (blake2b_cycles(0) + CKB_CYCLES_LOOP_ITERATION) +
+          blake2b_cycles(shape.witness_size) - CKB_CYCLES_BLAKE2B_FIXED);
+  add(&bound, "merges",
+      (shape.messages + MMR_CARRIES) *
+          (CKB_CYCLES_BLAKE2B_BLOCK + 2 * HASH_SIZE * CKB_CYCLES_MEMORY_BYTE));
+  add(&bound, "state", 3 * MMR_STATE_SIZE * CKB_CYCLES_MEMORY_BYTE);
+  return bound;
+}
+
+/* One Schnorr verification whatever the committee size */
+static bound_t musig_lock_bound() {
+  bound_t bound = start_bound("musig_lock");
+  add_program(&bound, "musig_lock");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "copy args and signature",
+      (SCHNORR_PUBKEY_SIZE + SCHNORR_SIGNATURE_SIZE) *
+          CKB_CYCLES_MEMORY_BYTE);
+  add(&bound, "load schnorr library",
+      load_library_cycles(&schnorr_lib, &schnorr_image));
+  add(&bound, "clear lock", SCHNORR_SIGNATURE_SIZE * CKB_CYCLES_MEMORY_BYTE);
+  add_secp_data(&bound);
+  add_sighash_message(&bound);
+  add(&bound, "secp256k1 schnorr verify", CKB_CYCLES_SECP_SCHNORR_VERIFY);
+  return bound;
+}
+
+/* The refund path, since check and one Schnorr verification */
+static bound_t ptlc_bound() {
+  bound_t bound = start_bound("ptlc");
+  add_program(&bound, "ptlc");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "witness", syscall_cycles(shape.witness_size) +
+                             molecule_cycles(WITNESS_ARGS_ITEMS));
+  add(&bound, "copy args and signature",
+      (2 * SCHNORR_PUBKEY_SIZE + SINCE_SIZE + SCHNORR_SIGNATURE_SIZE) *
+          CKB_CYCLES_MEMORY_BYTE);
+  add(&bound, "since", syscall_cycles(SINCE_SIZE));
+  add(&bound, "load schnorr library",
+      load_library_cycles(&schnorr_lib, &schnorr_image));
+  add(&bound, "clear lock",
+      (SCHNORR_SIGNATURE_SIZE + 1) * CKB_CYCLES_MEMORY_BYTE);
+  add_secp_data(&bound);
+  add_sighash_message(&bound);
+  add(&bound, "secp256k1 schnorr verify", CKB_CYCLES_SECP_SCHNORR_VERIFY);
+  return bound;
+}
+
+/*
+ * The master input is assumed last, so every input lock hash is loaded.
+ * The master's own bound comes on top.
+ */
+static bound_t proxy_lock_bound() {
+  bound_t bound = start_bound("proxy_lock");
+  add_program(&bound, "proxy_lock");
+  add(&bound, "script", load_script_cycles());
+  add(&bound, "input lock hashes",
+      (shape.inputs + 1) *
+          (syscall_cycles(HASH_SIZE) + CKB_CYCLES_LOOP_ITERATION));
+  return bound;
+}
+
+static int parse_shape(int argc, char *argv[], int *first_measurement) {
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      verbose = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "--schnorr") == 0) {
+      schnorr = 1;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return ERROR_ARGS;
+    }
+    const char *value = argv[++i];
+    uint64_t n = strtoull(value, NULL, 0);
+    if (strcmp(argv[i - 1], "--build") == 0) {
+      build_dir = value;
+    } else if (strcmp(argv[i - 1], "--witness-size") == 0) {
+      shape.witness_size = n;
+    } else if (strcmp(argv[i - 1], "--inputs") == 0) {
+      shape.inputs = n;
+    } else if (strcmp(argv[i - 1], "--witnesses") == 0) {
+      shape.witnesses = n;
+    } else if (strcmp(argv[i - 1], "--group-inputs") == 0) {
+      shape.group_inputs = n;
+    } else if (strcmp(argv[i - 1], "--group-outputs") == 0) {
+      shape.group_outputs = n;
+    } else if (strcmp(argv[i - 1], "--script-size") == 0) {
+      shape.script_size = n;
+    } else if (strcmp(argv[i - 1], "--cell-deps") == 0) {
+      shape.cell_deps = n;
+    } else if (strcmp(argv[i - 1], "--branches") == 0) {
+      shape.branches = n;
+    } else if (strcmp(argv[i - 1], "--outputs") == 0) {
+      shape.outputs = n;
+    } else if (strcmp(argv[i - 1], "--registry-records") == 0) {
+      shape.registry_records = n;
+    } else if (strcmp(argv[i - 1], "--touched-assets") == 0) {
+      shape.touched_assets = n;
+    } else if (strcmp(argv[i - 1], "--messages") == 0) {
+      shape.messages = n;
+    } else {
+      return ERROR_ARGS;
+    }
+  }
+  if (shape.inputs == 0 || shape.group_inputs == 0 ||
+      shape.group_inputs > shape.inputs) {
+    return ERROR_ARGS;
+  }
+  *first_measurement = i;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  int first_measurement = 0;
+  if (parse_shape(argc, argv, &first_measurement) != 0) {
+    printf(
+        "Usage: %s [-v] [--schnorr] [--build <dir>] [--witness-size <bytes>] "
+        "[--inputs <n>] [--witnesses <n>] [--group-inputs <n>] "
+        "[--group-outputs <n>] [--script-size <bytes>] [--cell-deps <n>] "
+        "[--branches <n>] [--outputs <n>] [--registry-records <n>] "
+        "[--touched-assets <n>] [--messages <n>] "
+        "[<script>=<measured cycles>...]\n",
+        argv[0]);
+    return ERROR_ARGS;
+  }
+  int ret = load_library_info(SIGHASH_LIB, &sighash_lib);
+  if (ret != 0) {
+    return ret;
+  }
+  ret = load_image_info(SIGHASH_LIB_IMAGE, &sighash_image);
+  if (ret != 0) {
+    return ret;
+  }
+  if (schnorr) {
+    ret = load_library_info(SCHNORR_LIB, &schnorr_lib);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = load_image_info(SCHNORR_LIB_IMAGE, &schnorr_image);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  secp_data_size = file_size(SECP256K1_DATA);
+  /* The Schnorr locks come last, see script_count */
+  const char *binaries[] = {"htlc", "or", "simple_udt", "crosschain_lockscript",
+                            "crosschain_typescript", "crosschain_queue",
+                            "proxy_lock", "musig_lock", "ptlc"};
+  size_t binary_count = sizeof(binaries) / sizeof(binaries[0]);
+  if (!schnorr) {
+    binary_count -= 2;
+  }
+  for (size_t i = 0; i < binary_count; i++) {
+    if (file_size(binaries[i]) == 0) {
+      printf("%s/%s is missing\n", build_dir, binaries[i]);
+      return ERROR_IO;
+    }
+  }
+  if (secp_data_size == 0) {
+    return ERROR_IO;
+  }
+
+  bound_t (*scripts[])() = {htlc_bound,
+                            htlc_covenant_bound,
+                            or_bound,
+                            simple_udt_bound,
+                            crosschain_lockscript_bound,
+                            crosschain_typescript_bound,
+                            crosschain_queue_bound,
+                            proxy_lock_bound,
+                            musig_lock_bound,
+                            ptlc_bound};
+  size_t script_count = sizeof(scripts) / sizeof(scripts[0]);
+  if (!schnorr) {
+    script_count -= 2;
+  }
+  bound_t bounds[script_count];
+  for (size_t i = 0; i < script_count; i++) {
+    bounds[i] = scripts[i]();
+  }
+
+  printf("witness size %lu, inputs %lu, witnesses %lu, group inputs %lu, "
+         "group outputs %lu, cell deps %lu, or branches %lu, outputs %lu, "
+         "registry records %lu, touched assets %lu, messages %lu\n",
+         (unsigned long)shape.witness_size, (unsigned long)shape.inputs,
+         (unsigned long)shape.witnesses, (unsigned long)shape.group_inputs,
+         (unsigned long)shape.group_outputs, (unsigned long)shape.cell_deps,
+         (unsigned long)shape.branches, (unsigned long)shape.outputs,
+         (unsigned long)shape.registry_records,
+         (unsigned long)shape.touched_assets,
+         (unsigned long)shape.messages);
+  for (size_t i = 0; i < script_count; i++) {
+    printf("  %-24s %12lu\n", bounds[i].name, (unsigned long)bounds[i].total);
+  }
+
+  ret = 0;
+  for (int i = first_measurement; i < argc; i++) {
+    char *cycles = strchr(argv[i], '=');
+    if (cycles == NULL) {
+      return ERROR_ARGS;
+    }
+    *cycles++ = '\0';
+    uint64_t measured = strtoull(cycles, NULL, 0);
+    size_t j = 0;
+    while (j < script_count && strcmp(bounds[j].name, argv[i]) != 0) {
+      j++;
+    }
+    if (j == script_count) {
+      return ERROR_ARGS;
+    }
+    int exceeded = measured > bounds[j].total;
+    printf("  %-24s %12lu measured%s\n", argv[i], (unsigned long)measured,
+           exceeded ? ", exceeds the bound" : "");
+    if (exceeded) {
+      ret = ERROR_BOUND_EXCEEDED;
+    }
+  }
+  return ret;
+}
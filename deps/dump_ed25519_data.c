@@ -0,0 +1,54 @@
+/*
+ * Builds the Ed25519 base point table on the host, writes it to
+ * build/ed25519_data for deployment in a cell, and its size and data hash
+ * to build/ed25519_data_info.h, see deps/ed25519_helper.h.
+ */
+#include <stdio.h>
+
+#include "blake2b.h"
+#include "ed25519.h"
+
+#define ERROR_IO -1
+
+static ed25519_base_table_t table;
+
+int main(int argc, char* argv[]) {
+  ed25519_base_table_build(&table);
+
+  FILE* fp_data = fopen("build/ed25519_data", "wb");
+  if (!fp_data) {
+    return ERROR_IO;
+  }
+  fwrite(&table, sizeof(table), 1, fp_data);
+  fclose(fp_data);
+
+  FILE* fp = fopen("build/ed25519_data_info.h", "w");
+  if (!fp) {
+    return ERROR_IO;
+  }
+
+  fprintf(fp, "#ifndef CKB_ED25519_DATA_INFO_H_\n");
+  fprintf(fp, "#define CKB_ED25519_DATA_INFO_H_\n");
+  fprintf(fp, "#define CKB_ED25519_DATA_SIZE %ld\n", sizeof(table));
+
+  blake2b_state blake2b_ctx;
+  uint8_t hash[32];
+  blake2b_init(&blake2b_ctx, 32);
+  blake2b_update(&blake2b_ctx, &table, sizeof(table));
+  blake2b_final(&blake2b_ctx, hash, 32);
+
+  fprintf(fp,
+          "static uint8_t ckb_ed25519_data_hash[32] "
+          "__attribute__((unused)) = {\n  ");
+  for (int i = 0; i < 32; i++) {
+    fprintf(fp, "%u", hash[i]);
+    if (i != 31) {
+      fprintf(fp, ", ");
+    }
+  }
+  fprintf(fp, "\n};\n");
+  fprintf(fp, "#endif\n");
+  fclose(fp);
+
+  return 0;
+}
@@ -42,7 +42,9 @@ int main(int argc, char* argv[]) {
                  pre128_size);
   blake2b_final(&blake2b_ctx, hash, 32);
 
-  fprintf(fp, "static uint8_t ckb_secp256k1_data_hash[32] = {\n  ");
+  fprintf(fp,
+          "static uint8_t ckb_secp256k1_data_hash[32] "
+          "__attribute__((unused)) = {\n  ");
   for (int i = 0; i < 32; i++) {
     fprintf(fp, "%u", hash[i]);
     if (i != 31) {
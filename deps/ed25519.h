@@ -0,0 +1,793 @@
+/*
+ * Ed25519 signature verification, variable time, verify only.
+ *
+ * Field elements are five 51 bit limbs, the group formulas are those of
+ * the ref10 implementation in extended twisted Edwards coordinates, and
+ * scalar reduction modulo the group order follows TweetNaCl.
+ *
+ * Multiples of the base point come from a precomputed table, which
+ * on-chain is loaded from a cell dep, see deps/ed25519_helper.h and
+ * deps/dump_ed25519_data.c. Everything else is computed on the fly.
+ *
+ * Verification follows ZIP 215, the rules Tendermint light clients use:
+ * non canonical point encodings are accepted, S must be below the group
+ * order, and the cofactored equation [8][S]B = [8]R + [8][k]A is checked,
+ * so single and batch verification always agree.
+ */
+#ifndef CKB_ED25519_H_
+#define CKB_ED25519_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sha512.h"
+
+#define ED25519_PUBKEY_SIZE 32
+#define ED25519_SIGNATURE_SIZE 64
+#define ED25519_SCALAR_SIZE 32
+/* Signed radix 16 digits of a scalar below 2^255 */
+#define ED25519_DIGITS 64
+/* Multiples 1..8 of a point, for digits in [-8, 8] */
+#define ED25519_WINDOW 8
+
+#define ED25519_ERROR_ENCODING -1
+#define ED25519_ERROR_VERIFY -2
+
+typedef unsigned __int128 ed25519_uint128_t;
+typedef uint64_t fe25519[5];
+
+/* Extended coordinates, x = X/Z, y = Y/Z, xy = T/Z */
+typedef struct {
+  fe25519 X, Y, Z, T;
+} ge25519_p3;
+
+typedef struct {
+  fe25519 X, Y, Z;
+} ge25519_p2;
+
+/* Result of an addition or doubling before the final multiplications */
+typedef struct {
+  fe25519 X, Y, Z, T;
+} ge25519_p1p1;
+
+/* Ready to be added to another point */
+typedef struct {
+  fe25519 YplusX, YminusX, Z, T2d;
+} ge25519_cached;
+
+/* Affine point ready to be added, for the base point table */
+typedef struct {
+  fe25519 yplusx, yminusx, xy2d;
+} ge25519_precomp;
+
+/*
+ * base[i][j] = (j + 1) 16^(2i) B. The table is plain data on the host and
+ * in the VM alike, both are little endian 64 bit.
+ */
+typedef struct {
+  ge25519_precomp base[32][ED25519_WINDOW];
+} ed25519_base_table_t;
+
+/* A signature parsed, with its challenge computed */
+typedef struct {
+  ge25519_p3 a;
+  ge25519_p3 r;
+  uint8_t s[ED25519_SCALAR_SIZE];
+  /* SHA-512(R || A || M) mod l */
+  uint8_t k[ED25519_SCALAR_SIZE];
+} ed25519_prepared_t;
+
+/* Scratch memory of one point in a multi-scalar multiplication */
+typedef struct {
+  ge25519_cached multiples[ED25519_WINDOW];
+  int8_t digits[ED25519_DIGITS];
+} ed25519_msm_point_t;
+
+#define FE25519_MASK ((((uint64_t)1) << 51) - 1)
+
+static const fe25519 fe25519_d = {0x34dca135978a3ULL, 0x1a8283b156ebdULL,
+                                  0x5e7a26001c029ULL, 0x739c663a03cbbULL,
+                                  0x52036cee2b6ffULL};
+static const fe25519 fe25519_d2 = {0x69b9426b2f159ULL, 0x35050762add7aULL,
+                                   0x3cf44c0038052ULL, 0x6738cc7407977ULL,
+                                   0x2406d9dc56dffULL};
+static const fe25519 fe25519_sqrtm1 = {
+    0x61b274a0ea0b0ULL, 0x0d5a5fc8f189dULL, 0x7ef5e9cbd0c60ULL,
+    0x78595a6804c9eULL, 0x2b8324804fc1dULL};
+static const fe25519 fe25519_base_x = {
+    0x62d608f25d51aULL, 0x412a4b4f6592aULL, 0x75b7171a4b31dULL,
+    0x1ff60527118feULL, 0x216936d3cd6e5ULL};
+static const fe25519 fe25519_base_y = {
+    0x6666666666658ULL, 0x4ccccccccccccULL, 0x1999999999999ULL,
+    0x3333333333333ULL, 0x6666666666666ULL};
+
+static uint64_t ed25519_load64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+static void fe25519_0(fe25519 h) { memset(h, 0, sizeof(fe25519)); }
+
+static void fe25519_1(fe25519 h) {
+  fe25519_0(h);
+  h[0] = 1;
+}
+
+static void fe25519_copy(fe25519 h, const fe25519 f) {
+  memcpy(h, f, sizeof(fe25519));
+}
+
+/* Limbs back below 2^51, plus a small excess in the lowest one */
+static void fe25519_carry(fe25519 h) {
+  h[1] += h[0] >> 51;
+  h[0] &= FE25519_MASK;
+  h[2] += h[1] >> 51;
+  h[1] &= FE25519_MASK;
+  h[3] += h[2] >> 51;
+  h[2] &= FE25519_MASK;
+  h[4] += h[3] >> 51;
+  h[3] &= FE25519_MASK;
+  h[0] += 19 * (h[4] >> 51);
+  h[4] &= FE25519_MASK;
+}
+
+static void fe25519_add(fe25519 h, const fe25519 f, const fe25519 g) {
+  for (int i = 0; i < 5; i++) {
+    h[i] = f[i] + g[i];
+  }
+  fe25519_carry(h);
+}
+
+/* Adds 4p first, so g may have limbs up to 2^53 */
+static void fe25519_sub(fe25519 h, const fe25519 f, const fe25519 g) {
+  h[0] = f[0] + 0x1fffffffffffb4ULL - g[0];
+  for (int i = 1; i < 5; i++) {
+    h[i] = f[i] + 0x1ffffffffffffcULL - g[i];
+  }
+  fe25519_carry(h);
+}
+
+static void fe25519_neg(fe25519 h, const fe25519 f) {
+  fe25519 zero;
+  fe25519_0(zero);
+  fe25519_sub(h, zero, f);
+}
+
+static void fe25519_mul(fe25519 h, const fe25519 f, const fe25519 g) {
+  uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2], g3_19 = 19 * g[3],
+           g4_19 = 19 * g[4];
+  ed25519_uint128_t r0 = (ed25519_uint128_t)f[0] * g[0] +
+                         (ed25519_uint128_t)f[1] * g4_19 +
+                         (ed25519_uint128_t)f[2] * g3_19 +
+                         (ed25519_uint128_t)f[3] * g2_19 +
+                         (ed25519_uint128_t)f[4] * g1_19;
+  ed25519_uint128_t r1 = (ed25519_uint128_t)f[0] * g[1] +
+                         (ed25519_uint128_t)f[1] * g[0] +
+                         (ed25519_uint128_t)f[2] * g4_19 +
+                         (ed25519_uint128_t)f[3] * g3_19 +
+                         (ed25519_uint128_t)f[4] * g2_19;
+  ed25519_uint128_t r2 = (ed25519_uint128_t)f[0] * g[2] +
+                         (ed25519_uint128_t)f[1] * g[1] +
+                         (ed25519_uint128_t)f[2] * g[0] +
+                         (ed25519_uint128_t)f[3] * g4_19 +
+                         (ed25519_uint128_t)f[4] * g3_19;
+  ed25519_uint128_t r3 = (ed25519_uint128_t)f[0] * g[3] +
+                         (ed25519_uint128_t)f[1] * g[2] +
+                         (ed25519_uint128_t)f[2] * g[1] +
+                         (ed25519_uint128_t)f[3] * g[0] +
+                         (ed25519_uint128_t)f[4] * g4_19;
+  ed25519_uint128_t r4 = (ed25519_uint128_t)f[0] * g[4] +
+                         (ed25519_uint128_t)f[1] * g[3] +
+                         (ed25519_uint128_t)f[2] * g[2] +
+                         (ed25519_uint128_t)f[3] * g[1] +
+                         (ed25519_uint128_t)f[4] * g[0];
+
+  r1 += (uint64_t)(r0 >> 51);
+  r2 += (uint64_t)(r1 >> 51);
+  r3 += (uint64_t)(r2 >> 51);
+  r4 += (uint64_t)(r3 >> 51);
+  ed25519_uint128_t c =
+      (ed25519_uint128_t)(uint64_t)(r4 >> 51) * 19 + ((uint64_t)r0 & FE25519_MASK);
+  h[0] = (uint64_t)c & FE25519_MASK;
+  h[1] = ((uint64_t)r1 & FE25519_MASK) + (uint64_t)(c >> 51);
+  h[2] = (uint64_t)r2 & FE25519_MASK;
+  h[3] = (uint64_t)r3 & FE25519_MASK;
+  h[4] = (uint64_t)r4 & FE25519_MASK;
+}
+
+static void fe25519_sq(fe25519 h, const fe25519 f) {
+  uint64_t f0_2 = 2 * f[0], f1_2 = 2 * f[1];
+  uint64_t f3_19 = 19 * f[3], f4_19 = 19 * f[4];
+  ed25519_uint128_t r0 = (ed25519_uint128_t)f[0] * f[0] +
+                         (ed25519_uint128_t)(2 * f[1]) * f4_19 +
+                         (ed25519_uint128_t)(2 * f[2]) * f3_19;
+  ed25519_uint128_t r1 = (ed25519_uint128_t)f0_2 * f[1] +
+                         (ed25519_uint128_t)(2 * f[2]) * f4_19 +
+                         (ed25519_uint128_t)f[3] * f3_19;
+  ed25519_uint128_t r2 = (ed25519_uint128_t)f0_2 * f[2] +
+                         (ed25519_uint128_t)f[1] * f[1] +
+                         (ed25519_uint128_t)(2 * f[3]) * f4_19;
+  ed25519_uint128_t r3 = (ed25519_uint128_t)f0_2 * f[3] +
+                         (ed25519_uint128_t)f1_2 * f[2] +
+                         (ed25519_uint128_t)f[4] * f4_19;
+  ed25519_uint128_t r4 = (ed25519_uint128_t)f0_2 * f[4] +
+                         (ed25519_uint128_t)f1_2 * f[3] +
+                         (ed25519_uint128_t)f[2] * f[2];
+
+  r1 += (uint64_t)(r0 >> 51);
+  r2 += (uint64_t)(r1 >> 51);
+  r3 += (uint64_t)(r2 >> 51);
+  r4 += (uint64_t)(r3 >> 51);
+  ed25519_uint128_t c =
+      (ed25519_uint128_t)(uint64_t)(r4 >> 51) * 19 + ((uint64_t)r0 & FE25519_MASK);
+  h[0] = (uint64_t)c & FE25519_MASK;
+  h[1] = ((uint64_t)r1 & FE25519_MASK) + (uint64_t)(c >> 51);
+  h[2] = (uint64_t)r2 & FE25519_MASK;
+  h[3] = (uint64_t)r3 & FE25519_MASK;
+  h[4] = (uint64_t)r4 & FE25519_MASK;
+}
+
+static void fe25519_sqn(fe25519 h, const fe25519 f, int n) {
+  fe25519_sq(h, f);
+  for (int i = 1; i < n; i++) {
+    fe25519_sq(h, h);
+  }
+}
+
+/* Bit 255 is ignored, values from p up to 2^255 are taken modulo p */
+static void fe25519_frombytes(fe25519 h, const uint8_t *s) {
+  h[0] = ed25519_load64(s) & FE25519_MASK;
+  h[1] = (ed25519_load64(s + 6) >> 3) & FE25519_MASK;
+  h[2] = (ed25519_load64(s + 12) >> 6) & FE25519_MASK;
+  h[3] = (ed25519_load64(s + 19) >> 1) & FE25519_MASK;
+  h[4] = (ed25519_load64(s + 24) >> 12) & FE25519_MASK;
+}
+
+/* Canonical encoding, fully reduced modulo p */
+static void fe25519_tobytes(uint8_t *s, const fe25519 f) {
+  fe25519 h;
+  fe25519_copy(h, f);
+  fe25519_carry(h);
+  fe25519_carry(h);
+  /* h < 2^255 now, subtract p when h >= p */
+  uint64_t q = (h[0] + 19) >> 51;
+  q = (h[1] + q) >> 51;
+  q = (h[2] + q) >> 51;
+  q = (h[3] + q) >> 51;
+  q = (h[4] + q) >> 51;
+  h[0] += 19 * q;
+  h[1] += h[0] >> 51;
+  h[0] &= FE25519_MASK;
+  h[2] += h[1] >> 51;
+  h[1] &= FE25519_MASK;
+  h[3] += h[2] >> 51;
+  h[2] &= FE25519_MASK;
+  h[4] += h[3] >> 51;
+  h[3] &= FE25519_MASK;
+  h[4] &= FE25519_MASK;
+
+  uint64_t w[4] = {h[0] | (h[1] << 51), (h[1] >> 13) | (h[2] << 38),
+                   (h[2] >> 26) | (h[3] << 25), (h[3] >> 39) | (h[4] << 12)};
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      s[i * 8 + j] = (uint8_t)(w[i] >> (8 * j));
+    }
+  }
+}
+
+static int fe25519_iszero(const fe25519 f) {
+  uint8_t s[32];
+  fe25519_tobytes(s, f);
+  uint8_t acc = 0;
+  for (int i = 0; i < 32; i++) {
+    acc |= s[i];
+  }
+  return acc == 0;
+}
+
+static int fe25519_isnegative(const fe25519 f) {
+  uint8_t s[32];
+  fe25519_tobytes(s, f);
+  return s[0] & 1;
+}
+
+static int fe25519_equal(const fe25519 f, const fe25519 g) {
+  fe25519 h;
+  fe25519_sub(h, f, g);
+  return fe25519_iszero(h);
+}
+
+/* z^(2^250 - 1) in out, z^11 in z11 */
+static void fe25519_pow2501(fe25519 out, fe25519 z11, const fe25519 z) {
+  fe25519 t0, t1, t2;
+  fe25519_sq(t0, z);
+  fe25519_sqn(t1, t0, 2);
+  fe25519_mul(t1, z, t1);
+  fe25519_mul(z11, t0, t1);
+  fe25519_sq(t0, z11);
+  fe25519_mul(t0, t1, t0);
+  fe25519_sqn(t1, t0, 5);
+  fe25519_mul(t0, t1, t0);
+  fe25519_sqn(t1, t0, 10);
+  fe25519_mul(t1, t1, t0);
+  fe25519_sqn(t2, t1, 20);
+  fe25519_mul(t1, t2, t1);
+  fe25519_sqn(t1, t1, 10);
+  fe25519_mul(t0, t1, t0);
+  fe25519_sqn(t1, t0, 50);
+  fe25519_mul(t1, t1, t0);
+  fe25519_sqn(t2, t1, 100);
+  fe25519_mul(t1, t2, t1);
+  fe25519_sqn(t1, t1, 50);
+  fe25519_mul(out, t1, t0);
+}
+
+/* z^(p - 2) */
+static void fe25519_invert(fe25519 out, const fe25519 z) {
+  fe25519 t, z11;
+  fe25519_pow2501(t, z11, z);
+  fe25519_sqn(t, t, 5);
+  fe25519_mul(out, t, z11);
+}
+
+/* z^((p - 5) / 8) */
+static void fe25519_pow22523(fe25519 out, const fe25519 z) {
+  fe25519 t, z11;
+  fe25519_pow2501(t, z11, z);
+  fe25519_sqn(t, t, 2);
+  fe25519_mul(out, t, z);
+}
+
+static void ge25519_identity(ge25519_p3 *h) {
+  fe25519_0(h->X);
+  fe25519_1(h->Y);
+  fe25519_1(h->Z);
+  fe25519_0(h->T);
+}
+
+static void ge25519_p1p1_to_p2(ge25519_p2 *r, const ge25519_p1p1 *p) {
+  fe25519_mul(r->X, p->X, p->T);
+  fe25519_mul(r->Y, p->Y, p->Z);
+  fe25519_mul(r->Z, p->Z, p->T);
+}
+
+static void ge25519_p1p1_to_p3(ge25519_p3 *r, const ge25519_p1p1 *p) {
+  fe25519_mul(r->X, p->X, p->T);
+  fe25519_mul(r->Y, p->Y, p->Z);
+  fe25519_mul(r->Z, p->Z, p->T);
+  fe25519_mul(r->T, p->X, p->Y);
+}
+
+static void ge25519_p3_to_cached(ge25519_cached *r, const ge25519_p3 *p) {
+  fe25519_add(r->YplusX, p->Y, p->X);
+  fe25519_sub(r->YminusX, p->Y, p->X);
+  fe25519_copy(r->Z, p->Z);
+  fe25519_mul(r->T2d, p->T, fe25519_d2);
+}
+
+static void ge25519_p2_dbl(ge25519_p1p1 *r, const ge25519_p2 *p) {
+  fe25519 t0;
+  fe25519_sq(r->X, p->X);
+  fe25519_sq(r->Z, p->Y);
+  fe25519_sq(r->T, p->Z);
+  fe25519_add(r->T, r->T, r->T);
+  fe25519_add(r->Y, p->X, p->Y);
+  fe25519_sq(t0, r->Y);
+  fe25519_add(r->Y, r->Z, r->X);
+  fe25519_sub(r->Z, r->Z, r->X);
+  fe25519_sub(r->X, t0, r->Y);
+  fe25519_sub(r->T, r->T, r->Z);
+}
+
+static void ge25519_p3_dbl(ge25519_p1p1 *r, const ge25519_p3 *p) {
+  ge25519_p2 q;
+  fe25519_copy(q.X, p->X);
+  fe25519_copy(q.Y, p->Y);
+  fe25519_copy(q.Z, p->Z);
+  ge25519_p2_dbl(r, &q);
+}
+
+/* r = p + q, or p - q when negate is set */
+static void ge25519_add_cached(ge25519_p1p1 *r, const ge25519_p3 *p,
+                               const ge25519_cached *q, int negate) {
+  fe25519 t0;
+  fe25519_add(r->X, p->Y, p->X);
+  fe25519_sub(r->Y, p->Y, p->X);
+  fe25519_mul(r->Z, r->X, negate ? q->YminusX : q->YplusX);
+  fe25519_mul(r->Y, r->Y, negate ? q->YplusX : q->YminusX);
+  fe25519_mul(r->T, q->T2d, p->T);
+  fe25519_mul(r->X, p->Z, q->Z);
+  fe25519_add(t0, r->X, r->X);
+  fe25519_sub(r->X, r->Z, r->Y);
+  fe25519_add(r->Y, r->Z, r->Y);
+  if (negate) {
+    fe25519_sub(r->Z, t0, r->T);
+    fe25519_add(r->T, t0, r->T);
+  } else {
+    fe25519_add(r->Z, t0, r->T);
+    fe25519_sub(r->T, t0, r->T);
+  }
+}
+
+static void ge25519_add_precomp(ge25519_p1p1 *r, const ge25519_p3 *p,
+                                const ge25519_precomp *q, int negate) {
+  fe25519 t0;
+  fe25519_add(r->X, p->Y, p->X);
+  fe25519_sub(r->Y, p->Y, p->X);
+  fe25519_mul(r->Z, r->X, negate ? q->yminusx : q->yplusx);
+  fe25519_mul(r->Y, r->Y, negate ? q->yplusx : q->yminusx);
+  fe25519_mul(r->T, q->xy2d, p->T);
+  fe25519_add(t0, p->Z, p->Z);
+  fe25519_sub(r->X, r->Z, r->Y);
+  fe25519_add(r->Y, r->Z, r->Y);
+  if (negate) {
+    fe25519_sub(r->Z, t0, r->T);
+    fe25519_add(r->T, t0, r->T);
+  } else {
+    fe25519_add(r->Z, t0, r->T);
+    fe25519_sub(r->T, t0, r->T);
+  }
+}
+
+static void ge25519_add_p3(ge25519_p3 *r, const ge25519_p3 *p,
+                           const ge25519_p3 *q, int negate) {
+  ge25519_cached c;
+  ge25519_p1p1 t;
+  ge25519_p3_to_cached(&c, q);
+  ge25519_add_cached(&t, p, &c, negate);
+  ge25519_p1p1_to_p3(r, &t);
+}
+
+/* r = 2^n p */
+static void ge25519_dbln(ge25519_p3 *r, const ge25519_p3 *p, int n) {
+  ge25519_p1p1 t;
+  ge25519_p2 q;
+  ge25519_p3_dbl(&t, p);
+  for (int i = 1; i < n; i++) {
+    ge25519_p1p1_to_p2(&q, &t);
+    ge25519_p2_dbl(&t, &q);
+  }
+  ge25519_p1p1_to_p3(r, &t);
+}
+
+/* Only the identity and the points of small order pass after [8] */
+static int ge25519_is_identity(const ge25519_p3 *p) {
+  return fe25519_iszero(p->X) && fe25519_equal(p->Y, p->Z);
+}
+
+/*
+ * Decodes any 32 byte string with a y below 2^255 that is on the curve,
+ * canonical or not. x = 0 with the sign bit set decodes to x = 0.
+ */
+static int ge25519_frombytes(ge25519_p3 *h, const uint8_t *s) {
+  fe25519 u, v, v3, vxx, check;
+  fe25519_frombytes(h->Y, s);
+  fe25519_1(h->Z);
+  fe25519_sq(u, h->Y);
+  fe25519_mul(v, u, fe25519_d);
+  fe25519_sub(u, u, h->Z);
+  fe25519_add(v, v, h->Z);
+
+  /* x = u v^3 (u v^7)^((p - 5) / 8) */
+  fe25519_sq(v3, v);
+  fe25519_mul(v3, v3, v);
+  fe25519_sq(h->X, v3);
+  fe25519_mul(h->X, h->X, v);
+  fe25519_mul(h->X, h->X, u);
+  fe25519_pow22523(h->X, h->X);
+  fe25519_mul(h->X, h->X, v3);
+  fe25519_mul(h->X, h->X, u);
+
+  fe25519_sq(vxx, h->X);
+  fe25519_mul(vxx, vxx, v);
+  fe25519_sub(check, vxx, u);
+  if (!fe25519_iszero(check)) {
+    fe25519_add(check, vxx, u);
+    if (!fe25519_iszero(check)) {
+      return ED25519_ERROR_ENCODING;
+    }
+    fe25519_mul(h->X, h->X, fe25519_sqrtm1);
+  }
+  if (fe25519_isnegative(h->X) != (s[31] >> 7)) {
+    fe25519_neg(h->X, h->X);
+  }
+  fe25519_mul(h->T, h->X, h->Y);
+  return 0;
+}
+
+static const uint8_t sc25519_l[ED25519_SCALAR_SIZE] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7,
+    0xa2, 0xde, 0xf9, 0xde, 0x14, 0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0x10};
+
+/* r = x mod l for x in 64 signed byte sized digits, x is clobbered */
+static void sc25519_reduce_digits(uint8_t *r, int64_t x[64]) {
+  int64_t carry;
+  int i, j;
+  for (i = 63; i >= 32; i--) {
+    carry = 0;
+    for (j = i - 32; j < i - 12; j++) {
+      x[j] += carry - 16 * x[i] * sc25519_l[j - (i - 32)];
+      carry = (x[j] + 128) >> 8;
+      x[j] -= carry * 256;
+    }
+    x[j] += carry;
+    x[i] = 0;
+  }
+  carry = 0;
+  for (j = 0; j < 32; j++) {
+    x[j] += carry - (x[31] >> 4) * sc25519_l[j];
+    carry = x[j] >> 8;
+    x[j] &= 255;
+  }
+  for (j = 0; j < 32; j++) {
+    x[j] -= carry * sc25519_l[j];
+  }
+  for (i = 0; i < 32; i++) {
+    x[i + 1] += x[i] >> 8;
+    r[i] = x[i] & 255;
+  }
+}
+
+/* r = s mod l for a 64 byte s, e.g. a SHA-512 digest */
+static void sc25519_reduce64(uint8_t *r, const uint8_t *s) {
+  int64_t x[64];
+  for (int i = 0; i < 64; i++) {
+    x[i] = s[i];
+  }
+  sc25519_reduce_digits(r, x);
+}
+
+/* r = a b + c mod l */
+static void sc25519_muladd(uint8_t *r, const uint8_t *a, const uint8_t *b,
+                           const uint8_t *c) {
+  int64_t x[64];
+  memset(x, 0, sizeof(x));
+  for (int i = 0; i < 32; i++) {
+    x[i] = c[i];
+  }
+  for (int i = 0; i < 32; i++) {
+    for (int j = 0; j < 32; j++) {
+      x[i + j] += (int64_t)a[i] * b[j];
+    }
+  }
+  sc25519_reduce_digits(r, x);
+}
+
+static int sc25519_is_canonical(const uint8_t *s) {
+  for (int i = ED25519_SCALAR_SIZE - 1; i >= 0; i--) {
+    if (s[i] < sc25519_l[i]) {
+      return 1;
+    }
+    if (s[i] > sc25519_l[i]) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+/* Signed radix 16 digits in [-8, 8), for scalars below 2^255 */
+static void sc25519_digits(int8_t *e, const uint8_t *a) {
+  for (int i = 0; i < 32; i++) {
+    e[2 * i] = a[i] & 15;
+    e[2 * i + 1] = (a[i] >> 4) & 15;
+  }
+  int8_t carry = 0;
+  for (int i = 0; i < ED25519_DIGITS - 1; i++) {
+    e[i] += carry;
+    carry = (e[i] + 8) >> 4;
+    e[i] -= carry << 4;
+  }
+  e[ED25519_DIGITS - 1] += carry;
+}
+
+static void ge25519_precomp_from_p3(ge25519_precomp *r, const ge25519_p3 *p) {
+  fe25519 recip, x, y;
+  fe25519_invert(recip, p->Z);
+  fe25519_mul(x, p->X, recip);
+  fe25519_mul(y, p->Y, recip);
+  fe25519_add(r->yplusx, y, x);
+  fe25519_sub(r->yminusx, y, x);
+  fe25519_mul(r->xy2d, x, y);
+  fe25519_mul(r->xy2d, r->xy2d, fe25519_d2);
+  /* Canonical limbs, so the table bytes do not depend on the path taken */
+  uint8_t s[32];
+  fe25519_tobytes(s, r->yplusx);
+  fe25519_frombytes(r->yplusx, s);
+  fe25519_tobytes(s, r->yminusx);
+  fe25519_frombytes(r->yminusx, s);
+  fe25519_tobytes(s, r->xy2d);
+  fe25519_frombytes(r->xy2d, s);
+}
+
+/* Fills the base point table, only needed on the host */
+static void ed25519_base_table_build(ed25519_base_table_t *table) {
+  ge25519_p3 row;
+  fe25519_copy(row.X, fe25519_base_x);
+  fe25519_copy(row.Y, fe25519_base_y);
+  fe25519_1(row.Z);
+  fe25519_mul(row.T, row.X, row.Y);
+  for (int i = 0; i < 32; i++) {
+    ge25519_p3 multiple = row;
+    for (int j = 0; j < ED25519_WINDOW; j++) {
+      ge25519_precomp_from_p3(&table->base[i][j], &multiple);
+      ge25519_add_p3(&multiple, &multiple, &row, 0);
+    }
+    /* Next row is 256 times this one */
+    ge25519_dbln(&row, &row, 8);
+  }
+}
+
+/* h = [a]B, a below 2^255 */
+static void ed25519_scalarmult_base(ge25519_p3 *h,
+                                    const ed25519_base_table_t *table,
+                                    const uint8_t *a) {
+  int8_t e[ED25519_DIGITS];
+  sc25519_digits(e, a);
+  ge25519_p1p1 r;
+  ge25519_identity(h);
+  for (int pass = 1; pass >= 0; pass--) {
+    if (pass == 0) {
+      ge25519_dbln(h, h, 4);
+    }
+    for (int i = pass; i < ED25519_DIGITS; i += 2) {
+      if (e[i] == 0) {
+        continue;
+      }
+      int negate = e[i] < 0;
+      int index = (negate ? -e[i] : e[i]) - 1;
+      ge25519_add_precomp(&r, h, &table->base[i / 2][index], negate);
+      ge25519_p1p1_to_p3(h, &r);
+    }
+  }
+}
+
+/* Multiples 1..8 of p for the window of a multi-scalar multiplication */
+static void ed25519_msm_point_init(ed25519_msm_point_t *point,
+                                   const ge25519_p3 *p, const uint8_t *a) {
+  ge25519_p3 multiple = *p;
+  ge25519_p3_to_cached(&point->multiples[0], p);
+  for (int j = 1; j < ED25519_WINDOW; j++) {
+    ge25519_p1p1 t;
+    ge25519_add_cached(&t, &multiple, &point->multiples[0], 0);
+    ge25519_p1p1_to_p3(&multiple, &t);
+    ge25519_p3_to_cached(&point->multiples[j], &multiple);
+  }
+  sc25519_digits(point->digits, a);
+}
+
+/*
+ * h = sum [a_i]P_i over points prepared by ed25519_msm_point_init, Straus
+ * style: all points share one chain of doublings.
+ */
+static void ed25519_msm(ge25519_p3 *h, const ed25519_msm_point_t *points,
+                        size_t count) {
+  int top = ED25519_DIGITS - 1;
+  while (top > 0) {
+    int nonzero = 0;
+    for (size_t i = 0; i < count && !nonzero; i++) {
+      nonzero = points[i].digits[top] != 0;
+    }
+    if (nonzero) {
+      break;
+    }
+    top--;
+  }
+  ge25519_identity(h);
+  for (int d = top; d >= 0; d--) {
+    if (d != top) {
+      ge25519_dbln(h, h, 4);
+    }
+    for (size_t i = 0; i < count; i++) {
+      int8_t digit = points[i].digits[d];
+      if (digit == 0) {
+        continue;
+      }
+      ge25519_p1p1 t;
+      int negate = digit < 0;
+      int index = (negate ? -digit : digit) - 1;
+      ge25519_add_cached(&t, h, &points[i].multiples[index], negate);
+      ge25519_p1p1_to_p3(h, &t);
+    }
+  }
+}
+
+static int ed25519_prepare(ed25519_prepared_t *prepared,
+                           const uint8_t *pubkey, const uint8_t *signature,
+                           const uint8_t *message, size_t message_len) {
+  if (!sc25519_is_canonical(&signature[32])) {
+    return ED25519_ERROR_ENCODING;
+  }
+  if (ge25519_frombytes(&prepared->a, pubkey) != 0 ||
+      ge25519_frombytes(&prepared->r, signature) != 0) {
+    return ED25519_ERROR_ENCODING;
+  }
+  memcpy(prepared->s, &signature[32], ED25519_SCALAR_SIZE);
+
+  uint8_t hash[SHA512_HASH_SIZE];
+  sha512_ctx_t ctx;
+  sha512_init(&ctx);
+  sha512_update(&ctx, signature, 32);
+  sha512_update(&ctx, pubkey, ED25519_PUBKEY_SIZE);
+  sha512_update(&ctx, message, message_len);
+  sha512_final(&ctx, hash);
+  sc25519_reduce64(prepared->k, hash);
+  return 0;
+}
+
+/* [8]([S]B - [k]A - R) == 0 */
+static int ed25519_check(const ed25519_base_table_t *table,
+                         const ed25519_prepared_t *prepared,
+                         ed25519_msm_point_t *scratch) {
+  ge25519_p3 q, sb;
+  ed25519_msm_point_init(scratch, &prepared->a, prepared->k);
+  ed25519_msm(&q, scratch, 1);
+  ge25519_add_p3(&q, &q, &prepared->r, 0);
+  ed25519_scalarmult_base(&sb, table, prepared->s);
+  ge25519_add_p3(&q, &sb, &q, 1);
+  ge25519_dbln(&q, &q, 3);
+  return ge25519_is_identity(&q) ? 0 : ED25519_ERROR_VERIFY;
+}
+
+/*
+ * Randomized batch check of count prepared signatures:
+ *
+ *   [8]([sum z_i S_i]B - sum [z_i]R_i - sum [z_i k_i]A_i) == 0
+ *
+ * with 128 bit randomizers z_i. They are derived from a hash over every
+ * k_i and S_i, and k_i commits to R_i, A_i and the message, so a signer
+ * can not predict them. scratch must hold 2 count points.
+ */
+static int ed25519_check_batch(const ed25519_base_table_t *table,
+                               const ed25519_prepared_t *prepared,
+                               size_t count, ed25519_msm_point_t *scratch) {
+  uint8_t seed[SHA512_HASH_SIZE + sizeof(uint32_t)];
+  sha512_ctx_t ctx;
+  sha512_init(&ctx);
+  for (size_t i = 0; i < count; i++) {
+    sha512_update(&ctx, prepared[i].k, ED25519_SCALAR_SIZE);
+    sha512_update(&ctx, prepared[i].s, ED25519_SCALAR_SIZE);
+  }
+  sha512_final(&ctx, seed);
+
+  uint8_t s_sum[ED25519_SCALAR_SIZE];
+  memset(s_sum, 0, sizeof(s_sum));
+  uint8_t randomizers[SHA512_HASH_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    /* One digest yields four randomizers */
+    size_t offset = (i % 4) * 16;
+    if (offset == 0) {
+      uint32_t block = (uint32_t)(i / 4);
+      for (int j = 0; j < 4; j++) {
+        seed[SHA512_HASH_SIZE + j] = (uint8_t)(block >> (8 * j));
+      }
+      sha512_init(&ctx);
+      sha512_update(&ctx, seed, sizeof(seed));
+      sha512_final(&ctx, randomizers);
+    }
+    uint8_t z[ED25519_SCALAR_SIZE];
+    memset(z, 0, sizeof(z));
+    memcpy(z, &randomizers[offset], 16);
+
+    uint8_t zk[ED25519_SCALAR_SIZE];
+    uint8_t zero[ED25519_SCALAR_SIZE];
+    memset(zero, 0, sizeof(zero));
+    sc25519_muladd(zk, z, prepared[i].k, zero);
+    sc25519_muladd(s_sum, z, prepared[i].s, s_sum);
+    ed25519_msm_point_init(&scratch[2 * i], &prepared[i].r, z);
+    ed25519_msm_point_init(&scratch[2 * i + 1], &prepared[i].a, zk);
+  }
+
+  ge25519_p3 q, sb;
+  ed25519_msm(&q, scratch, 2 * count);
+  ed25519_scalarmult_base(&sb, table, s_sum);
+  ge25519_add_p3(&q, &sb, &q, 1);
+  ge25519_dbln(&q, &q, 3);
+  return ge25519_is_identity(&q) ? 0 : ED25519_ERROR_VERIFY;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CKB_ED25519_HELPER_H_
+#define CKB_ED25519_HELPER_H_
+
+#include "ckb_syscalls.h"
+#include "ed25519.h"
+#include "ed25519_data_info.h"
+#include "tx_context.h"
+
+#define CKB_ED25519_HELPER_ERROR_LOADING_DATA -106
+
+/*
+ * Loads the base point table built by deps/dump_ed25519_data.c from the
+ * cell dep with its data hash, the way secp256k1_helper.h loads the
+ * secp256k1 tables. The table lands in the storage the transaction context
+ * carries, at most once per script run, or in data when the context has
+ * none. data should then be at least CKB_ED25519_DATA_SIZE big.
+ */
+int ckb_ed25519_load_table_with_context(ckb_tx_context_t* tx_ctx, void* data,
+                                        const ed25519_base_table_t** table) {
+  if (CKB_ED25519_DATA_SIZE != sizeof(ed25519_base_table_t)) {
+    return CKB_ED25519_HELPER_ERROR_LOADING_DATA;
+  }
+  int shared = tx_ctx->ed25519_data != NULL &&
+               tx_ctx->ed25519_data_size >= CKB_ED25519_DATA_SIZE;
+  if (shared && ckb_tx_context_has(tx_ctx, CKB_TX_CONTEXT_HAS_ED25519_DATA)) {
+    *table = (const ed25519_base_table_t*)tx_ctx->ed25519_data;
+    return 0;
+  }
+  void* target = shared ? tx_ctx->ed25519_data : data;
+  if (target == NULL) {
+    return CKB_ED25519_HELPER_ERROR_LOADING_DATA;
+  }
+
+  size_t index = SIZE_MAX;
+  int ret = ckb_tx_context_find_dep(tx_ctx, ckb_ed25519_data_hash, &index);
+  if (ret != CKB_SUCCESS) {
+    return ret;
+  }
+  uint64_t len = CKB_ED25519_DATA_SIZE;
+  ret = ckb_load_cell_data(target, &len, 0, index, CKB_SOURCE_CELL_DEP);
+  if (ret != CKB_SUCCESS || len != CKB_ED25519_DATA_SIZE) {
+    return CKB_ED25519_HELPER_ERROR_LOADING_DATA;
+  }
+  if (shared) {
+    tx_ctx->computed |= CKB_TX_CONTEXT_HAS_ED25519_DATA;
+  }
+  *table = (const ed25519_base_table_t*)target;
+  return 0;
+}
+
+#endif
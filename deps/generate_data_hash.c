@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "blake2b.h"
 
 int main(int argc, char *argv[]) {
   if (argc != 3) {
-    printf("Usage: %s <file name to hash> <hash variable name>\n", argv[0]);
+    printf("Usage: %s <file name to hash> <hash variable name | --hex>\n",
+           argv[0]);
     return 1;
   }
 
@@ -31,6 +33,16 @@ int main(int argc, char *argv[]) {
 
   free(buffer);
 
+  /* Plain 0x prefixed hex, as used in JSON transactions */
+  if (strcmp(argv[2], "--hex") == 0) {
+    printf("0x");
+    for (int i = 0; i < 32; i++) {
+      printf("%02x", hash[i]);
+    }
+    printf("\n");
+    return 0;
+  }
+
   printf("#ifndef CKB_%s_H_\n", argv[2]);
   printf("#define CKB_%s_H_\n", argv[2]);
   printf("static uint8_t %s[32] = {\n  ", argv[2]);
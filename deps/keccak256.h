@@ -0,0 +1,193 @@
+/*
+ * Keccak-256 as used by Ethereum: keccak-f[1600] with a 136 byte rate and
+ * the original 0x01 padding, not the 0x06 of FIPS 202 SHA3-256.
+ */
+#ifndef CKB_KECCAK256_H_
+#define CKB_KECCAK256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define KECCAK256_HASH_SIZE 32
+#define KECCAK256_RATE 136
+
+typedef struct {
+  uint64_t state[25];
+  uint8_t block[KECCAK256_RATE];
+  size_t block_len;
+} keccak256_ctx_t;
+
+static const uint64_t keccak_round_constants[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+    0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+#define KECCAK_ROL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+/* chi of one plane, B holds the plane after theta, rho and pi */
+#define KECCAK_CHI(E, p, B)                 \
+  E##p##a = B##a ^ (~B##e & B##i);          \
+  E##p##e = B##e ^ (~B##i & B##o);          \
+  E##p##i = B##i ^ (~B##o & B##u);          \
+  E##p##o = B##o ^ (~B##u & B##a);          \
+  E##p##u = B##u ^ (~B##a & B##e)
+
+/*
+ * One round reading lanes A and writing lanes E. Two rounds per loop
+ * iteration swap the roles back, so the 50 lanes stay plain locals and pi
+ * costs no moves at all. The 25 lanes of a round plus theta's temporaries
+ * about fill the 31 usable registers of RV64, the other set lives on the
+ * stack.
+ */
+#define KECCAK_ROUND(A, E, rc)                                            \
+  do {                                                                    \
+    uint64_t Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa;                  \
+    uint64_t Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se;                  \
+    uint64_t Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si;                  \
+    uint64_t Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so;                  \
+    uint64_t Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su;                  \
+    uint64_t Da = Cu ^ KECCAK_ROL(Ce, 1);                                 \
+    uint64_t De = Ca ^ KECCAK_ROL(Ci, 1);                                 \
+    uint64_t Di = Ce ^ KECCAK_ROL(Co, 1);                                 \
+    uint64_t Do = Ci ^ KECCAK_ROL(Cu, 1);                                 \
+    uint64_t Du = Co ^ KECCAK_ROL(Ca, 1);                                 \
+    uint64_t Ba, Be, Bi, Bo, Bu;                                          \
+                                                                          \
+    Ba = A##ba ^ Da;                                                      \
+    Be = KECCAK_ROL(A##ge ^ De, 44);                                      \
+    Bi = KECCAK_ROL(A##ki ^ Di, 43);                                      \
+    Bo = KECCAK_ROL(A##mo ^ Do, 21);                                      \
+    Bu = KECCAK_ROL(A##su ^ Du, 14);                                      \
+    KECCAK_CHI(E, b, B);                                                  \
+    E##ba ^= (rc);                                                        \
+                                                                          \
+    Ba = KECCAK_ROL(A##bo ^ Do, 28);                                      \
+    Be = KECCAK_ROL(A##gu ^ Du, 20);                                      \
+    Bi = KECCAK_ROL(A##ka ^ Da, 3);                                       \
+    Bo = KECCAK_ROL(A##me ^ De, 45);                                      \
+    Bu = KECCAK_ROL(A##si ^ Di, 61);                                      \
+    KECCAK_CHI(E, g, B);                                                  \
+                                                                          \
+    Ba = KECCAK_ROL(A##be ^ De, 1);                                       \
+    Be = KECCAK_ROL(A##gi ^ Di, 6);                                       \
+    Bi = KECCAK_ROL(A##ko ^ Do, 25);                                      \
+    Bo = KECCAK_ROL(A##mu ^ Du, 8);                                       \
+    Bu = KECCAK_ROL(A##sa ^ Da, 18);                                      \
+    KECCAK_CHI(E, k, B);                                                  \
+                                                                          \
+    Ba = KECCAK_ROL(A##bu ^ Du, 27);                                      \
+    Be = KECCAK_ROL(A##ga ^ Da, 36);                                      \
+    Bi = KECCAK_ROL(A##ke ^ De, 10);                                      \
+    Bo = KECCAK_ROL(A##mi ^ Di, 15);                                      \
+    Bu = KECCAK_ROL(A##so ^ Do, 56);                                      \
+    KECCAK_CHI(E, m, B);                                                  \
+                                                                          \
+    Ba = KECCAK_ROL(A##bi ^ Di, 62);                                      \
+    Be = KECCAK_ROL(A##go ^ Do, 55);                                      \
+    Bi = KECCAK_ROL(A##ku ^ Du, 39);                                      \
+    Bo = KECCAK_ROL(A##ma ^ Da, 41);                                      \
+    Bu = KECCAK_ROL(A##se ^ De, 2);                                       \
+    KECCAK_CHI(E, s, B);                                                  \
+  } while (0)
+
+#define KECCAK_LANES(X)                                                   \
+  X##ba, X##be, X##bi, X##bo, X##bu, X##ga, X##ge, X##gi, X##go, X##gu,   \
+      X##ka, X##ke, X##ki, X##ko, X##ku, X##ma, X##me, X##mi, X##mo,      \
+      X##mu, X##sa, X##se, X##si, X##so, X##su
+
+static void keccak_f1600(uint64_t *state) {
+  uint64_t KECCAK_LANES(A);
+  uint64_t KECCAK_LANES(E);
+  Aba = state[0], Abe = state[1], Abi = state[2], Abo = state[3];
+  Abu = state[4], Aga = state[5], Age = state[6], Agi = state[7];
+  Ago = state[8], Agu = state[9], Aka = state[10], Ake = state[11];
+  Aki = state[12], Ako = state[13], Aku = state[14], Ama = state[15];
+  Ame = state[16], Ami = state[17], Amo = state[18], Amu = state[19];
+  Asa = state[20], Ase = state[21], Asi = state[22], Aso = state[23];
+  Asu = state[24];
+  for (int i = 0; i < 24; i += 2) {
+    KECCAK_ROUND(A, E, keccak_round_constants[i]);
+    KECCAK_ROUND(E, A, keccak_round_constants[i + 1]);
+  }
+  state[0] = Aba, state[1] = Abe, state[2] = Abi, state[3] = Abo;
+  state[4] = Abu, state[5] = Aga, state[6] = Age, state[7] = Agi;
+  state[8] = Ago, state[9] = Agu, state[10] = Aka, state[11] = Ake;
+  state[12] = Aki, state[13] = Ako, state[14] = Aku, state[15] = Ama;
+  state[16] = Ame, state[17] = Ami, state[18] = Amo, state[19] = Amu;
+  state[20] = Asa, state[21] = Ase, state[22] = Asi, state[23] = Aso;
+  state[24] = Asu;
+}
+
+#undef KECCAK_LANES
+#undef KECCAK_ROUND
+#undef KECCAK_CHI
+#undef KECCAK_ROL
+
+/*
+ * Lanes are little endian like RV64, so a block is XORed in a word at a
+ * time. CKB-VM allows the unaligned loads of a block inside a witness.
+ */
+static void keccak256_absorb(keccak256_ctx_t *ctx, const uint8_t *block) {
+  for (int i = 0; i < KECCAK256_RATE / 8; i++) {
+    uint64_t lane;
+    memcpy(&lane, &block[i * 8], sizeof(lane));
+    ctx->state[i] ^= lane;
+  }
+  keccak_f1600(ctx->state);
+}
+
+static void keccak256_init(keccak256_ctx_t *ctx) {
+  memset(ctx->state, 0, sizeof(ctx->state));
+  ctx->block_len = 0;
+}
+
+static void keccak256_update(keccak256_ctx_t *ctx, const uint8_t *data,
+                             size_t len) {
+  if (ctx->block_len > 0) {
+    size_t n = KECCAK256_RATE - ctx->block_len;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(&ctx->block[ctx->block_len], data, n);
+    ctx->block_len += n;
+    data += n;
+    len -= n;
+    if (ctx->block_len < KECCAK256_RATE) {
+      return;
+    }
+    keccak256_absorb(ctx, ctx->block);
+    ctx->block_len = 0;
+  }
+  /* Full blocks are absorbed in place */
+  while (len >= KECCAK256_RATE) {
+    keccak256_absorb(ctx, data);
+    data += KECCAK256_RATE;
+    len -= KECCAK256_RATE;
+  }
+  memcpy(ctx->block, data, len);
+  ctx->block_len = len;
+}
+
+static void keccak256_final(keccak256_ctx_t *ctx, uint8_t *hash) {
+  memset(&ctx->block[ctx->block_len], 0, KECCAK256_RATE - ctx->block_len);
+  ctx->block[ctx->block_len] = 0x01;
+  ctx->block[KECCAK256_RATE - 1] |= 0x80;
+  keccak256_absorb(ctx, ctx->block);
+  memcpy(hash, ctx->state, KECCAK256_HASH_SIZE);
+}
+
+/* One digest of a buffer, e.g. a trie node hashed inside the witness */
+static void keccak256(const uint8_t *data, size_t len, uint8_t *hash) {
+  keccak256_ctx_t ctx;
+  keccak256_init(&ctx);
+  keccak256_update(&ctx, data, len);
+  keccak256_final(&ctx, hash);
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Prints the memory plan of a script and checks it against the CKB-VM
+ * memory limit.
+ *
+ * The input is the unstripped script binary (the .debug file produced by
+ * the build keeps section headers and the symbol table). The report lists
+ * the allocated sections, the phase sizes recorded with CKB_MEMORY_PHASE
+ * and the large static objects. Peak memory is the end of the highest
+ * allocated section plus the stack, since the stack grows down from the top
+ * of VM memory towards the image.
+ *
+ * The stack is the worst case computed by stack_report, or the high water
+ * mark measured in a VM run when that is larger. The peak must fit in the
+ * budget, which defaults to the whole VM memory.
+ */
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_layout.h"
+
+#define LARGE_OBJECT_SIZE 4096
+
+#define ERROR_ARGS 1
+#define ERROR_IO -1
+#define ERROR_INVALID_ELF -2
+#define ERROR_MEMORY_LIMIT -5
+
+static uint8_t *input;
+static size_t input_size;
+
+static int in_range(uint64_t offset, uint64_t size, uint64_t limit) {
+  return offset <= limit && size <= limit - offset;
+}
+
+static int load_input(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return ERROR_IO;
+  }
+  fseek(f, 0, SEEK_END);
+  input_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  input = malloc(input_size);
+  if (fread(input, input_size, 1, f) != 1) {
+    fclose(f);
+    return ERROR_IO;
+  }
+  fclose(f);
+  return 0;
+}
+
+static const char *string_at(const Elf64_Shdr *strtab, uint32_t offset) {
+  if (offset >= strtab->sh_size) {
+    return "";
+  }
+  return (const char *)(input + strtab->sh_offset + offset);
+}
+
+static void print_symbols(const Elf64_Shdr *shs, const Elf64_Shdr *symtab) {
+  const Elf64_Shdr *strtab = &shs[symtab->sh_link];
+  const Elf64_Sym *syms = (const Elf64_Sym *)(input + symtab->sh_offset);
+  size_t count = symtab->sh_size / sizeof(Elf64_Sym);
+  size_t prefix_len = strlen(CKB_MEMORY_SYMBOL_PREFIX);
+
+  printf("  phases:\n");
+  for (size_t i = 0; i < count; i++) {
+    const char *name = string_at(strtab, syms[i].st_name);
+    if (syms[i].st_shndx == SHN_ABS &&
+        strncmp(name, CKB_MEMORY_SYMBOL_PREFIX, prefix_len) == 0) {
+      printf("    %-40s %10lu\n", name + prefix_len,
+             (unsigned long)syms[i].st_value);
+    }
+  }
+  printf("  large objects:\n");
+  for (size_t i = 0; i < count; i++) {
+    if (ELF64_ST_TYPE(syms[i].st_info) == STT_OBJECT &&
+        syms[i].st_size >= LARGE_OBJECT_SIZE) {
+      printf("    %-40s %10lu\n", string_at(strtab, syms[i].st_name),
+             (unsigned long)syms[i].st_size);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc > 5) {
+    printf(
+        "Usage: %s <unstripped script> <worst case stack> "
+        "[<measured stack> [<budget>]]\n",
+        argv[0]);
+    return ERROR_ARGS;
+  }
+  int ret = load_input(argv[1]);
+  if (ret != 0) {
+    return ret;
+  }
+  uint64_t stack = strtoull(argv[2], NULL, 0);
+  uint64_t measured_stack = argc > 3 ? strtoull(argv[3], NULL, 0) : 0;
+  uint64_t budget = argc > 4 ? strtoull(argv[4], NULL, 0) : CKB_VM_MEMORY_SIZE;
+  if (budget == 0 || budget > CKB_VM_MEMORY_SIZE) {
+    budget = CKB_VM_MEMORY_SIZE;
+  }
+
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)input;
+  if (input_size < sizeof(Elf64_Ehdr) ||
+      memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_ident[EI_CLASS] != ELFCLASS64 ||
+      header->e_shentsize != sizeof(Elf64_Shdr) ||
+      header->e_shstrndx >= header->e_shnum ||
+      !in_range(header->e_shoff, header->e_shnum * sizeof(Elf64_Shdr),
+                input_size)) {
+    return ERROR_INVALID_ELF;
+  }
+  const Elf64_Shdr *shs = (const Elf64_Shdr *)(input + header->e_shoff);
+  for (int i = 0; i < header->e_shnum; i++) {
+    if (shs[i].sh_type != SHT_NOBITS &&
+        !in_range(shs[i].sh_offset, shs[i].sh_size, input_size)) {
+      return ERROR_INVALID_ELF;
+    }
+    if (shs[i].sh_type == SHT_SYMTAB && shs[i].sh_link >= header->e_shnum) {
+      return ERROR_INVALID_ELF;
+    }
+  }
+  const Elf64_Shdr *shstrtab = &shs[header->e_shstrndx];
+
+  printf("%s\n  sections:\n", argv[1]);
+  uint64_t image_end = 0;
+  const Elf64_Shdr *symtab = NULL;
+  for (int i = 0; i < header->e_shnum; i++) {
+    if (shs[i].sh_type == SHT_SYMTAB) {
+      symtab = &shs[i];
+    }
+    if ((shs[i].sh_flags & SHF_ALLOC) == 0 || shs[i].sh_size == 0) {
+      continue;
+    }
+    printf("    %-24s 0x%08lx %10lu\n", string_at(shstrtab, shs[i].sh_name),
+           (unsigned long)shs[i].sh_addr, (unsigned long)shs[i].sh_size);
+    if (shs[i].sh_addr + shs[i].sh_size > image_end) {
+      image_end = shs[i].sh_addr + shs[i].sh_size;
+    }
+  }
+  if (symtab != NULL) {
+    print_symbols(shs, symtab);
+  }
+
+  printf("  image end      0x%08lx\n", (unsigned long)image_end);
+  printf("  stack          %10lu worst case\n", (unsigned long)stack);
+  if (measured_stack > 0) {
+    printf("  stack          %10lu measured\n", (unsigned long)measured_stack);
+    if (measured_stack > stack) {
+      stack = measured_stack;
+    }
+  }
+  uint64_t peak = image_end + stack;
+  printf("  peak           %10lu of %lu budget, %d VM (%lu%%)\n",
+         (unsigned long)peak, (unsigned long)budget, CKB_VM_MEMORY_SIZE,
+         (unsigned long)(peak * 100 / CKB_VM_MEMORY_SIZE));
+  if (peak > budget) {
+    printf("  exceeds the memory budget\n");
+    return ERROR_MEMORY_LIMIT;
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Host side Merkle mountain range tool for c/crosschain_queue.c, see
+ * c/mmr.h for the layout.
+ *
+ *   mmr_proof < messages
+ *
+ * reads the queued messages in queue order, one hex message per line, and
+ * prints the cell data of the queue holding them and its root, the data
+ * hash of that cell.
+ *
+ *   mmr_proof <index> < messages
+ *
+ * prints the same plus the leaf hash of message index and its inclusion
+ * proof, the sibling path followed by the other peaks as mmr_verify takes
+ * them. Every proof is checked with mmr_verify before it is printed.
+ *
+ * Relayers collect the messages from the output_type witnesses of the
+ * queue's transactions. Output is hex, one labelled value per line.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mmr.h"
+
+/* A message fits in a witness */
+#define MAX_MESSAGE_SIZE 32768
+
+#define ERROR_ARGS 1
+#define ERROR_IO -1
+#define ERROR_INVALID_MESSAGE -2
+#define ERROR_PROOF -3
+
+static int parse_hex(const char *hex, size_t hex_len, uint8_t *out,
+                     size_t *size) {
+  if (hex_len >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+    hex += 2;
+    hex_len -= 2;
+  }
+  if (hex_len % 2 != 0 || hex_len / 2 > MAX_MESSAGE_SIZE) {
+    return 0;
+  }
+  for (size_t i = 0; i < hex_len / 2; i++) {
+    unsigned int byte = 0;
+    if (sscanf(&hex[i * 2], "%2x", &byte) != 1) {
+      return 0;
+    }
+    out[i] = byte;
+  }
+  *size = hex_len / 2;
+  return 1;
+}
+
+static void print_hex(const char *label, const uint8_t *data, size_t size) {
+  printf("%s ", label);
+  for (size_t i = 0; i < size; i++) {
+    printf("%02x", data[i]);
+  }
+  printf("\n");
+}
+
+/* Hashes every message of stdin into a newly allocated array of leaves */
+static int read_leaves(uint8_t **leaves, uint64_t *count) {
+  static char line[2 * MAX_MESSAGE_SIZE + 4];
+  static uint8_t message[MAX_MESSAGE_SIZE];
+  uint64_t capacity = 0;
+  *leaves = NULL;
+  *count = 0;
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') {
+      len--;
+    } else if (!feof(stdin)) {
+      return ERROR_INVALID_MESSAGE;
+    }
+    size_t size = 0;
+    if (!parse_hex(line, len, message, &size)) {
+      return ERROR_INVALID_MESSAGE;
+    }
+    if (*count == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      uint8_t *grown = realloc(*leaves, capacity * MMR_HASH_SIZE);
+      if (grown == NULL) {
+        return ERROR_IO;
+      }
+      *leaves = grown;
+    }
+    mmr_hash(message, size, &(*leaves)[*count * MMR_HASH_SIZE]);
+    (*count)++;
+  }
+  return ferror(stdin) ? ERROR_IO : 0;
+}
+
+/*
+ * Writes the proof of leaf index to proof and returns its size: the
+ * siblings are read off the levels of the tree under the leaf's peak,
+ * rebuilt from its leaves.
+ */
+static int build_proof(const mmr_t *mmr, const uint8_t *leaves,
+                       uint64_t index, uint8_t *proof, uint64_t *proof_size) {
+  uint64_t start = 0, peak = 0;
+  int height = 63;
+  for (;; height--) {
+    uint64_t width = (uint64_t)1 << height;
+    if (!(mmr->count & width)) {
+      continue;
+    }
+    if (index - start < width) {
+      break;
+    }
+    start += width;
+    peak++;
+  }
+  uint64_t width = (uint64_t)1 << height;
+  uint8_t *level = malloc(width * MMR_HASH_SIZE);
+  if (level == NULL) {
+    return ERROR_IO;
+  }
+  memcpy(level, &leaves[start * MMR_HASH_SIZE], width * MMR_HASH_SIZE);
+  uint64_t size = 0, position = index - start;
+  for (; width > 1; width >>= 1, position >>= 1) {
+    memcpy(&proof[size], &level[(position ^ 1) * MMR_HASH_SIZE],
+           MMR_HASH_SIZE);
+    size += MMR_HASH_SIZE;
+    for (uint64_t i = 0; i < width / 2; i++) {
+      mmr_merge(mmr, &level[2 * i * MMR_HASH_SIZE],
+                &level[(2 * i + 1) * MMR_HASH_SIZE],
+                &level[i * MMR_HASH_SIZE]);
+    }
+  }
+  free(level);
+  for (uint64_t i = 0; i < mmr->peak_count; i++) {
+    if (i != peak) {
+      memcpy(&proof[size], mmr->peaks[i], MMR_HASH_SIZE);
+      size += MMR_HASH_SIZE;
+    }
+  }
+  *proof_size = size;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 2) {
+    printf("Usage: %s [<message index>] < messages\n", argv[0]);
+    return ERROR_ARGS;
+  }
+  uint8_t *leaves = NULL;
+  uint64_t count = 0;
+  int ret = read_leaves(&leaves, &count);
+  if (ret != 0) {
+    free(leaves);
+    return ret;
+  }
+
+  static mmr_t mmr;
+  mmr_init(&mmr);
+  for (uint64_t i = 0; i < count; i++) {
+    mmr_append(&mmr, &leaves[i * MMR_HASH_SIZE]);
+  }
+  uint8_t data[MMR_DATA_SIZE_MAX];
+  uint64_t data_size = mmr_store(&mmr, data);
+  uint8_t root[MMR_HASH_SIZE];
+  mmr_hash(data, data_size, root);
+  printf("count %llu\n", (unsigned long long)count);
+  print_hex("data", data, data_size);
+  print_hex("root", root, MMR_HASH_SIZE);
+
+  if (argc == 2) {
+    char *end = NULL;
+    uint64_t index = strtoull(argv[1], &end, 0);
+    if (*argv[1] == '\0' || *end != '\0' || index >= count) {
+      free(leaves);
+      return ERROR_ARGS;
+    }
+    /* At most 63 siblings and 63 other peaks */
+    uint8_t proof[2 * MMR_PEAKS_MAX * MMR_HASH_SIZE];
+    uint64_t proof_size = 0;
+    ret = build_proof(&mmr, leaves, index, proof, &proof_size);
+    const uint8_t *leaf = &leaves[index * MMR_HASH_SIZE];
+    if (ret == 0 &&
+        mmr_verify(&mmr, root, count, index, leaf, proof, proof_size) != 0) {
+      ret = ERROR_PROOF;
+    }
+    if (ret == 0) {
+      printf("index %llu\n", (unsigned long long)index);
+      print_hex("leaf", leaf, MMR_HASH_SIZE);
+      print_hex("proof", proof, proof_size);
+    }
+  }
+  free(leaves);
+  return ret;
+}
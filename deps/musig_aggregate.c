@@ -0,0 +1,247 @@
+/*
+ * Host side MuSig2 aggregation for c/musig_lock.c, following BIP327
+ * without tweaks.
+ *
+ *   musig_aggregate key <pubkey>...
+ *
+ * sorts the 33 byte compressed pubkeys of the committee (KeySort),
+ * aggregates them (KeyAgg) and prints the 32 byte x-only aggregated pubkey
+ * that goes into the lock args.
+ *
+ *   musig_aggregate sig <R> <partial signature>...
+ *
+ * adds up the 32 byte partial signatures of a signing session whose final
+ * nonce has the x coordinate R, and prints the 64 byte BIP340 signature
+ * that goes into the witness. Nonce exchange and partial signing happen in
+ * the signers' wallets.
+ *
+ *   musig_aggregate secret <T> <pre-signature> <signature>
+ *
+ * recovers the adaptor secret t of c/ptlc.c from the 33 byte compressed
+ * adaptor point T, the 32 byte s' of the adaptor pre-signature and the
+ * published 64 byte signature (R, s). The signers negate t when R' + T has
+ * odd y, so s = s' + t or s = s' - t; of the two candidates s - s' and
+ * s' - s it prints the one with tG == T, and fails if neither matches.
+ *
+ * Arguments and output are hex. Built from the same secp256k1 sources as
+ * the on-chain libraries.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HAVE_CONFIG_H 1
+#include <secp256k1.c>
+
+#define PUBKEY_SIZE 33
+#define XONLY_SIZE 32
+#define SCALAR_SIZE 32
+#define MAX_KEYS 1024
+
+#define ERROR_ARGS 1
+#define ERROR_INVALID_PUBKEY -3
+#define ERROR_INVALID_SCALAR -4
+#define ERROR_AGGREGATION -5
+#define ERROR_ADAPTOR -6
+
+static int parse_hex(const char *hex, unsigned char *out, size_t size) {
+  if (hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+    hex += 2;
+  }
+  if (strlen(hex) != size * 2) {
+    return 0;
+  }
+  for (size_t i = 0; i < size; i++) {
+    unsigned int byte = 0;
+    if (sscanf(&hex[i * 2], "%2x", &byte) != 1) {
+      return 0;
+    }
+    out[i] = byte;
+  }
+  return 1;
+}
+
+static void print_hex(const unsigned char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    printf("%02x", data[i]);
+  }
+  printf("\n");
+}
+
+static int compare_pubkeys(const void *a, const void *b) {
+  return memcmp(a, b, PUBKEY_SIZE);
+}
+
+static void tagged_hash(secp256k1_sha256 *hash, const char *tag) {
+  secp256k1_sha256_initialize_tagged(hash, (const unsigned char *)tag,
+                                     strlen(tag));
+}
+
+static int aggregate_keys(int count, char *hex[]) {
+  if (count < 1 || count > MAX_KEYS) {
+    return ERROR_ARGS;
+  }
+  static unsigned char keys[MAX_KEYS][PUBKEY_SIZE];
+  for (int i = 0; i < count; i++) {
+    if (!parse_hex(hex[i], keys[i], PUBKEY_SIZE)) {
+      return ERROR_ARGS;
+    }
+  }
+  qsort(keys, count, PUBKEY_SIZE, compare_pubkeys);
+
+  secp256k1_context *ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+  unsigned char list_hash[SCALAR_SIZE];
+  secp256k1_sha256 hash;
+  tagged_hash(&hash, "KeyAgg list");
+  for (int i = 0; i < count; i++) {
+    secp256k1_sha256_write(&hash, keys[i], PUBKEY_SIZE);
+  }
+  secp256k1_sha256_finalize(&hash, list_hash);
+
+  /* The second distinct key gets coefficient 1 */
+  const unsigned char *second = NULL;
+  for (int i = 1; i < count && second == NULL; i++) {
+    if (memcmp(keys[i], keys[0], PUBKEY_SIZE) != 0) {
+      second = keys[i];
+    }
+  }
+
+  static secp256k1_pubkey points[MAX_KEYS];
+  static const secp256k1_pubkey *point_ptrs[MAX_KEYS];
+  for (int i = 0; i < count; i++) {
+    if (!secp256k1_ec_pubkey_parse(ctx, &points[i], keys[i], PUBKEY_SIZE)) {
+      secp256k1_context_destroy(ctx);
+      return ERROR_INVALID_PUBKEY;
+    }
+    if (second == NULL || memcmp(keys[i], second, PUBKEY_SIZE) != 0) {
+      unsigned char coefficient[SCALAR_SIZE];
+      tagged_hash(&hash, "KeyAgg coefficient");
+      secp256k1_sha256_write(&hash, list_hash, SCALAR_SIZE);
+      secp256k1_sha256_write(&hash, keys[i], PUBKEY_SIZE);
+      secp256k1_sha256_finalize(&hash, coefficient);
+      if (!secp256k1_ec_pubkey_tweak_mul(ctx, &points[i], coefficient)) {
+        secp256k1_context_destroy(ctx);
+        return ERROR_AGGREGATION;
+      }
+    }
+    point_ptrs[i] = &points[i];
+  }
+
+  secp256k1_pubkey aggregated;
+  unsigned char serialized[PUBKEY_SIZE];
+  size_t serialized_size = PUBKEY_SIZE;
+  if (!secp256k1_ec_pubkey_combine(ctx, &aggregated, point_ptrs, count) ||
+      !secp256k1_ec_pubkey_serialize(ctx, serialized, &serialized_size,
+                                     &aggregated, SECP256K1_EC_COMPRESSED)) {
+    secp256k1_context_destroy(ctx);
+    return ERROR_AGGREGATION;
+  }
+  secp256k1_context_destroy(ctx);
+  /* x-only, the signers account for the parity of the aggregated key */
+  print_hex(&serialized[1], XONLY_SIZE);
+  return 0;
+}
+
+static int aggregate_signatures(int count, char *hex[]) {
+  if (count < 2) {
+    return ERROR_ARGS;
+  }
+  unsigned char signature[XONLY_SIZE + SCALAR_SIZE];
+  if (!parse_hex(hex[0], signature, XONLY_SIZE)) {
+    return ERROR_ARGS;
+  }
+  secp256k1_scalar s;
+  secp256k1_scalar_clear(&s);
+  for (int i = 1; i < count; i++) {
+    unsigned char partial32[SCALAR_SIZE];
+    if (!parse_hex(hex[i], partial32, SCALAR_SIZE)) {
+      return ERROR_ARGS;
+    }
+    secp256k1_scalar partial;
+    int overflow = 0;
+    secp256k1_scalar_set_b32(&partial, partial32, &overflow);
+    if (overflow) {
+      return ERROR_INVALID_SCALAR;
+    }
+    secp256k1_scalar_add(&s, &s, &partial);
+  }
+  secp256k1_scalar_get_b32(&signature[XONLY_SIZE], &s);
+  print_hex(signature, sizeof(signature));
+  return 0;
+}
+
+/* Whether secret32 is the discrete log of the compressed point */
+static int matches_point(const secp256k1_context *ctx,
+                         const unsigned char *secret32,
+                         const unsigned char *point) {
+  secp256k1_pubkey pubkey;
+  unsigned char serialized[PUBKEY_SIZE];
+  size_t serialized_size = PUBKEY_SIZE;
+  return secp256k1_ec_pubkey_create(ctx, &pubkey, secret32) &&
+         secp256k1_ec_pubkey_serialize(ctx, serialized, &serialized_size,
+                                       &pubkey, SECP256K1_EC_COMPRESSED) &&
+         memcmp(serialized, point, PUBKEY_SIZE) == 0;
+}
+
+static int extract_secret(int count, char *hex[]) {
+  if (count != 3) {
+    return ERROR_ARGS;
+  }
+  unsigned char adaptor[PUBKEY_SIZE];
+  unsigned char pre32[SCALAR_SIZE];
+  unsigned char signature[XONLY_SIZE + SCALAR_SIZE];
+  if (!parse_hex(hex[0], adaptor, PUBKEY_SIZE) ||
+      !parse_hex(hex[1], pre32, SCALAR_SIZE) ||
+      !parse_hex(hex[2], signature, sizeof(signature))) {
+    return ERROR_ARGS;
+  }
+  secp256k1_scalar pre, s;
+  int overflow = 0;
+  secp256k1_scalar_set_b32(&pre, pre32, &overflow);
+  if (overflow) {
+    return ERROR_INVALID_SCALAR;
+  }
+  secp256k1_scalar_set_b32(&s, &signature[XONLY_SIZE], &overflow);
+  if (overflow) {
+    return ERROR_INVALID_SCALAR;
+  }
+  secp256k1_scalar_negate(&pre, &pre);
+  secp256k1_scalar_add(&s, &s, &pre);
+
+  secp256k1_context *ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+  unsigned char secret[SCALAR_SIZE];
+  secp256k1_scalar_get_b32(secret, &s);
+  int ret = 0;
+  if (!matches_point(ctx, secret, adaptor)) {
+    secp256k1_scalar_negate(&s, &s);
+    secp256k1_scalar_get_b32(secret, &s);
+    if (!matches_point(ctx, secret, adaptor)) {
+      ret = ERROR_ADAPTOR;
+    }
+  }
+  secp256k1_context_destroy(ctx);
+  if (ret != 0) {
+    return ret;
+  }
+  print_hex(secret, SCALAR_SIZE);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  int ret = ERROR_ARGS;
+  if (argc >= 2 && strcmp(argv[1], "key") == 0) {
+    ret = aggregate_keys(argc - 2, &argv[2]);
+  } else if (argc >= 2 && strcmp(argv[1], "sig") == 0) {
+    ret = aggregate_signatures(argc - 2, &argv[2]);
+  } else if (argc >= 2 && strcmp(argv[1], "secret") == 0) {
+    ret = extract_secret(argc - 2, &argv[2]);
+  }
+  if (ret == ERROR_ARGS) {
+    printf(
+        "Usage: %s key <pubkey>...\n"
+        "       %s sig <R> <partial signature>...\n"
+        "       %s secret <T> <pre-signature> <signature>\n",
+        argv[0], argv[0], argv[0]);
+  }
+  return ret;
+}
@@ -0,0 +1,289 @@
+/*
+ * Produces a pre-relocated image of a CKB shared library for one fixed load
+ * address, see c/prelink_image.h for the output layout.
+ *
+ * The load address is that of the arena the caller passes to
+ * ckb_loader_open_prelinked, the library itself lives one page above it.
+ */
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prelink_image.h"
+
+#define PAGE_SIZE 4096
+#define ROUNDUP(a, b) ((((a)-1) / (b) + 1) * (b))
+
+#define ERROR_ARGS 1
+#define ERROR_IO -1
+#define ERROR_INVALID_ELF -2
+#define ERROR_LAYOUT -3
+#define ERROR_RELOCATION -4
+
+static uint8_t *input;
+static size_t input_size;
+static uint8_t *image;
+static uint64_t base, code_size, file_size, mem_size;
+
+static int in_range(uint64_t offset, uint64_t size, uint64_t limit) {
+  return offset <= limit && size <= limit - offset;
+}
+
+static int load_input(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return ERROR_IO;
+  }
+  fseek(f, 0, SEEK_END);
+  input_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  input = malloc(input_size);
+  if (fread(input, input_size, 1, f) != 1) {
+    fclose(f);
+    return ERROR_IO;
+  }
+  fclose(f);
+  return 0;
+}
+
+/*
+ * Lay out PT_LOAD segments at their virtual addresses. Everything below the
+ * end of the last executable segment is loaded as code, so only read-only
+ * segments may live there.
+ */
+static int layout_segments(const Elf64_Ehdr *header) {
+  const Elf64_Phdr *phs = (const Elf64_Phdr *)(input + header->e_phoff);
+  for (int i = 0; i < header->e_phnum; i++) {
+    const Elf64_Phdr *ph = &phs[i];
+    if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+      continue;
+    }
+    if (ph->p_filesz > ph->p_memsz ||
+        !in_range(ph->p_offset, ph->p_filesz, input_size)) {
+      return ERROR_INVALID_ELF;
+    }
+    uint64_t end = ROUNDUP(ph->p_vaddr + ph->p_memsz, PAGE_SIZE);
+    if ((ph->p_flags & PF_X) != 0 && end > code_size) {
+      code_size = end;
+    }
+    if (end > mem_size) {
+      mem_size = end;
+    }
+  }
+  file_size = code_size;
+  for (int i = 0; i < header->e_phnum; i++) {
+    const Elf64_Phdr *ph = &phs[i];
+    if (ph->p_type != PT_LOAD || ph->p_memsz == 0 ||
+        (ph->p_flags & PF_X) != 0) {
+      continue;
+    }
+    if (ph->p_vaddr < code_size) {
+      if ((ph->p_flags & PF_W) != 0 || ph->p_vaddr + ph->p_memsz > code_size) {
+        return ERROR_LAYOUT;
+      }
+    } else if (ph->p_vaddr + ph->p_filesz > file_size) {
+      file_size = ph->p_vaddr + ph->p_filesz;
+    }
+  }
+  image = calloc(mem_size, 1);
+  for (int i = 0; i < header->e_phnum; i++) {
+    const Elf64_Phdr *ph = &phs[i];
+    if (ph->p_type == PT_LOAD && ph->p_memsz > 0) {
+      memcpy(image + ph->p_vaddr, input + ph->p_offset, ph->p_filesz);
+    }
+  }
+  return 0;
+}
+
+static uint64_t symbol_count(const uint32_t *sysv_hash,
+                             const uint32_t *gnu_hash, uint64_t dynsym,
+                             uint64_t dynstr) {
+  if (sysv_hash != NULL) {
+    return sysv_hash[1];
+  }
+  if (gnu_hash != NULL) {
+    uint32_t nbuckets = gnu_hash[0];
+    uint32_t symoffset = gnu_hash[1];
+    const uint32_t *buckets =
+        (const uint32_t *)((const uint64_t *)&gnu_hash[4] + gnu_hash[2]);
+    const uint32_t *chain = &buckets[nbuckets];
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < nbuckets; i++) {
+      if (buckets[i] > last) {
+        last = buckets[i];
+      }
+    }
+    if (last < symoffset) {
+      return symoffset;
+    }
+    while ((chain[last - symoffset] & 1) == 0) {
+      last++;
+    }
+    return last + 1;
+  }
+  return dynstr > dynsym ? (dynstr - dynsym) / sizeof(Elf64_Sym) : 0;
+}
+
+static int relocate(const Elf64_Rela *relas, uint64_t count,
+                    const Elf64_Sym *dynsyms, uint64_t dynsym_count) {
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t type = ELF64_R_TYPE(relas[i].r_info);
+    if (type == R_RISCV_NONE) {
+      continue;
+    }
+    /* Code pages are frozen after loading, text relocations can't work */
+    if (relas[i].r_offset < code_size ||
+        !in_range(relas[i].r_offset, sizeof(uint64_t), mem_size)) {
+      return ERROR_RELOCATION;
+    }
+    uint64_t value = 0;
+    if (type == R_RISCV_RELATIVE) {
+      value = base + relas[i].r_addend;
+    } else if (type == R_RISCV_64 || type == R_RISCV_JUMP_SLOT) {
+      uint64_t sym = ELF64_R_SYM(relas[i].r_info);
+      if (sym >= dynsym_count || dynsyms[sym].st_shndx == SHN_UNDEF) {
+        return ERROR_RELOCATION;
+      }
+      value = base + dynsyms[sym].st_value + relas[i].r_addend;
+    } else {
+      return ERROR_RELOCATION;
+    }
+    memcpy(image + relas[i].r_offset, &value, sizeof(uint64_t));
+  }
+  return 0;
+}
+
+static int process_dynamic(const Elf64_Ehdr *header,
+                           ckb_prelink_header_t *out) {
+  const Elf64_Phdr *phs = (const Elf64_Phdr *)(input + header->e_phoff);
+  const Elf64_Phdr *dynamic = NULL;
+  for (int i = 0; i < header->e_phnum; i++) {
+    if (phs[i].p_type == PT_DYNAMIC) {
+      dynamic = &phs[i];
+    }
+  }
+  if (dynamic == NULL ||
+      !in_range(dynamic->p_vaddr, dynamic->p_memsz, mem_size)) {
+    return ERROR_INVALID_ELF;
+  }
+
+  uint64_t rela = 0, relasz = 0, jmprel = 0, pltrelsz = 0;
+  const Elf64_Dyn *dyns = (const Elf64_Dyn *)(image + dynamic->p_vaddr);
+  for (uint64_t i = 0;
+       i < dynamic->p_memsz / sizeof(Elf64_Dyn) && dyns[i].d_tag != DT_NULL;
+       i++) {
+    switch (dyns[i].d_tag) {
+      case DT_SYMTAB:
+        out->dynsym = dyns[i].d_un.d_ptr;
+        break;
+      case DT_STRTAB:
+        out->dynstr = dyns[i].d_un.d_ptr;
+        break;
+      case DT_STRSZ:
+        out->dynstr_size = dyns[i].d_un.d_val;
+        break;
+      case DT_HASH:
+        out->sysv_hash = dyns[i].d_un.d_ptr;
+        break;
+      case DT_GNU_HASH:
+        out->gnu_hash = dyns[i].d_un.d_ptr;
+        break;
+      case DT_RELA:
+        rela = dyns[i].d_un.d_ptr;
+        break;
+      case DT_RELASZ:
+        relasz = dyns[i].d_un.d_val;
+        break;
+      case DT_JMPREL:
+        jmprel = dyns[i].d_un.d_ptr;
+        break;
+      case DT_PLTRELSZ:
+        pltrelsz = dyns[i].d_un.d_val;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!in_range(out->dynstr, out->dynstr_size, mem_size) ||
+      !in_range(rela, relasz, mem_size) ||
+      !in_range(jmprel, pltrelsz, mem_size)) {
+    return ERROR_INVALID_ELF;
+  }
+  out->dynsym_count = symbol_count(
+      out->sysv_hash ? (const uint32_t *)(image + out->sysv_hash) : NULL,
+      out->gnu_hash ? (const uint32_t *)(image + out->gnu_hash) : NULL,
+      out->dynsym, out->dynstr);
+  if (!in_range(out->dynsym, out->dynsym_count * sizeof(Elf64_Sym),
+                mem_size)) {
+    return ERROR_INVALID_ELF;
+  }
+
+  const Elf64_Sym *dynsyms = (const Elf64_Sym *)(image + out->dynsym);
+  int ret = relocate((const Elf64_Rela *)(image + rela),
+                     relasz / sizeof(Elf64_Rela), dynsyms, out->dynsym_count);
+  if (ret != 0) {
+    return ret;
+  }
+  return relocate((const Elf64_Rela *)(image + jmprel),
+                  pltrelsz / sizeof(Elf64_Rela), dynsyms, out->dynsym_count);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 4) {
+    printf("Usage: %s <shared library> <arena address> <output image>\n",
+           argv[0]);
+    return ERROR_ARGS;
+  }
+  int ret = load_input(argv[1]);
+  if (ret != 0) {
+    return ret;
+  }
+  base = strtoull(argv[2], NULL, 0) + PAGE_SIZE;
+  if (base % PAGE_SIZE != 0) {
+    return ERROR_ARGS;
+  }
+
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)input;
+  if (input_size < sizeof(Elf64_Ehdr) ||
+      memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_ident[EI_CLASS] != ELFCLASS64 ||
+      header->e_machine != EM_RISCV || header->e_type != ET_DYN ||
+      !in_range(header->e_phoff, header->e_phnum * sizeof(Elf64_Phdr),
+                input_size)) {
+    return ERROR_INVALID_ELF;
+  }
+
+  ret = layout_segments(header);
+  if (ret != 0) {
+    return ret;
+  }
+  ckb_prelink_header_t out;
+  memset(&out, 0, sizeof(out));
+  memcpy(out.magic, CKB_PRELINK_MAGIC, CKB_PRELINK_MAGIC_SIZE);
+  out.version = CKB_PRELINK_VERSION;
+  out.header_size = CKB_PRELINK_HEADER_SIZE;
+  out.base = base;
+  ret = process_dynamic(header, &out);
+  if (ret != 0) {
+    return ret;
+  }
+  out.code_size = code_size;
+  out.file_size = file_size;
+  out.mem_size = mem_size;
+
+  FILE *fp = fopen(argv[3], "wb");
+  if (!fp) {
+    return ERROR_IO;
+  }
+  uint8_t header_page[CKB_PRELINK_HEADER_SIZE];
+  memset(header_page, 0, CKB_PRELINK_HEADER_SIZE);
+  memcpy(header_page, &out, sizeof(out));
+  fwrite(header_page, CKB_PRELINK_HEADER_SIZE, 1, fp);
+  fwrite(image, file_size, 1, fp);
+  fclose(fp);
+
+  free(image);
+  free(input);
+  return 0;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env bash
+#
+# Replays saved transactions through a baseline build and the current build
+# and reports the cycles of every script group of this repo.
+#
+# Usage: replay.sh <baseline build dir> <current build dir> <dump>...
+#
+# A dump is a transaction saved in the ckb-debugger mock format (tx plus
+# resolved cell deps, inputs and header deps), the way it was sent to the
+# chain. The scripts and libraries it references are the deployed ones, which
+# are taken to be the baseline build: script groups are recognized by a data
+# hash_type code_hash equal to the data hash of a baseline binary.
+#
+# For the current build the group's script is run with --replace-binary, so
+# the transaction hash and the signatures stay valid. Libraries whose data
+# hash changed (the verifier libraries, their prelinked images and the
+# secp256k1 and ed25519 tables) are swapped in place in the cell deps, and
+# their old data hash is rewritten to the new one in the args of the
+# resolved input cells, which is where or branches keep library code hashes.
+# Neither is covered by the transaction hash. Nothing is fetched from the
+# network.
+#
+# CKB_DEBUGGER overrides the ckb-debugger binary, GENERATE_DATA_HASH the data
+# hash tool (build/generate_data_hash of the current build by default).
+
+set -euo pipefail
+
+SCRIPTS="htlc or simple_udt crosschain_lockscript crosschain_typescript crosschain_queue musig_lock ptlc proxy_lock"
+LIBRARIES="secp256k1_blake2b_sighash_all_lib.so"
+LIBRARIES="$LIBRARIES secp256k1_blake2b_sighash_all_lib.img secp256k1_data"
+LIBRARIES="$LIBRARIES secp256k1_blake2b_multisig_all_lib.so"
+LIBRARIES="$LIBRARIES secp256k1_blake2b_multisig_all_lib.img"
+LIBRARIES="$LIBRARIES secp256k1_schnorr_sighash_all_lib.so"
+LIBRARIES="$LIBRARIES secp256k1_schnorr_sighash_all_lib.img"
+LIBRARIES="$LIBRARIES secp256k1_keccak256_sighash_all_lib.so"
+LIBRARIES="$LIBRARIES secp256k1_keccak256_sighash_all_lib.img"
+LIBRARIES="$LIBRARIES ed25519_lib.so ed25519_lib.img ed25519_data"
+LIBRARIES="$LIBRARIES eth_receipt_proof_lib.so eth_receipt_proof_lib.img"
+
+if [ $# -lt 3 ]; then
+  echo "Usage: $0 <baseline build dir> <current build dir> <dump>..." >&2
+  exit 1
+fi
+BASELINE=$1
+CURRENT=$2
+shift 2
+
+CKB_DEBUGGER=${CKB_DEBUGGER:-ckb-debugger}
+GENERATE_DATA_HASH=${GENERATE_DATA_HASH:-$CURRENT/generate_data_hash}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+data_hash() {
+  "$GENERATE_DATA_HASH" "$1" --hex
+}
+
+hex_file() {
+  { printf 0x; od -An -v -tx1 "$1" | tr -d ' \n'; } > "$2"
+}
+
+# code hash -> script name, from the baseline binaries
+: > "$WORK/scripts"
+for script in $SCRIPTS; do
+  if [ -f "$BASELINE/$script" ]; then
+    echo "$(data_hash "$BASELINE/$script") $script" >> "$WORK/scripts"
+  fi
+done
+
+# jq filter moving the dumps from the baseline libraries to the current ones
+FILTER="."
+FILTER_ARGS=()
+n=0
+for library in $LIBRARIES; do
+  if [ ! -f "$BASELINE/$library" ] || [ ! -f "$CURRENT/$library" ]; then
+    continue
+  fi
+  old_hash=$(data_hash "$BASELINE/$library")
+  new_hash=$(data_hash "$CURRENT/$library")
+  if [ "$old_hash" = "$new_hash" ]; then
+    continue
+  fi
+  hex_file "$BASELINE/$library" "$WORK/old$n"
+  hex_file "$CURRENT/$library" "$WORK/new$n"
+  FILTER_ARGS+=(--rawfile "old$n" "$WORK/old$n")
+  FILTER_ARGS+=(--rawfile "new$n" "$WORK/new$n")
+  FILTER="$FILTER | (.mock_info.cell_deps[] | select(.data == \$old$n)"
+  FILTER="$FILTER | .data) |= \$new$n"
+  FILTER="$FILTER | (.mock_info.inputs[].output | .lock, (.type // empty)"
+  FILTER="$FILTER | .args) |= gsub(\"${old_hash#0x}\"; \"${new_hash#0x}\")"
+  n=$((n + 1))
+done
+
+# One line per script group: <group type> <cell type> <index> <code hash>
+# <hash type>, the first cell of the group selects it.
+GROUPS_FILTER='
+  (.mock_info.inputs | to_entries
+    | map({i: .key, s: .value.output.lock}) | group_by(.s) | .[] | .[0]
+    | "lock input \(.i) \(.s.code_hash) \(.s.hash_type)"),
+  (([.mock_info.inputs[].output.type] | to_entries
+      | map(select(.value != null) | {c: "input", i: .key, s: .value}))
+    + ([.tx.outputs[].type] | to_entries
+      | map(select(.value != null) | {c: "output", i: .key, s: .value}))
+    | group_by(.s) | .[] | .[0]
+    | "type \(.c) \(.i) \(.s.code_hash) \(.s.hash_type)")'
+
+# Prints the cycles of one run, or "fail" when the script did not return 0
+run() {
+  local output
+  if ! output=$("$CKB_DEBUGGER" "$@" 2>&1); then
+    echo fail
+    return
+  fi
+  if ! echo "$output" | grep -q 'Run result: Ok(0)'; then
+    echo fail
+    return
+  fi
+  echo "$output" |
+    sed -n 's/.*\(cycles consumed\|All cycles\): *\([0-9][0-9,]*\).*/\2/p' |
+    head -n 1 | tr -d ,
+}
+
+printf "%-24s %-24s %-22s %12s %12s %10s\n" dump group script \
+  baseline current delta
+: > "$WORK/results"
+for dump in "$@"; do
+  name=$(basename "$dump" .json)
+  jq "${FILTER_ARGS[@]}" "$FILTER" "$dump" > "$WORK/current.json"
+  jq -r "$GROUPS_FILTER" "$dump" |
+    while read -r group cell index code_hash hash_type; do
+      script=
+      if [ "$hash_type" = data ]; then
+        script=$(awk -v h="$code_hash" '$1 == h { print $2 }' \
+          "$WORK/scripts")
+      fi
+      if [ -z "$script" ]; then
+        continue
+      fi
+      select_group=(--script-group-type "$group" --cell-type "$cell"
+        --cell-index "$index")
+      before=$(run --tx-file "$dump" "${select_group[@]}")
+      after=$(run --tx-file "$WORK/current.json" "${select_group[@]}" \
+        --replace-binary "$CURRENT/$script")
+      delta=-
+      if [ "$before" != fail ] && [ "$after" != fail ]; then
+        delta=$((after - before))
+        echo "$script $before $after" >> "$WORK/results"
+      else
+        echo "$name $group/$cell/$index" >> "$WORK/failed"
+      fi
+      printf "%-24s %-24s %-22s %12s %12s %10s\n" "$name" \
+        "$group/$cell/$index" "$script" "$before" "$after" "$delta"
+    done
+done
+
+echo
+awk '
+  { base[$1] += $2; cur[$1] += $3; runs[$1]++ }
+  END {
+    printf "%-22s %6s %14s %14s %12s %8s\n", "script", "groups",
+      "baseline", "current", "delta", "%"
+    for (s in base) {
+      printf "%-22s %6d %14d %14d %12d %7.2f%%\n", s, runs[s], base[s],
+        cur[s], cur[s] - base[s], (cur[s] - base[s]) * 100.0 / base[s]
+    }
+  }' "$WORK/results"
+
+if [ -s "$WORK/failed" ]; then
+  echo "failed groups:" >&2
+  cat "$WORK/failed" >&2
+  exit 1
+fi
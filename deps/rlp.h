@@ -0,0 +1,141 @@
+/*
+ * Zero copy decoder of Ethereum's RLP encoding.
+ *
+ * Items are slices of the input, typically a witness, the same way a
+ * mol_seg_t is a slice of a molecule buffer: decoding a whole trie proof
+ * never copies a byte, and skipping an item only reads its prefix. Only
+ * canonical encodings are accepted, as trie nodes are identified by the
+ * hash of their encoding.
+ */
+#ifndef CKB_RLP_H_
+#define CKB_RLP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RLP_STRING_SHORT 0x80
+#define RLP_STRING_LONG 0xb7
+#define RLP_LIST_SHORT 0xc0
+#define RLP_LIST_LONG 0xf7
+/* Longest payload of the short forms */
+#define RLP_SHORT_MAX 55
+
+/* Same layout as mol_seg_t, a slice of the input */
+typedef struct {
+  const uint8_t *ptr;
+  uint32_t size;
+} rlp_seg_t;
+
+typedef struct {
+  /* Payload without the prefix */
+  rlp_seg_t payload;
+  int is_list;
+} rlp_item_t;
+
+/* Length of the long forms, big endian without leading zeros */
+static int rlp_long_length(const rlp_seg_t *in, uint32_t length_size,
+                           uint32_t *length) {
+  if (length_size > sizeof(uint32_t) || in->size < 1 + length_size ||
+      in->ptr[1] == 0) {
+    return -1;
+  }
+  uint32_t n = 0;
+  for (uint32_t i = 1; i <= length_size; i++) {
+    n = (n << 8) | in->ptr[i];
+  }
+  if (n <= RLP_SHORT_MAX) {
+    return -1;
+  }
+  *length = n;
+  return 0;
+}
+
+/* Decodes the item at the start of *in and moves *in past it */
+static int rlp_next(rlp_seg_t *in, rlp_item_t *item) {
+  if (in->size == 0) {
+    return -1;
+  }
+  uint8_t prefix = in->ptr[0];
+  uint32_t header = 1, length = 0;
+  item->is_list = prefix >= RLP_LIST_SHORT;
+  if (prefix < RLP_STRING_SHORT) {
+    /* A single byte below 0x80 is its own encoding */
+    header = 0;
+    length = 1;
+  } else if (prefix <= RLP_STRING_LONG) {
+    length = prefix - RLP_STRING_SHORT;
+    if (length == 1 && (in->size < 2 || in->ptr[1] < RLP_STRING_SHORT)) {
+      return -1;
+    }
+  } else if (prefix < RLP_LIST_SHORT) {
+    header += prefix - RLP_STRING_LONG;
+    if (rlp_long_length(in, prefix - RLP_STRING_LONG, &length) != 0) {
+      return -1;
+    }
+  } else if (prefix <= RLP_LIST_LONG) {
+    length = prefix - RLP_LIST_SHORT;
+  } else {
+    header += prefix - RLP_LIST_LONG;
+    if (rlp_long_length(in, prefix - RLP_LIST_LONG, &length) != 0) {
+      return -1;
+    }
+  }
+  if (length > in->size - header) {
+    return -1;
+  }
+  item->payload.ptr = in->ptr + header;
+  item->payload.size = length;
+  in->ptr += header + length;
+  in->size -= header + length;
+  return 0;
+}
+
+/* Decodes an input holding exactly one item */
+static int rlp_decode(rlp_seg_t in, rlp_item_t *item) {
+  if (rlp_next(&in, item) != 0 || in.size != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Decodes the items of a list, at most max of them. Only the prefixes of
+ * the items are read, nested lists are left to the caller.
+ */
+static int rlp_list_items(const rlp_item_t *list, rlp_item_t *items,
+                          size_t max, size_t *count) {
+  if (!list->is_list) {
+    return -1;
+  }
+  rlp_seg_t in = list->payload;
+  size_t n = 0;
+  while (in.size > 0) {
+    if (n == max || rlp_next(&in, &items[n]) != 0) {
+      return -1;
+    }
+    n++;
+  }
+  *count = n;
+  return 0;
+}
+
+/* A string of size bytes, e.g. a hash or an address */
+static int rlp_is_string(const rlp_item_t *item, uint32_t size) {
+  return !item->is_list && item->payload.size == size;
+}
+
+/* Scalars are big endian without leading zeros, 0 is the empty string */
+static int rlp_uint64(const rlp_item_t *item, uint64_t *value) {
+  if (item->is_list || item->payload.size > sizeof(uint64_t) ||
+      (item->payload.size > 0 && item->payload.ptr[0] == 0)) {
+    return -1;
+  }
+  uint64_t n = 0;
+  for (uint32_t i = 0; i < item->payload.size; i++) {
+    n = (n << 8) | item->payload.ptr[i];
+  }
+  *value = n;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * Variable time modular inversion for the secp256k1 field and group
+ * order, with the safegcd algorithm of Bernstein and Yang in the variant
+ * of libsecp256k1's modinv64: 62 division steps per batch on signed 62
+ * bit limbs, skipping runs of zero bits of g at once.
+ *
+ * The running time depends on the input, so this is only for public data,
+ * which is all a verifier ever inverts.
+ */
+#ifndef CKB_SAFEGCD_VAR_H_
+#define CKB_SAFEGCD_VAR_H_
+
+#include <stdint.h>
+
+#define CKB_SAFEGCD_M62 ((uint64_t)UINT64_MAX >> 2)
+
+typedef __int128 ckb_int128_t;
+
+/* Value sum v[i] 2^(62 i), limbs below 2^62 except for the top one */
+typedef struct {
+  int64_t v[5];
+} ckb_safegcd_signed62_t;
+
+typedef struct {
+  ckb_safegcd_signed62_t modulus;
+  /* modulus^-1 mod 2^62 */
+  uint64_t modulus_inv62;
+} ckb_safegcd_modinfo_t;
+
+/* Transition matrix of 62 division steps, scaled by 2^62 */
+typedef struct {
+  int64_t u, v, q, r;
+} ckb_safegcd_trans2x2_t;
+
+static const ckb_safegcd_modinfo_t ckb_safegcd_modinfo_fe = {
+    {{-0x1000003D1LL, 0, 0, 0, 256}}, 0x27C7F6E22DDACACFULL};
+
+static const ckb_safegcd_modinfo_t ckb_safegcd_modinfo_scalar = {
+    {{0x3FD25E8CD0364141LL, 0x2ABB739ABD2280EELL, -0x15LL, 0, 256}},
+    0x34F20099AA774EC1ULL};
+
+/* RV64 has no count trailing zeros instruction without Zbb */
+static int ckb_safegcd_ctz64_var(uint64_t x) {
+  static const uint8_t debruijn[64] = {
+      0,  1,  2,  53, 3,  7,  54, 27, 4,  38, 41, 8,  34, 55, 48, 28,
+      62, 5,  39, 46, 44, 42, 22, 9,  24, 35, 59, 56, 49, 18, 29, 11,
+      63, 52, 6,  26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+      51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12};
+  return debruijn[((x & -x) * 0x022FDD63CC95386DULL) >> 58];
+}
+
+/*
+ * 62 division steps on the low bits f0 and g0 of f and g, eta is minus
+ * delta. Zero bits of g are shifted out in one go, and when g gets a new
+ * f up to 6 bits of it are cancelled per step instead of 1.
+ */
+static int64_t ckb_safegcd_divsteps_62_var(int64_t eta, uint64_t f0,
+                                           uint64_t g0,
+                                           ckb_safegcd_trans2x2_t *t) {
+  uint64_t u = 1, v = 0, q = 0, r = 1;
+  uint64_t f = f0, g = g0, m;
+  uint32_t w;
+  int i = 62, limit, zeros;
+
+  for (;;) {
+    zeros = ckb_safegcd_ctz64_var(g | (UINT64_MAX << i));
+    g >>= zeros;
+    u <<= zeros;
+    v <<= zeros;
+    eta -= zeros;
+    i -= zeros;
+    if (i == 0) {
+      break;
+    }
+    if (eta < 0) {
+      uint64_t tmp;
+      eta = -eta;
+      tmp = f;
+      f = g;
+      g = -tmp;
+      tmp = u;
+      u = q;
+      q = -tmp;
+      tmp = v;
+      v = r;
+      r = -tmp;
+      limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+      m = (UINT64_MAX >> (64 - limit)) & 63U;
+      w = (f * g * (f * f - 2)) & m;
+    } else {
+      limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+      m = (UINT64_MAX >> (64 - limit)) & 15U;
+      w = f + (((f + 1) & 4) << 1);
+      w = (-w * g) & m;
+    }
+    g += f * w;
+    q += u * w;
+    r += v * w;
+  }
+  t->u = (int64_t)u;
+  t->v = (int64_t)v;
+  t->q = (int64_t)q;
+  t->r = (int64_t)r;
+  return eta;
+}
+
+/* [d, e] = t [d, e] / 2^62 mod modulus, keeping both in (-2 modulus, modulus) */
+static void ckb_safegcd_update_de_62(ckb_safegcd_signed62_t *d,
+                                     ckb_safegcd_signed62_t *e,
+                                     const ckb_safegcd_trans2x2_t *t,
+                                     const ckb_safegcd_modinfo_t *modinfo) {
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  const int64_t sd = d->v[4] >> 63, se = e->v[4] >> 63;
+  /* Add the modulus for negative inputs, plus what clears the low bits */
+  int64_t md = (u & sd) + (v & se);
+  int64_t me = (q & sd) + (r & se);
+  ckb_int128_t cd = (ckb_int128_t)u * d->v[0] + (ckb_int128_t)v * e->v[0];
+  ckb_int128_t ce = (ckb_int128_t)q * d->v[0] + (ckb_int128_t)r * e->v[0];
+  md -= (modinfo->modulus_inv62 * (uint64_t)cd + md) & CKB_SAFEGCD_M62;
+  me -= (modinfo->modulus_inv62 * (uint64_t)ce + me) & CKB_SAFEGCD_M62;
+  cd += (ckb_int128_t)modinfo->modulus.v[0] * md;
+  ce += (ckb_int128_t)modinfo->modulus.v[0] * me;
+  cd >>= 62;
+  ce >>= 62;
+  for (int i = 1; i < 5; i++) {
+    cd += (ckb_int128_t)u * d->v[i] + (ckb_int128_t)v * e->v[i];
+    ce += (ckb_int128_t)q * d->v[i] + (ckb_int128_t)r * e->v[i];
+    /* Most limbs of the field size are 0 */
+    if (modinfo->modulus.v[i] != 0) {
+      cd += (ckb_int128_t)modinfo->modulus.v[i] * md;
+      ce += (ckb_int128_t)modinfo->modulus.v[i] * me;
+    }
+    d->v[i - 1] = (int64_t)cd & CKB_SAFEGCD_M62;
+    e->v[i - 1] = (int64_t)ce & CKB_SAFEGCD_M62;
+    cd >>= 62;
+    ce >>= 62;
+  }
+  d->v[4] = (int64_t)cd;
+  e->v[4] = (int64_t)ce;
+}
+
+/* [f, g] = t [f, g] / 2^62 on the len limbs still in use */
+static void ckb_safegcd_update_fg_62_var(int len, ckb_safegcd_signed62_t *f,
+                                         ckb_safegcd_signed62_t *g,
+                                         const ckb_safegcd_trans2x2_t *t) {
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  ckb_int128_t cf = (ckb_int128_t)u * f->v[0] + (ckb_int128_t)v * g->v[0];
+  ckb_int128_t cg = (ckb_int128_t)q * f->v[0] + (ckb_int128_t)r * g->v[0];
+  cf >>= 62;
+  cg >>= 62;
+  for (int i = 1; i < len; i++) {
+    cf += (ckb_int128_t)u * f->v[i] + (ckb_int128_t)v * g->v[i];
+    cg += (ckb_int128_t)q * f->v[i] + (ckb_int128_t)r * g->v[i];
+    f->v[i - 1] = (int64_t)cf & CKB_SAFEGCD_M62;
+    g->v[i - 1] = (int64_t)cg & CKB_SAFEGCD_M62;
+    cf >>= 62;
+    cg >>= 62;
+  }
+  f->v[len - 1] = (int64_t)cf;
+  g->v[len - 1] = (int64_t)cg;
+}
+
+/* Brings r from (-2 modulus, modulus) to [0, modulus), negated if sign < 0 */
+static void ckb_safegcd_normalize_62(ckb_safegcd_signed62_t *r, int64_t sign,
+                                     const ckb_safegcd_modinfo_t *modinfo) {
+  int64_t cond_add = r->v[4] >> 63;
+  int64_t cond_negate = sign >> 63;
+  for (int i = 0; i < 5; i++) {
+    r->v[i] += modinfo->modulus.v[i] & cond_add;
+    r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+  }
+  for (int i = 0; i < 4; i++) {
+    r->v[i + 1] += r->v[i] >> 62;
+    r->v[i] &= CKB_SAFEGCD_M62;
+  }
+  cond_add = r->v[4] >> 63;
+  for (int i = 0; i < 5; i++) {
+    r->v[i] += modinfo->modulus.v[i] & cond_add;
+  }
+  for (int i = 0; i < 4; i++) {
+    r->v[i + 1] += r->v[i] >> 62;
+    r->v[i] &= CKB_SAFEGCD_M62;
+  }
+}
+
+/* x = x^-1 mod modulus for x in [0, modulus), 0 stays 0 */
+static void ckb_safegcd_modinv_var(ckb_safegcd_signed62_t *x,
+                                   const ckb_safegcd_modinfo_t *modinfo) {
+  ckb_safegcd_signed62_t d = {{0, 0, 0, 0, 0}};
+  ckb_safegcd_signed62_t e = {{1, 0, 0, 0, 0}};
+  ckb_safegcd_signed62_t f = modinfo->modulus;
+  ckb_safegcd_signed62_t g = *x;
+  int len = 5;
+  int64_t eta = -1;
+
+  for (;;) {
+    ckb_safegcd_trans2x2_t t;
+    eta = ckb_safegcd_divsteps_62_var(eta, f.v[0], g.v[0], &t);
+    ckb_safegcd_update_de_62(&d, &e, &t, modinfo);
+    ckb_safegcd_update_fg_62_var(len, &f, &g, &t);
+    if (g.v[0] == 0) {
+      int64_t cond = 0;
+      for (int j = 1; j < len; j++) {
+        cond |= g.v[j];
+      }
+      if (cond == 0) {
+        break;
+      }
+    }
+    /* Drop the top limbs of f and g once both fit one limb less */
+    int64_t fn = f.v[len - 1], gn = g.v[len - 1];
+    int64_t cond = ((int64_t)len - 2) >> 63;
+    cond |= fn ^ (fn >> 63);
+    cond |= gn ^ (gn >> 63);
+    if (cond == 0) {
+      f.v[len - 2] |= (uint64_t)fn << 62;
+      g.v[len - 2] |= (uint64_t)gn << 62;
+      len--;
+    }
+  }
+  /* f is now the gcd, plus or minus 1 */
+  ckb_safegcd_normalize_62(&d, f.v[len - 1], modinfo);
+  *x = d;
+}
+
+/* Conversions from and to 32 byte big endian, as secp256k1 serializes */
+static void ckb_safegcd_from_b32(ckb_safegcd_signed62_t *r,
+                                 const uint8_t *b32) {
+  uint64_t a[4];
+  for (int i = 0; i < 4; i++) {
+    uint64_t limb = 0;
+    for (int j = 0; j < 8; j++) {
+      limb = (limb << 8) | b32[(3 - i) * 8 + j];
+    }
+    a[i] = limb;
+  }
+  r->v[0] = a[0] & CKB_SAFEGCD_M62;
+  r->v[1] = (a[0] >> 62 | a[1] << 2) & CKB_SAFEGCD_M62;
+  r->v[2] = (a[1] >> 60 | a[2] << 4) & CKB_SAFEGCD_M62;
+  r->v[3] = (a[2] >> 58 | a[3] << 6) & CKB_SAFEGCD_M62;
+  r->v[4] = a[3] >> 56;
+}
+
+static void ckb_safegcd_to_b32(uint8_t *b32, const ckb_safegcd_signed62_t *a) {
+  uint64_t r[4];
+  r[0] = (uint64_t)a->v[0] | (uint64_t)a->v[1] << 62;
+  r[1] = (uint64_t)a->v[1] >> 2 | (uint64_t)a->v[2] << 60;
+  r[2] = (uint64_t)a->v[2] >> 4 | (uint64_t)a->v[3] << 58;
+  r[3] = (uint64_t)a->v[3] >> 6 | (uint64_t)a->v[4] << 56;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) {
+      b32[(3 - i) * 8 + j] = (uint8_t)(r[i] >> (56 - 8 * j));
+    }
+  }
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "ckb_syscalls.h"
 #include "secp256k1_data_info.h"
+#include "tx_context.h"
 
 #define CKB_SECP256K1_HELPER_ERROR_LOADING_DATA -101
 #define CKB_SECP256K1_HELPER_ERROR_ILLEGAL_CALLBACK -102
@@ -15,6 +16,50 @@
  */
 #define HAVE_CONFIG_H 1
 #define USE_EXTERNAL_DEFAULT_CALLBACKS
+
+/*
+ * Without GMP, the variable time inverses of secp256k1 fall back to the
+ * constant time exponentiation. Verification only ever inverts public
+ * data, so the field and scalar code is pulled in first, and every later
+ * use of the _var inverses, in recovery, ECDSA and Schnorr verification
+ * and point normalization, is pointed at the safegcd ones of
+ * safegcd_var.h. Define CKB_SECP256K1_CONST_TIME_INVERSE to keep the
+ * library's own.
+ */
+#ifndef CKB_SECP256K1_CONST_TIME_INVERSE
+#include "include/secp256k1.h"
+#include "util.h"
+#include "field_impl.h"
+#include "scalar_impl.h"
+#include "safegcd_var.h"
+
+static void ckb_secp256k1_fe_inv_var(secp256k1_fe* r, const secp256k1_fe* a) {
+  secp256k1_fe t = *a;
+  uint8_t b32[32];
+  ckb_safegcd_signed62_t s;
+  secp256k1_fe_normalize_var(&t);
+  secp256k1_fe_get_b32(b32, &t);
+  ckb_safegcd_from_b32(&s, b32);
+  ckb_safegcd_modinv_var(&s, &ckb_safegcd_modinfo_fe);
+  ckb_safegcd_to_b32(b32, &s);
+  secp256k1_fe_set_b32(r, b32);
+}
+
+static void ckb_secp256k1_scalar_inverse_var(secp256k1_scalar* r,
+                                             const secp256k1_scalar* x) {
+  uint8_t b32[32];
+  ckb_safegcd_signed62_t s;
+  secp256k1_scalar_get_b32(b32, x);
+  ckb_safegcd_from_b32(&s, b32);
+  ckb_safegcd_modinv_var(&s, &ckb_safegcd_modinfo_scalar);
+  ckb_safegcd_to_b32(b32, &s);
+  secp256k1_scalar_set_b32(r, b32, NULL);
+}
+
+#define secp256k1_fe_inv_var ckb_secp256k1_fe_inv_var
+#define secp256k1_scalar_inverse_var ckb_secp256k1_scalar_inverse_var
+#endif
+
 #include <secp256k1.c>
 
 void secp256k1_default_illegal_callback_fn(const char* str, void* data) {
@@ -29,6 +74,23 @@ void secp256k1_default_error_callback_fn(const char* str, void* data) {
   ckb_exit(CKB_SECP256K1_HELPER_ERROR_ERROR_CALLBACK);
 }
 
+static void ckb_secp256k1_setup_verify_only_context(secp256k1_context* context,
+                                                    void* data) {
+  context->illegal_callback = default_illegal_callback;
+  context->error_callback = default_error_callback;
+
+  secp256k1_ecmult_context_init(&context->ecmult_ctx);
+  secp256k1_ecmult_gen_context_init(&context->ecmult_gen_ctx);
+
+  /* Recasting data to (uint8_t*) for pointer math */
+  uint8_t* p = data;
+  secp256k1_ge_storage(*pre_g)[] = (secp256k1_ge_storage(*)[])p;
+  secp256k1_ge_storage(*pre_g_128)[] =
+      (secp256k1_ge_storage(*)[])(&p[CKB_SECP256K1_DATA_PRE_SIZE]);
+  context->ecmult_ctx.pre_g = pre_g;
+  context->ecmult_ctx.pre_g_128 = pre_g_128;
+}
+
 /*
  * data should at least be CKB_SECP256K1_DATA_SIZE big
  * so as to hold all loaded data.
@@ -47,20 +109,40 @@ int ckb_secp256k1_custom_verify_only_initialize(secp256k1_context* context,
     return CKB_SECP256K1_HELPER_ERROR_LOADING_DATA;
   }
 
-  context->illegal_callback = default_illegal_callback;
-  context->error_callback = default_error_callback;
-
-  secp256k1_ecmult_context_init(&context->ecmult_ctx);
-  secp256k1_ecmult_gen_context_init(&context->ecmult_gen_ctx);
+  ckb_secp256k1_setup_verify_only_context(context, data);
+  return 0;
+}
 
-  /* Recasting data to (uint8_t*) for pointer math */
-  uint8_t* p = data;
-  secp256k1_ge_storage(*pre_g)[] = (secp256k1_ge_storage(*)[])p;
-  secp256k1_ge_storage(*pre_g_128)[] =
-      (secp256k1_ge_storage(*)[])(&p[CKB_SECP256K1_DATA_PRE_SIZE]);
-  context->ecmult_ctx.pre_g = pre_g;
-  context->ecmult_ctx.pre_g_128 = pre_g_128;
+/*
+ * Same as above, but reuses the tables kept in the transaction context when
+ * the caller provided storage for them. data is only used as a fallback and
+ * may be NULL when the context storage is known to be large enough.
+ */
+int ckb_secp256k1_custom_verify_only_initialize_with_context(
+    secp256k1_context* context, ckb_tx_context_t* tx_ctx, void* data) {
+  if (tx_ctx->secp_data == NULL ||
+      tx_ctx->secp_data_size < CKB_SECP256K1_DATA_SIZE) {
+    if (data == NULL) {
+      return CKB_SECP256K1_HELPER_ERROR_LOADING_DATA;
+    }
+    return ckb_secp256k1_custom_verify_only_initialize(context, data);
+  }
+  if (!ckb_tx_context_has(tx_ctx, CKB_TX_CONTEXT_HAS_SECP_DATA)) {
+    size_t index = SIZE_MAX;
+    int ret = ckb_tx_context_find_dep(tx_ctx, ckb_secp256k1_data_hash, &index);
+    if (ret != CKB_SUCCESS) {
+      return ret;
+    }
+    uint64_t len = CKB_SECP256K1_DATA_SIZE;
+    ret = ckb_load_cell_data(tx_ctx->secp_data, &len, 0, index,
+                             CKB_SOURCE_CELL_DEP);
+    if (ret != CKB_SUCCESS || len != CKB_SECP256K1_DATA_SIZE) {
+      return CKB_SECP256K1_HELPER_ERROR_LOADING_DATA;
+    }
+    tx_ctx->computed |= CKB_TX_CONTEXT_HAS_SECP_DATA;
+  }
 
+  ckb_secp256k1_setup_verify_only_context(context, tx_ctx->secp_data);
   return 0;
 }
 
@@ -0,0 +1,446 @@
+/*
+ * Worst case stack depth of a script or library, from the call graph of its
+ * RISC-V object file and the frame sizes gcc writes with -fstack-usage.
+ *
+ * The object must be compiled with -ffunction-sections, the stack usage
+ * file is expected next to it with the .su extension. Calls are found
+ * through R_RISCV_CALL, R_RISCV_CALL_PLT and R_RISCV_JAL relocations, tail
+ * calls included. A jalr or jr not belonging to such a call is an indirect
+ * call, e.g. into a dynamically loaded library; it is charged the indirect
+ * call stack given on the command line.
+ *
+ * The report goes to stderr, the worst case over all entries in bytes to
+ * stdout so the build can feed it to memory_report.
+ */
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAME_SIZE 256
+#define MAX_LINE_SIZE 1024
+
+#define ERROR_ARGS 1
+#define ERROR_IO -1
+#define ERROR_INVALID_ELF -2
+#define ERROR_RECURSION -6
+#define ERROR_DYNAMIC_FRAME -7
+#define ERROR_ENTRY -8
+
+#ifndef R_RISCV_JAL
+#define R_RISCV_JAL 17
+#endif
+#ifndef R_RISCV_CALL
+#define R_RISCV_CALL 18
+#endif
+#ifndef R_RISCV_CALL_PLT
+#define R_RISCV_CALL_PLT 19
+#endif
+
+#define RISCV_REG_RA 1
+
+typedef struct {
+  const char *name;
+  uint16_t shndx;
+  uint64_t start;
+  uint64_t end;
+  uint64_t frame;
+  int has_frame;
+  int dynamic_frame;
+  int indirect;
+  size_t *callees;
+  size_t callee_count;
+
+  /* Search state */
+  int visiting;
+  int done;
+  uint64_t worst;
+  size_t worst_callee;
+} function_t;
+
+static uint8_t *input;
+static size_t input_size;
+static const Elf64_Shdr *shs;
+static uint16_t shnum;
+static const Elf64_Sym *syms;
+static size_t sym_count;
+static const char *strtab;
+static uint64_t strtab_size;
+
+static function_t *functions;
+static size_t function_count;
+static uint64_t indirect_stack;
+
+static int in_range(uint64_t offset, uint64_t size, uint64_t limit) {
+  return offset <= limit && size <= limit - offset;
+}
+
+static int load_input(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return ERROR_IO;
+  }
+  fseek(f, 0, SEEK_END);
+  input_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  input = malloc(input_size);
+  if (fread(input, input_size, 1, f) != 1) {
+    fclose(f);
+    return ERROR_IO;
+  }
+  fclose(f);
+  return 0;
+}
+
+static const char *symbol_name(const Elf64_Sym *sym) {
+  return sym->st_name < strtab_size ? strtab + sym->st_name : "";
+}
+
+/* gcc clones like foo.constprop.0 are reported under their source name */
+static int same_source_name(const char *symbol, const char *name) {
+  size_t len = strlen(name);
+  return strncmp(symbol, name, len) == 0 &&
+         (symbol[len] == '\0' || symbol[len] == '.');
+}
+
+static function_t *find_function(const char *name) {
+  for (size_t i = 0; i < function_count; i++) {
+    if (strcmp(functions[i].name, name) == 0) {
+      return &functions[i];
+    }
+  }
+  return NULL;
+}
+
+static function_t *function_at(uint16_t shndx, uint64_t offset) {
+  for (size_t i = 0; i < function_count; i++) {
+    if (functions[i].shndx == shndx && offset >= functions[i].start &&
+        offset < functions[i].end) {
+      return &functions[i];
+    }
+  }
+  return NULL;
+}
+
+/* Functions defined in the object, plus the external functions it calls */
+static size_t add_function(const char *name, uint16_t shndx, uint64_t start,
+                           uint64_t end) {
+  function_t *f = find_function(name);
+  if (f != NULL) {
+    return f - functions;
+  }
+  functions = realloc(functions, (function_count + 1) * sizeof(function_t));
+  f = &functions[function_count];
+  memset(f, 0, sizeof(function_t));
+  f->name = name;
+  f->shndx = shndx;
+  f->start = start;
+  f->end = end;
+  return function_count++;
+}
+
+static void add_callee(function_t *f, size_t callee) {
+  for (size_t i = 0; i < f->callee_count; i++) {
+    if (f->callees[i] == callee) {
+      return;
+    }
+  }
+  f->callees = realloc(f->callees, (f->callee_count + 1) * sizeof(size_t));
+  f->callees[f->callee_count++] = callee;
+}
+
+static int load_symbols(const Elf64_Ehdr *header) {
+  if (header->e_shentsize != sizeof(Elf64_Shdr) ||
+      !in_range(header->e_shoff, header->e_shnum * sizeof(Elf64_Shdr),
+                input_size)) {
+    return ERROR_INVALID_ELF;
+  }
+  shs = (const Elf64_Shdr *)(input + header->e_shoff);
+  shnum = header->e_shnum;
+  for (uint16_t i = 0; i < shnum; i++) {
+    if (shs[i].sh_type != SHT_NOBITS &&
+        !in_range(shs[i].sh_offset, shs[i].sh_size, input_size)) {
+      return ERROR_INVALID_ELF;
+    }
+    if (shs[i].sh_type == SHT_SYMTAB) {
+      if (shs[i].sh_link >= shnum) {
+        return ERROR_INVALID_ELF;
+      }
+      syms = (const Elf64_Sym *)(input + shs[i].sh_offset);
+      sym_count = shs[i].sh_size / sizeof(Elf64_Sym);
+      strtab = (const char *)(input + shs[shs[i].sh_link].sh_offset);
+      strtab_size = shs[shs[i].sh_link].sh_size;
+    }
+  }
+  if (syms == NULL) {
+    return ERROR_INVALID_ELF;
+  }
+  for (size_t i = 0; i < sym_count; i++) {
+    if (ELF64_ST_TYPE(syms[i].st_info) == STT_FUNC &&
+        syms[i].st_shndx != SHN_UNDEF && syms[i].st_shndx < shnum) {
+      add_function(symbol_name(&syms[i]), syms[i].st_shndx, syms[i].st_value,
+                   syms[i].st_value + syms[i].st_size);
+    }
+  }
+  return 0;
+}
+
+/* Lines look like "c/htlc.c:120:5:main\t33024\tstatic" */
+static int load_stack_usage(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return ERROR_IO;
+  }
+  char line[MAX_LINE_SIZE];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char *bytes = strchr(line, '\t');
+    if (bytes == NULL) {
+      continue;
+    }
+    *bytes++ = '\0';
+    char *name = strrchr(line, ':');
+    name = name != NULL ? name + 1 : line;
+    char *qualifier = strchr(bytes, '\t');
+    uint64_t frame = strtoull(bytes, NULL, 10);
+    int dynamic = qualifier != NULL && strstr(qualifier, "dynamic") != NULL &&
+                  strstr(qualifier, "bounded") == NULL;
+    for (size_t i = 0; i < function_count; i++) {
+      function_t *fn = &functions[i];
+      if (fn->shndx != SHN_UNDEF && same_source_name(fn->name, name)) {
+        if (!fn->has_frame || frame > fn->frame) {
+          fn->frame = frame;
+        }
+        fn->has_frame = 1;
+        fn->dynamic_frame |= dynamic;
+      }
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int is_call_relocation(uint32_t type) {
+  return type == R_RISCV_CALL || type == R_RISCV_CALL_PLT ||
+         type == R_RISCV_JAL;
+}
+
+static int has_call_at(const Elf64_Shdr *rela_section, uint64_t offset) {
+  const Elf64_Rela *relas =
+      (const Elf64_Rela *)(input + rela_section->sh_offset);
+  size_t count = rela_section->sh_size / sizeof(Elf64_Rela);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t type = ELF64_R_TYPE(relas[i].r_info);
+    if (relas[i].r_offset == offset &&
+        (type == R_RISCV_CALL || type == R_RISCV_CALL_PLT)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void load_calls(const Elf64_Shdr *rela_section) {
+  uint16_t target = rela_section->sh_info;
+  const Elf64_Rela *relas =
+      (const Elf64_Rela *)(input + rela_section->sh_offset);
+  size_t count = rela_section->sh_size / sizeof(Elf64_Rela);
+  for (size_t i = 0; i < count; i++) {
+    if (!is_call_relocation(ELF64_R_TYPE(relas[i].r_info)) ||
+        ELF64_R_SYM(relas[i].r_info) >= sym_count) {
+      continue;
+    }
+    function_t *caller = function_at(target, relas[i].r_offset);
+    const Elf64_Sym *sym = &syms[ELF64_R_SYM(relas[i].r_info)];
+    if (caller == NULL) {
+      continue;
+    }
+    size_t callee;
+    if (sym->st_shndx == SHN_UNDEF) {
+      callee = add_function(symbol_name(sym), SHN_UNDEF, 0, 0);
+    } else {
+      /* Local labels resolve to a section symbol plus addend */
+      uint64_t offset = sym->st_value;
+      if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION) {
+        offset += relas[i].r_addend;
+      }
+      function_t *f = function_at(sym->st_shndx, offset);
+      if (f == NULL || (f == caller && offset != f->start)) {
+        continue;
+      }
+      callee = f - functions;
+    }
+    /* The array may have moved while adding an external function */
+    add_callee(function_at(target, relas[i].r_offset), callee);
+  }
+}
+
+static const Elf64_Shdr *relocations_of(uint16_t shndx) {
+  for (uint16_t i = 0; i < shnum; i++) {
+    if (shs[i].sh_type == SHT_RELA && shs[i].sh_info == shndx) {
+      return &shs[i];
+    }
+  }
+  return NULL;
+}
+
+/* Any jalr or jr that is not the second half of an auipc based call */
+static void load_indirect_calls(function_t *f) {
+  const Elf64_Shdr *section = &shs[f->shndx];
+  if (section->sh_type == SHT_NOBITS ||
+      !in_range(f->start, f->end - f->start, section->sh_size)) {
+    return;
+  }
+  const Elf64_Shdr *rela_section = relocations_of(f->shndx);
+  const uint8_t *code = input + section->sh_offset;
+  uint64_t pc = f->start;
+  while (pc + 2 <= f->end) {
+    uint32_t ins = code[pc] | (code[pc + 1] << 8);
+    if ((ins & 3) != 3) {
+      uint32_t rs1 = (ins >> 7) & 0x1f;
+      /* c.jalr, or c.jr other than ret */
+      if (((ins & 0xf07f) == 0x9002 && rs1 != 0) ||
+          ((ins & 0xf07f) == 0x8002 && rs1 != 0 && rs1 != RISCV_REG_RA)) {
+        f->indirect = 1;
+      }
+      pc += 2;
+      continue;
+    }
+    if (pc + 4 > f->end) {
+      break;
+    }
+    ins |= (code[pc + 2] << 16) | ((uint32_t)code[pc + 3] << 24);
+    uint32_t rd = (ins >> 7) & 0x1f;
+    uint32_t rs1 = (ins >> 15) & 0x1f;
+    if ((ins & 0x7f) == 0x67 && (rd != 0 || rs1 != RISCV_REG_RA) &&
+        (pc < 4 || rela_section == NULL ||
+         !has_call_at(rela_section, pc - 4))) {
+      f->indirect = 1;
+    }
+    pc += 4;
+  }
+}
+
+static void load_call_graph() {
+  for (uint16_t i = 0; i < shnum; i++) {
+    if (shs[i].sh_type == SHT_RELA && shs[i].sh_info < shnum &&
+        (shs[shs[i].sh_info].sh_flags & SHF_EXECINSTR) != 0) {
+      load_calls(&shs[i]);
+    }
+  }
+  for (size_t i = 0; i < function_count; i++) {
+    if (functions[i].shndx != SHN_UNDEF) {
+      load_indirect_calls(&functions[i]);
+    }
+  }
+}
+
+static int worst_case(size_t index, uint64_t *result) {
+  function_t *f = &functions[index];
+  if (f->done) {
+    *result = f->worst;
+    return 0;
+  }
+  if (f->visiting) {
+    fprintf(stderr, "  recursion through %s, stack is unbounded\n", f->name);
+    return ERROR_RECURSION;
+  }
+  if (f->dynamic_frame) {
+    fprintf(stderr, "  %s has an unbounded dynamic frame\n", f->name);
+    return ERROR_DYNAMIC_FRAME;
+  }
+  if (!f->has_frame) {
+    fprintf(stderr, "  warning: no frame size for %s, assuming 0\n", f->name);
+  }
+  f->visiting = 1;
+  uint64_t deepest = f->indirect ? indirect_stack : 0;
+  f->worst_callee = SIZE_MAX;
+  for (size_t i = 0; i < f->callee_count; i++) {
+    uint64_t callee_worst = 0;
+    int ret = worst_case(f->callees[i], &callee_worst);
+    if (ret != 0) {
+      fprintf(stderr, "    called from %s\n", f->name);
+      return ret;
+    }
+    if (callee_worst > deepest) {
+      deepest = callee_worst;
+      f->worst_callee = f->callees[i];
+    }
+  }
+  f->visiting = 0;
+  f->done = 1;
+  f->worst = f->frame + deepest;
+  *result = f->worst;
+  return 0;
+}
+
+static void print_path(size_t index) {
+  while (index != SIZE_MAX) {
+    function_t *f = &functions[index];
+    fprintf(stderr, "    %-48s %8lu\n", f->name, (unsigned long)f->frame);
+    if (f->worst_callee == SIZE_MAX && f->indirect &&
+        f->worst > f->frame) {
+      fprintf(stderr, "    %-48s %8lu\n", "(indirect call)",
+              (unsigned long)indirect_stack);
+    }
+    index = f->worst_callee;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    printf("Usage: %s <object> <indirect call stack> <entry>...\n", argv[0]);
+    return ERROR_ARGS;
+  }
+  int ret = load_input(argv[1]);
+  if (ret != 0) {
+    return ret;
+  }
+  indirect_stack = strtoull(argv[2], NULL, 0);
+
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)input;
+  if (input_size < sizeof(Elf64_Ehdr) ||
+      memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_ident[EI_CLASS] != ELFCLASS64 || header->e_type != ET_REL ||
+      header->e_machine != EM_RISCV) {
+    return ERROR_INVALID_ELF;
+  }
+  ret = load_symbols(header);
+  if (ret != 0) {
+    return ret;
+  }
+  load_call_graph();
+
+  char su_path[MAX_NAME_SIZE];
+  size_t len = strlen(argv[1]);
+  if (len < 2 || len + 2 > sizeof(su_path) ||
+      strcmp(argv[1] + len - 2, ".o") != 0) {
+    return ERROR_ARGS;
+  }
+  memcpy(su_path, argv[1], len - 2);
+  strcpy(su_path + len - 2, ".su");
+  ret = load_stack_usage(su_path);
+  if (ret != 0) {
+    return ret;
+  }
+
+  uint64_t worst = 0;
+  fprintf(stderr, "%s\n", argv[1]);
+  for (int i = 3; i < argc; i++) {
+    function_t *entry = find_function(argv[i]);
+    if (entry == NULL || entry->shndx == SHN_UNDEF) {
+      fprintf(stderr, "  entry %s not found\n", argv[i]);
+      return ERROR_ENTRY;
+    }
+    uint64_t entry_worst = 0;
+    ret = worst_case(entry - functions, &entry_worst);
+    if (ret != 0) {
+      return ret;
+    }
+    fprintf(stderr, "  %s: %lu bytes\n", argv[i], (unsigned long)entry_worst);
+    print_path(entry - functions);
+    if (entry_worst > worst) {
+      worst = entry_worst;
+    }
+  }
+  printf("%lu\n", (unsigned long)worst);
+  return 0;
+}
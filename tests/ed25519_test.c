@@ -0,0 +1,179 @@
+/*
+ * deps/ed25519.h against the RFC 8032 test vectors, the ZIP 215 edge
+ * cases it accepts on purpose, and batches with a corrupted member. The
+ * base point table is built on the host, as deps/dump_ed25519_data.c does.
+ */
+#include "ed25519.h"
+
+#include "test.h"
+
+#define BATCH_COUNT 3
+#define MAX_MESSAGE_SIZE 2
+
+typedef struct {
+  uint8_t pubkey[ED25519_PUBKEY_SIZE];
+  uint8_t message[MAX_MESSAGE_SIZE];
+  size_t message_len;
+  uint8_t signature[ED25519_SIGNATURE_SIZE];
+} vector_t;
+
+/* Tests 1 to 3 of RFC 8032, section 7.1 */
+static const char *RFC8032[BATCH_COUNT][3] = {
+    {"d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+     "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+    {"3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+     "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+     "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+    {"fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+     "af82",
+     "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+     "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"},
+};
+
+/* Encodings of small order points, y little endian with the sign of x */
+#define IDENTITY \
+  "0100000000000000000000000000000000000000000000000000000000000000"
+#define IDENTITY_NEGATIVE_ZERO \
+  "0100000000000000000000000000000000000000000000000000000000000080"
+#define IDENTITY_Y_ABOVE_P \
+  "eeffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f"
+#define ORDER_2 \
+  "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f"
+#define ORDER_4 \
+  "0000000000000000000000000000000000000000000000000000000000000000"
+#define ZERO_SCALAR \
+  "0000000000000000000000000000000000000000000000000000000000000000"
+/* The group order l, the smallest S that is not canonical */
+#define GROUP_ORDER \
+  "edd3f55c1a631258d69cf7a2def9de1400000000000000000000000000000010"
+/* y = 2 has no x on the curve */
+#define NOT_ON_CURVE \
+  "0200000000000000000000000000000000000000000000000000000000000000"
+
+static ed25519_base_table_t table;
+static ed25519_prepared_t prepared[BATCH_COUNT];
+static ed25519_msm_point_t scratch[2 * BATCH_COUNT];
+static vector_t vectors[BATCH_COUNT];
+
+static size_t from_hex(const char *hex, uint8_t *out) {
+  size_t size = strlen(hex) / 2;
+  for (size_t i = 0; i < size; i++) {
+    unsigned int byte;
+    sscanf(&hex[2 * i], "%2x", &byte);
+    out[i] = (uint8_t)byte;
+  }
+  return size;
+}
+
+static void set_vectors() {
+  for (size_t i = 0; i < BATCH_COUNT; i++) {
+    from_hex(RFC8032[i][0], vectors[i].pubkey);
+    vectors[i].message_len = from_hex(RFC8032[i][1], vectors[i].message);
+    from_hex(RFC8032[i][2], vectors[i].signature);
+  }
+}
+
+static int verify(const vector_t *vector) {
+  int ret = ed25519_prepare(&prepared[0], vector->pubkey, vector->signature,
+                            vector->message, vector->message_len);
+  if (ret != 0) {
+    return ret;
+  }
+  return ed25519_check(&table, &prepared[0], &scratch[0]);
+}
+
+static int verify_batch() {
+  for (size_t i = 0; i < BATCH_COUNT; i++) {
+    int ret = ed25519_prepare(&prepared[i], vectors[i].pubkey,
+                              vectors[i].signature, vectors[i].message,
+                              vectors[i].message_len);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  return ed25519_check_batch(&table, prepared, BATCH_COUNT, scratch);
+}
+
+/* A signature by the small order pubkey with nonce point r and S = s */
+static int verify_small_order(const char *pubkey, const char *r,
+                              const char *s) {
+  vector_t vector;
+  from_hex(pubkey, vector.pubkey);
+  from_hex(r, vector.signature);
+  from_hex(s, &vector.signature[32]);
+  vector.message[0] = 'x';
+  vector.message_len = 1;
+  return verify(&vector);
+}
+
+int main() {
+  ed25519_base_table_build(&table);
+
+  set_vectors();
+  EXPECT_RET("RFC 8032 test 1", verify(&vectors[0]), 0);
+  EXPECT_RET("RFC 8032 test 2", verify(&vectors[1]), 0);
+  EXPECT_RET("RFC 8032 test 3", verify(&vectors[2]), 0);
+
+  vectors[1].message[0] ^= 1;
+  EXPECT_RET("another message", verify(&vectors[1]), ED25519_ERROR_VERIFY);
+
+  set_vectors();
+  vectors[2].pubkey[0] ^= 1;
+  EXPECT_RET("another pubkey", verify(&vectors[2]), ED25519_ERROR_VERIFY);
+
+  set_vectors();
+  from_hex(GROUP_ORDER, &vectors[0].signature[32]);
+  EXPECT_RET("S equal to l", verify(&vectors[0]), ED25519_ERROR_ENCODING);
+
+  set_vectors();
+  from_hex(NOT_ON_CURVE, vectors[0].pubkey);
+  EXPECT_RET("pubkey off the curve", verify(&vectors[0]),
+             ED25519_ERROR_ENCODING);
+
+  set_vectors();
+  from_hex(NOT_ON_CURVE, vectors[0].signature);
+  EXPECT_RET("R off the curve", verify(&vectors[0]), ED25519_ERROR_ENCODING);
+
+  /*
+   * ZIP 215: small order points and non canonical encodings decode, and
+   * the cofactored equation holds for S = 0 whatever the message.
+   */
+  EXPECT_RET("identity pubkey and R",
+             verify_small_order(IDENTITY, IDENTITY, ZERO_SCALAR), 0);
+  EXPECT_RET("identity with the sign of x set",
+             verify_small_order(IDENTITY_NEGATIVE_ZERO,
+                                IDENTITY_NEGATIVE_ZERO, ZERO_SCALAR),
+             0);
+  EXPECT_RET("identity with y above p",
+             verify_small_order(IDENTITY_Y_ABOVE_P, IDENTITY_Y_ABOVE_P,
+                                ZERO_SCALAR),
+             0);
+  EXPECT_RET("order 2 pubkey, order 4 R",
+             verify_small_order(ORDER_2, ORDER_4, ZERO_SCALAR), 0);
+  EXPECT_RET("small order with S equal to l",
+             verify_small_order(IDENTITY, IDENTITY, GROUP_ORDER),
+             ED25519_ERROR_ENCODING);
+
+  set_vectors();
+  EXPECT_RET("batch", verify_batch(), 0);
+
+  set_vectors();
+  vectors[1].signature[40] ^= 1;
+  EXPECT_RET("batch with a corrupted S", verify_batch(), ED25519_ERROR_VERIFY);
+
+  set_vectors();
+  vectors[2].signature[0] ^= 1;
+  EXPECT_RET("batch with a corrupted R", verify_batch(), ED25519_ERROR_VERIFY);
+
+  /* Only a plain sum of the equations would hold */
+  set_vectors();
+  uint8_t s[ED25519_SCALAR_SIZE];
+  memcpy(s, &vectors[0].signature[32], ED25519_SCALAR_SIZE);
+  memcpy(&vectors[0].signature[32], &vectors[1].signature[32],
+         ED25519_SCALAR_SIZE);
+  memcpy(&vectors[1].signature[32], s, ED25519_SCALAR_SIZE);
+  EXPECT_RET("batch with swapped S", verify_batch(), ED25519_ERROR_VERIFY);
+
+  return test_failures == 0 ? 0 : 1;
+}
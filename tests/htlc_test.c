@@ -0,0 +1,103 @@
+/*
+ * Covenant mode of c/htlc.c: the output paired with a settled input must
+ * pay the destination lock and carry the input's capacity, type script and
+ * data unchanged.
+ */
+#define main htlc_main
+#include "htlc.c"
+#undef main
+
+#include "test.h"
+
+static const uint8_t HTLC_CODE_HASH[32] = {1};
+static const uint8_t DEST_CODE_HASH[32] = {2};
+static const uint8_t TOKEN_CODE_HASH[32] = {3};
+static const uint8_t PREIMAGE[] = "htlc covenant preimage";
+
+static uint8_t dest_lock[MOCK_SCRIPT_SIZE];
+static uint64_t dest_lock_size;
+
+/*
+ * One HTLC input claimed with the preimage in covenant mode, paired with an
+ * output to the claim destination that keeps the input's type and data.
+ */
+static void setup_claim(int typed) {
+  mock_reset();
+  uint8_t refund_lock[MOCK_SCRIPT_SIZE];
+  uint8_t refund_args[1] = {0};
+  uint64_t refund_lock_size = mock_script(refund_lock, DEST_CODE_HASH, 0,
+                                          refund_args, sizeof(refund_args));
+  uint8_t claim_args[1] = {1};
+  dest_lock_size = mock_script(dest_lock, DEST_CODE_HASH, 0, claim_args,
+                               sizeof(claim_args));
+
+  uint8_t args[COVENANT_ARG_SIZE] = {0};
+  mock_hash(refund_lock, refund_lock_size, args);
+  mock_hash(dest_lock, dest_lock_size, &args[LOCK_HASH_SIZE]);
+  SHA256_CTX sha256_ctx;
+  sha256_init(&sha256_ctx);
+  sha256_update(&sha256_ctx, PREIMAGE, sizeof(PREIMAGE));
+  sha256_final(&sha256_ctx, &args[LOCK_HASH_SIZE * 2]);
+  mock_tx.script_size =
+      mock_script(mock_tx.script, HTLC_CODE_HASH, 0, args, sizeof(args));
+
+  mock_cell_t *input = &mock_tx.inputs[0];
+  mock_cell_t *output = &mock_tx.outputs[0];
+  input->capacity = 1000;
+  memcpy(input->lock, mock_tx.script, mock_tx.script_size);
+  input->lock_size = mock_tx.script_size;
+  output->capacity = 1000;
+  memcpy(output->lock, dest_lock, dest_lock_size);
+  output->lock_size = dest_lock_size;
+  if (typed) {
+    uint8_t token_args[32] = {4};
+    input->type_size = mock_script(input->type, TOKEN_CODE_HASH, 0,
+                                   token_args, sizeof(token_args));
+    memcpy(output->type, input->type, input->type_size);
+    output->type_size = input->type_size;
+    input->data_size = output->data_size = 16;
+    memset(input->data, 7, input->data_size);
+    memset(output->data, 7, output->data_size);
+  }
+  mock_tx.input_count = mock_tx.output_count = 1;
+  mock_witness(0, PREIMAGE, sizeof(PREIMAGE), NULL, 0, NULL, 0);
+}
+
+int main() {
+  setup_claim(0);
+  EXPECT_RET("plain cell paid forward", htlc_main(), CKB_SUCCESS);
+
+  setup_claim(1);
+  EXPECT_RET("typed cell paid forward", htlc_main(), CKB_SUCCESS);
+
+  setup_claim(0);
+  mock_tx.outputs[0].lock[dest_lock_size - 1] ^= 1;
+  EXPECT_RET("output to another lock", htlc_main(), ERROR_COVENANT_LOCK);
+
+  setup_claim(0);
+  mock_tx.outputs[0].capacity -= 1;
+  EXPECT_RET("output short of capacity", htlc_main(), ERROR_COVENANT_CAPACITY);
+
+  setup_claim(1);
+  mock_tx.outputs[0].type[mock_tx.outputs[0].type_size - 1] ^= 1;
+  EXPECT_RET("output type script changed", htlc_main(), ERROR_COVENANT_TYPE);
+
+  setup_claim(1);
+  mock_tx.outputs[0].type_size = 0;
+  EXPECT_RET("output type script dropped", htlc_main(), ERROR_COVENANT_TYPE);
+
+  setup_claim(0);
+  memcpy(mock_tx.outputs[0].type, mock_tx.script, mock_tx.script_size);
+  mock_tx.outputs[0].type_size = mock_tx.script_size;
+  EXPECT_RET("output type script added", htlc_main(), ERROR_COVENANT_TYPE);
+
+  setup_claim(1);
+  mock_tx.outputs[0].data[0] ^= 1;
+  EXPECT_RET("output data changed", htlc_main(), ERROR_COVENANT_DATA);
+
+  setup_claim(0);
+  mock_tx.outputs[0].data_size = 1;
+  EXPECT_RET("output data added", htlc_main(), ERROR_COVENANT_DATA);
+
+  return test_failures == 0 ? 0 : 1;
+}
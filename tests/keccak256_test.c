@@ -0,0 +1,87 @@
+/*
+ * deps/keccak256.h against known answers, computed with a reference
+ * Keccak-256 (the 0x01 padding of Ethereum, not SHA3-256's 0x06), around
+ * the 136 byte rate: 135 bytes put both padding bits in one byte, 136
+ * bytes need a block of padding alone. The messages are bytes 0, 1, 2...
+ * Split updates must give the same digests.
+ */
+#include "keccak256.h"
+
+#include "test.h"
+
+#define MAX_MESSAGE_SIZE (2 * KECCAK256_RATE)
+
+typedef struct {
+  size_t len;
+  const char *hash;
+} known_answer_t;
+
+static const known_answer_t KNOWN_ANSWERS[] = {
+    {0, "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"},
+    {135, "cbdfd9dee5faad3818d6b06f95a219fd290b0e1706f6a82e5a595b9ce9faca62"},
+    {136, "7ce759f1ab7f9ce437719970c26b0a66ff11fe3e38e17df89cf5d29c7d7f807e"},
+    {137, "ac73d4fae68b8453f764007c1a20ce95994187861f0c3227a3a8e99a73a3b1db"},
+    {272, "fdf2ec49e749960d3c8521a0219af8d03e30e2b3bf19bd16150ee0eaf133d66e"},
+};
+
+static void from_hex(const char *hex, uint8_t *out, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    unsigned int byte;
+    sscanf(&hex[2 * i], "%2x", &byte);
+    out[i] = (uint8_t)byte;
+  }
+}
+
+int main() {
+  uint8_t message[MAX_MESSAGE_SIZE];
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = (uint8_t)i;
+  }
+
+  for (size_t i = 0; i < sizeof(KNOWN_ANSWERS) / sizeof(KNOWN_ANSWERS[0]);
+       i++) {
+    const known_answer_t *answer = &KNOWN_ANSWERS[i];
+    uint8_t expected[KECCAK256_HASH_SIZE];
+    from_hex(answer->hash, expected, KECCAK256_HASH_SIZE);
+    char name[64];
+
+    uint8_t hash[KECCAK256_HASH_SIZE];
+    keccak256(message, answer->len, hash);
+    snprintf(name, sizeof(name), "keccak256 of %zu bytes", answer->len);
+    EXPECT_RET(name, memcmp(hash, expected, KECCAK256_HASH_SIZE), 0);
+
+    /* Every split into two updates, and byte by byte */
+    int split_mismatches = 0;
+    for (size_t split = 0; split <= answer->len; split++) {
+      keccak256_ctx_t ctx;
+      keccak256_init(&ctx);
+      keccak256_update(&ctx, message, split);
+      keccak256_update(&ctx, &message[split], answer->len - split);
+      keccak256_final(&ctx, hash);
+      split_mismatches += memcmp(hash, expected, KECCAK256_HASH_SIZE) != 0;
+    }
+    snprintf(name, sizeof(name), "keccak256 of %zu bytes split",
+             answer->len);
+    EXPECT_RET(name, split_mismatches, 0);
+
+    keccak256_ctx_t ctx;
+    keccak256_init(&ctx);
+    for (size_t j = 0; j < answer->len; j++) {
+      keccak256_update(&ctx, &message[j], 1);
+    }
+    keccak256_final(&ctx, hash);
+    snprintf(name, sizeof(name), "keccak256 of %zu bytes one by one",
+             answer->len);
+    EXPECT_RET(name, memcmp(hash, expected, KECCAK256_HASH_SIZE), 0);
+  }
+
+  uint8_t hash[KECCAK256_HASH_SIZE];
+  uint8_t expected[KECCAK256_HASH_SIZE];
+  keccak256((const uint8_t *)"abc", 3, hash);
+  from_hex("4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45",
+           expected, KECCAK256_HASH_SIZE);
+  EXPECT_RET("keccak256 of abc", memcmp(hash, expected, KECCAK256_HASH_SIZE),
+             0);
+
+  return test_failures == 0 ? 0 : 1;
+}
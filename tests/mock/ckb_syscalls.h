@@ -0,0 +1,356 @@
+/*
+ * Host stand-in for the ckb-c-stdlib syscalls, used by the tests in tests/.
+ *
+ * Syscalls read an in-memory transaction, mock_tx, that a test fills in
+ * before calling the main of the script under test. The script running is
+ * mock_tx.script, its group holds the inputs (and for a type script the
+ * outputs too) whose lock or type is that script. Hashes are computed from
+ * the cells like CKB does, blake2b with the ckb-default-hash
+ * personalization.
+ *
+ * Loads follow the syscall semantics: at most *len bytes from offset are
+ * copied and *len is set to the full size left from offset.
+ */
+#ifndef CKB_MOCK_SYSCALLS_H_
+#define CKB_MOCK_SYSCALLS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "blake2b.h"
+
+#define CKB_SUCCESS 0
+#define CKB_INDEX_OUT_OF_BOUND 1
+#define CKB_ITEM_MISSING 2
+#define CKB_LENGTH_NOT_ENOUGH 3
+
+#define CKB_SOURCE_INPUT 1
+#define CKB_SOURCE_OUTPUT 2
+#define CKB_SOURCE_CELL_DEP 3
+#define CKB_SOURCE_HEADER_DEP 4
+#define CKB_SOURCE_GROUP_INPUT 0x0100000000000001
+#define CKB_SOURCE_GROUP_OUTPUT 0x0100000000000002
+
+#define CKB_CELL_FIELD_CAPACITY 0
+#define CKB_CELL_FIELD_DATA_HASH 1
+#define CKB_CELL_FIELD_LOCK 2
+#define CKB_CELL_FIELD_LOCK_HASH 3
+#define CKB_CELL_FIELD_TYPE 4
+#define CKB_CELL_FIELD_TYPE_HASH 5
+#define CKB_CELL_FIELD_OCCUPIED_CAPACITY 6
+
+#define CKB_INPUT_FIELD_OUT_POINT 0
+#define CKB_INPUT_FIELD_SINCE 1
+
+#define MOCK_CELLS_MAX 16
+#define MOCK_SCRIPT_SIZE 256
+#define MOCK_DATA_SIZE 4096
+#define MOCK_WITNESS_SIZE 32768
+#define MOCK_HASH_SIZE 32
+/* since | tx hash | index, a molecule CellInput */
+#define MOCK_OUT_POINT_SIZE 36
+#define MOCK_CELL_INPUT_SIZE (8 + MOCK_OUT_POINT_SIZE)
+
+typedef struct {
+  uint64_t capacity;
+  uint8_t lock[MOCK_SCRIPT_SIZE];
+  uint64_t lock_size;
+  /* No type script when type_size is 0 */
+  uint8_t type[MOCK_SCRIPT_SIZE];
+  uint64_t type_size;
+  uint8_t data[MOCK_DATA_SIZE];
+  uint64_t data_size;
+  /* Inputs only */
+  uint64_t since;
+  uint8_t out_point[MOCK_OUT_POINT_SIZE];
+} mock_cell_t;
+
+typedef struct {
+  mock_cell_t inputs[MOCK_CELLS_MAX];
+  size_t input_count;
+  mock_cell_t outputs[MOCK_CELLS_MAX];
+  size_t output_count;
+  uint8_t witnesses[MOCK_CELLS_MAX][MOCK_WITNESS_SIZE];
+  uint64_t witness_sizes[MOCK_CELLS_MAX];
+  size_t witness_count;
+  uint8_t tx_hash[MOCK_HASH_SIZE];
+  /* The script being run and whether it runs as a type script */
+  uint8_t script[MOCK_SCRIPT_SIZE];
+  uint64_t script_size;
+  int script_is_type;
+} mock_tx_t;
+
+static mock_tx_t mock_tx;
+
+static void mock_hash(const uint8_t *data, size_t size, uint8_t *hash) {
+  blake2b_state state;
+  blake2b_init(&state, MOCK_HASH_SIZE);
+  blake2b_update(&state, data, size);
+  blake2b_final(&state, hash, MOCK_HASH_SIZE);
+}
+
+static int mock_copy(void *addr, uint64_t *len, size_t offset,
+                     const void *data, uint64_t size) {
+  if (offset > size) {
+    return CKB_LENGTH_NOT_ENOUGH;
+  }
+  uint64_t available = size - offset;
+  memcpy(addr, (const uint8_t *)data + offset,
+         *len < available ? *len : available);
+  *len = available;
+  return CKB_SUCCESS;
+}
+
+static int mock_in_group(const mock_cell_t *cell, int output) {
+  if (mock_tx.script_is_type) {
+    return cell->type_size == mock_tx.script_size &&
+           memcmp(cell->type, mock_tx.script, mock_tx.script_size) == 0;
+  }
+  return !output && cell->lock_size == mock_tx.script_size &&
+         memcmp(cell->lock, mock_tx.script, mock_tx.script_size) == 0;
+}
+
+/* Index in the transaction of cell index of source, or -1 */
+static long mock_index(size_t index, size_t source) {
+  switch (source) {
+    case CKB_SOURCE_INPUT:
+      return index < mock_tx.input_count ? (long)index : -1;
+    case CKB_SOURCE_OUTPUT:
+      return index < mock_tx.output_count ? (long)index : -1;
+    case CKB_SOURCE_GROUP_INPUT:
+    case CKB_SOURCE_GROUP_OUTPUT: {
+      int output = source == CKB_SOURCE_GROUP_OUTPUT;
+      const mock_cell_t *cells = output ? mock_tx.outputs : mock_tx.inputs;
+      size_t count = output ? mock_tx.output_count : mock_tx.input_count;
+      for (size_t i = 0; i < count; i++) {
+        if (mock_in_group(&cells[i], output) && index-- == 0) {
+          return (long)i;
+        }
+      }
+      return -1;
+    }
+    default:
+      return -1;
+  }
+}
+
+static const mock_cell_t *mock_cell(size_t index, size_t source) {
+  long i = mock_index(index, source);
+  if (i < 0) {
+    return NULL;
+  }
+  if (source == CKB_SOURCE_INPUT || source == CKB_SOURCE_GROUP_INPUT) {
+    return &mock_tx.inputs[i];
+  }
+  return &mock_tx.outputs[i];
+}
+
+static int ckb_load_tx_hash(void *addr, uint64_t *len, size_t offset) {
+  return mock_copy(addr, len, offset, mock_tx.tx_hash, MOCK_HASH_SIZE);
+}
+
+static int ckb_load_script_hash(void *addr, uint64_t *len, size_t offset) {
+  uint8_t hash[MOCK_HASH_SIZE];
+  mock_hash(mock_tx.script, mock_tx.script_size, hash);
+  return mock_copy(addr, len, offset, hash, MOCK_HASH_SIZE);
+}
+
+static int ckb_load_script(void *addr, uint64_t *len, size_t offset) {
+  return mock_copy(addr, len, offset, mock_tx.script, mock_tx.script_size);
+}
+
+static int ckb_load_witness(void *addr, uint64_t *len, size_t offset,
+                            size_t index, size_t source) {
+  long i = mock_index(index, source);
+  if (i < 0 || (size_t)i >= mock_tx.witness_count) {
+    return CKB_INDEX_OUT_OF_BOUND;
+  }
+  return mock_copy(addr, len, offset, mock_tx.witnesses[i],
+                   mock_tx.witness_sizes[i]);
+}
+
+static int ckb_load_cell_data(void *addr, uint64_t *len, size_t offset,
+                              size_t index, size_t source) {
+  const mock_cell_t *cell = mock_cell(index, source);
+  if (cell == NULL) {
+    return CKB_INDEX_OUT_OF_BOUND;
+  }
+  return mock_copy(addr, len, offset, cell->data, cell->data_size);
+}
+
+static int ckb_load_cell_by_field(void *addr, uint64_t *len, size_t offset,
+                                  size_t index, size_t source, size_t field) {
+  const mock_cell_t *cell = mock_cell(index, source);
+  if (cell == NULL) {
+    return CKB_INDEX_OUT_OF_BOUND;
+  }
+  uint8_t hash[MOCK_HASH_SIZE];
+  switch (field) {
+    case CKB_CELL_FIELD_CAPACITY:
+      return mock_copy(addr, len, offset, &cell->capacity, 8);
+    case CKB_CELL_FIELD_DATA_HASH:
+      mock_hash(cell->data, cell->data_size, hash);
+      return mock_copy(addr, len, offset, hash, MOCK_HASH_SIZE);
+    case CKB_CELL_FIELD_LOCK:
+      return mock_copy(addr, len, offset, cell->lock, cell->lock_size);
+    case CKB_CELL_FIELD_LOCK_HASH:
+      mock_hash(cell->lock, cell->lock_size, hash);
+      return mock_copy(addr, len, offset, hash, MOCK_HASH_SIZE);
+    case CKB_CELL_FIELD_TYPE:
+      if (cell->type_size == 0) {
+        return CKB_ITEM_MISSING;
+      }
+      return mock_copy(addr, len, offset, cell->type, cell->type_size);
+    case CKB_CELL_FIELD_TYPE_HASH:
+      if (cell->type_size == 0) {
+        return CKB_ITEM_MISSING;
+      }
+      mock_hash(cell->type, cell->type_size, hash);
+      return mock_copy(addr, len, offset, hash, MOCK_HASH_SIZE);
+    default:
+      return CKB_ITEM_MISSING;
+  }
+}
+
+static int ckb_load_input(void *addr, uint64_t *len, size_t offset,
+                          size_t index, size_t source) {
+  const mock_cell_t *cell = mock_cell(index, source);
+  if (cell == NULL || source == CKB_SOURCE_OUTPUT ||
+      source == CKB_SOURCE_GROUP_OUTPUT) {
+    return CKB_INDEX_OUT_OF_BOUND;
+  }
+  uint8_t input[MOCK_CELL_INPUT_SIZE];
+  memcpy(input, &cell->since, 8);
+  memcpy(&input[8], cell->out_point, MOCK_OUT_POINT_SIZE);
+  return mock_copy(addr, len, offset, input, MOCK_CELL_INPUT_SIZE);
+}
+
+static int ckb_load_input_by_field(void *addr, uint64_t *len, size_t offset,
+                                   size_t index, size_t source, size_t field) {
+  const mock_cell_t *cell = mock_cell(index, source);
+  if (cell == NULL || source == CKB_SOURCE_OUTPUT ||
+      source == CKB_SOURCE_GROUP_OUTPUT) {
+    return CKB_INDEX_OUT_OF_BOUND;
+  }
+  if (field == CKB_INPUT_FIELD_SINCE) {
+    return mock_copy(addr, len, offset, &cell->since, 8);
+  }
+  return mock_copy(addr, len, offset, cell->out_point, MOCK_OUT_POINT_SIZE);
+}
+
+static int ckb_checked_load_tx_hash(void *addr, uint64_t *len, size_t offset) {
+  uint64_t old_len = *len;
+  int ret = ckb_load_tx_hash(addr, len, offset);
+  return ret == CKB_SUCCESS && *len > old_len ? CKB_LENGTH_NOT_ENOUGH : ret;
+}
+
+static int ckb_checked_load_witness(void *addr, uint64_t *len, size_t offset,
+                                    size_t index, size_t source) {
+  uint64_t old_len = *len;
+  int ret = ckb_load_witness(addr, len, offset, index, source);
+  return ret == CKB_SUCCESS && *len > old_len ? CKB_LENGTH_NOT_ENOUGH : ret;
+}
+
+static int ckb_checked_load_cell_by_field(void *addr, uint64_t *len,
+                                          size_t offset, size_t index,
+                                          size_t source, size_t field) {
+  uint64_t old_len = *len;
+  int ret = ckb_load_cell_by_field(addr, len, offset, index, source, field);
+  return ret == CKB_SUCCESS && *len > old_len ? CKB_LENGTH_NOT_ENOUGH : ret;
+}
+
+/* No cell deps, scripts under test never get to load a library */
+static int ckb_load_cell_code(void *addr, size_t memory_size,
+                              size_t content_offset, size_t content_size,
+                              size_t index, size_t source) {
+  (void)addr;
+  (void)memory_size;
+  (void)content_offset;
+  (void)content_size;
+  (void)index;
+  (void)source;
+  return CKB_INDEX_OUT_OF_BOUND;
+}
+
+static int ckb_look_for_dep_with_hash(const uint8_t *data_hash,
+                                      size_t *index) {
+  (void)data_hash;
+  (void)index;
+  return CKB_ITEM_MISSING;
+}
+
+static int ckb_calculate_inputs_len() { return (int)mock_tx.input_count; }
+
+static int ckb_debug(const char *s) {
+  fprintf(stderr, "%s\n", s);
+  return CKB_SUCCESS;
+}
+
+/* Builders for the molecule encoded parts of mock_tx */
+
+static void mock_pack_number(uint8_t *dst, uint32_t n) { memcpy(dst, &n, 4); }
+
+/* Writes Script { code_hash, hash_type, args } to out, returns its size */
+static uint64_t mock_script(uint8_t *out, const uint8_t *code_hash,
+                            uint8_t hash_type, const uint8_t *args,
+                            uint32_t args_size) {
+  uint32_t total = 16 + MOCK_HASH_SIZE + 1 + 4 + args_size;
+  mock_pack_number(out, total);
+  mock_pack_number(&out[4], 16);
+  mock_pack_number(&out[8], 16 + MOCK_HASH_SIZE);
+  mock_pack_number(&out[12], 16 + MOCK_HASH_SIZE + 1);
+  memcpy(&out[16], code_hash, MOCK_HASH_SIZE);
+  out[16 + MOCK_HASH_SIZE] = hash_type;
+  mock_pack_number(&out[16 + MOCK_HASH_SIZE + 1], args_size);
+  memcpy(&out[16 + MOCK_HASH_SIZE + 1 + 4], args, args_size);
+  return total;
+}
+
+/* Molecule Bytes of data, or nothing for a none BytesOpt when data is NULL */
+static uint32_t mock_bytes_opt(uint8_t *out, const uint8_t *data,
+                               uint32_t size) {
+  if (data == NULL) {
+    return 0;
+  }
+  mock_pack_number(out, size);
+  memcpy(&out[4], data, size);
+  return 4 + size;
+}
+
+/* Sets witness index to WitnessArgs { lock, input_type, output_type } */
+static void mock_witness(size_t index, const uint8_t *lock, uint32_t lock_size,
+                         const uint8_t *input_type, uint32_t input_type_size,
+                         const uint8_t *output_type,
+                         uint32_t output_type_size) {
+  uint8_t *out = mock_tx.witnesses[index];
+  uint32_t offset = 16;
+  mock_pack_number(&out[4], offset);
+  offset += mock_bytes_opt(&out[offset], lock, lock_size);
+  mock_pack_number(&out[8], offset);
+  offset += mock_bytes_opt(&out[offset], input_type, input_type_size);
+  mock_pack_number(&out[12], offset);
+  offset += mock_bytes_opt(&out[offset], output_type, output_type_size);
+  mock_pack_number(out, offset);
+  mock_tx.witness_sizes[index] = offset;
+  if (mock_tx.witness_count <= index) {
+    mock_tx.witness_count = index + 1;
+  }
+}
+
+/* Writes a molecule BytesVec of count items of item_size bytes */
+static uint32_t mock_bytes_vec(uint8_t *out, const uint8_t *items,
+                               uint32_t item_size, uint32_t count) {
+  uint32_t offset = 4 + 4 * count;
+  for (uint32_t i = 0; i < count; i++) {
+    mock_pack_number(&out[4 + 4 * i], offset);
+    offset += mock_bytes_opt(&out[offset], &items[i * item_size], item_size);
+  }
+  mock_pack_number(out, offset);
+  return offset;
+}
+
+static void mock_reset() { memset(&mock_tx, 0, sizeof(mock_tx)); }
+
+#endif
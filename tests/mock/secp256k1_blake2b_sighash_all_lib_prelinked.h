@@ -0,0 +1,5 @@
+/* Host stand-in for the generated data hash, no library cell exists */
+#ifndef CKB_secp256k1_blake2b_sighash_all_prelinked_data_hash_H_
+#define CKB_secp256k1_blake2b_sighash_all_prelinked_data_hash_H_
+static uint8_t secp256k1_blake2b_sighash_all_prelinked_data_hash[32] = {0};
+#endif
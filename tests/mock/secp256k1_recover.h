@@ -0,0 +1,79 @@
+/*
+ * Host stand-in for the parts of deps/secp256k1_helper.h the recovering
+ * signature libraries use, there are no secp256k1 sources on the host.
+ * Include it before the library: it takes the helper's include guard.
+ *
+ * The signer of a recoverable signature is the compressed pubkey 02 || r,
+ * so a test signs as any pubkey hash by its choice of r. A recovery id
+ * above 3 fails to parse, like a real one does. mock_recover_count counts
+ * the recoveries.
+ */
+#ifndef CKB_SECP256K1_HELPER_H_
+#define CKB_SECP256K1_HELPER_H_
+
+#include "ckb_syscalls.h"
+#include "secp256k1_data_info.h"
+#include "tx_context.h"
+
+#define SECP256K1_EC_COMPRESSED 258
+#define MOCK_SECP256K1_R_SIZE 32
+
+typedef struct {
+  int unused;
+} secp256k1_context;
+
+typedef struct {
+  unsigned char data[MOCK_SECP256K1_R_SIZE];
+} secp256k1_ecdsa_recoverable_signature;
+
+typedef struct {
+  unsigned char data[MOCK_SECP256K1_R_SIZE];
+} secp256k1_pubkey;
+
+static int mock_recover_count = 0;
+
+static int secp256k1_ecdsa_recoverable_signature_parse_compact(
+    const secp256k1_context *context,
+    secp256k1_ecdsa_recoverable_signature *signature,
+    const unsigned char *input64, int recid) {
+  (void)context;
+  if (recid < 0 || recid > 3) {
+    return 0;
+  }
+  memcpy(signature->data, input64, MOCK_SECP256K1_R_SIZE);
+  return 1;
+}
+
+static int secp256k1_ecdsa_recover(
+    const secp256k1_context *context, secp256k1_pubkey *pubkey,
+    const secp256k1_ecdsa_recoverable_signature *signature,
+    const unsigned char *message) {
+  (void)context;
+  (void)message;
+  mock_recover_count++;
+  memcpy(pubkey->data, signature->data, MOCK_SECP256K1_R_SIZE);
+  return 1;
+}
+
+static int secp256k1_ec_pubkey_serialize(const secp256k1_context *context,
+                                         unsigned char *output,
+                                         size_t *output_size,
+                                         const secp256k1_pubkey *pubkey,
+                                         unsigned int flags) {
+  (void)context;
+  (void)flags;
+  output[0] = 0x02;
+  memcpy(&output[1], pubkey->data, MOCK_SECP256K1_R_SIZE);
+  *output_size = MOCK_SECP256K1_R_SIZE + 1;
+  return 1;
+}
+
+static int ckb_secp256k1_custom_verify_only_initialize_with_context(
+    secp256k1_context *context, ckb_tx_context_t *tx_ctx, void *data) {
+  (void)context;
+  (void)tx_ctx;
+  (void)data;
+  return 0;
+}
+
+#endif
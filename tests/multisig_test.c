@@ -0,0 +1,146 @@
+/*
+ * Signer matching of c/secp256k1_blake2b_multisig_all_lib.c: threshold,
+ * require_first_n, config order, duplicate signers and the early exit
+ * once too few config slots are left, with the recovery of
+ * tests/mock/secp256k1_recover.h.
+ */
+#include "secp256k1_recover.h"
+
+#include "secp256k1_blake2b_multisig_all_lib.c"
+
+#include "test.h"
+
+#define MAX_PUBKEYS 8
+#define LOCK_MAX                                 \
+  (SECP256K1_MULTISIG_CONFIG_SIZE(MAX_PUBKEYS) + \
+   MAX_PUBKEYS * SECP256K1_MULTISIG_SIGNATURE_SIZE)
+
+static const uint8_t WITNESS[] = "multisig witness";
+
+static uint8_t lock[LOCK_MAX];
+static size_t lock_size;
+static uint8_t config_hash[SECP256K1_MULTISIG_BLAKE160_SIZE];
+
+/* The r that recovers to the pubkey of config slot */
+static void signer_r(size_t slot, uint8_t *r) {
+  memset(r, (int)slot + 1, MOCK_SECP256K1_R_SIZE);
+}
+
+/*
+ * A require_first_n, threshold of pubkeys config signed by the config
+ * slots in signers, in that order.
+ */
+static void setup(uint8_t require_first_n, uint8_t threshold, uint8_t pubkeys,
+                  const size_t *signers) {
+  lock[0] = 0;
+  lock[1] = require_first_n;
+  lock[2] = threshold;
+  lock[3] = pubkeys;
+  for (size_t i = 0; i < pubkeys; i++) {
+    uint8_t serialized[PUBKEY_SIZE] = {0x02};
+    signer_r(i, &serialized[1]);
+    blake160(serialized, PUBKEY_SIZE,
+             &lock[SECP256K1_MULTISIG_HEADER_SIZE +
+                   i * SECP256K1_MULTISIG_BLAKE160_SIZE]);
+  }
+  size_t config_size = SECP256K1_MULTISIG_CONFIG_SIZE(pubkeys);
+  blake160(lock, config_size, config_hash);
+  for (size_t i = 0; i < threshold; i++) {
+    uint8_t *signature =
+        &lock[config_size + i * SECP256K1_MULTISIG_SIGNATURE_SIZE];
+    memset(signature, 0, SECP256K1_MULTISIG_SIGNATURE_SIZE);
+    signer_r(signers[i], signature);
+  }
+  lock_size = config_size + threshold * SECP256K1_MULTISIG_SIGNATURE_SIZE;
+  mock_recover_count = 0;
+}
+
+static int validate() {
+  mock_reset();
+  ckb_tx_context_t ctx;
+  ckb_tx_context_init(&ctx);
+  ckb_tx_context_set_first_witness(&ctx, WITNESS, sizeof(WITNESS));
+  return validate_secp256k1_blake2b_multisig_all(&ctx, config_hash, lock,
+                                                 lock_size);
+}
+
+int main() {
+  const size_t in_order[] = {0, 2};
+  setup(0, 2, 3, in_order);
+  EXPECT_RET("2 of 3", validate(), CKB_SUCCESS);
+
+  const size_t all[] = {0, 1, 2};
+  setup(0, 3, 3, all);
+  EXPECT_RET("3 of 3", validate(), CKB_SUCCESS);
+
+  /* Unlike the system multisig script, which takes any order */
+  const size_t reversed[] = {2, 0};
+  setup(0, 2, 3, reversed);
+  EXPECT_RET("signatures out of config order", validate(),
+             ERROR_MULTISIG_VERIFY);
+
+  const size_t duplicate[] = {1, 1};
+  setup(0, 2, 3, duplicate);
+  EXPECT_RET("same signer twice", validate(), ERROR_MULTISIG_VERIFY);
+
+  const size_t stranger[] = {0, 5};
+  setup(0, 2, 3, stranger);
+  EXPECT_RET("signer outside the config", validate(),
+             ERROR_MULTISIG_VERIFY);
+
+  const size_t first_and_last[] = {0, 2};
+  setup(1, 2, 3, first_and_last);
+  EXPECT_RET("require_first_n 1 met", validate(), CKB_SUCCESS);
+
+  const size_t skip_first[] = {1, 2};
+  setup(1, 2, 3, skip_first);
+  EXPECT_RET("require_first_n 1 skipped", validate(), ERROR_MULTISIG_VERIFY);
+
+  const size_t first_two[] = {0, 1, 3};
+  setup(2, 3, 4, first_two);
+  EXPECT_RET("require_first_n 2 met", validate(), CKB_SUCCESS);
+
+  const size_t second_missing[] = {0, 2, 3};
+  setup(2, 3, 4, second_missing);
+  EXPECT_RET("require_first_n 2 with slot 2", validate(),
+             ERROR_MULTISIG_VERIFY);
+
+  /* Slot 2 leaves one slot for two signatures, no second recovery */
+  const size_t late_start[] = {2, 3, 3};
+  setup(0, 3, 4, late_start);
+  EXPECT_RET("too few slots left", validate(), ERROR_MULTISIG_VERIFY);
+  EXPECT_RET("recoveries before the early exit", mock_recover_count, 1);
+
+  setup(0, 2, 3, in_order);
+  lock[lock_size - 1] = 4;
+  EXPECT_RET("recovery id out of range", validate(),
+             ERROR_SECP_PARSE_SIGNATURE);
+
+  setup(0, 2, 3, in_order);
+  config_hash[0] ^= 1;
+  EXPECT_RET("config of another hash", validate(),
+             ERROR_MULTISIG_CONFIG_HASH);
+
+  setup(0, 2, 3, in_order);
+  lock_size -= 1;
+  EXPECT_RET("lock short of a signature byte", validate(),
+             ERROR_MULTISIG_LOCK_SIZE);
+
+  setup(0, 2, 3, in_order);
+  lock[0] = 1;
+  EXPECT_RET("reserved byte set", validate(), ERROR_MULTISIG_CONFIG);
+
+  setup(0, 0, 3, in_order);
+  EXPECT_RET("threshold 0", validate(), ERROR_MULTISIG_CONFIG);
+
+  setup(0, 2, 3, in_order);
+  lock[2] = 4;
+  EXPECT_RET("threshold above pubkeys", validate(), ERROR_MULTISIG_CONFIG);
+
+  setup(0, 2, 3, in_order);
+  lock[1] = 3;
+  EXPECT_RET("require_first_n above threshold", validate(),
+             ERROR_MULTISIG_CONFIG);
+
+  return test_failures == 0 ? 0 : 1;
+}
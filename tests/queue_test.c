@@ -0,0 +1,82 @@
+/*
+ * The crosschain_queue: creation is bound to its type id, and an append
+ * must store the old state with the witness messages appended.
+ */
+#define main queue_main
+#include "crosschain_queue.c"
+#undef main
+
+#include "test.h"
+
+static const uint8_t QUEUE_CODE_HASH[32] = {9};
+static const uint8_t MESSAGES[2][8] = {"message0", "message1"};
+
+/* Stores the state of the first count messages in cell */
+static void set_queue(mock_cell_t *cell, size_t count) {
+  mmr_t mmr;
+  mmr_init(&mmr);
+  for (size_t i = 0; i < count; i++) {
+    uint8_t leaf[MMR_HASH_SIZE];
+    mmr_hash(MESSAGES[i], sizeof(MESSAGES[i]), leaf);
+    mmr_append(&mmr, leaf);
+  }
+  cell->data_size = mmr_store(&mmr, cell->data);
+  memcpy(cell->type, mock_tx.script, mock_tx.script_size);
+  cell->type_size = mock_tx.script_size;
+}
+
+/* Messages from index first on in the output_type of witness 0 */
+static void set_messages(size_t first) {
+  uint8_t vec[64];
+  uint32_t size = mock_bytes_vec(vec, MESSAGES[first], sizeof(MESSAGES[0]),
+                                 2 - first);
+  mock_witness(0, NULL, 0, NULL, 0, vec, size);
+}
+
+/* A queue created with the first message from input 0, out point seed */
+static void setup_create(uint8_t seed) {
+  mock_reset();
+  mock_tx.input_count = mock_tx.output_count = 1;
+  mock_tx.inputs[0].out_point[0] = seed;
+  uint8_t input[MOCK_CELL_INPUT_SIZE] = {0};
+  memcpy(&input[8], mock_tx.inputs[0].out_point, MOCK_OUT_POINT_SIZE);
+  uint8_t index[8] = {0};
+  uint8_t type_id[CKB_TYPE_ID_SIZE];
+  blake2b_state state;
+  blake2b_init(&state, CKB_TYPE_ID_SIZE);
+  blake2b_update(&state, input, sizeof(input));
+  blake2b_update(&state, index, sizeof(index));
+  blake2b_final(&state, type_id, CKB_TYPE_ID_SIZE);
+  mock_tx.script_size = mock_script(mock_tx.script, QUEUE_CODE_HASH, 1,
+                                    type_id, sizeof(type_id));
+  mock_tx.script_is_type = 1;
+  set_queue(&mock_tx.outputs[0], 2);
+  set_messages(0);
+}
+
+int main() {
+  setup_create(1);
+  EXPECT_RET("create", queue_main(), CKB_SUCCESS);
+
+  setup_create(1);
+  mock_tx.inputs[0].out_point[0] = 2;
+  EXPECT_RET("create from another input", queue_main(),
+             CKB_TYPE_ID_ERROR_MISMATCH);
+
+  setup_create(1);
+  mock_tx.script_size = mock_script(mock_tx.script, QUEUE_CODE_HASH, 1,
+                                    MESSAGES[0], sizeof(MESSAGES[0]));
+  EXPECT_RET("args of another size", queue_main(), ERROR_ARGUMENTS_LEN);
+
+  /* Spending the queue, its type id is not checked again */
+  setup_create(1);
+  set_queue(&mock_tx.inputs[0], 1);
+  mock_tx.inputs[0].out_point[0] = 2;
+  set_messages(1);
+  EXPECT_RET("append", queue_main(), CKB_SUCCESS);
+
+  mock_tx.outputs[0].data[0] ^= 1;
+  EXPECT_RET("append of another state", queue_main(), ERROR_QUEUE_APPEND);
+
+  return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+/*
+ * deps/rlp.h and c/eth_receipt_proof_lib.c: the non canonical encodings
+ * the decoder rejects, then proofs through a leaf alone, a branch with the
+ * leaf embedded and an extension down to a hashed leaf, with wrong keys,
+ * roots and nodes trailing the leaf.
+ */
+#include "eth_receipt_proof_lib.c"
+
+#include "test.h"
+
+#define NODE_SIZE 256
+#define MAX_NODES 3
+#define RECEIPT_TYPE 2
+
+static uint8_t nodes[MAX_NODES][NODE_SIZE];
+static size_t sizes[MAX_NODES];
+static uint8_t proof[MAX_NODES * (NODE_SIZE + 3) + 3];
+static size_t proof_size;
+static uint8_t root[KECCAK256_HASH_SIZE];
+static eth_receipt_t receipt;
+
+static const uint8_t ADDRESS[ETH_ADDRESS_SIZE] = {0xaa, 0xaa, 0xaa, 0xaa,
+                                                  0xaa, 0xaa, 0xaa, 0xaa,
+                                                  0xaa, 0xaa, 0xaa, 0xaa,
+                                                  0xaa, 0xaa, 0xaa, 0xaa,
+                                                  0xaa, 0xaa, 0xaa, 0xaa};
+
+/* Wraps the len bytes at p into an RLP string or list in place */
+static size_t rlp_wrap(uint8_t *p, size_t len, uint8_t base) {
+  uint8_t header[3];
+  size_t header_size = 1;
+  if (base == RLP_STRING_SHORT && len == 1 && p[0] < RLP_STRING_SHORT) {
+    return len;
+  }
+  if (len <= RLP_SHORT_MAX) {
+    header[0] = base + len;
+  } else {
+    size_t length_size = len > 0xff ? 2 : 1;
+    header[0] = base + RLP_SHORT_MAX + length_size;
+    for (size_t i = 0; i < length_size; i++) {
+      header[1 + i] = (uint8_t)(len >> (8 * (length_size - 1 - i)));
+    }
+    header_size += length_size;
+  }
+  memmove(p + header_size, p, len);
+  memcpy(p, header, header_size);
+  return header_size + len;
+}
+
+static size_t rlp_put(uint8_t *p, uint8_t fill, size_t len) {
+  memset(p, fill, len);
+  return rlp_wrap(p, len, RLP_STRING_SHORT);
+}
+
+/*
+ * A typed receipt of status as a leaf value, with an empty logs bloom and
+ * either no logs, small enough to embed its leaf, or one log of ADDRESS.
+ */
+static size_t build_receipt(uint8_t *p, uint8_t status, int with_log) {
+  size_t n = 0;
+  p[n++] = RECEIPT_TYPE;
+  size_t fields = n;
+  p[n++] = status == 0 ? RLP_STRING_SHORT : status;
+  p[n++] = 0x21;
+  p[n++] = RLP_STRING_SHORT;
+  size_t logs = n;
+  if (with_log) {
+    size_t log = n;
+    memcpy(&p[n], ADDRESS, ETH_ADDRESS_SIZE);
+    n += rlp_wrap(&p[n], ETH_ADDRESS_SIZE, RLP_STRING_SHORT);
+    size_t topics = n;
+    n += rlp_put(&p[n], 0xbb, ETH_HASH_SIZE);
+    n = topics + rlp_wrap(&p[topics], n - topics, RLP_LIST_SHORT);
+    n += rlp_put(&p[n], 0xdd, 4);
+    n = log + rlp_wrap(&p[log], n - log, RLP_LIST_SHORT);
+  }
+  n = logs + rlp_wrap(&p[logs], n - logs, RLP_LIST_SHORT);
+  n = fields + rlp_wrap(&p[fields], n - fields, RLP_LIST_SHORT);
+  return rlp_wrap(p, n, RLP_STRING_SHORT);
+}
+
+/* A leaf or extension of the hex prefix encoded path and encoded child */
+static size_t build_short(uint8_t *p, const uint8_t *path, size_t path_size,
+                          const uint8_t *child, size_t child_size) {
+  memcpy(p, path, path_size);
+  size_t n = rlp_wrap(p, path_size, RLP_STRING_SHORT);
+  memcpy(&p[n], child, child_size);
+  return rlp_wrap(p, n + child_size, RLP_LIST_SHORT);
+}
+
+/* A branch with the encoded child in slot and every other slot empty */
+static size_t build_branch(uint8_t *p, size_t slot, const uint8_t *child,
+                           size_t child_size) {
+  size_t n = 0;
+  for (size_t i = 0; i < BRANCH_VALUE; i++) {
+    if (i == slot) {
+      memcpy(&p[n], child, child_size);
+      n += child_size;
+    } else {
+      p[n++] = RLP_STRING_SHORT;
+    }
+  }
+  p[n++] = RLP_STRING_SHORT;
+  return rlp_wrap(p, n, RLP_LIST_SHORT);
+}
+
+/* The reference to node d, the RLP string of its hash */
+static size_t hash_reference(size_t d, uint8_t *p) {
+  keccak256(nodes[d], sizes[d], &p[1]);
+  p[0] = RLP_STRING_SHORT + KECCAK256_HASH_SIZE;
+  return 1 + KECCAK256_HASH_SIZE;
+}
+
+/* The proof of the first count nodes and the root, the hash of node 0 */
+static void build_proof(size_t count) {
+  size_t n = 0;
+  for (size_t d = 0; d < count; d++) {
+    memcpy(&proof[n], nodes[d], sizes[d]);
+    n += rlp_wrap(&proof[n], sizes[d], RLP_STRING_SHORT);
+  }
+  proof_size = rlp_wrap(proof, n, RLP_LIST_SHORT);
+  keccak256(nodes[0], sizes[0], root);
+}
+
+static int verify(uint64_t tx_index) {
+  return verify_eth_receipt(root, tx_index, proof, proof_size, &receipt);
+}
+
+static int decode(const uint8_t *encoded, size_t size) {
+  rlp_seg_t in = {encoded, (uint32_t)size};
+  rlp_item_t item;
+  return rlp_decode(in, &item);
+}
+
+static void test_rlp() {
+  uint8_t long_string[2 + 56];
+  memset(long_string, 'a', sizeof(long_string));
+  long_string[0] = 0xb8;
+  long_string[1] = 56;
+  EXPECT_RET("rlp long string", decode(long_string, 2 + 56), 0);
+  long_string[1] = 55;
+  EXPECT_RET("rlp long string of a short length", decode(long_string, 2 + 55),
+             -1);
+
+  uint8_t leading_zero[3 + 56];
+  memset(leading_zero, 'a', sizeof(leading_zero));
+  leading_zero[0] = 0xb9;
+  leading_zero[1] = 0;
+  leading_zero[2] = 56;
+  EXPECT_RET("rlp length with a leading zero",
+             decode(leading_zero, sizeof(leading_zero)), -1);
+
+  const uint8_t long_list[] = {0xf8, 0x01, 0x05};
+  EXPECT_RET("rlp long list of a short length",
+             decode(long_list, sizeof(long_list)), -1);
+
+  const uint8_t single_byte[] = {0x05};
+  EXPECT_RET("rlp single byte", decode(single_byte, 1), 0);
+  const uint8_t wrapped_byte[] = {0x81, 0x05};
+  EXPECT_RET("rlp single byte below 0x80 wrapped",
+             decode(wrapped_byte, sizeof(wrapped_byte)), -1);
+  const uint8_t wrapped_high_byte[] = {0x81, 0x80};
+  EXPECT_RET("rlp single byte of 0x80 wrapped",
+             decode(wrapped_high_byte, sizeof(wrapped_high_byte)), 0);
+
+  const uint8_t truncated[] = {0x83, 'a', 'b'};
+  EXPECT_RET("rlp string past the input",
+             decode(truncated, sizeof(truncated)), -1);
+  const uint8_t trailing[] = {0x05, 0x06};
+  EXPECT_RET("rlp bytes after the item", decode(trailing, sizeof(trailing)),
+             -1);
+
+  uint64_t value = 0;
+  const uint8_t zero_scalar[] = {0x82, 0x00, 0x01};
+  rlp_seg_t in = {zero_scalar, sizeof(zero_scalar)};
+  rlp_item_t item;
+  rlp_decode(in, &item);
+  EXPECT_RET("rlp scalar with a leading zero", rlp_uint64(&item, &value), -1);
+}
+
+/* tx_index 1, the key 0x01, in a leaf of the whole path */
+static void test_leaf() {
+  const uint8_t path[] = {0x20, 0x01};
+  uint8_t value[NODE_SIZE];
+  size_t value_size = build_receipt(value, 1, 1);
+  sizes[0] = build_short(nodes[0], path, sizeof(path), value, value_size);
+  build_proof(1);
+  EXPECT_RET("leaf proof", verify(1), CKB_SUCCESS);
+  EXPECT_RET("leaf proof receipt type", receipt.type, RECEIPT_TYPE);
+
+  uint8_t topic[ETH_HASH_SIZE];
+  memset(topic, 0xbb, ETH_HASH_SIZE);
+  eth_log_t log;
+  EXPECT_RET("log found", find_eth_log(&receipt, ADDRESS, topic, 0, &log),
+             CKB_SUCCESS);
+  EXPECT_RET("log data", log.data_size == 4 && log.data[0] == 0xdd, 1);
+  EXPECT_RET("no log past the first",
+             find_eth_log(&receipt, ADDRESS, topic, 1, &log),
+             ERROR_LOG_NOT_FOUND);
+
+  EXPECT_RET("leaf proof of another key", verify(2), ERROR_PROOF_KEY);
+
+  root[0] ^= 1;
+  EXPECT_RET("leaf proof of another root", verify(1), ERROR_PROOF_HASH);
+
+  /* Any node after the leaf, even one of the proof */
+  memcpy(nodes[1], nodes[0], sizes[0]);
+  sizes[1] = sizes[0];
+  build_proof(2);
+  EXPECT_RET("node trailing the leaf", verify(1), ERROR_PROOF_NODE);
+
+  value_size = build_receipt(value, 0, 1);
+  sizes[0] = build_short(nodes[0], path, sizeof(path), value, value_size);
+  build_proof(1);
+  EXPECT_RET("reverted receipt proof", verify(1), CKB_SUCCESS);
+  EXPECT_RET("reverted receipt logs",
+             find_eth_log(&receipt, ADDRESS, topic, 0, &log),
+             ERROR_RECEIPT_STATUS);
+}
+
+/*
+ * tx_index 1 again, a branch at nibble 0 of the key holding the leaf of
+ * the last nibble, under 32 bytes and so embedded in the branch.
+ */
+static void test_embedded() {
+  const uint8_t path[] = {0x31};
+  uint8_t value[NODE_SIZE];
+  size_t value_size = build_receipt(value, 1, 0);
+  uint8_t leaf[NODE_SIZE];
+  size_t leaf_size = build_short(leaf, path, sizeof(path), value, value_size);
+  EXPECT_RET("embedded leaf under 32 bytes", leaf_size < KECCAK256_HASH_SIZE,
+             1);
+  sizes[0] = build_branch(nodes[0], 0, leaf, leaf_size);
+  build_proof(1);
+  EXPECT_RET("embedded leaf proof", verify(1), CKB_SUCCESS);
+  /* Less the string prefix, the type and the list prefix */
+  EXPECT_RET("embedded leaf receipt", (int)receipt.fields_size,
+             (int)value_size - 3);
+  EXPECT_RET("embedded leaf of another key", verify(2), ERROR_PROOF_KEY);
+  /* The key 0x10 takes the empty slot 1 */
+  EXPECT_RET("empty slot", verify(0x10), ERROR_PROOF_KEY);
+
+  /* The proof list in the long form of a short length */
+  memmove(&proof[2], &proof[1], proof_size - 1);
+  proof[1] = proof[0] - RLP_LIST_SHORT;
+  proof[0] = RLP_LIST_LONG + 1;
+  proof_size++;
+  EXPECT_RET("proof in a non canonical list", verify(1), ERROR_RLP_ENCODING);
+}
+
+/*
+ * tx_index 0x81, the key 0x81 0x81: an extension of nibbles 8 1 to a
+ * branch, whose slot 8 is the hash of the leaf of the last nibble.
+ */
+static void test_extension() {
+  const uint8_t extension_path[] = {0x00, 0x81};
+  const uint8_t leaf_path[] = {0x31};
+  uint8_t value[NODE_SIZE];
+  size_t value_size = build_receipt(value, 1, 1);
+  sizes[2] =
+      build_short(nodes[2], leaf_path, sizeof(leaf_path), value, value_size);
+  uint8_t child[1 + KECCAK256_HASH_SIZE];
+  size_t child_size = hash_reference(2, child);
+  sizes[1] = build_branch(nodes[1], 8, child, child_size);
+  child_size = hash_reference(1, child);
+  sizes[0] = build_short(nodes[0], extension_path, sizeof(extension_path),
+                         child, child_size);
+  build_proof(3);
+  EXPECT_RET("extension proof", verify(0x81), CKB_SUCCESS);
+  /* The keys 0x82 0x01 0x00, 0x81 0x82 and 0x81 0x91 */
+  EXPECT_RET("extension proof of another extension key", verify(0x0100),
+             ERROR_PROOF_KEY);
+  EXPECT_RET("extension proof of another leaf key", verify(0x82),
+             ERROR_PROOF_KEY);
+  EXPECT_RET("extension proof through an empty slot", verify(0x91),
+             ERROR_PROOF_KEY);
+
+  /* The leaf swapped for another one, under the same parent hash */
+  value[value_size - 1] ^= 1;
+  sizes[2] =
+      build_short(nodes[2], leaf_path, sizeof(leaf_path), value, value_size);
+  build_proof(3);
+  EXPECT_RET("extension proof of another leaf", verify(0x81),
+             ERROR_PROOF_HASH);
+
+  /* A proof stopping at the branch */
+  build_proof(2);
+  EXPECT_RET("extension proof missing the leaf", verify(0x81),
+             ERROR_PROOF_NODE);
+}
+
+int main() {
+  test_rlp();
+  test_leaf();
+  test_embedded();
+  test_extension();
+  return test_failures == 0 ? 0 : 1;
+}
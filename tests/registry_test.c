@@ -0,0 +1,268 @@
+/*
+ * The crosschain_typescript registry and the crosschain_lockscript owner
+ * locks of its assets: creation is bound to its type id, records hold the
+ * UDT derived for their asset, UDT supply only changes for assets the
+ * update touches, every mint is bound to relayed messages and every burn
+ * is rate limited.
+ */
+#define main registry_main
+#include "crosschain_typescript.c"
+#undef main
+
+#define main owner_lock_main
+#include "crosschain_lockscript.c"
+#undef main
+
+#include "test.h"
+
+static const uint8_t REGISTRY_CODE_HASH[32] = {5};
+static const uint8_t OWNER_CODE_HASH[32] = {6};
+static const uint8_t UDT_CODE_HASH[32] = {7};
+static const uint8_t PLAIN_CODE_HASH[32] = {8};
+static const uint8_t ASSET_A[ASSET_ID_SIZE] = {0xa};
+static const uint8_t ASSET_B[ASSET_ID_SIZE] = {0xb};
+
+static uint8_t registry_type[MOCK_SCRIPT_SIZE];
+static uint64_t registry_type_size;
+static uint8_t registry_type_hash[UDT_HASH_SIZE];
+static uint8_t plain_lock[MOCK_SCRIPT_SIZE];
+static uint64_t plain_lock_size;
+/* Witness of the registry update */
+static const uint8_t *touched_ids;
+static uint32_t touched_ids_size;
+static uint8_t messages[8 * MESSAGE_SIZE];
+static uint32_t messages_size;
+
+/* The registry script with type_id, and the lock of every other cell */
+static void setup_scripts(const uint8_t *type_id) {
+  uint8_t args[REGISTRY_ARGS_SIZE] = {0};
+  memcpy(args, type_id, CKB_TYPE_ID_SIZE);
+  memcpy(&args[CKB_TYPE_ID_SIZE], OWNER_CODE_HASH, 32);
+  memcpy(&args[CKB_TYPE_ID_SIZE + SCRIPT_CODE_SIZE], UDT_CODE_HASH, 32);
+  registry_type_size = mock_script(registry_type, REGISTRY_CODE_HASH, 1,
+                                   args, sizeof(args));
+  mock_hash(registry_type, registry_type_size, registry_type_hash);
+  uint8_t plain_args[1] = {0};
+  plain_lock_size = mock_script(plain_lock, PLAIN_CODE_HASH, 0, plain_args,
+                                sizeof(plain_args));
+}
+
+static uint64_t owner_lock(const uint8_t *id, uint8_t *script) {
+  uint8_t args[UDT_HASH_SIZE + ASSET_ID_SIZE];
+  memcpy(args, registry_type_hash, UDT_HASH_SIZE);
+  memcpy(&args[UDT_HASH_SIZE], id, ASSET_ID_SIZE);
+  return mock_script(script, OWNER_CODE_HASH, 0, args, sizeof(args));
+}
+
+static uint64_t udt_type(const uint8_t *id, uint8_t *script) {
+  uint8_t lock[MOCK_SCRIPT_SIZE];
+  uint8_t owner_hash[UDT_HASH_SIZE];
+  mock_hash(lock, owner_lock(id, lock), owner_hash);
+  return mock_script(script, UDT_CODE_HASH, 0, owner_hash, UDT_HASH_SIZE);
+}
+
+static void set_lock(mock_cell_t *cell, const uint8_t *lock, uint64_t size) {
+  memcpy(cell->lock, lock, size);
+  cell->lock_size = size;
+}
+
+/* A registry cell holding one record of id with supply and caps */
+static void set_registry(mock_cell_t *cell, const uint8_t *id,
+                         uint128_t supply) {
+  set_lock(cell, plain_lock, plain_lock_size);
+  memcpy(cell->type, registry_type, registry_type_size);
+  cell->type_size = registry_type_size;
+  memset(cell->data, 0, REGISTRY_HEADER_SIZE + RECORD_SIZE);
+  cell->data_size = REGISTRY_HEADER_SIZE + RECORD_SIZE;
+  uint8_t *record = &cell->data[REGISTRY_HEADER_SIZE];
+  memcpy(record, id, ASSET_ID_SIZE);
+  uint8_t udt[MOCK_SCRIPT_SIZE];
+  mock_hash(udt, udt_type(id, udt), &record[RECORD_UDT_HASH]);
+  registry_set_amount(record, RECORD_SUPPLY, supply);
+  registry_set_amount(record, RECORD_CAP, 1000);
+  registry_set_amount(record, RECORD_WITHDRAW_CAP, 100);
+}
+
+static void set_udt(mock_cell_t *cell, const uint8_t *id, uint128_t amount) {
+  set_lock(cell, plain_lock, plain_lock_size);
+  cell->type_size = udt_type(id, cell->type);
+  memcpy(cell->data, &amount, AMOUNT_SIZE);
+  cell->data_size = AMOUNT_SIZE;
+}
+
+static void run_registry(const char *name, int expected) {
+  memcpy(mock_tx.script, registry_type, registry_type_size);
+  mock_tx.script_size = registry_type_size;
+  mock_tx.script_is_type = 1;
+  EXPECT_RET(name, registry_main(), expected);
+}
+
+static void run_owner_lock(const char *name, const uint8_t *id,
+                           int expected) {
+  mock_tx.script_size = owner_lock(id, mock_tx.script);
+  mock_tx.script_is_type = 0;
+  EXPECT_RET(name, owner_lock_main(), expected);
+}
+
+/* A registry created from input 0, whose out point is seed */
+static void setup_create(uint8_t seed) {
+  mock_reset();
+  mock_tx.input_count = mock_tx.output_count = 1;
+  mock_tx.inputs[0].out_point[0] = seed;
+  uint8_t input[MOCK_CELL_INPUT_SIZE] = {0};
+  memcpy(&input[8], mock_tx.inputs[0].out_point, MOCK_OUT_POINT_SIZE);
+  uint8_t index[8] = {0};
+  uint8_t type_id[CKB_TYPE_ID_SIZE];
+  blake2b_state state;
+  blake2b_init(&state, CKB_TYPE_ID_SIZE);
+  blake2b_update(&state, input, sizeof(input));
+  blake2b_update(&state, index, sizeof(index));
+  blake2b_final(&state, type_id, CKB_TYPE_ID_SIZE);
+  setup_scripts(type_id);
+  set_lock(&mock_tx.inputs[0], plain_lock, plain_lock_size);
+  set_registry(&mock_tx.outputs[0], ASSET_A, 0);
+}
+
+/* Issues amount of asset id, listing the ids of touched */
+static void setup_mint(const uint8_t *id, uint128_t amount,
+                       const uint8_t *touched, uint32_t touched_size) {
+  mock_reset();
+  uint8_t type_id[CKB_TYPE_ID_SIZE] = {1};
+  setup_scripts(type_id);
+  mock_tx.input_count = mock_tx.output_count = 2;
+  set_registry(&mock_tx.inputs[0], id, 0);
+  set_registry(&mock_tx.outputs[0], id, touched_size > 0 ? amount : 0);
+  mock_tx.inputs[1].lock_size = owner_lock(id, mock_tx.inputs[1].lock);
+  set_udt(&mock_tx.outputs[1], id, amount);
+  touched_ids = touched;
+  touched_ids_size = touched_size;
+  messages_size = 0;
+  mock_witness(0, NULL, 0, touched, touched_size, NULL, 0);
+}
+
+/* Relays message id minting amount of asset in the update */
+static void relay(uint64_t id, const uint8_t *asset, uint128_t amount) {
+  uint8_t *message = &messages[messages_size];
+  memcpy(message, &id, MESSAGE_ID_SIZE);
+  memcpy(&message[MESSAGE_ASSET], asset, ASSET_ID_SIZE);
+  memcpy(&message[MESSAGE_AMOUNT], &amount, AMOUNT_SIZE);
+  messages_size += MESSAGE_SIZE;
+  mock_tx.outputs[0].data[8 + id / 8] |= 1 << (id % 8);
+  mock_witness(0, NULL, 0, touched_ids, touched_ids_size, messages,
+               messages_size);
+}
+
+/*
+ * Burns amount of asset A from a supply of 200 in epoch 10, listing the
+ * ids of touched, with the withdrawal recorded in the new registry.
+ */
+static void setup_burn(uint128_t amount, const uint8_t *touched,
+                       uint32_t touched_size) {
+  mock_reset();
+  uint8_t type_id[CKB_TYPE_ID_SIZE] = {1};
+  setup_scripts(type_id);
+  mock_tx.input_count = 3;
+  mock_tx.output_count = 1;
+  set_registry(&mock_tx.inputs[0], ASSET_A, 200);
+  uint64_t since = SINCE_EPOCH_FLAGS | 10;
+  mock_tx.inputs[0].since = since;
+  mock_tx.inputs[1].lock_size = owner_lock(ASSET_A, mock_tx.inputs[1].lock);
+  set_udt(&mock_tx.inputs[2], ASSET_A, amount);
+  set_registry(&mock_tx.outputs[0], ASSET_A, 200);
+  if (touched_size > 0) {
+    uint8_t *record = &mock_tx.outputs[0].data[REGISTRY_HEADER_SIZE];
+    registry_set_amount(record, RECORD_SUPPLY, 200 - amount);
+    memcpy(&record[RECORD_LAST_SINCE], &since, SINCE_SIZE);
+    registry_set_amount(record, RECORD_WINDOW_SUM, amount);
+    registry_set_amount(record, RECORD_RING + (10 % RATE_EPOCHS) * AMOUNT_SIZE,
+                        amount);
+  }
+  mock_witness(0, NULL, 0, touched, touched_size, NULL, 0);
+}
+
+int main() {
+  setup_create(1);
+  run_registry("create", CKB_SUCCESS);
+
+  setup_create(1);
+  mock_tx.inputs[0].out_point[0] = 2;
+  run_registry("create from another input", CKB_TYPE_ID_ERROR_MISMATCH);
+
+  setup_create(1);
+  mock_tx.outputs[0].data[REGISTRY_HEADER_SIZE + RECORD_UDT_HASH] ^= 1;
+  run_registry("create with a foreign UDT", ERROR_REGISTRY_RECORD);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 50);
+  run_registry("listed mint", CKB_SUCCESS);
+  run_owner_lock("owner of listed mint", ASSET_A, CKB_SUCCESS);
+  run_owner_lock("owner of another asset", ASSET_B, ERROR_ASSET_NOT_TOUCHED);
+
+  setup_mint(ASSET_A, 50, NULL, 0);
+  run_registry("unlisted mint", ERROR_REGISTRY_UNLISTED);
+  run_owner_lock("owner of unlisted mint", ASSET_A, ERROR_ASSET_NOT_TOUCHED);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  set_udt(&mock_tx.inputs[0], ASSET_A, 0);
+  run_owner_lock("owner without the registry first", ASSET_A,
+                 ERROR_1ST_CELL_TYPE_HASH_NOT_MATCH);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 20);
+  relay(1, ASSET_A, 30);
+  run_registry("mint of two messages", CKB_SUCCESS);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  run_registry("mint without a message", ERROR_RELAY_AMOUNT);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 40);
+  run_registry("mint above its messages", ERROR_RELAY_AMOUNT);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 50);
+  relay(1, ASSET_B, 10);
+  run_registry("message of an untouched asset", ERROR_RELAY_AMOUNT);
+
+  setup_mint(ASSET_A, 0, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 50);
+  run_registry("message without a mint", ERROR_RELAY_AMOUNT);
+
+  setup_mint(ASSET_A, 50, ASSET_A, ASSET_ID_SIZE);
+  relay(0, ASSET_A, 25);
+  relay(0, ASSET_A, 25);
+  run_registry("message relayed twice", ERROR_RELAY_REPLAY);
+
+  setup_burn(30, ASSET_A, ASSET_ID_SIZE);
+  run_registry("listed burn", CKB_SUCCESS);
+  run_owner_lock("owner of listed burn", ASSET_A, CKB_SUCCESS);
+
+  setup_burn(150, ASSET_A, ASSET_ID_SIZE);
+  run_registry("listed burn above the limit", ERROR_RATE_LIMIT);
+
+  setup_burn(150, NULL, 0);
+  run_registry("unlisted burn", ERROR_REGISTRY_UNLISTED);
+  run_owner_lock("owner of unlisted burn", ASSET_A, ERROR_ASSET_NOT_TOUCHED);
+
+  /* Inserting asset B next to A with a UDT not derived for it */
+  setup_mint(ASSET_A, 0, ASSET_B, ASSET_ID_SIZE);
+  mock_tx.input_count = mock_tx.output_count = 1;
+  uint8_t *records = &mock_tx.outputs[0].data[REGISTRY_HEADER_SIZE];
+  memcpy(&records[RECORD_SIZE], records, RECORD_SIZE);
+  memcpy(&records[RECORD_SIZE], ASSET_B, ASSET_ID_SIZE);
+  mock_tx.outputs[0].data_size += RECORD_SIZE;
+  run_registry("insert with a foreign UDT", ERROR_REGISTRY_RECORD);
+  uint8_t udt[MOCK_SCRIPT_SIZE];
+  mock_hash(udt, udt_type(ASSET_B, udt),
+            &records[RECORD_SIZE + RECORD_UDT_HASH]);
+  run_registry("insert", CKB_SUCCESS);
+
+  /* Destroying the registry while spending an owner cell */
+  setup_mint(ASSET_A, 0, ASSET_A, ASSET_ID_SIZE);
+  mock_tx.output_count = 0;
+  run_registry("destroy with an owner cell", ERROR_REGISTRY_UNLISTED);
+  mock_tx.input_count = 1;
+  run_registry("destroy", CKB_SUCCESS);
+
+  return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+ * secp256k1_schnorr_sighash_all_lib against the BIP340 test vectors, so a
+ * bump of deps/secp256k1 can not silently change what verify_signature
+ * and the batch verifier accept. The batch signatures are BIP340
+ * signatures of vector 1's message, made with aux_rand 0 by the secret
+ * keys of vectors 0 to 2.
+ */
+#include "secp256k1_schnorr_sighash_all_lib.c"
+
+#include "test.h"
+
+#define MESSAGE_SIZE CKB_SIGHASH_ALL_MESSAGE_SIZE
+#define PUBKEY_SIZE SECP256K1_SCHNORR_PUBKEY_SIZE
+#define SIGNATURE_SIZE SECP256K1_SCHNORR_SIGNATURE_SIZE
+
+typedef struct {
+  const char *name;
+  const char *pubkey;
+  const char *message;
+  const char *signature;
+  int expected;
+} vector_t;
+
+#define MESSAGE_0 \
+  "0000000000000000000000000000000000000000000000000000000000000000"
+#define MESSAGE_1 \
+  "243F6A8885A308D313198A2E03707344A4093822299F31D0082EFA98EC4E6C89"
+#define PUBKEY_0 \
+  "F9308A019258C31049344F85F89D5229B531C845836F99B08601F113BCE036F9"
+#define PUBKEY_1 \
+  "DFF1D77F2A671C5F36183726DB2341BE58FEAE1DA2DECED843240F7B502BA659"
+#define PUBKEY_2 \
+  "DD308AFEC5777E13121FA72B9CC1B7CC0139715309B086C960E18FD969774EB8"
+#define R_1 "6896BD60EEAE296DB48A229FF71DFE071BDE413E6D43F917DC8DCF8C78DE3341"
+#define S_1 "8906D11AC976ABCCB20B091292BFF4EA897EFCB639EA871CFA95F6DE339E4B0A"
+
+static const vector_t VECTORS[] = {
+    {"vector 0", PUBKEY_0, MESSAGE_0,
+     "E907831F80848D1069A5371B402410364BDF1C5F8307B0084C55F1CE2DCA8215"
+     "25F66A4A85EA8B71E482A74F382D2CE5EBEEE8FDB2172F477DF4900D310536C0",
+     CKB_SUCCESS},
+    {"vector 1", PUBKEY_1, MESSAGE_1, R_1 S_1, CKB_SUCCESS},
+    {"vector 2", PUBKEY_2,
+     "7E2D58D8B3BCDF1ABADEC7829054F90DDA9805AAB56C77333024B9D0A508B75C",
+     "5831AAEED7B44BB74E5EAB94BA9D4294C49BCF2A60728D8B4C200F50DD313C1B"
+     "AB745879A5AD954A72C45A91C3A51D3C7ADEA98D82F8481E0E1E03674A6F3FB7",
+     CKB_SUCCESS},
+    {"vector 3",
+     "25D1DFF95105F5253C4022F628A996AD3A0D95FBF21D468A1B33F8C160D8F517",
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+     "7EB0509757E246F19449885651611CB965ECC1A187DD51B64FDA1EDC9637D5EC"
+     "97582B9CB13DB3933705B32BA982AF5AF25FD78881EBB32771FC5922EFC66EA3",
+     CKB_SUCCESS},
+    {"vector 4",
+     "D69C3509BB99E412E68B0FE8544E72837DFA30746D8BE2AA65975F29D22DC7B9",
+     "4DF3C3F68FCC83B27E9D42C90431A72499F17875C81A599B566C9889B9696703",
+     "00000000000000000000003B78CE563F89A0ED9414F5AA28AD0D96D6795F9C63"
+     "76AFB1548AF603B3EB45C9F8207DEE1060CB71C04E80F593060B07D28308D7F4",
+     CKB_SUCCESS},
+    {"vector 5, pubkey not on the curve",
+     "EEFDEA4CDB677750A420FEE807EACF21EB9898AE79B9768766E4FAA04A2D4A34",
+     MESSAGE_1, R_1 S_1, ERROR_SCHNORR_PARSE_PUBKEY},
+    {"vector 6, R with odd y", PUBKEY_1, MESSAGE_1,
+     "FFF97BD5755EEEA420453A14355235D382F6472F8568A18B2F057A1460297556"
+     "3CC27944640AC607CD107AE10923D9EF7A73C643E166BE5EBEAFA34B1AC553E2",
+     ERROR_SCHNORR_VERIFY},
+    {"vector 7, negated message", PUBKEY_1, MESSAGE_1,
+     "1FA62E331EDBC21C394792D2AB1100A7B432B013DF3F6FF4F99FCB33E0E1515F"
+     "28890B3EDB6E7189B630448B515CE4F8622A954CFE545735AAEA5134FCCDB2BD",
+     ERROR_SCHNORR_VERIFY},
+    {"vector 8, negated s", PUBKEY_1, MESSAGE_1,
+     "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E177769"
+     "961764B3AA9B2FFCB6EF947B6887A226E8D7C93E00C5ED0C1834FF0D0C2E6DA6",
+     ERROR_SCHNORR_VERIFY},
+    {"vector 9, sG - eP at infinity", PUBKEY_1, MESSAGE_1,
+     "0000000000000000000000000000000000000000000000000000000000000000"
+     "123DDA8328AF9C23A94C1FEECFD123BA4FB73476F0D594DCB65C6425BD186051",
+     ERROR_SCHNORR_VERIFY},
+    {"vector 10, sG - eP at infinity", PUBKEY_1, MESSAGE_1,
+     "0000000000000000000000000000000000000000000000000000000000000001"
+     "7615FBAF5AE28864013C099742DEADB4DBA87F11AC6754F93780D5A1837CF197",
+     ERROR_SCHNORR_VERIFY},
+    {"r not an x coordinate", PUBKEY_1, MESSAGE_1,
+     "4A298DACAE57395A15D0795DDBFD1DCB564DA82B0F269BC70A74F8220429BA1D" S_1,
+     ERROR_SCHNORR_VERIFY},
+    {"r equal to p", PUBKEY_1, MESSAGE_1,
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F" S_1,
+     ERROR_SCHNORR_VERIFY},
+    {"s equal to n", PUBKEY_1, MESSAGE_1,
+     R_1 "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141",
+     ERROR_SCHNORR_VERIFY},
+    {"pubkey past p",
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC30",
+     MESSAGE_1, R_1 S_1, ERROR_SCHNORR_PARSE_PUBKEY},
+};
+
+#define BATCH_COUNT 3
+static const char *BATCH_PUBKEYS[BATCH_COUNT] = {PUBKEY_0, PUBKEY_1,
+                                                 PUBKEY_2};
+static const char *BATCH_SIGNATURES[BATCH_COUNT] = {
+    "E20CA2B31DEC2D9F3455832295F820045B6171086402EF794691A56E00F40960"
+    "967B20F1C685F13397694B6061A52E8A9CB5C2C296150DDF762D5309B61DA38E",
+    "EB8EADC001FA1F3D08F19DB7027DDB0AFFA61C0357D4B577F8BB1978837382C8"
+    "5AE9CCC675360D9055CB2A2BDA001BC5C62DF9B5ED936CACCFD00B169EDE131D",
+    "BDF4E74C5C1D74C56F802FB00B5A5695A27EB69E08E792377F6EB0DB1F41B5C1"
+    "D36B23FC961858C6469BAF5E06B7EEA7B66F0970E5FBFA22366A7C77A439BA55",
+};
+
+static void from_hex(const char *hex, uint8_t *out, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    unsigned int byte;
+    sscanf(&hex[2 * i], "%2x", &byte);
+    out[i] = (uint8_t)byte;
+  }
+}
+
+static uint8_t message[MESSAGE_SIZE];
+static uint8_t pubkeys[BATCH_COUNT * PUBKEY_SIZE];
+static uint8_t signatures[BATCH_COUNT * SIGNATURE_SIZE];
+
+static void set_batch() {
+  from_hex(MESSAGE_1, message, MESSAGE_SIZE);
+  for (size_t i = 0; i < BATCH_COUNT; i++) {
+    from_hex(BATCH_PUBKEYS[i], &pubkeys[i * PUBKEY_SIZE], PUBKEY_SIZE);
+    from_hex(BATCH_SIGNATURES[i], &signatures[i * SIGNATURE_SIZE],
+             SIGNATURE_SIZE);
+  }
+}
+
+int main() {
+  secp256k1_context *context =
+      secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+
+  for (size_t i = 0; i < sizeof(VECTORS) / sizeof(VECTORS[0]); i++) {
+    uint8_t pubkey[PUBKEY_SIZE];
+    uint8_t signature[SIGNATURE_SIZE];
+    from_hex(VECTORS[i].pubkey, pubkey, PUBKEY_SIZE);
+    from_hex(VECTORS[i].message, message, MESSAGE_SIZE);
+    from_hex(VECTORS[i].signature, signature, SIGNATURE_SIZE);
+    EXPECT_RET(VECTORS[i].name,
+               verify_signature(context, message, pubkey, signature),
+               VECTORS[i].expected);
+  }
+
+  set_batch();
+  for (size_t i = 0; i < BATCH_COUNT; i++) {
+    EXPECT_RET("batch signature alone",
+               verify_signature(context, message, &pubkeys[i * PUBKEY_SIZE],
+                                &signatures[i * SIGNATURE_SIZE]),
+               CKB_SUCCESS);
+  }
+  EXPECT_RET("batch", verify_batch(context, message, pubkeys, signatures,
+                                   BATCH_COUNT),
+             CKB_SUCCESS);
+
+  set_batch();
+  signatures[SIGNATURE_SIZE + 40] ^= 1;
+  EXPECT_RET("batch with a corrupted s",
+             verify_batch(context, message, pubkeys, signatures, BATCH_COUNT),
+             ERROR_SCHNORR_VERIFY);
+
+  /* Each equation fails on its own, only their plain sum would hold */
+  set_batch();
+  uint8_t s[32];
+  memcpy(s, &signatures[32], 32);
+  memcpy(&signatures[32], &signatures[SIGNATURE_SIZE + 32], 32);
+  memcpy(&signatures[SIGNATURE_SIZE + 32], s, 32);
+  EXPECT_RET("batch with swapped s",
+             verify_batch(context, message, pubkeys, signatures, BATCH_COUNT),
+             ERROR_SCHNORR_VERIFY);
+
+  set_batch();
+  from_hex(VECTORS[6].signature, &signatures[SIGNATURE_SIZE], SIGNATURE_SIZE);
+  EXPECT_RET("batch with an R of odd y",
+             verify_batch(context, message, pubkeys, signatures, BATCH_COUNT),
+             ERROR_SCHNORR_VERIFY);
+
+  set_batch();
+  from_hex(VECTORS[5].pubkey, &pubkeys[2 * PUBKEY_SIZE], PUBKEY_SIZE);
+  EXPECT_RET("batch with a pubkey off the curve",
+             verify_batch(context, message, pubkeys, signatures, BATCH_COUNT),
+             ERROR_SCHNORR_PARSE_PUBKEY);
+
+  set_batch();
+  EXPECT_RET("empty batch",
+             validate_secp256k1_schnorr_sighash_all_batch(NULL, pubkeys,
+                                                          signatures, 0),
+             ERROR_SCHNORR_BATCH_SIZE);
+  EXPECT_RET("batch past the maximum",
+             validate_secp256k1_schnorr_sighash_all_batch(
+                 NULL, pubkeys, signatures, SECP256K1_SCHNORR_BATCH_MAX + 1),
+             ERROR_SCHNORR_BATCH_SIZE);
+
+  secp256k1_context_destroy(context);
+  return test_failures == 0 ? 0 : 1;
+}
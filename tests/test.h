@@ -0,0 +1,26 @@
+/*
+ * Checks shared by the host tests in tests/. Each test sets up mock_tx (see
+ * tests/mock/ckb_syscalls.h), runs the script's main and compares its exit
+ * code with the expected one. A test binary exits non-zero if any check
+ * failed, see `make test`.
+ */
+#ifndef CKB_TEST_H_
+#define CKB_TEST_H_
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define EXPECT_RET(name, actual, expected)                          \
+  do {                                                              \
+    int actual_ = (actual);                                         \
+    if (actual_ != (expected)) {                                    \
+      printf("FAIL %s: returned %d, expected %d\n", (name), actual_, \
+             (expected));                                           \
+      test_failures++;                                              \
+    } else {                                                        \
+      printf("ok %s\n", (name));                                    \
+    }                                                               \
+  } while (0)
+
+#endif